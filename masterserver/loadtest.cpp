@@ -0,0 +1,499 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Master Server Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: loadtest.cpp
+//
+// Description: Load generator for the master server. Simulates thousands of
+// servers and launchers on loopback, all from a single socket: every simulated
+// host gets its own 127.x.y.z address (Linux routes all of 127.0.0.0/8 to the
+// loopback device), which is picked per datagram with IP_PKTINFO.
+//
+// Servers register, answer the verification request, acknowledge the ban list
+// and keep sending heartbeats. Launchers request the server list at the given
+// rate, and the time until the last part of the list arrived is measured.
+//
+// Usage: master-loadtest [-servers N] [-launchers N] [-rate queries/s]
+//        [-time seconds] [-master address:port]
+//
+//-----------------------------------------------------------------------------
+
+#include "../src/networkheaders.h"
+#include "../src/networkshared.h"
+#include "../src/huffman/huffman.h"
+
+#ifdef __linux__
+
+#include <poll.h>
+#include <chrono>
+#include <vector>
+#include <string>
+
+//*****************************************************************************
+//	DEFINES
+
+// How often the simulated servers send a heartbeat (seconds).
+#define	LOADTEST_HEARTBEAT_INTERVAL		10
+
+// The second octet of the addresses of the simulated servers and launchers.
+#define	LOADTEST_SERVER_NETWORK			1
+#define	LOADTEST_LAUNCHER_NETWORK		2
+
+//*****************************************************************************
+//	STRUCTURES
+
+typedef struct
+{
+	// Our verification string, the master sends it back with everything it sends us.
+	std::string		VerificationString;
+
+	// When we send the next heartbeat (seconds since the start).
+	double			dNextHeartbeat;
+
+	// Did the master send us the ban list yet?
+	bool			bReceivedBanList;
+
+} LOADTEST_SERVER_s;
+
+typedef struct
+{
+	// When we sent the last query (seconds since the start), negative if there is no open query.
+	double			dQueryTime;
+
+	// How many servers we received in the reply to the open query.
+	unsigned int	ulNumServers;
+
+} LOADTEST_LAUNCHER_s;
+
+//*****************************************************************************
+//	VARIABLES
+
+static	SOCKET			g_Socket;
+static	sockaddr_in		g_MasterAddress;
+static	USHORT			g_usLocalPort;
+static	std::chrono::steady_clock::time_point	g_StartTime;
+
+static	NETBUFFER_s		g_SendBuffer;
+static	UCHAR			g_ucHuffmanBuffer[MAX_UDP_PACKET * 4];
+static	UCHAR			g_ucDecodeBuffer[MAX_UDP_PACKET * 4];
+
+static	std::vector<LOADTEST_SERVER_s>		g_Servers;
+static	std::vector<LOADTEST_LAUNCHER_s>	g_Launchers;
+
+// Statistics.
+static	unsigned long	g_ulQueriesSent = 0;
+static	unsigned long	g_ulListsReceived = 0;
+static	unsigned long	g_ulListPacketsReceived = 0;
+static	unsigned long	g_ulQueriesRefused = 0;
+static	unsigned long	g_ulServersVerified = 0;
+static	unsigned int	g_ulServersInLastList = 0;
+static	double			g_dTotalLatency = 0;
+static	double			g_dMaxLatency = 0;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static double loadtest_GetTime( void )
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now( ) - g_StartTime ).count( );
+}
+
+//*****************************************************************************
+//
+// Returns the (network byte order) address of the given simulated host.
+static in_addr_t loadtest_GetHostAddress( const int iNetwork, const unsigned int ulIdx )
+{
+	return htonl(( 127u << 24 ) | ( static_cast<unsigned int>( iNetwork ) << 16 ) | (( ulIdx / 250 ) << 8 ) | ( ulIdx % 250 + 1 ));
+}
+
+//*****************************************************************************
+//
+// Huffman-encodes g_SendBuffer and sends it to the master, from the given address.
+static void loadtest_SendToMaster( const in_addr_t SourceAddress )
+{
+	int iNumBytesOut = sizeof( g_ucHuffmanBuffer );
+	g_SendBuffer.ulCurrentSize = g_SendBuffer.CalcSize( );
+	HUFFMAN_Encode( g_SendBuffer.pbData, g_ucHuffmanBuffer, g_SendBuffer.ulCurrentSize, &iNumBytesOut );
+
+	struct iovec vector;
+	vector.iov_base = g_ucHuffmanBuffer;
+	vector.iov_len = iNumBytesOut;
+
+	char control[CMSG_SPACE( sizeof( struct in_pktinfo ))];
+	memset( control, 0, sizeof( control ));
+
+	struct msghdr header;
+	memset( &header, 0, sizeof( header ));
+	header.msg_name = &g_MasterAddress;
+	header.msg_namelen = sizeof( g_MasterAddress );
+	header.msg_iov = &vector;
+	header.msg_iovlen = 1;
+	header.msg_control = control;
+	header.msg_controllen = sizeof( control );
+
+	// Send from the simulated host's address.
+	struct cmsghdr *pControlMessage = CMSG_FIRSTHDR( &header );
+	pControlMessage->cmsg_level = IPPROTO_IP;
+	pControlMessage->cmsg_type = IP_PKTINFO;
+	pControlMessage->cmsg_len = CMSG_LEN( sizeof( struct in_pktinfo ));
+	reinterpret_cast<struct in_pktinfo *>( CMSG_DATA( pControlMessage ))->ipi_spec_dst.s_addr = SourceAddress;
+
+	if ( sendmsg( g_Socket, &header, 0 ) == -1 && ( errno != EWOULDBLOCK ))
+		printf( "loadtest_SendToMaster: %s\n", strerror( errno ));
+}
+
+//*****************************************************************************
+//
+static void loadtest_SendHeartbeat( const unsigned int ulIdx )
+{
+	g_SendBuffer.Clear( );
+	g_SendBuffer.ByteStream.WriteLong( SERVER_MASTER_CHALLENGE );
+	g_SendBuffer.ByteStream.WriteString( g_Servers[ulIdx].VerificationString.c_str( ));
+	g_SendBuffer.ByteStream.WriteByte( 1 ); // We enforce the master ban list.
+	g_SendBuffer.ByteStream.WriteLong( 9999 ); // Our revision.
+	loadtest_SendToMaster( loadtest_GetHostAddress( LOADTEST_SERVER_NETWORK, ulIdx ));
+}
+
+//*****************************************************************************
+//
+static void loadtest_SendQuery( const unsigned int ulIdx )
+{
+	g_SendBuffer.Clear( );
+	g_SendBuffer.ByteStream.WriteLong( LAUNCHER_MASTER_CHALLENGE );
+	g_SendBuffer.ByteStream.WriteShort( MASTER_SERVER_VERSION );
+	loadtest_SendToMaster( loadtest_GetHostAddress( LOADTEST_LAUNCHER_NETWORK, ulIdx ));
+
+	g_Launchers[ulIdx].dQueryTime = loadtest_GetTime( );
+	g_Launchers[ulIdx].ulNumServers = 0;
+	g_ulQueriesSent++;
+}
+
+//*****************************************************************************
+//
+// Handles something the master sent to one of our servers.
+static void loadtest_ParseServerPacket( const unsigned int ulIdx, BYTESTREAM_s *pByteStream )
+{
+	const int iCommand = pByteStream->ReadByte( );
+	const std::string VerificationString = pByteStream->ReadString( );
+
+	switch ( iCommand )
+	{
+	case MASTER_SERVER_VERIFICATION:
+		{
+			const int iVerificationInt = pByteStream->ReadLong( );
+
+			g_SendBuffer.Clear( );
+			g_SendBuffer.ByteStream.WriteLong( SERVER_MASTER_VERIFICATION );
+			g_SendBuffer.ByteStream.WriteString( VerificationString.c_str( ));
+			g_SendBuffer.ByteStream.WriteLong( iVerificationInt );
+			loadtest_SendToMaster( loadtest_GetHostAddress( LOADTEST_SERVER_NETWORK, ulIdx ));
+		}
+		break;
+	case MASTER_SERVER_BANLISTPART:
+
+		if ( g_Servers[ulIdx].bReceivedBanList == false )
+		{
+			g_Servers[ulIdx].bReceivedBanList = true;
+			g_ulServersVerified++;
+		}
+
+		// Just acknowledge every part, the master doesn't mind.
+		g_SendBuffer.Clear( );
+		g_SendBuffer.ByteStream.WriteLong( SERVER_MASTER_BANLIST_RECEIPT );
+		g_SendBuffer.ByteStream.WriteString( VerificationString.c_str( ));
+		loadtest_SendToMaster( loadtest_GetHostAddress( LOADTEST_SERVER_NETWORK, ulIdx ));
+		break;
+	}
+}
+
+//*****************************************************************************
+//
+// Handles something the master sent to one of our launchers.
+static void loadtest_ParseLauncherPacket( const unsigned int ulIdx, BYTESTREAM_s *pByteStream )
+{
+	LOADTEST_LAUNCHER_s &launcher = g_Launchers[ulIdx];
+
+	switch ( pByteStream->ReadLong( ))
+	{
+	case MSC_BEGINSERVERLISTPART:
+
+		g_ulListPacketsReceived++;
+		pByteStream->ReadByte( ); // Packet number.
+
+		while ( true )
+		{
+			const int iCommand = pByteStream->ReadByte( );
+
+			if ( iCommand == MSC_SERVERBLOCK )
+			{
+				int iNumPorts;
+				while (( iNumPorts = pByteStream->ReadByte( )) > 0 )
+				{
+					for ( int i = 0; i < 4; ++i )
+						pByteStream->ReadByte( );
+					for ( int i = 0; i < iNumPorts; ++i )
+						pByteStream->ReadShort( );
+
+					launcher.ulNumServers += iNumPorts;
+				}
+			}
+			else if (( iCommand == MSC_ENDSERVERLIST ) && ( launcher.dQueryTime >= 0 ))
+			{
+				const double dLatency = loadtest_GetTime( ) - launcher.dQueryTime;
+				g_dTotalLatency += dLatency;
+				g_dMaxLatency = std::max( g_dMaxLatency, dLatency );
+				g_ulListsReceived++;
+				g_ulServersInLastList = launcher.ulNumServers;
+				launcher.dQueryTime = -1;
+				return;
+			}
+			else
+				return;
+		}
+
+	case MSC_REQUESTIGNORED:
+	case MSC_IPISBANNED:
+	case MSC_WRONGVERSION:
+
+		g_ulQueriesRefused++;
+		launcher.dQueryTime = -1;
+		return;
+	}
+}
+
+//*****************************************************************************
+//
+// Reads everything that arrived and hands it to the simulated host it was sent to.
+static void loadtest_ReceivePackets( void )
+{
+	while ( true )
+	{
+		struct iovec vector;
+		vector.iov_base = g_ucHuffmanBuffer;
+		vector.iov_len = sizeof( g_ucHuffmanBuffer );
+
+		char control[CMSG_SPACE( sizeof( struct in_pktinfo ))];
+		sockaddr_in from;
+
+		struct msghdr header;
+		memset( &header, 0, sizeof( header ));
+		header.msg_name = &from;
+		header.msg_namelen = sizeof( from );
+		header.msg_iov = &vector;
+		header.msg_iovlen = 1;
+		header.msg_control = control;
+		header.msg_controllen = sizeof( control );
+
+		const ssize_t numBytes = recvmsg( g_Socket, &header, 0 );
+		if ( numBytes <= 0 )
+			return;
+
+		// Find out which of our addresses this was sent to.
+		in_addr_t destination = 0;
+		for ( struct cmsghdr *pControlMessage = CMSG_FIRSTHDR( &header ); pControlMessage; pControlMessage = CMSG_NXTHDR( &header, pControlMessage ))
+		{
+			if (( pControlMessage->cmsg_level == IPPROTO_IP ) && ( pControlMessage->cmsg_type == IP_PKTINFO ))
+				destination = ntohl( reinterpret_cast<struct in_pktinfo *>( CMSG_DATA( pControlMessage ))->ipi_addr.s_addr );
+		}
+
+		const int iNetwork = ( destination >> 16 ) & 0xFF;
+		const unsigned int ulIdx = (( destination >> 8 ) & 0xFF ) * 250 + ( destination & 0xFF ) - 1;
+
+		int iDecodedNumBytes = sizeof( g_ucDecodeBuffer );
+		HUFFMAN_Decode( g_ucHuffmanBuffer, g_ucDecodeBuffer, static_cast<int>( numBytes ), &iDecodedNumBytes );
+
+		BYTESTREAM_s byteStream;
+		byteStream.pbStream = g_ucDecodeBuffer;
+		byteStream.pbStreamEnd = g_ucDecodeBuffer + iDecodedNumBytes;
+
+		if (( iNetwork == LOADTEST_SERVER_NETWORK ) && ( ulIdx < g_Servers.size( )))
+			loadtest_ParseServerPacket( ulIdx, &byteStream );
+		else if (( iNetwork == LOADTEST_LAUNCHER_NETWORK ) && ( ulIdx < g_Launchers.size( )))
+			loadtest_ParseLauncherPacket( ulIdx, &byteStream );
+	}
+}
+
+//*****************************************************************************
+//
+static void loadtest_PrintStatistics( const double dTime )
+{
+	printf( "%6.1fs: %lu/%lu servers listed, %lu queries, %lu lists (%lu packets, %u servers in the last one), %lu refused, latency %.2f ms avg / %.2f ms max\n",
+		dTime, g_ulServersVerified, static_cast<unsigned long>( g_Servers.size( )), g_ulQueriesSent, g_ulListsReceived, g_ulListPacketsReceived,
+		g_ulServersInLastList, g_ulQueriesRefused, ( g_ulListsReceived > 0 ) ? ( 1000.0 * g_dTotalLatency / g_ulListsReceived ) : 0.0, 1000.0 * g_dMaxLatency );
+}
+
+//*****************************************************************************
+//
+int main( int argc, char **argv )
+{
+	unsigned int	ulNumServers = 1000;
+	unsigned int	ulNumLaunchers = 2000;
+	double			dQueriesPerSecond = 40;
+	double			dDuration = 60;
+	const char		*pszMaster = "127.0.0.1";
+
+	for ( int i = 1; i + 1 < argc; i += 2 )
+	{
+		if ( stricmp( argv[i], "-servers" ) == 0 )
+			ulNumServers = atoi( argv[i + 1] );
+		else if ( stricmp( argv[i], "-launchers" ) == 0 )
+			ulNumLaunchers = atoi( argv[i + 1] );
+		else if ( stricmp( argv[i], "-rate" ) == 0 )
+			dQueriesPerSecond = atof( argv[i + 1] );
+		else if ( stricmp( argv[i], "-time" ) == 0 )
+			dDuration = atof( argv[i + 1] );
+		else if ( stricmp( argv[i], "-master" ) == 0 )
+			pszMaster = argv[i + 1];
+	}
+
+	// Each simulated host needs its own address in 127.x.0.0/16.
+	ulNumServers = std::min( ulNumServers, 250u * 256u );
+	ulNumLaunchers = std::min( ulNumLaunchers, 250u * 256u );
+
+	NETADDRESS_s MasterAddress;
+	if ( MasterAddress.LoadFromString( pszMaster ) == false )
+	{
+		printf( "Invalid master server address: %s\n", pszMaster );
+		return ( 1 );
+	}
+	if ( MasterAddress.usPort == 0 )
+		MasterAddress.SetPort( DEFAULT_MASTER_PORT );
+	MasterAddress.ToSocketAddress( reinterpret_cast<sockaddr &>( g_MasterAddress ));
+
+	HUFFMAN_Construct( );
+	g_SendBuffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+
+	// Bind to all addresses, so that we get the replies to every simulated host.
+	g_Socket = socket( PF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	sockaddr_in LocalAddress;
+	memset( &LocalAddress, 0, sizeof( LocalAddress ));
+	LocalAddress.sin_family = AF_INET;
+	LocalAddress.sin_addr.s_addr = INADDR_ANY;
+	socklen_t addressLength = sizeof( LocalAddress );
+
+	int enable = 1;
+	if (( g_Socket == INVALID_SOCKET )
+		|| ( bind( g_Socket, reinterpret_cast<sockaddr *>( &LocalAddress ), sizeof( LocalAddress )) == SOCKET_ERROR )
+		|| ( getsockname( g_Socket, reinterpret_cast<sockaddr *>( &LocalAddress ), &addressLength ) == SOCKET_ERROR )
+		|| ( setsockopt( g_Socket, IPPROTO_IP, IP_PKTINFO, &enable, sizeof( enable )) == SOCKET_ERROR ))
+	{
+		printf( "Couldn't set up the socket: %s\n", strerror( errno ));
+		return ( 1 );
+	}
+
+	ULONG ulArg = true;
+	ioctlsocket( g_Socket, FIONBIO, &ulArg );
+	g_usLocalPort = ntohs( LocalAddress.sin_port );
+
+	printf( "Simulating %u servers and %u launchers (%.1f queries per second) from port %u against %s for %.0f seconds.\n",
+		ulNumServers, ulNumLaunchers, dQueriesPerSecond, g_usLocalPort, MasterAddress.ToString( ), dDuration );
+
+	g_StartTime = std::chrono::steady_clock::now( );
+
+	// Spread the heartbeats of the servers over the interval.
+	g_Servers.resize( ulNumServers );
+	for ( unsigned int i = 0; i < ulNumServers; ++i )
+	{
+		g_Servers[i].VerificationString = "loadtest" + std::to_string( i );
+		g_Servers[i].dNextHeartbeat = static_cast<double>( i ) * LOADTEST_HEARTBEAT_INTERVAL / ulNumServers;
+		g_Servers[i].bReceivedBanList = false;
+	}
+
+	g_Launchers.resize( ulNumLaunchers );
+	for ( unsigned int i = 0; i < ulNumLaunchers; ++i )
+	{
+		g_Launchers[i].dQueryTime = -1;
+		g_Launchers[i].ulNumServers = 0;
+	}
+
+	unsigned int ulNextServer = 0;
+	unsigned int ulNextLauncher = 0;
+	double dNextStatistics = 1;
+	double dTime;
+
+	while (( dTime = loadtest_GetTime( )) < dDuration )
+	{
+		// Heartbeats are due in the order of g_Servers.
+		for ( unsigned int i = 0; ( i < ulNumServers ) && ( g_Servers[ulNextServer].dNextHeartbeat <= dTime ); ++i )
+		{
+			loadtest_SendHeartbeat( ulNextServer );
+			g_Servers[ulNextServer].dNextHeartbeat += LOADTEST_HEARTBEAT_INTERVAL;
+			ulNextServer = ( ulNextServer + 1 ) % ulNumServers;
+		}
+
+		// Let the launchers in once the servers had the time to register.
+		if (( ulNumLaunchers > 0 ) && ( dTime >= LOADTEST_HEARTBEAT_INTERVAL ))
+		{
+			while ( g_ulQueriesSent < ( dTime - LOADTEST_HEARTBEAT_INTERVAL ) * dQueriesPerSecond )
+			{
+				loadtest_SendQuery( ulNextLauncher );
+				ulNextLauncher = ( ulNextLauncher + 1 ) % ulNumLaunchers;
+			}
+		}
+
+		struct pollfd pollSocket;
+		pollSocket.fd = g_Socket;
+		pollSocket.events = POLLIN;
+		poll( &pollSocket, 1, 1 );
+		loadtest_ReceivePackets( );
+
+		if ( dTime >= dNextStatistics )
+		{
+			loadtest_PrintStatistics( dTime );
+			dNextStatistics += 1;
+		}
+	}
+
+	loadtest_PrintStatistics( dTime );
+	g_SendBuffer.Free( );
+	closesocket( g_Socket );
+	return ( 0 );
+}
+
+#else
+
+int main( int argc, char **argv )
+{
+	printf( "The master server load generator needs Linux (IP_PKTINFO on the loopback network).\n" );
+	return ( 1 );
+}
+
+#endif
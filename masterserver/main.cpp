@@ -54,7 +54,10 @@
 #include "network.h"
 #include "main.h"
 #include <sstream>
-#include <set>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
 
 // [BB] Needed for I_GetTime.
 #ifdef _MSC_VER
@@ -67,24 +70,146 @@
 //*****************************************************************************
 //	VARIABLES
 
-// [BB] Comparision function, necessary to put SERVER_s entries into a std::set.
-class SERVERCompFunc
-{
+//==========================================================================
+//
+// ServerStore
+//
+// Stores servers hashed by their address. Also counts the servers on
+// each IP and keeps a timeout wheel, so neither needs a walk over all servers.
+//
+//==========================================================================
+
+class ServerStore {
 public:
-	bool operator()(SERVER_s s1, SERVER_s s2) const
+	typedef std::unordered_map<unsigned long long, SERVER_s>::iterator iterator;
+
+	ServerStore ( )
+		: _ulVersion ( 0 ),
+			_ulNextScheduleId ( 0 ),
+			_lLastTimeoutCheck ( 0 )
 	{
-		// [BB] NETWORK_AddressToString uses a static char array to generate the string, so we
-		// need to cache the string conversion of the first string when comparing to two.
-		// Note: Because we need a "<" comparison and not a "!=" comparison we can't use
-		// NETWORK_CompareAddress.
-		std::string address1 = s1.Address.ToString();
-		return ( stricmp ( address1.c_str(), s2.Address.ToString() ) < 0 );
+	}
+
+	iterator begin ( ) { return _servers.begin(); }
+	iterator end ( ) { return _servers.end(); }
+	unsigned long size ( ) const { return static_cast<unsigned long>( _servers.size() ); }
+
+	// Changes whenever servers are added or removed, or touch() is called.
+	unsigned long getVersion ( ) const { return _ulVersion; }
+	void touch ( ) { ++_ulVersion; }
+
+	SERVER_s *find ( const NETADDRESS_s &Address ) {
+		iterator it = _servers.find( getKey( Address ) );
+		return ( it != _servers.end() ) ? &it->second : NULL;
+	}
+
+	// Returns the stored server, which is the old one if the address is already known.
+	SERVER_s &insert ( const SERVER_s &Server, const long lCurrentTime ) {
+		const unsigned long long key = getKey( Server.Address );
+		std::pair<iterator, bool> result = _servers.insert( std::make_pair( key, Server ) );
+		SERVER_s &storedServer = result.first->second;
+
+		storedServer.lLastReceived = lCurrentTime;
+		if ( result.second )
+		{
+			++_serversPerIP[getIPKey( Server.Address )];
+			schedule( key, storedServer );
+			++_ulVersion;
+		}
+		return storedServer;
+	}
+
+	void erase ( const NETADDRESS_s &Address ) {
+		iterator it = _servers.find( getKey( Address ) );
+		if ( it != _servers.end() )
+			erase( it );
+	}
+
+	unsigned int countServersOnIP ( const NETADDRESS_s &Address ) const {
+		std::unordered_map<unsigned int, unsigned int>::const_iterator it = _serversPerIP.find( getIPKey( Address ) );
+		return ( it != _serversPerIP.end() ) ? it->second : 0;
+	}
+
+	// Removes all servers we didn't hear from for SERVER_TIMEOUT seconds and returns their
+	// addresses. Only the wheel slots that came due since the last call are looked at.
+	void removeTimedOut ( const long lCurrentTime, std::vector<NETADDRESS_s> &TimedOut ) {
+		long lFirst = _lLastTimeoutCheck + 1;
+		if ( lCurrentTime - lFirst >= static_cast<long>( TIMEOUT_WHEEL_SIZE ) )
+			lFirst = lCurrentTime - TIMEOUT_WHEEL_SIZE + 1;
+
+		for ( long lTime = lFirst; lTime <= lCurrentTime; ++lTime )
+		{
+			std::vector<std::pair<unsigned long long, unsigned long> > due;
+			due.swap( _timeoutWheel[lTime % TIMEOUT_WHEEL_SIZE] );
+
+			for ( unsigned int i = 0; i < due.size(); ++i )
+			{
+				iterator it = _servers.find( due[i].first );
+
+				// The server was removed or scheduled again since.
+				if (( it == _servers.end() ) || ( it->second.ulTimeoutScheduleId != due[i].second ))
+					continue;
+
+				if (( lCurrentTime - it->second.lLastReceived ) >= SERVER_TIMEOUT )
+				{
+					TimedOut.push_back( it->second.Address );
+					erase( it );
+				}
+				// We heard from it in the meantime, check again when it could time out next.
+				else
+					schedule( it->first, it->second );
+			}
+		}
+
+		_lLastTimeoutCheck = ( std::max )( _lLastTimeoutCheck, lCurrentTime );
+	}
+
+private:
+	// Must be larger than SERVER_TIMEOUT, so that no deadline is a full turn away.
+	static const unsigned int TIMEOUT_WHEEL_SIZE = 64;
+
+	std::unordered_map<unsigned long long, SERVER_s> _servers;
+	std::unordered_map<unsigned int, unsigned int> _serversPerIP;
+	std::vector<std::pair<unsigned long long, unsigned long> > _timeoutWheel[TIMEOUT_WHEEL_SIZE];
+	unsigned long _ulVersion;
+	unsigned long _ulNextScheduleId;
+	long _lLastTimeoutCheck;
+
+	static unsigned int getIPKey ( const NETADDRESS_s &Address ) {
+		return ( static_cast<unsigned int>( Address.abIP[0] ) << 24 ) | ( static_cast<unsigned int>( Address.abIP[1] ) << 16 )
+			| ( static_cast<unsigned int>( Address.abIP[2] ) << 8 ) | static_cast<unsigned int>( Address.abIP[3] );
+	}
+
+	static unsigned long long getKey ( const NETADDRESS_s &Address ) {
+		return ( static_cast<unsigned long long>( getIPKey( Address ) ) << 16 ) | Address.usPort;
+	}
+
+	void schedule ( const unsigned long long key, SERVER_s &Server ) {
+		Server.ulTimeoutScheduleId = ++_ulNextScheduleId;
+		_timeoutWheel[( Server.lLastReceived + SERVER_TIMEOUT ) % TIMEOUT_WHEEL_SIZE].push_back( std::make_pair( key, Server.ulTimeoutScheduleId ) );
+	}
+
+	void erase ( iterator it ) {
+		std::unordered_map<unsigned int, unsigned int>::iterator count = _serversPerIP.find( getIPKey( it->second.Address ) );
+		if (( count != _serversPerIP.end() ) && ( --count->second == 0 ))
+			_serversPerIP.erase( count );
+
+		_servers.erase( it );
+		++_ulVersion;
 	}
 };
 
 // Global server list.
-static	std::set<SERVER_s, SERVERCompFunc> g_Servers;
-static	std::set<SERVER_s, SERVERCompFunc> g_UnverifiedServers;
+static	ServerStore				g_Servers;
+static	ServerStore				g_UnverifiedServers;
+
+// The MSC_BEGINSERVERLISTPART packets of the server list, already Huffman-encoded, and the
+// g_Servers version they were built for.
+static	std::vector<std::vector<BYTE> >	g_ServerListPackets;
+static	unsigned long			g_ulServerListVersion = ~0UL;
+
+// Servers that need the ban list again. Sending it to them is left to MASTERSERVER_CheckTimeouts.
+static	std::vector<NETADDRESS_s>	g_ServersWithoutBanList;
 
 // Message buffer we write our commands to.
 static	NETBUFFER_s				g_MessageBuffer;
@@ -334,6 +459,18 @@ bool MASTERSERVER_RefreshIPList( IPList &List, const char *FileName )
 	return ( strcmp ( newIPs.str().c_str(), oldIPs.str().c_str() ) != 0 );
 }
 
+//*****************************************************************************
+//
+// The server will be sent the ban list again by MASTERSERVER_CheckTimeouts.
+void MASTERSERVER_MarkBanListOutdated( SERVER_s &Server )
+{
+	if ( Server.bHasLatestBanList )
+		g_ServersWithoutBanList.push_back( Server.Address );
+
+	Server.bHasLatestBanList = false;
+	Server.bVerifiedLatestBanList = false;
+}
+
 //*****************************************************************************
 //
 void MASTERSERVER_InitializeBans( void )
@@ -353,11 +490,8 @@ void MASTERSERVER_InitializeBans( void )
 	if ( BannedIPsChanged || BannedIPExemptionsChanged )
 	{
 		// [BB] The ban list was changed, so no server has the latest list anymore.
-		for( std::set<SERVER_s, SERVERCompFunc>::iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
-		{
-			it->bHasLatestBanList = false;
-			it->bVerifiedLatestBanList = false;
-		}
+		for( ServerStore::iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
+			MASTERSERVER_MarkBanListOutdated( it->second );
 
 		std::cerr << "Ban lists were changed since last refresh\n";
 	}
@@ -376,23 +510,86 @@ void MASTERSERVER_InitializeBans( void )
 
 //*****************************************************************************
 //
-void MASTERSERVER_AddServer( const SERVER_s &Server, std::set<SERVER_s, SERVERCompFunc> &ServerSet )
+void MASTERSERVER_AddServer( const SERVER_s &Server, ServerStore &ServerSet )
 {
-	std::set<SERVER_s, SERVERCompFunc>::iterator addedServer = ServerSet.insert ( Server ).first;
+	SERVER_s &addedServer = ServerSet.insert ( Server, g_lCurrentTime );
 
-	if ( addedServer == ServerSet.end() )
-		printf( "ERROR: Adding new entry to the set failed. This should not happen!\n" );
+	if ( &ServerSet == &g_Servers )
+	{
+		printf( "+ Adding %s (revision %d) to the server list.\n", addedServer.Address.ToString(), addedServer.iServerRevision );
+		MASTERSERVER_SendBanlistToServer( addedServer );
+	}
 	else
+		printf( "+ Adding %s (revision %d) to the verification list.\n", addedServer.Address.ToString(), addedServer.iServerRevision );
+}
+
+//*****************************************************************************
+//
+// Splits the visible servers into MSC_BEGINSERVERLISTPART packets and encodes them, all
+// launchers are sent these until g_Servers changes.
+void MASTERSERVER_BuildServerListPackets( void )
+{
+	const unsigned long ulMaxPacketSize = 1024;
+	unsigned long ulPacketNum = 0;
+	std::vector<const SERVER_s *> servers;
+
+	for( ServerStore::iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
+	{
+		// [BB] Possibly omit servers that don't enforce our ban list.
+		if ( ( it->second.bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) )
+			servers.push_back( &it->second );
+	}
+
+	// The blocks below need the servers on the same IP next to each other.
+	std::sort( servers.begin(), servers.end(), []( const SERVER_s *pServer1, const SERVER_s *pServer2 ) {
+		const int iCompare = memcmp( pServer1->Address.abIP, pServer2->Address.abIP, sizeof( pServer1->Address.abIP ));
+		return ( iCompare != 0 ) ? ( iCompare < 0 ) : ( ntohs( pServer1->Address.usPort ) < ntohs( pServer2->Address.usPort ));
+	});
+
+	g_ServerListPackets.clear();
+	g_MessageBuffer.Clear();
+	g_MessageBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLISTPART );
+	g_MessageBuffer.ByteStream.WriteByte( ulPacketNum );
+	g_MessageBuffer.ByteStream.WriteByte( MSC_SERVERBLOCK );
+	unsigned long ulSizeOfPacket = 6; // 4 (MSC_BEGINSERVERLISTPART) + 1 (0) + 1 (MSC_SERVERBLOCK)
+
+	for ( unsigned int i = 0; i < servers.size(); )
 	{
-		addedServer->lLastReceived = g_lCurrentTime;						
-		if ( &ServerSet == &g_Servers )
+		NETADDRESS_s serverAddress = servers[i]->Address;
+		std::vector<USHORT> serverPortList;
+
+		do {
+			serverPortList.push_back ( servers[i]->Address.usPort );
+			++i;
+		} while ( ( i < servers.size() ) && servers[i]->Address.CompareNoPort( serverAddress ) );
+
+		const unsigned long ulServerBlockNetSize = MASTERSERVER_CalcServerIPBlockNetSize( serverAddress, serverPortList );
+
+		// [BB] If sending this block would cause the current packet to exceed ulMaxPacketSize ...
+		if ( ulSizeOfPacket + ulServerBlockNetSize > ulMaxPacketSize - 1 )
 		{
-			printf( "+ Adding %s (revision %d) to the server list.\n", addedServer->Address.ToString(), addedServer->iServerRevision );
-			MASTERSERVER_SendBanlistToServer( *addedServer );
+			// [BB] ... close the current packet and start a new one.
+			g_MessageBuffer.ByteStream.WriteByte( 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
+			g_MessageBuffer.ByteStream.WriteByte( MSC_ENDSERVERLISTPART );
+			g_ServerListPackets.push_back( std::vector<BYTE>() );
+			NETWORK_EncodePacket( &g_MessageBuffer, g_ServerListPackets.back() );
+
+			g_MessageBuffer.Clear();
+			++ulPacketNum;
+			ulSizeOfPacket = 5;
+			g_MessageBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLISTPART );
+			g_MessageBuffer.ByteStream.WriteByte( ulPacketNum );
+			g_MessageBuffer.ByteStream.WriteByte( MSC_SERVERBLOCK );
 		}
-		else
-			printf( "+ Adding %s (revision %d) to the verification list.\n", addedServer->Address.ToString(), addedServer->iServerRevision );
+		ulSizeOfPacket += ulServerBlockNetSize;
+		MASTERSERVER_SendServerIPBlockToLauncher ( serverAddress, serverPortList, &g_MessageBuffer.ByteStream );
 	}
+	g_MessageBuffer.ByteStream.WriteByte( 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
+	g_MessageBuffer.ByteStream.WriteByte( MSC_ENDSERVERLIST );
+	g_ServerListPackets.push_back( std::vector<BYTE>() );
+	NETWORK_EncodePacket( &g_MessageBuffer, g_ServerListPackets.back() );
+
+	g_ulServerListVersion = g_Servers.getVersion();
 }
 
 //*****************************************************************************
@@ -455,19 +652,13 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 			newServer.bNewFormatServer = ( temp != -1 );
 			newServer.iServerRevision = ( ( pByteStream->pbStreamEnd - pByteStream->pbStream ) >= 4 ) ? pByteStream->ReadLong() : pByteStream->ReadShort();
 
-			std::set<SERVER_s, SERVERCompFunc>::iterator currentServer = g_Servers.find ( newServer );
+			SERVER_s *currentServer = g_Servers.find ( newServer.Address );
 
 			// This is a new server; add it to the list.
-			if ( currentServer == g_Servers.end() )
+			if ( currentServer == NULL )
 			{
-				unsigned int iNumOtherServers = 0;
-
 				// First count the number of servers from this IP.
-				for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
-				{
-					if ( it->Address.CompareNoPort( AddressFrom ))
-						iNumOtherServers++;
-				}
+				const unsigned int iNumOtherServers = g_Servers.countServersOnIP( AddressFrom );
 
 				if ( iNumOtherServers >= 10 && !g_MultiServerExceptions.isIPInList( AddressFrom ))
 					printf( "* More than 10 servers received from %s. Ignoring request...\n", AddressFrom.ToString() );
@@ -476,9 +667,8 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 					// [BB] 3021 is 98d, don't put those servers on the list.
 					if ( ( newServer.bNewFormatServer ) && ( newServer.iServerRevision != 3021 ) )
 					{
-						std::set<SERVER_s, SERVERCompFunc>::iterator currentUnverifiedServer = g_UnverifiedServers.find ( newServer );
 						// [BB] This is a new server, but we still need to verify it.
-						if ( currentUnverifiedServer == g_UnverifiedServers.end() )
+						if ( g_UnverifiedServers.find ( newServer.Address ) == NULL )
 						{
 							srand ( static_cast<unsigned int>( time(NULL) ) );
 							newServer.ServerVerificationInt = rand() + rand() * rand() + rand() * rand() * rand();
@@ -505,6 +695,9 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 				{
 					currentServer->lLastReceived = g_lCurrentTime;
 					// [BB] The server possibly changed the ban setting, so update it.
+					// This may show or hide it in the server list.
+					if ( currentServer->bEnforcesBanList != newServer.bEnforcesBanList )
+						g_Servers.touch();
 					currentServer->bEnforcesBanList = newServer.bEnforcesBanList;
 				}
 			}
@@ -521,17 +714,17 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 			newServer.MasterBanlistVerificationString = pByteStream->ReadString();
 			newServer.ServerVerificationInt = pByteStream->ReadLong();
 
-			std::set<SERVER_s, SERVERCompFunc>::iterator currentServer = g_UnverifiedServers.find ( newServer );
+			SERVER_s *currentServer = g_UnverifiedServers.find ( newServer.Address );
 
 			// [BB] Apparently, we didn't request any verification from this server, so ignore it.
-			if ( currentServer == g_UnverifiedServers.end() )
+			if ( currentServer == NULL )
 				return;
 
 			if ( ( stricmp ( newServer.MasterBanlistVerificationString.c_str(), currentServer->MasterBanlistVerificationString.c_str() ) == 0 )
 				&& ( newServer.ServerVerificationInt == currentServer->ServerVerificationInt ) )
 			{
 				MASTERSERVER_AddServer( *currentServer, g_Servers );
-				g_UnverifiedServers.erase ( currentServer );
+				g_UnverifiedServers.erase ( AddressFrom );
 			}
 			return;
 		}
@@ -541,10 +734,10 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 			server.Address = AddressFrom;
 			server.MasterBanlistVerificationString = pByteStream->ReadString();
 
-			std::set<SERVER_s, SERVERCompFunc>::iterator currentServer = g_Servers.find ( server );
+			SERVER_s *currentServer = g_Servers.find ( server.Address );
 
 			// [BB] We don't know the server. Just ignore it.
-			if ( currentServer == g_Servers.end() )
+			if ( currentServer == NULL )
 				return;
 
 			if ( stricmp ( server.MasterBanlistVerificationString.c_str(), currentServer->MasterBanlistVerificationString.c_str() ) == 0 )
@@ -595,11 +788,11 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 			case LAUNCHER_SERVER_CHALLENGE:
 				// Send the list of servers.
 				g_MessageBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLIST );
-				for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
+				for( ServerStore::iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
 				{
 					// [BB] Possibly omit servers that don't enforce our ban list.
-					if ( ( it->bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) )
-						MASTERSERVER_SendServerIPToLauncher ( it->Address, &g_MessageBuffer.ByteStream );
+					if ( ( it->second.bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) )
+						MASTERSERVER_SendServerIPToLauncher ( it->second.Address, &g_MessageBuffer.ByteStream );
 				}
 
 				// Tell the launcher that we're done sending servers.
@@ -611,55 +804,11 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 
 			case LAUNCHER_MASTER_CHALLENGE:
 
-				const unsigned long ulMaxPacketSize = 1024;
-				unsigned long ulPacketNum = 0;
+				// Everybody gets the same packets until the server list changes.
+				if ( g_ulServerListVersion != g_Servers.getVersion() )
+					MASTERSERVER_BuildServerListPackets( );
 
-				std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin();
-
-				g_MessageBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLISTPART );
-				g_MessageBuffer.ByteStream.WriteByte( ulPacketNum );
-				g_MessageBuffer.ByteStream.WriteByte( MSC_SERVERBLOCK );
-				unsigned long ulSizeOfPacket = 6; // 4 (MSC_BEGINSERVERLISTPART) + 1 (0) + 1 (MSC_SERVERBLOCK)
-
-				while ( it != g_Servers.end() )
-				{
-					NETADDRESS_s serverAddress = it->Address;
-					std::vector<USHORT> serverPortList;
-
-					do {
-						// [BB] Possibly omit servers that don't enforce our ban list.
-						if ( ( it->bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) )
-							serverPortList.push_back ( it->Address.usPort );
-						++it;
-					} while ( ( it != g_Servers.end() ) && it->Address.CompareNoPort( serverAddress ) );
-
-					// [BB] All servers on this IP ignore the list, nothing to send.
-					if ( serverPortList.size() == 0 )
-						continue;
-
-					const unsigned long ulServerBlockNetSize = MASTERSERVER_CalcServerIPBlockNetSize( serverAddress, serverPortList );
-
-					// [BB] If sending this block would cause the current packet to exceed ulMaxPacketSize ...
-					if ( ulSizeOfPacket + ulServerBlockNetSize > ulMaxPacketSize - 1 )
-					{
-						// [BB] ... close the current packet and start a new one.
-						g_MessageBuffer.ByteStream.WriteByte( 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
-						g_MessageBuffer.ByteStream.WriteByte( MSC_ENDSERVERLISTPART );
-						NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
-
-						g_MessageBuffer.Clear();
-						++ulPacketNum;
-						ulSizeOfPacket = 5;
-						g_MessageBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLISTPART );
-						g_MessageBuffer.ByteStream.WriteByte( ulPacketNum );
-						g_MessageBuffer.ByteStream.WriteByte( MSC_SERVERBLOCK );
-					}
-					ulSizeOfPacket += ulServerBlockNetSize;
-					MASTERSERVER_SendServerIPBlockToLauncher ( serverAddress, serverPortList, &g_MessageBuffer.ByteStream );
-				}
-				g_MessageBuffer.ByteStream.WriteByte( 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
-				g_MessageBuffer.ByteStream.WriteByte( MSC_ENDSERVERLIST );
-				NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
+				NETWORK_LaunchEncodedPackets( g_ServerListPackets, AddressFrom );
 				return;
 			}
 		}
@@ -671,31 +820,29 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 
 //*****************************************************************************
 //
-void MASTERSERVER_CheckTimeouts( std::set<SERVER_s, SERVERCompFunc> &ServerSet )
+void MASTERSERVER_CheckTimeouts( ServerStore &ServerSet )
 {
-	// [BB] Because we are erasing entries from the set, the iterator has to be incremented inside
-	// the loop, depending on whether and element was erased or not.
-	for( std::set<SERVER_s, SERVERCompFunc>::iterator it = ServerSet.begin(); it != ServerSet.end(); )
+	std::vector<NETADDRESS_s> timedOut;
+	ServerSet.removeTimedOut( g_lCurrentTime, timedOut );
+
+	for ( unsigned int i = 0; i < timedOut.size(); ++i )
+		printf( "- %server at %s timed out.\n", ( &ServerSet == &g_UnverifiedServers ) ? "Unverified s" : "S", timedOut[i].ToString() );
+}
+
+//*****************************************************************************
+//
+// Sends the ban list to all servers that were marked by MASTERSERVER_MarkBanListOutdated.
+void MASTERSERVER_SendPendingBanlists( void )
+{
+	std::vector<NETADDRESS_s> pending;
+	pending.swap( g_ServersWithoutBanList );
+
+	for ( unsigned int i = 0; i < pending.size(); ++i )
 	{
-		// If the server has timed out, make it an open slot!
-		if (( g_lCurrentTime - it->lLastReceived ) >= 60 )
-		{
-			printf( "- %server at %s timed out.\n", ( &ServerSet == &g_UnverifiedServers ) ? "Unverified s" : "S", it->Address.ToString() );
-			// [BB] The standard does not require set::erase to return the incremented operator,
-			// that's why we must use the post increment operator here.
-			ServerSet.erase ( it++ );
-			continue;
-		}
-		else
-		{
-			// [BB] If the server doesn't have the latest ban list, send it now.
-			// This construction has the drawback that all servers are updated at once.
-			// Possibly it will be necessary to do this differently.
-			if ( it->bHasLatestBanList == false )
-				MASTERSERVER_SendBanlistToServer( *it );
+		SERVER_s *server = g_Servers.find( pending[i] );
 
-			++it;
-		}
+		if (( server != NULL ) && ( server->bHasLatestBanList == false ))
+			MASTERSERVER_SendBanlistToServer( *server );
 	}
 }
 
@@ -705,6 +852,63 @@ void MASTERSERVER_CheckTimeouts( void )
 {
 	MASTERSERVER_CheckTimeouts ( g_Servers );
 	MASTERSERVER_CheckTimeouts ( g_UnverifiedServers );
+	MASTERSERVER_SendPendingBanlists( );
+}
+
+//*****************************************************************************
+//
+// Feeds the flood queues with packets from spoofed addresses the way MASTERSERVER_ParseCommands
+// does (two flood checks, the query check and adding the address) and prints the throughput.
+void MASTERSERVER_BenchmarkFlood( unsigned long ulNumPackets )
+{
+	QueryIPQueue	floodQueue( 10 );
+	QueryIPQueue	shortFloodQueue( 3 );
+	QueryIPQueue	queryQueue( 10 );
+	unsigned long	ulNumIgnored = 0;
+
+	// Create the packet sources up front so that only the queues are timed. Half of the
+	// packets come from a few hundred repeating addresses, the rest from a few thousand spoofed
+	// ones, which keeps the queues full.
+	std::vector<NETADDRESS_s> addresses( 4096 );
+	std::vector<unsigned int> sources( 65536 );
+	srand( 0 );
+	for ( unsigned int i = 0; i < addresses.size( ); ++i )
+	{
+		for ( int j = 0; j < 4; ++j )
+			addresses[i].abIP[j] = static_cast<BYTE>( rand( ) % 256 );
+		addresses[i].usPort = static_cast<USHORT>( rand( ));
+	}
+	for ( unsigned int i = 0; i < sources.size( ); ++i )
+		sources[i] = ( i & 1 ) ? ( rand( ) % 256 ) : ( rand( ) % addresses.size( ));
+
+	std::ostringstream discardedErrors;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+	for ( unsigned long ulPacket = 0; ulPacket < ulNumPackets; ulPacket++ )
+	{
+		// Pretend a second passes every 10000 packets.
+		const unsigned long ulTime = ulPacket / 10000;
+		const NETADDRESS_s &AddressFrom = addresses[sources[ulPacket % sources.size( )]];
+
+		if (( ulPacket % 10000 ) == 0 )
+		{
+			floodQueue.adjustHead( ulTime );
+			shortFloodQueue.adjustHead( ulTime );
+			queryQueue.adjustHead( ulTime );
+		}
+
+		if ( floodQueue.addressInQueue( AddressFrom ) || shortFloodQueue.addressInQueue( AddressFrom ) || queryQueue.addressInQueue( AddressFrom ))
+		{
+			ulNumIgnored++;
+			continue;
+		}
+
+		queryQueue.addAddress( AddressFrom, ulTime, &discardedErrors );
+	}
+
+	const double dSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+	std::cerr << "Processed " << ulNumPackets << " packets (" << ulNumIgnored << " ignored) in " << dSeconds * 1000.0 << " ms, "
+		<< (( dSeconds > 0 ) ? ( ulNumPackets / dSeconds ) : 0 ) << " packets per second.\n";
 }
 
 //*****************************************************************************
@@ -718,6 +922,13 @@ int main( int argc, char **argv )
 
 	std::cerr << "Port: " << DEFAULT_MASTER_PORT << std::endl << std::endl;
 
+	// Only measure how fast flooding packets are rejected and quit.
+	if (( argc >= 2 ) && ( stricmp ( argv[1], "-benchmarkflood" ) == 0 ))
+	{
+		MASTERSERVER_BenchmarkFlood(( argc >= 3 ) ? strtoul( argv[2], NULL, 10 ) : 10000000 );
+		return ( 0 );
+	}
+
 	// Initialize the network system.
 	NETWORK_Construct( DEFAULT_MASTER_PORT, ( ( argc >= 4 ) && ( stricmp ( argv[2], "-useip" ) == 0 ) ) ? argv[3] : NULL );
 
@@ -771,12 +982,12 @@ int main( int argc, char **argv )
 
 		if ( g_lCurrentTime > lastBanlistVerificationTimeout + 10 )
 		{
-			for( std::set<SERVER_s, SERVERCompFunc>::iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
+			for( ServerStore::iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
 			{
-				if ( ( it->bVerifiedLatestBanList == false ) && ( it->bNewFormatServer == true ) )
+				if ( ( it->second.bVerifiedLatestBanList == false ) && ( it->second.bNewFormatServer == true ) )
 				{
-					it->bHasLatestBanList = false;
-					std::cerr << "No receipt received from " << it->Address.ToString() << ". Resending banlist.\n";
+					MASTERSERVER_MarkBanListOutdated( it->second );
+					std::cerr << "No receipt received from " << it->second.Address.ToString() << ". Resending banlist.\n";
 				}
 			}
 			lastBanlistVerificationTimeout = g_lCurrentTime;
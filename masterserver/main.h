@@ -61,6 +61,9 @@ typedef int32_t __int32;
 // This is the maximum number of servers we can store in our list. Hopefully ST won't grow so big that this number can't hold them all!
 #define	MAX_SERVERS						512
 
+// Servers we don't hear from for this many seconds are removed from the list.
+#define	SERVER_TIMEOUT					60
+
 //*****************************************************************************
 //	STRUCTURES
 
@@ -97,6 +100,9 @@ typedef struct
 	// [BB] Number that we send the server along with our verification request.
 	__int32 ServerVerificationInt;
 
+	// Identifies the server's current entry in the timeout wheel of its ServerStore.
+	unsigned long	ulTimeoutScheduleId;
+
 } SERVER_s;
 
 #endif	// __MAIN_H__
@@ -79,10 +79,28 @@ static	USHORT			g_usLocalPort;
 // Buffer for the Huffman encoding.
 static	UCHAR			g_ucHuffmanBuffer[131072];
 
+#ifdef __linux__
+// Number of datagrams read with a single recvmmsg, or sent with a single sendmmsg.
+#define	NETWORK_BATCH_SIZE		32
+
+// Anything at least this long can't be decoded into g_NetworkMessage and is dropped.
+#define	NETWORK_MAX_ENCODED_SIZE	(( MAX_UDP_PACKET * 8 ) / 3 + 1 )
+
+// Datagrams of the current receive batch and where they came from.
+static	UCHAR			g_ucReceiveBatch[NETWORK_BATCH_SIZE][NETWORK_MAX_ENCODED_SIZE + 1];
+static	struct iovec	g_ReceiveVectors[NETWORK_BATCH_SIZE];
+static	sockaddr_in		g_ReceiveAddresses[NETWORK_BATCH_SIZE];
+static	struct mmsghdr	g_ReceiveHeaders[NETWORK_BATCH_SIZE];
+static	int				g_iNumReceived = 0;
+static	int				g_iNextReceived = 0;
+#endif
+
 //*****************************************************************************
 //	PROTOTYPES
 
 static	void			network_Error( const char *pszError );
+static	int				network_DecodePacket( const UCHAR *pucData, LONG lNumBytes, const sockaddr &SocketFrom );
+static	void			network_ReportSendError( const NETADDRESS_s &Address );
 static	SOCKET			network_AllocateSocket( void );
 static	bool			network_BindSocketToPort( SOCKET Socket, ULONG ulInAddr, USHORT usPort, bool bReUse );
 
@@ -195,10 +213,63 @@ void NETWORK_Construct( USHORT usPort, const char *pszIPAddress )
 
 //*****************************************************************************
 //
+#ifdef __linux__
+// Returns the next datagram of the current batch, reading a new batch with recvmmsg when
+// the current one is used up.
+int NETWORK_GetPackets( void )
+{
+	while ( true )
+	{
+		if ( g_iNextReceived >= g_iNumReceived )
+		{
+			g_iNumReceived = g_iNextReceived = 0;
+
+			for ( int i = 0; i < NETWORK_BATCH_SIZE; ++i )
+			{
+				g_ReceiveVectors[i].iov_base = g_ucReceiveBatch[i];
+				g_ReceiveVectors[i].iov_len = sizeof( g_ucReceiveBatch[i] );
+				memset( &g_ReceiveHeaders[i], 0, sizeof( g_ReceiveHeaders[i] ));
+				g_ReceiveHeaders[i].msg_hdr.msg_name = &g_ReceiveAddresses[i];
+				g_ReceiveHeaders[i].msg_hdr.msg_namelen = sizeof( g_ReceiveAddresses[i] );
+				g_ReceiveHeaders[i].msg_hdr.msg_iov = &g_ReceiveVectors[i];
+				g_ReceiveHeaders[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			const int iNumReceived = recvmmsg( g_NetworkSocket, g_ReceiveHeaders, NETWORK_BATCH_SIZE, 0, NULL );
+
+			// If the number of packets returned is -1, an error has occured.
+			if ( iNumReceived == -1 )
+			{
+				if (( errno == EWOULDBLOCK ) || ( errno == ECONNREFUSED ))
+					return ( false );
+
+				printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
+				return ( false );
+			}
+
+			if ( iNumReceived <= 0 )
+				return ( 0 );
+
+			g_iNumReceived = iNumReceived;
+		}
+
+		const int iIdx = g_iNextReceived++;
+		const LONG lNumBytes = g_ReceiveHeaders[iIdx].msg_len;
+
+		// Skip empty datagrams and ones too big for our buffers, instead of ending the batch.
+		if (( lNumBytes <= 0 ) || ( lNumBytes >= static_cast<LONG>( g_NetworkMessage.ulMaxSize )) || ( g_ReceiveHeaders[iIdx].msg_hdr.msg_flags & MSG_TRUNC ))
+			continue;
+
+		// A datagram that decodes to nothing isn't the end of the batch either.
+		const int iDecodedSize = network_DecodePacket( g_ucReceiveBatch[iIdx], lNumBytes, reinterpret_cast<const sockaddr &>( g_ReceiveAddresses[iIdx] ));
+		if ( iDecodedSize > 0 )
+			return ( iDecodedSize );
+	}
+}
+#else
 int NETWORK_GetPackets( void )
 {
 	LONG				lNumBytes;
-	INT					iDecodedNumBytes = g_NetworkMessage.ulMaxSize;
 	sockaddr			SocketFrom;
 	INT					iSocketFromLength;
 
@@ -251,17 +322,9 @@ int NETWORK_GetPackets( void )
 	if ( lNumBytes >= static_cast<LONG>(g_NetworkMessage.ulMaxSize) )
 		return ( 0 );
 
-	// Decode the huffman-encoded message we received.
-	HUFFMAN_Decode( g_ucHuffmanBuffer, (unsigned char *)g_NetworkMessage.pbData, lNumBytes, &iDecodedNumBytes );
-	g_NetworkMessage.ulCurrentSize = iDecodedNumBytes;
-	g_NetworkMessage.ByteStream.pbStream = g_NetworkMessage.pbData;
-	g_NetworkMessage.ByteStream.pbStreamEnd = g_NetworkMessage.ByteStream.pbStream + g_NetworkMessage.ulCurrentSize;
-
-	// Store the IP address of the sender.
-	g_AddressFrom.LoadFromSocketAddress( SocketFrom );
-
-	return ( g_NetworkMessage.ulCurrentSize );
+	return network_DecodePacket( g_ucHuffmanBuffer, lNumBytes, SocketFrom );
 }
+#endif
 
 //*****************************************************************************
 //
@@ -293,45 +356,132 @@ void NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address )
 
 	// If sendto returns -1, there was an error.
 	if ( lNumBytes == -1 )
-	{
-#ifdef __WIN32__
-		INT	iError = WSAGetLastError( );
+		network_ReportSendError( Address );
+}
 
-		// Wouldblock is silent.
-		if ( iError == WSAEWOULDBLOCK )
-			return;
+//*****************************************************************************
+//
+// Huffman-encodes the buffer into Encoded, so that it can be sent any number of times
+// with NETWORK_LaunchEncodedPackets.
+void NETWORK_EncodePacket( NETBUFFER_s *pBuffer, std::vector<BYTE> &Encoded )
+{
+	INT					iNumBytesOut = sizeof(g_ucHuffmanBuffer);
+
+	pBuffer->ulCurrentSize = pBuffer->CalcSize();
+	HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, g_ucHuffmanBuffer, pBuffer->ulCurrentSize, &iNumBytesOut );
+	Encoded.assign( g_ucHuffmanBuffer, g_ucHuffmanBuffer + iNumBytesOut );
+}
+
+//*****************************************************************************
+//
+// Sends already encoded packets to the address, with as few system calls as possible.
+void NETWORK_LaunchEncodedPackets( const std::vector<std::vector<BYTE> > &Packets, NETADDRESS_s Address )
+{
+	// Convert the IP address to a socket address.
+	struct sockaddr_in SocketAddress;
+	Address.ToSocketAddress( reinterpret_cast<sockaddr&>(SocketAddress) );
 
-		switch ( iError )
+#ifdef __linux__
+	struct iovec	vectors[NETWORK_BATCH_SIZE];
+	struct mmsghdr	headers[NETWORK_BATCH_SIZE];
+
+	for ( size_t first = 0; first < Packets.size( ); )
+	{
+		const unsigned int numPackets = static_cast<unsigned int>(( std::min )( Packets.size( ) - first, static_cast<size_t>( NETWORK_BATCH_SIZE )));
+
+		for ( unsigned int i = 0; i < numPackets; ++i )
 		{
-		case WSAEACCES:
+			vectors[i].iov_base = const_cast<BYTE *>( Packets[first + i].data( ));
+			vectors[i].iov_len = Packets[first + i].size( );
+			memset( &headers[i], 0, sizeof( headers[i] ));
+			headers[i].msg_hdr.msg_name = &SocketAddress;
+			headers[i].msg_hdr.msg_namelen = sizeof( SocketAddress );
+			headers[i].msg_hdr.msg_iov = &vectors[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+		}
 
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEACCES: Permission denied for address: %s\n", iError, Address.ToString() );
-			return;
-		case WSAEADDRNOTAVAIL:
+		const int iNumSent = sendmmsg( g_NetworkSocket, headers, numPackets, 0 );
 
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEADDRENOTAVAIL: Address %s not available\n", iError, Address.ToString() );
+		// Don't try again, the datagrams would just be dropped (or fail) again.
+		if ( iNumSent <= 0 )
+		{
+			network_ReportSendError( Address );
 			return;
-		case WSAEHOSTUNREACH:
-
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEHOSTUNREACH: Address %s unreachable\n", iError, Address.ToString() );
-			return;				
-		default:
+		}
 
-			printf( "NETWORK_LaunchPacket: Error #%d\n", iError );
+		first += iNumSent;
+	}
+#else
+	for ( size_t i = 0; i < Packets.size( ); ++i )
+	{
+		if ( sendto( g_NetworkSocket, (const char*)Packets[i].data( ), static_cast<int>( Packets[i].size( )), 0, reinterpret_cast<sockaddr*>(&SocketAddress), sizeof( SocketAddress )) == -1 )
+		{
+			network_ReportSendError( Address );
 			return;
 		}
+	}
+#endif
+}
+
+//*****************************************************************************
+//
+// Stores the decoded packet in g_NetworkMessage, and where it came from in g_AddressFrom.
+static int network_DecodePacket( const UCHAR *pucData, LONG lNumBytes, const sockaddr &SocketFrom )
+{
+	INT					iDecodedNumBytes = g_NetworkMessage.ulMaxSize;
+
+	// Decode the huffman-encoded message we received.
+	HUFFMAN_Decode( pucData, (unsigned char *)g_NetworkMessage.pbData, lNumBytes, &iDecodedNumBytes );
+	g_NetworkMessage.ulCurrentSize = iDecodedNumBytes;
+	g_NetworkMessage.ByteStream.pbStream = g_NetworkMessage.pbData;
+	g_NetworkMessage.ByteStream.pbStreamEnd = g_NetworkMessage.ByteStream.pbStream + g_NetworkMessage.ulCurrentSize;
+
+	// Store the IP address of the sender.
+	g_AddressFrom.LoadFromSocketAddress( SocketFrom );
+
+	return ( g_NetworkMessage.ulCurrentSize );
+}
+
+//*****************************************************************************
+//
+static void network_ReportSendError( const NETADDRESS_s &Address )
+{
+#ifdef __WIN32__
+	INT	iError = WSAGetLastError( );
+
+	// Wouldblock is silent.
+	if ( iError == WSAEWOULDBLOCK )
+		return;
+
+	switch ( iError )
+	{
+	case WSAEACCES:
+
+		printf( "NETWORK_LaunchPacket: Error #%d, WSAEACCES: Permission denied for address: %s\n", iError, Address.ToString() );
+		return;
+	case WSAEADDRNOTAVAIL:
+
+		printf( "NETWORK_LaunchPacket: Error #%d, WSAEADDRENOTAVAIL: Address %s not available\n", iError, Address.ToString() );
+		return;
+	case WSAEHOSTUNREACH:
+
+		printf( "NETWORK_LaunchPacket: Error #%d, WSAEHOSTUNREACH: Address %s unreachable\n", iError, Address.ToString() );
+		return;
+	default:
+
+		printf( "NETWORK_LaunchPacket: Error #%d\n", iError );
+		return;
+	}
 #else
 	if ( errno == EWOULDBLOCK )
-return;
-
-          if ( errno == ECONNREFUSED )
-              return;
+		return;
 
-		printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
-		printf( "NETWORK_LaunchPacket: Address %s\n", Address.ToString() );
+	if ( errno == ECONNREFUSED )
+		return;
 
+	printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
+	printf( "NETWORK_LaunchPacket: Address %s\n", Address.ToString() );
 #endif
-	}
 }
 
 //*****************************************************************************
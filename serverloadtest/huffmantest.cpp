@@ -0,0 +1,179 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: huffmantest.cpp
+//
+// Description: Round-trip test of the Huffman codec that all network traffic
+// goes through. Encodes generated packets with the lookup table codec, the
+// bitwise reference implementation and from several segments, checks that
+// they all produce the same data, and that it decodes to the original packet
+// with both decoders. HUFFMAN_Encode and HUFFMAN_Decode are checked too,
+// including the packets that are sent unencoded because they would expand.
+//
+// The exit code is non-zero if anything didn't match.
+//
+// Usage: huffman-test [number of packets]
+//
+//-----------------------------------------------------------------------------
+
+#include "../src/networkheaders.h"
+#include "../src/networkshared.h"
+#include "../src/huffman/huffman.h"
+
+#include <random>
+#include <vector>
+
+//*****************************************************************************
+//	DEFINES
+
+// How many packets are tested by default.
+#define	HUFFMANTEST_NUMPACKETS			10000
+
+//*****************************************************************************
+//	VARIABLES
+
+static	unsigned char	g_ucEncoded[4][MAX_UDP_PACKET * 2];
+static	unsigned char	g_ucDecoded[3][MAX_UDP_PACKET * 2];
+
+//*****************************************************************************
+//	FUNCTIONS
+
+// Returns false and tells what's wrong if the packet doesn't survive the round trip.
+static bool huffmantest_CheckPacket( const std::vector<unsigned char> &Packet, std::mt19937 &Random )
+{
+	skulltag::HuffmanCodec *pCodec = HUFFMAN_GetCodec( );
+	const unsigned char *pInput = Packet.empty( ) ? NULL : Packet.data( );
+	const int lLength = static_cast<int>( Packet.size( ));
+	const int lOutLength = sizeof( g_ucEncoded[0] );
+
+	const int lEncoded = pCodec->encode( pInput, g_ucEncoded[0], lLength, lOutLength );
+	const int lEncodedBitwise = pCodec->encodeBitwise( pInput, g_ucEncoded[1], lLength, lOutLength );
+
+	// Split the packet into three segments at random points, like a packet that's
+	// put together from the client's buffer and the broadcast journal.
+	int alSplit[2];
+	alSplit[0] = std::uniform_int_distribution<int>( 0, lLength )( Random );
+	alSplit[1] = std::uniform_int_distribution<int>( alSplit[0], lLength )( Random );
+	const unsigned char *apSegments[3] = { pInput, pInput + alSplit[0], pInput + alSplit[1] };
+	const int alSegmentLengths[3] = { alSplit[0], alSplit[1] - alSplit[0], lLength - alSplit[1] };
+	const int lEncodedSegments = pCodec->encodeSegments( apSegments, alSegmentLengths, 3, g_ucEncoded[2], lOutLength );
+
+	if (( lEncoded != lEncodedBitwise ) || ( lEncoded != lEncodedSegments ))
+	{
+		printf( "%d byte packet: encoded to %d bytes, %d bitwise and %d from segments.\n", lLength, lEncoded, lEncodedBitwise, lEncodedSegments );
+		return ( false );
+	}
+
+	if (( lEncoded > 0 ) && (( memcmp( g_ucEncoded[0], g_ucEncoded[1], lEncoded ) != 0 ) || ( memcmp( g_ucEncoded[0], g_ucEncoded[2], lEncoded ) != 0 )))
+	{
+		printf( "%d byte packet: the encoders don't agree.\n", lLength );
+		return ( false );
+	}
+
+	// The packet expanded, HUFFMAN_Encode sends it unencoded.
+	if ( lEncoded >= 0 )
+	{
+		const int lDecoded = pCodec->decode( g_ucEncoded[0], g_ucDecoded[0], lEncoded, sizeof( g_ucDecoded[0] ));
+		const int lDecodedBitwise = pCodec->decodeBitwise( g_ucEncoded[0], g_ucDecoded[1], lEncoded, sizeof( g_ucDecoded[1] ));
+
+		if (( lDecoded != lLength ) || ( lDecodedBitwise != lLength )
+			|| (( lLength > 0 ) && (( memcmp( g_ucDecoded[0], pInput, lLength ) != 0 ) || ( memcmp( g_ucDecoded[1], pInput, lLength ) != 0 ))))
+		{
+			printf( "%d byte packet: decoded to %d bytes, %d bitwise, which doesn't match.\n", lLength, lDecoded, lDecodedBitwise );
+			return ( false );
+		}
+	}
+
+	// And the whole way a packet takes.
+	int lNumBytes = sizeof( g_ucEncoded[3] );
+	HUFFMAN_Encode( pInput, g_ucEncoded[3], lLength, &lNumBytes );
+	int lNumDecodedBytes = sizeof( g_ucDecoded[2] );
+	HUFFMAN_Decode( g_ucEncoded[3], g_ucDecoded[2], lNumBytes, &lNumDecodedBytes );
+
+	if (( lNumDecodedBytes != lLength ) || (( lLength > 0 ) && ( memcmp( g_ucDecoded[2], pInput, lLength ) != 0 )))
+	{
+		printf( "%d byte packet: HUFFMAN_Decode returned %d bytes, which don't match.\n", lLength, lNumDecodedBytes );
+		return ( false );
+	}
+
+	return ( true );
+}
+
+//*****************************************************************************
+//
+int main( int argc, char **argv )
+{
+	const unsigned int ulNumPackets = ( argc >= 2 ) ? static_cast<unsigned int>( atoi( argv[1] )) : HUFFMANTEST_NUMPACKETS;
+	std::mt19937 Random( 12345 );
+	std::vector<unsigned char> Packet;
+	unsigned int ulNumFailed = 0;
+
+	HUFFMAN_Construct( );
+
+	// Every byte on its own, which covers each code in the tree.
+	for ( unsigned int ulValue = 0; ulValue < 256; ++ulValue )
+	{
+		Packet.assign( 1, static_cast<unsigned char>( ulValue ));
+		if ( huffmantest_CheckPacket( Packet, Random ) == false )
+			ulNumFailed++;
+	}
+
+	// Packets of any size. Most resemble real packets, mostly small values with the
+	// occasional random byte, the rest are random and mostly expand.
+	for ( unsigned int ulIdx = 0; ulIdx < ulNumPackets; ++ulIdx )
+	{
+		const bool bRandom = ( ulIdx % 8 == 0 );
+		Packet.resize( std::uniform_int_distribution<int>( 0, MAX_UDP_PACKET )( Random ));
+
+		for ( unsigned int i = 0; i < Packet.size( ); ++i )
+		{
+			const unsigned int ulByte = Random( ) & 0xFF;
+			Packet[i] = static_cast<unsigned char>(( bRandom || ( ulByte < 96 )) ? ( Random( ) & 0xFF ) : ( ulByte & 0x0F ));
+		}
+
+		if ( huffmantest_CheckPacket( Packet, Random ) == false )
+			ulNumFailed++;
+	}
+
+	printf( "%u packets, %u failed.\n", ulNumPackets + 256, ulNumFailed );
+	return ( ulNumFailed > 0 ) ? 1 : 0;
+}
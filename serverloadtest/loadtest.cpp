@@ -0,0 +1,942 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: loadtest.cpp
+//
+// Description: Load generator for the game server. Connects any number of
+// synthetic clients to one server over loopback and lets them run around, so
+// that the server can be benchmarked without real players. Like the master
+// server load generator, every client gets its own 127.1.x.y address (Linux
+// routes all of 127.0.0.0/8 to the loopback device), which is picked per
+// datagram with IP_PKTINFO. This keeps the clients clear of sv_maxclientsperip.
+//
+// The clients go through the real connection sequence: they authenticate the
+// map, request the snapshot, acknowledge the full update, then send scripted
+// movement commands every tic together with their packet acknowledgements and
+// those of the other players' movement, and request the reliable packets they
+// are missing like the real client does. The server's commands themselves are
+// not interpreted.
+//
+// Since the clients can't load the map, its checksum must be passed with
+// -checksum (use "mapchecksum <map>" on the server). The server either needs
+// sv_pure 0 or the lump checksum passed with -lumps. Map changes aren't
+// followed. If the server exports its profile (sv_profileexportfile) to a file
+// we can read, the average server tic time over the run is reported too.
+//
+// Usage: server-loadtest -checksum <map checksum> [-clients N] [-time seconds]
+//        [-server address:port] [-password password] [-lumps checksum]
+//        [-profile file]
+//
+//-----------------------------------------------------------------------------
+
+#include "../src/networkheaders.h"
+#include "../src/networkshared.h"
+#include "../src/network_enums.h"
+#include "../src/version.h"
+#include "../src/huffman/huffman.h"
+
+#ifdef __linux__
+
+#include <poll.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <map>
+
+//*****************************************************************************
+//	DEFINES
+
+// The second octet of the addresses of the synthetic clients.
+#define	LOADTEST_CLIENT_NETWORK			1
+
+// How often a client repeats its connection attempt or map authentication when it gets no answer (seconds).
+#define	LOADTEST_RESEND_INTERVAL		3
+
+// The server's tic rate, we send our movement commands at the same rate.
+#define	LOADTEST_TICRATE				35
+
+// Movement command bits and buttons, these must match network.h and d_event.h.
+#define	LOADTEST_UPDATE_YAW				0x01
+#define	LOADTEST_UPDATE_BUTTONS			0x08
+#define	LOADTEST_UPDATE_FORWARDMOVE		0x10
+#define	LOADTEST_UPDATE_SIDEMOVE		0x20
+#define	LOADTEST_BT_JUMP				( 1 << 2 )
+
+// The most players a server can have, this must match doomdef.h.
+#define	LOADTEST_MAXPLAYERS				64
+
+// How long each part of the movement script lasts (tics).
+#define	LOADTEST_SCRIPT_STEP			( 2 * LOADTEST_TICRATE )
+
+//*****************************************************************************
+//	STRUCTURES
+
+enum LOADTESTSTATE_e
+{
+	LTS_CONNECTING,
+	LTS_AUTHENTICATING,
+	LTS_WAITINGFORFULLUPDATE,
+	LTS_ACTIVE,
+	LTS_FAILED,
+};
+
+typedef struct
+{
+	LOADTESTSTATE_e	State;
+
+	// When we last sent the command for the current state (seconds since the start).
+	double			dLastAttempt;
+
+	// When we started to connect and when the full update was completed.
+	double			dConnectTime;
+	double			dActiveTime;
+
+	// The server's gametic when it asked us to authenticate and the time when it did.
+	int				lServerGametic;
+	double			dServerGameticTime;
+
+	// Our own gametic, counted up with every movement command.
+	int				lGametic;
+
+	// The sequence of the player movement updates we got since we last acknowledged them.
+	bool			bMovementAckPending;
+	BYTE			ucMovementSequence;
+
+	// Reliable packet bookkeeping, the same as the real client's.
+	int				lLastParsedSequence;
+	int				lHighestReceivedSequence;
+	std::map<int, std::vector<BYTE> >	PendingPackets;
+
+	// Statistics.
+	unsigned long	ulBytesReceived;
+	unsigned long	ulBytesSent;
+	unsigned long	ulPacketsReceived;
+	unsigned long	ulPacketsLost;
+	unsigned long	ulMissingPacketsRequested;
+
+} LOADTEST_CLIENT_s;
+
+typedef struct
+{
+	double			dTicSum;
+	unsigned long	ulNumTics;
+	unsigned long	ulNumSlowTics;
+
+} LOADTEST_PROFILE_s;
+
+//*****************************************************************************
+//	VARIABLES
+
+static	SOCKET			g_Socket;
+static	sockaddr_in		g_ServerAddress;
+static	std::chrono::steady_clock::time_point	g_StartTime;
+
+static	NETBUFFER_s		g_SendBuffer;
+static	UCHAR			g_ucHuffmanBuffer[MAX_UDP_PACKET * 4];
+static	UCHAR			g_ucDecodeBuffer[MAX_UDP_PACKET * 4];
+
+static	std::vector<LOADTEST_CLIENT_s>	g_Clients;
+
+// Command line options.
+static	BYTE			g_abMapChecksum[16];
+static	const char		*g_pszPassword = "";
+static	const char		*g_pszLumpsChecksum = "";
+
+// Totals over all clients, for the statistics of the last second.
+static	unsigned long	g_ulLastBytesReceived = 0;
+static	unsigned long	g_ulLastBytesSent = 0;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static double loadtest_GetTime( void )
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now( ) - g_StartTime ).count( );
+}
+
+//*****************************************************************************
+//
+// We can't know the server's gametic exactly, but this is never ahead of the server's.
+static int loadtest_EstimateServerGametic( const LOADTEST_CLIENT_s &client )
+{
+	const int lServerGametic = client.lServerGametic + static_cast<int>(( loadtest_GetTime( ) - client.dServerGameticTime ) * LOADTEST_TICRATE ) - 1;
+	return std::max( client.lServerGametic, lServerGametic );
+}
+
+//*****************************************************************************
+//
+// Returns the (network byte order) address of the given client.
+static in_addr_t loadtest_GetClientAddress( const unsigned int ulIdx )
+{
+	return htonl(( 127u << 24 ) | ( LOADTEST_CLIENT_NETWORK << 16 ) | (( ulIdx / 250 ) << 8 ) | ( ulIdx % 250 + 1 ));
+}
+
+//*****************************************************************************
+//
+// Huffman-encodes g_SendBuffer and sends it to the server, from the given client's address.
+static void loadtest_SendToServer( const unsigned int ulIdx )
+{
+	int iNumBytesOut = sizeof( g_ucHuffmanBuffer );
+	g_SendBuffer.ulCurrentSize = g_SendBuffer.CalcSize( );
+	HUFFMAN_Encode( g_SendBuffer.pbData, g_ucHuffmanBuffer, g_SendBuffer.ulCurrentSize, &iNumBytesOut );
+
+	struct iovec vector;
+	vector.iov_base = g_ucHuffmanBuffer;
+	vector.iov_len = iNumBytesOut;
+
+	char control[CMSG_SPACE( sizeof( struct in_pktinfo ))];
+	memset( control, 0, sizeof( control ));
+
+	struct msghdr header;
+	memset( &header, 0, sizeof( header ));
+	header.msg_name = &g_ServerAddress;
+	header.msg_namelen = sizeof( g_ServerAddress );
+	header.msg_iov = &vector;
+	header.msg_iovlen = 1;
+	header.msg_control = control;
+	header.msg_controllen = sizeof( control );
+
+	// Send from the client's address.
+	struct cmsghdr *pControlMessage = CMSG_FIRSTHDR( &header );
+	pControlMessage->cmsg_level = IPPROTO_IP;
+	pControlMessage->cmsg_type = IP_PKTINFO;
+	pControlMessage->cmsg_len = CMSG_LEN( sizeof( struct in_pktinfo ));
+	reinterpret_cast<struct in_pktinfo *>( CMSG_DATA( pControlMessage ))->ipi_spec_dst.s_addr = loadtest_GetClientAddress( ulIdx );
+
+	if ( sendmsg( g_Socket, &header, 0 ) == -1 && ( errno != EWOULDBLOCK ))
+		printf( "loadtest_SendToServer: %s\n", strerror( errno ));
+	else
+		g_Clients[ulIdx].ulBytesSent += iNumBytesOut;
+}
+
+//*****************************************************************************
+//
+// Clears the reliable packet bookkeeping, the server starts counting from zero for every new connection.
+static void loadtest_ResetSequences( LOADTEST_CLIENT_s &client )
+{
+	client.lLastParsedSequence = -1;
+	client.lHighestReceivedSequence = -1;
+	client.PendingPackets.clear( );
+}
+
+//*****************************************************************************
+//
+static void loadtest_AttemptConnection( const unsigned int ulIdx )
+{
+	LOADTEST_CLIENT_s &client = g_Clients[ulIdx];
+
+	client.State = LTS_CONNECTING;
+	client.dLastAttempt = loadtest_GetTime( );
+	loadtest_ResetSequences( client );
+
+	g_SendBuffer.Clear( );
+	g_SendBuffer.ByteStream.WriteByte( CLCC_ATTEMPTCONNECTION );
+	g_SendBuffer.ByteStream.WriteString( DOTVERSIONSTR );
+	g_SendBuffer.ByteStream.WriteString( g_pszPassword );
+	g_SendBuffer.ByteStream.WriteByte( 0 ); // Connection flags, we want to play.
+	g_SendBuffer.ByteStream.WriteByte( 0 ); // Don't hide our account.
+	g_SendBuffer.ByteStream.WriteByte( NETGAMEVERSION );
+	g_SendBuffer.ByteStream.WriteString( g_pszLumpsChecksum );
+	loadtest_SendToServer( ulIdx );
+}
+
+//*****************************************************************************
+//
+static void loadtest_AttemptAuthentication( const unsigned int ulIdx )
+{
+	g_Clients[ulIdx].State = LTS_AUTHENTICATING;
+	g_Clients[ulIdx].dLastAttempt = loadtest_GetTime( );
+
+	g_SendBuffer.Clear( );
+	g_SendBuffer.ByteStream.WriteByte( CLCC_ATTEMPTAUTHENTICATION );
+	g_SendBuffer.ByteStream.WriteBuffer( g_abMapChecksum, sizeof( g_abMapChecksum ));
+	loadtest_SendToServer( ulIdx );
+}
+
+//*****************************************************************************
+//
+static void loadtest_RequestSnapshot( const unsigned int ulIdx )
+{
+	const std::string Name = "loadtest" + std::to_string( ulIdx );
+
+	g_Clients[ulIdx].State = LTS_WAITINGFORFULLUPDATE;
+	g_Clients[ulIdx].dLastAttempt = loadtest_GetTime( );
+
+	g_SendBuffer.Clear( );
+	g_SendBuffer.ByteStream.WriteByte( CLCC_REQUESTSNAPSHOT );
+
+	// Our userinfo, just the name, the server uses the defaults for the rest.
+	// Names are written like NETWORK_WriteName does for names that aren't predefined.
+	g_SendBuffer.ByteStream.WriteByte( CLC_USERINFO );
+	g_SendBuffer.ByteStream.WriteShort( -1 );
+	g_SendBuffer.ByteStream.WriteString( "name" );
+	g_SendBuffer.ByteStream.WriteString( Name.c_str( ));
+	g_SendBuffer.ByteStream.WriteShort( 0 ); // NAME_None ends the userinfo.
+	loadtest_SendToServer( ulIdx );
+}
+
+//*****************************************************************************
+//
+// Handles a reliable packet from the server, in the order the server sent them.
+static void loadtest_ParseReliablePacket( const unsigned int ulIdx, const std::vector<BYTE> &Packet )
+{
+	LOADTEST_CLIENT_s &client = g_Clients[ulIdx];
+
+	if ( Packet.empty( ))
+		return;
+
+	BYTESTREAM_s byteStream;
+	byteStream.pbStream = const_cast<BYTE *>( Packet.data( ));
+	byteStream.pbStreamEnd = byteStream.pbStream + Packet.size( );
+
+	switch ( byteStream.ReadByte( ))
+	{
+	case SVCC_AUTHENTICATE:
+
+		if ( client.State == LTS_CONNECTING )
+		{
+			byteStream.ReadString( ); // Map name.
+			client.lServerGametic = byteStream.ReadLong( );
+			client.dServerGameticTime = loadtest_GetTime( );
+			loadtest_AttemptAuthentication( ulIdx );
+		}
+		return;
+	case SVCC_MAPLOAD:
+
+		if ( client.State == LTS_AUTHENTICATING )
+			loadtest_RequestSnapshot( ulIdx );
+		return;
+	}
+
+	// We don't parse the server's commands, but the server always starts a new packet
+	// for the end of the full update, so the first command of each packet is enough.
+	if ( client.State != LTS_WAITINGFORFULLUPDATE )
+		return;
+
+	byteStream.pbStream = const_cast<BYTE *>( Packet.data( ));
+	if (( byteStream.ReadByte( ) == SVC_EXTENDEDCOMMAND ) && ( byteStream.ReadByte( ) == SVC2_FULLUPDATECOMPLETED ))
+	{
+		client.State = LTS_ACTIVE;
+		client.dActiveTime = loadtest_GetTime( );
+
+		g_SendBuffer.Clear( );
+		g_SendBuffer.ByteStream.WriteByte( CLC_FULLUPDATE );
+		loadtest_SendToServer( ulIdx );
+	}
+}
+
+//*****************************************************************************
+//
+// Handles a packet from the server: reliable packets are buffered until all packets
+// before them arrived, like CLIENT_ReadPacketHeader does.
+static void loadtest_ParsePacket( const unsigned int ulIdx, BYTESTREAM_s *pByteStream )
+{
+	LOADTEST_CLIENT_s &client = g_Clients[ulIdx];
+
+	client.ulPacketsReceived++;
+
+	switch ( pByteStream->ReadByte( ))
+	{
+	case SVC_HEADER:
+
+		break;
+	case SVC_UNRELIABLEPACKET:
+
+		// The server sends the movement of the other players in these every tic, with the
+		// gametic as the sequence. We don't parse them, so we take our estimate of it.
+		if ( client.State == LTS_ACTIVE )
+		{
+			client.bMovementAckPending = true;
+			client.ucMovementSequence = static_cast<BYTE>( loadtest_EstimateServerGametic( client ));
+		}
+		return;
+	default:
+
+		return;
+	}
+
+	const int lSequence = pByteStream->ReadLong( );
+
+	// Errors come with sequence 0 if they are about our connection attempt.
+	if (( pByteStream->pbStream < pByteStream->pbStreamEnd ) && ( *pByteStream->pbStream == SVCC_ERROR ))
+	{
+		if ( client.State != LTS_FAILED )
+		{
+			pByteStream->ReadByte( );
+			printf( "Client %u: the server refused us (error code %d).\n", ulIdx, pByteStream->ReadByte( ));
+			client.State = LTS_FAILED;
+		}
+		return;
+	}
+
+	// Skip packets we already have.
+	if (( lSequence <= client.lLastParsedSequence ) || ( client.PendingPackets.count( lSequence ) > 0 ))
+		return;
+
+	// Everything between the highest packet so far and this one got lost.
+	if ( lSequence > client.lHighestReceivedSequence + 1 )
+		client.ulPacketsLost += lSequence - client.lHighestReceivedSequence - 1;
+
+	client.lHighestReceivedSequence = std::max( client.lHighestReceivedSequence, lSequence );
+	client.PendingPackets[lSequence].assign( pByteStream->pbStream, pByteStream->pbStreamEnd );
+
+	std::map<int, std::vector<BYTE> >::iterator it;
+	while (( it = client.PendingPackets.find( client.lLastParsedSequence + 1 )) != client.PendingPackets.end( ))
+	{
+		const std::vector<BYTE> Packet = it->second;
+		client.PendingPackets.erase( it );
+		client.lLastParsedSequence++;
+		loadtest_ParseReliablePacket( ulIdx, Packet );
+	}
+
+	// The server only keeps the last PACKET_BUFFER_SIZE packets, we can't recover from this.
+	if (( client.State != LTS_FAILED ) && ( client.lHighestReceivedSequence - client.lLastParsedSequence >= PACKET_BUFFER_SIZE ))
+	{
+		printf( "Client %u: missing more than %d packets, unable to recover.\n", ulIdx, PACKET_BUFFER_SIZE );
+		client.State = LTS_FAILED;
+	}
+}
+
+//*****************************************************************************
+//
+// Reads everything that arrived and hands it to the client it was sent to.
+static void loadtest_ReceivePackets( void )
+{
+	while ( true )
+	{
+		struct iovec vector;
+		vector.iov_base = g_ucHuffmanBuffer;
+		vector.iov_len = sizeof( g_ucHuffmanBuffer );
+
+		char control[CMSG_SPACE( sizeof( struct in_pktinfo ))];
+		sockaddr_in from;
+
+		struct msghdr header;
+		memset( &header, 0, sizeof( header ));
+		header.msg_name = &from;
+		header.msg_namelen = sizeof( from );
+		header.msg_iov = &vector;
+		header.msg_iovlen = 1;
+		header.msg_control = control;
+		header.msg_controllen = sizeof( control );
+
+		const ssize_t numBytes = recvmsg( g_Socket, &header, 0 );
+		if ( numBytes <= 0 )
+			return;
+
+		// Only listen to the server.
+		if (( from.sin_addr.s_addr != g_ServerAddress.sin_addr.s_addr ) || ( from.sin_port != g_ServerAddress.sin_port ))
+			continue;
+
+		// Find out which of our addresses this was sent to.
+		in_addr_t destination = 0;
+		for ( struct cmsghdr *pControlMessage = CMSG_FIRSTHDR( &header ); pControlMessage; pControlMessage = CMSG_NXTHDR( &header, pControlMessage ))
+		{
+			if (( pControlMessage->cmsg_level == IPPROTO_IP ) && ( pControlMessage->cmsg_type == IP_PKTINFO ))
+				destination = ntohl( reinterpret_cast<struct in_pktinfo *>( CMSG_DATA( pControlMessage ))->ipi_addr.s_addr );
+		}
+
+		const unsigned int ulIdx = (( destination >> 8 ) & 0xFF ) * 250 + ( destination & 0xFF ) - 1;
+		if (((( destination >> 16 ) & 0xFF ) != LOADTEST_CLIENT_NETWORK ) || ( ulIdx >= g_Clients.size( )))
+			continue;
+
+		g_Clients[ulIdx].ulBytesReceived += numBytes;
+
+		int iDecodedNumBytes = sizeof( g_ucDecodeBuffer );
+		HUFFMAN_Decode( g_ucHuffmanBuffer, g_ucDecodeBuffer, static_cast<int>( numBytes ), &iDecodedNumBytes );
+
+		BYTESTREAM_s byteStream;
+		byteStream.pbStream = g_ucDecodeBuffer;
+		byteStream.pbStreamEnd = g_ucDecodeBuffer + iDecodedNumBytes;
+		loadtest_ParsePacket( ulIdx, &byteStream );
+	}
+}
+
+//*****************************************************************************
+//
+// Writes a CLC_PACKETACK like CLIENT_AcknowledgePackets does.
+static void loadtest_WritePacketAck( LOADTEST_CLIENT_s &client )
+{
+	ULONG ulReceivedBits = 0;
+	for ( std::map<int, std::vector<BYTE> >::const_iterator it = client.PendingPackets.begin( ); it != client.PendingPackets.end( ); ++it )
+	{
+		const int lOffset = client.lHighestReceivedSequence - 1 - it->first;
+		if (( lOffset >= 0 ) && ( lOffset < 32 ))
+			ulReceivedBits |= ( 1u << lOffset );
+	}
+
+	g_SendBuffer.ByteStream.WriteByte( CLC_PACKETACK );
+	g_SendBuffer.ByteStream.WriteLong( client.lLastParsedSequence );
+	g_SendBuffer.ByteStream.WriteLong( client.lHighestReceivedSequence );
+	g_SendBuffer.ByteStream.WriteLong( ulReceivedBits );
+}
+
+//*****************************************************************************
+//
+// Writes a CLC_MISSINGPACKET like CLIENT_CheckForMissingPackets does.
+static void loadtest_WriteMissingPackets( LOADTEST_CLIENT_s &client )
+{
+	if ( client.lLastParsedSequence == client.lHighestReceivedSequence )
+		return;
+
+	g_SendBuffer.ByteStream.WriteByte( CLC_MISSINGPACKET );
+
+	for ( int lSequence = client.lLastParsedSequence + 1; lSequence < client.lHighestReceivedSequence; ++lSequence )
+	{
+		if ( client.PendingPackets.count( lSequence ) == 0 )
+		{
+			g_SendBuffer.ByteStream.WriteLong( lSequence );
+			client.ulMissingPacketsRequested++;
+		}
+	}
+
+	g_SendBuffer.ByteStream.WriteLong( -1 );
+}
+
+//*****************************************************************************
+//
+// Writes a CLC_PLAYERMOVEMENTACK like CLIENT_AcknowledgePlayerMovement does. We don't know
+// which players the server sent us, so we acknowledge all that our clients could be. The
+// server ignores the acknowledgements of updates it didn't send.
+static void loadtest_WritePlayerMovementAck( LOADTEST_CLIENT_s &client )
+{
+	if ( client.bMovementAckPending == false )
+		return;
+
+	const unsigned int ulNumPlayers = std::min( static_cast<unsigned int>( g_Clients.size( )), static_cast<unsigned int>( LOADTEST_MAXPLAYERS ));
+
+	g_SendBuffer.ByteStream.WriteByte( CLC_PLAYERMOVEMENTACK );
+	g_SendBuffer.ByteStream.WriteByte( ulNumPlayers );
+	for ( unsigned int ulPlayer = 0; ulPlayer < ulNumPlayers; ++ulPlayer )
+	{
+		g_SendBuffer.ByteStream.WriteByte( ulPlayer );
+		g_SendBuffer.ByteStream.WriteByte( client.ucMovementSequence );
+	}
+
+	client.bMovementAckPending = false;
+}
+
+//*****************************************************************************
+//
+// Writes the movement command for this tic. Every client walks the same script:
+// forward, turn, strafe, back and jump, but each starts at a different point in it.
+static void loadtest_WriteMove( const unsigned int ulIdx, LOADTEST_CLIENT_s &client )
+{
+	const int lStep = (( client.lGametic + ulIdx * 17 ) / LOADTEST_SCRIPT_STEP ) % 4;
+	int lBits = 0;
+	short sYaw = 0;
+	short sForwardMove = 0;
+	short sSideMove = 0;
+	BYTE ucButtons = 0;
+
+	switch ( lStep )
+	{
+	case 0:		sForwardMove = 0x32 << 8;								break;
+	case 1:		sForwardMove = 0x19 << 8;	sYaw = 640;					break;
+	case 2:		sSideMove = 0x28 << 8;		sYaw = -320;				break;
+	case 3:		sForwardMove = -( 0x19 << 8 );	ucButtons = LOADTEST_BT_JUMP;	break;
+	}
+
+	if ( sYaw != 0 )
+		lBits |= LOADTEST_UPDATE_YAW;
+	if ( ucButtons != 0 )
+		lBits |= LOADTEST_UPDATE_BUTTONS;
+	if ( sForwardMove != 0 )
+		lBits |= LOADTEST_UPDATE_FORWARDMOVE;
+	if ( sSideMove != 0 )
+		lBits |= LOADTEST_UPDATE_SIDEMOVE;
+
+	g_SendBuffer.ByteStream.WriteByte( CLC_CLIENTMOVE );
+	g_SendBuffer.ByteStream.WriteLong( ++client.lGametic );
+	g_SendBuffer.ByteStream.WriteLong( loadtest_EstimateServerGametic( client ));
+	g_SendBuffer.ByteStream.WriteByte( lBits );
+	if ( lBits & LOADTEST_UPDATE_YAW )
+		g_SendBuffer.ByteStream.WriteShort( sYaw );
+	if ( lBits & LOADTEST_UPDATE_BUTTONS )
+		g_SendBuffer.ByteStream.WriteByte( ucButtons );
+	if ( lBits & LOADTEST_UPDATE_FORWARDMOVE )
+		g_SendBuffer.ByteStream.WriteShort( sForwardMove );
+	if ( lBits & LOADTEST_UPDATE_SIDEMOVE )
+		g_SendBuffer.ByteStream.WriteShort( sSideMove );
+
+	// The server takes the angles from the ticcmd, it only looks at these and
+	// the checksum with LOG_SUSPICIOUS_CLIENTS.
+	g_SendBuffer.ByteStream.WriteLong( 0 );
+	g_SendBuffer.ByteStream.WriteLong( 0 );
+	g_SendBuffer.ByteStream.WriteLong( 0 );
+}
+
+//*****************************************************************************
+//
+// Does what the client does every tic: acknowledge the packets we got, request the
+// missing ones every 1/4 second and, once we are in the game, acknowledge the other
+// players' movement and move.
+static void loadtest_Tick( const unsigned int ulIdx, const unsigned long ulTic )
+{
+	LOADTEST_CLIENT_s &client = g_Clients[ulIdx];
+	const double dTime = loadtest_GetTime( );
+
+	switch ( client.State )
+	{
+	case LTS_CONNECTING:
+
+		if ( dTime - client.dLastAttempt >= LOADTEST_RESEND_INTERVAL )
+			loadtest_AttemptConnection( ulIdx );
+		return;
+	case LTS_AUTHENTICATING:
+
+		if ( dTime - client.dLastAttempt >= LOADTEST_RESEND_INTERVAL )
+			loadtest_AttemptAuthentication( ulIdx );
+		return;
+	case LTS_FAILED:
+
+		return;
+	default:
+
+		break;
+	}
+
+	g_SendBuffer.Clear( );
+	if ( client.lHighestReceivedSequence >= 0 )
+		loadtest_WritePacketAck( client );
+	if (( ulTic + ulIdx ) % ( LOADTEST_TICRATE / 4 ) == 0 )
+		loadtest_WriteMissingPackets( client );
+	if ( client.State == LTS_ACTIVE )
+	{
+		loadtest_WritePlayerMovementAck( client );
+		loadtest_WriteMove( ulIdx, client );
+	}
+
+	if ( g_SendBuffer.CalcSize( ) > 0 )
+		loadtest_SendToServer( ulIdx );
+}
+
+//*****************************************************************************
+//
+// Reads the total tic time from the server's profile export (sv_profileexportfile).
+static bool loadtest_ReadProfile( const char *pszFileName, LOADTEST_PROFILE_s &Profile )
+{
+	FILE *pFile = fopen( pszFileName, "r" );
+	if ( pFile == NULL )
+		return ( false );
+
+	char szLine[256];
+	bool bFoundSum = false;
+	bool bFoundCount = false;
+
+	while ( fgets( szLine, sizeof( szLine ), pFile ))
+	{
+		if ( sscanf( szLine, "zandronum_tic_ms_sum{stage=\"total\"} %lf", &Profile.dTicSum ) == 1 )
+			bFoundSum = true;
+		else if ( sscanf( szLine, "zandronum_tic_ms_count{stage=\"total\"} %lu", &Profile.ulNumTics ) == 1 )
+			bFoundCount = true;
+		else
+			sscanf( szLine, "zandronum_slow_tics_total %lu", &Profile.ulNumSlowTics );
+	}
+
+	fclose( pFile );
+	return ( bFoundSum && bFoundCount );
+}
+
+//*****************************************************************************
+//
+static void loadtest_PrintStatistics( const double dTime )
+{
+	unsigned long ulBytesReceived = 0;
+	unsigned long ulBytesSent = 0;
+	unsigned long ulPacketsReceived = 0;
+	unsigned long ulPacketsLost = 0;
+	unsigned long ulExpectedPackets = 0;
+	unsigned long ulMissingPacketsRequested = 0;
+	unsigned int ulNumActive = 0;
+	unsigned int ulNumFailed = 0;
+
+	for ( unsigned int i = 0; i < g_Clients.size( ); ++i )
+	{
+		const LOADTEST_CLIENT_s &client = g_Clients[i];
+
+		ulBytesReceived += client.ulBytesReceived;
+		ulBytesSent += client.ulBytesSent;
+		ulPacketsReceived += client.ulPacketsReceived;
+		ulPacketsLost += client.ulPacketsLost;
+		ulExpectedPackets += client.lHighestReceivedSequence + 1;
+		ulMissingPacketsRequested += client.ulMissingPacketsRequested;
+
+		if ( client.State == LTS_ACTIVE )
+			ulNumActive++;
+		else if ( client.State == LTS_FAILED )
+			ulNumFailed++;
+	}
+
+	const unsigned int ulNumConnected = std::max( g_Clients.size( ) - ulNumFailed, static_cast<size_t>( 1 ));
+
+	printf( "%6.1fs: %u/%u clients in the game, %u failed, %.2f KB/s down / %.2f KB/s up per client, %lu packets, %lu lost (%.2f%%), %lu requested again\n",
+		dTime, ulNumActive, static_cast<unsigned int>( g_Clients.size( )), ulNumFailed,
+		( ulBytesReceived - g_ulLastBytesReceived ) / 1024.0 / ulNumConnected, ( ulBytesSent - g_ulLastBytesSent ) / 1024.0 / ulNumConnected,
+		ulPacketsReceived, ulPacketsLost, ( ulExpectedPackets > 0 ) ? ( 100.0 * ulPacketsLost / ulExpectedPackets ) : 0.0, ulMissingPacketsRequested );
+
+	g_ulLastBytesReceived = ulBytesReceived;
+	g_ulLastBytesSent = ulBytesSent;
+}
+
+//*****************************************************************************
+//
+static void loadtest_PrintSummary( const double dTime, const char *pszProfile, const LOADTEST_PROFILE_s &StartProfile, const bool bHaveStartProfile )
+{
+	unsigned int ulNumActive = 0;
+	double dDownRate = 0, dMaxDownRate = 0;
+	double dUpRate = 0;
+	double dFullUpdateTime = 0, dMaxFullUpdateTime = 0;
+
+	for ( unsigned int i = 0; i < g_Clients.size( ); ++i )
+	{
+		const LOADTEST_CLIENT_s &client = g_Clients[i];
+
+		if ( client.State != LTS_ACTIVE )
+			continue;
+
+		// The rates are over the whole connection, including the full update.
+		const double dConnectedTime = std::max( dTime - client.dConnectTime, 1.0 );
+		dDownRate += client.ulBytesReceived / 1024.0 / dConnectedTime;
+		dMaxDownRate = std::max( dMaxDownRate, client.ulBytesReceived / 1024.0 / dConnectedTime );
+		dUpRate += client.ulBytesSent / 1024.0 / dConnectedTime;
+		dFullUpdateTime += client.dActiveTime - client.dConnectTime;
+		dMaxFullUpdateTime = std::max( dMaxFullUpdateTime, client.dActiveTime - client.dConnectTime );
+		ulNumActive++;
+	}
+
+	printf( "\n%u of %u clients made it into the game.\n", ulNumActive, static_cast<unsigned int>( g_Clients.size( )));
+	if ( ulNumActive > 0 )
+	{
+		printf( "Per client: %.2f KB/s down (%.2f KB/s max), %.2f KB/s up, %.2f s until the full update was completed (%.2f s max).\n",
+			dDownRate / ulNumActive, dMaxDownRate, dUpRate / ulNumActive, dFullUpdateTime / ulNumActive, dMaxFullUpdateTime );
+	}
+
+	if ( pszProfile == NULL )
+		return;
+
+	// The server only writes the export every sv_profileexportinterval seconds, so this
+	// doesn't cover the run exactly.
+	LOADTEST_PROFILE_s EndProfile = { 0, 0, 0 };
+	if ( loadtest_ReadProfile( pszProfile, EndProfile ) == false )
+	{
+		printf( "Couldn't read the server's profile from %s.\n", pszProfile );
+		return;
+	}
+
+	// Someone cleared the profile during the run.
+	LOADTEST_PROFILE_s Profile = EndProfile;
+	if ( bHaveStartProfile && ( EndProfile.ulNumTics >= StartProfile.ulNumTics ))
+	{
+		Profile.dTicSum -= StartProfile.dTicSum;
+		Profile.ulNumTics -= StartProfile.ulNumTics;
+		Profile.ulNumSlowTics -= std::min( StartProfile.ulNumSlowTics, Profile.ulNumSlowTics );
+	}
+
+	if ( Profile.ulNumTics > 0 )
+		printf( "Server: %.3f ms per tic over %lu tics, %lu slow tics.\n", Profile.dTicSum / Profile.ulNumTics, Profile.ulNumTics, Profile.ulNumSlowTics );
+	else
+		printf( "Server: the profile export wasn't updated during the run (see sv_profileexportinterval).\n" );
+}
+
+//*****************************************************************************
+//
+int main( int argc, char **argv )
+{
+	unsigned int	ulNumClients = 16;
+	double			dDuration = 60;
+	const char		*pszServer = "127.0.0.1";
+	const char		*pszChecksum = NULL;
+	const char		*pszProfile = NULL;
+
+	for ( int i = 1; i + 1 < argc; i += 2 )
+	{
+		if ( stricmp( argv[i], "-clients" ) == 0 )
+			ulNumClients = atoi( argv[i + 1] );
+		else if ( stricmp( argv[i], "-time" ) == 0 )
+			dDuration = atof( argv[i + 1] );
+		else if ( stricmp( argv[i], "-server" ) == 0 )
+			pszServer = argv[i + 1];
+		else if ( stricmp( argv[i], "-checksum" ) == 0 )
+			pszChecksum = argv[i + 1];
+		else if ( stricmp( argv[i], "-password" ) == 0 )
+			g_pszPassword = argv[i + 1];
+		else if ( stricmp( argv[i], "-lumps" ) == 0 )
+			g_pszLumpsChecksum = argv[i + 1];
+		else if ( stricmp( argv[i], "-profile" ) == 0 )
+			pszProfile = argv[i + 1];
+	}
+
+	// The map checksum, as printed by "mapchecksum".
+	if (( pszChecksum == NULL ) || ( strlen( pszChecksum ) != 2 * sizeof( g_abMapChecksum )))
+	{
+		printf( "Usage: %s -checksum <map checksum> [-clients N] [-time seconds] [-server address:port] [-password password] [-lumps checksum] [-profile file]\n", argv[0] );
+		printf( "Use \"mapchecksum <map>\" on the server to get the checksum of the map it's running.\n" );
+		return ( 1 );
+	}
+	for ( unsigned int i = 0; i < sizeof( g_abMapChecksum ); ++i )
+	{
+		unsigned int ulByte;
+		if ( sscanf( pszChecksum + 2 * i, "%2x", &ulByte ) != 1 )
+		{
+			printf( "Invalid map checksum: %s\n", pszChecksum );
+			return ( 1 );
+		}
+		g_abMapChecksum[i] = static_cast<BYTE>( ulByte );
+	}
+
+	// Each client needs its own address in 127.1.0.0/16.
+	ulNumClients = std::min( ulNumClients, 250u * 256u );
+
+	NETADDRESS_s ServerAddress;
+	if ( ServerAddress.LoadFromString( pszServer ) == false )
+	{
+		printf( "Invalid server address: %s\n", pszServer );
+		return ( 1 );
+	}
+	if ( ServerAddress.usPort == 0 )
+		ServerAddress.SetPort( DEFAULT_SERVER_PORT );
+	ServerAddress.ToSocketAddress( reinterpret_cast<sockaddr &>( g_ServerAddress ));
+
+	HUFFMAN_Construct( );
+	g_SendBuffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+
+	// Bind to all addresses, so that we get the packets for every client.
+	g_Socket = socket( PF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	sockaddr_in LocalAddress;
+	memset( &LocalAddress, 0, sizeof( LocalAddress ));
+	LocalAddress.sin_family = AF_INET;
+	LocalAddress.sin_addr.s_addr = INADDR_ANY;
+
+	int enable = 1;
+	if (( g_Socket == INVALID_SOCKET )
+		|| ( bind( g_Socket, reinterpret_cast<sockaddr *>( &LocalAddress ), sizeof( LocalAddress )) == SOCKET_ERROR )
+		|| ( setsockopt( g_Socket, IPPROTO_IP, IP_PKTINFO, &enable, sizeof( enable )) == SOCKET_ERROR ))
+	{
+		printf( "Couldn't set up the socket: %s\n", strerror( errno ));
+		return ( 1 );
+	}
+
+	// The full updates of many clients arrive at once.
+	int bufferSize = 8 * 1024 * 1024;
+	setsockopt( g_Socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof( bufferSize ));
+
+	ULONG ulArg = true;
+	ioctlsocket( g_Socket, FIONBIO, &ulArg );
+
+	printf( "Connecting %u clients to %s for %.0f seconds.\n", ulNumClients, ServerAddress.ToString( ), dDuration );
+
+	LOADTEST_PROFILE_s StartProfile = { 0, 0, 0 };
+	const bool bHaveStartProfile = ( pszProfile != NULL ) && loadtest_ReadProfile( pszProfile, StartProfile );
+
+	g_StartTime = std::chrono::steady_clock::now( );
+
+	g_Clients.resize( ulNumClients );
+	for ( unsigned int i = 0; i < ulNumClients; ++i )
+	{
+		LOADTEST_CLIENT_s &client = g_Clients[i];
+
+		client.dConnectTime = loadtest_GetTime( );
+		client.dActiveTime = 0;
+		client.lServerGametic = 0;
+		client.dServerGameticTime = 0;
+		client.lGametic = 0;
+		client.bMovementAckPending = false;
+		client.ucMovementSequence = 0;
+		client.ulBytesReceived = 0;
+		client.ulBytesSent = 0;
+		client.ulPacketsReceived = 0;
+		client.ulPacketsLost = 0;
+		client.ulMissingPacketsRequested = 0;
+		loadtest_AttemptConnection( i );
+	}
+
+	unsigned long ulTic = 0;
+	double dNextStatistics = 1;
+	double dTime;
+
+	while (( dTime = loadtest_GetTime( )) < dDuration )
+	{
+		// Tick the clients at the server's tic rate.
+		while ( ulTic < dTime * LOADTEST_TICRATE )
+		{
+			for ( unsigned int i = 0; i < ulNumClients; ++i )
+				loadtest_Tick( i, ulTic );
+			ulTic++;
+		}
+
+		struct pollfd pollSocket;
+		pollSocket.fd = g_Socket;
+		pollSocket.events = POLLIN;
+		poll( &pollSocket, 1, 1 );
+		loadtest_ReceivePackets( );
+
+		if ( dTime >= dNextStatistics )
+		{
+			loadtest_PrintStatistics( dTime );
+			dNextStatistics += 1;
+		}
+	}
+
+	// Let the server know we're gone, so that it doesn't have to wait for the timeout.
+	for ( unsigned int i = 0; i < ulNumClients; ++i )
+	{
+		g_SendBuffer.Clear( );
+		g_SendBuffer.ByteStream.WriteByte( CLC_QUIT );
+		loadtest_SendToServer( i );
+	}
+
+	loadtest_PrintSummary( dTime, pszProfile, StartProfile, bHaveStartProfile );
+	g_SendBuffer.Free( );
+	closesocket( g_Socket );
+	return ( 0 );
+}
+
+#else
+
+int main( int argc, char **argv )
+{
+	printf( "The server load generator needs Linux (IP_PKTINFO on the loopback network).\n" );
+	return ( 1 );
+}
+
+#endif
@@ -0,0 +1,478 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: netsim.cpp
+//
+// Description: Network simulator for the packet loss recovery of the game
+// server. It runs the server's OutgoingPacketBuffer against a simulated client
+// over a simulated link with latency, random loss and a bottleneck with limited
+// bandwidth and queue, entirely in memory and in simulated time. The server
+// sends a full update as a burst of packets and then one packet per tic, the
+// client acknowledges what it has every tic and requests the missing packets
+// like the real client does. Each link is simulated with and without
+// sv_adaptivepacing.
+//
+// The parts of OutgoingPacketBuffer that talk to the real client (see
+// sv_main.cpp) are defined here and talk to the simulated link instead.
+//
+// Without a loss rate, a few typical links are simulated. The exit code is
+// non-zero if the full update didn't get through on one of them.
+//
+// Usage: server-netsim [loss percent] [one way latency in ms]
+//        [full update packets] [link packets per tick] [link queue packets]
+//
+//-----------------------------------------------------------------------------
+
+#include "../src/doomtype.h"
+#include "../src/doomdef.h"
+#include "../src/templates.h"
+#include "../src/networkshared.h"
+#include "../src/network/packetarchive.h"
+
+#include <queue>
+#include <random>
+#include <vector>
+
+//*****************************************************************************
+//	DEFINES
+
+// The default of sv_maxpacketspertick.
+#define	NETSIM_MAXPACKETSPERTICK		64
+
+// How long the client has to get the full update (tics).
+#define	NETSIM_MAXTICS					( 60 * TICRATE )
+
+// How many packets before the highest received one the client acknowledges, like CLIENT_AcknowledgePackets.
+#define	NETSIM_ACK_WINDOW				32
+
+//*****************************************************************************
+//	STRUCTURES
+
+typedef struct NETSIM_EVENT_s
+{
+	double			dTime;
+	bool			bToClient;
+
+	// A packet for the client.
+	unsigned int	ulPacketNumber;
+
+	// An acknowledgement or missing packet request for the server.
+	int				lLastParsed;
+	int				lHighestReceived;
+	unsigned int	ulReceivedBits;
+	std::vector<unsigned int>	MissingPackets;
+
+	// The priority queue puts the earliest event first.
+	bool operator< ( const NETSIM_EVENT_s &Other ) const { return dTime > Other.dTime; }
+
+} NETSIM_EVENT_s;
+
+typedef struct
+{
+	double			dLossRate;
+	double			dLatency;
+	unsigned int	ulNumBurstPackets;
+	unsigned int	ulLinkPacketsPerTick;
+	unsigned int	ulQueueLimit;
+
+} NETSIM_LINKSETTINGS_s;
+
+typedef struct
+{
+	NETSIM_LINKSETTINGS_s	Settings;
+	bool			bAdaptive;
+	bool			bAborted;
+
+	// The simulated time (in ms) and when the bottleneck is free again.
+	double			dNow;
+	double			dLinkFreeTime;
+	double			dLinkInterval;
+
+	std::priority_queue<NETSIM_EVENT_s>	Events;
+	std::mt19937	Random;
+
+	// Statistics.
+	unsigned int	ulPacketsThisTick;
+	unsigned int	ulPeakPacketsPerTick;
+	unsigned int	ulNumSent;
+	unsigned int	ulNumQueueDrops;
+	unsigned int	ulNumRandomDrops;
+
+} NETSIM_LINK_s;
+
+//*****************************************************************************
+//	VARIABLES
+
+// The link the packet buffer is currently sending over.
+static	NETSIM_LINK_s	*g_pLink = NULL;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+// TArray needs these. The game's own (m_alloc.cpp) depend on the garbage collector.
+#if defined(_DEBUG)
+void *M_Malloc_Dbg( size_t size, const char *file, int lineno )
+#else
+void *M_Malloc( size_t size )
+#endif
+{
+	void *block = malloc( size );
+
+	if ( block == NULL )
+	{
+		fprintf( stderr, "Could not malloc %lu bytes.\n", static_cast<unsigned long>( size ));
+		exit( 1 );
+	}
+
+	return ( block );
+}
+
+//*****************************************************************************
+//
+#if defined(_DEBUG)
+void *M_Realloc_Dbg( void *memblock, size_t size, const char *file, int lineno )
+#else
+void *M_Realloc( void *memblock, size_t size )
+#endif
+{
+	void *block = realloc( memblock, size );
+
+	if (( block == NULL ) && ( size > 0 ))
+	{
+		fprintf( stderr, "Could not realloc %lu bytes.\n", static_cast<unsigned long>( size ));
+		exit( 1 );
+	}
+
+	return ( block );
+}
+
+//*****************************************************************************
+//
+void M_Free( void *memblock )
+{
+	free( memblock );
+}
+
+//*****************************************************************************
+//
+static bool netsim_Drop( NETSIM_LINK_s &Link )
+{
+	return std::uniform_real_distribution<double>( 0, 1 )( Link.Random ) < Link.Settings.dLossRate;
+}
+
+//*****************************************************************************
+//
+// The client's messages don't go through the bottleneck, only the latency and loss apply.
+static void netsim_SendToServer( NETSIM_LINK_s &Link, NETSIM_EVENT_s &Event )
+{
+	if ( netsim_Drop( Link ))
+		return;
+
+	Event.bToClient = false;
+	Event.dTime = Link.dNow + Link.Settings.dLatency;
+	Link.Events.push( Event );
+}
+
+//*****************************************************************************
+//
+void OutgoingPacketBuffer::LaunchPacket ( unsigned int packetNumber, const BYTE *data, size_t size )
+{
+	NETSIM_LINK_s &Link = *g_pLink;
+
+	Link.ulNumSent++;
+	Link.ulPacketsThisTick++;
+
+	// The packets queue up in front of the bottleneck, if the queue is full they're lost.
+	const double dDeparture = MAX( Link.dLinkFreeTime, Link.dNow );
+	if ( dDeparture - Link.dNow >= Link.Settings.ulQueueLimit * Link.dLinkInterval )
+	{
+		Link.ulNumQueueDrops++;
+		return;
+	}
+	Link.dLinkFreeTime = dDeparture + Link.dLinkInterval;
+
+	if ( netsim_Drop( Link ))
+	{
+		Link.ulNumRandomDrops++;
+		return;
+	}
+
+	NETSIM_EVENT_s Event;
+	Event.dTime = Link.dLinkFreeTime + Link.Settings.dLatency;
+	Event.bToClient = true;
+	Event.ulPacketNumber = packetNumber;
+	Link.Events.push( Event );
+}
+
+//*****************************************************************************
+//
+void OutgoingPacketBuffer::Abort ( const char *reason )
+{
+	g_pLink->bAborted = true;
+}
+
+//*****************************************************************************
+//
+unsigned int OutgoingPacketBuffer::GetTime ( ) const
+{
+	return static_cast<unsigned int>( g_pLink->dNow );
+}
+
+//*****************************************************************************
+//
+bool OutgoingPacketBuffer::UsesAdaptivePacing ( ) const
+{
+	return g_pLink->bAdaptive;
+}
+
+//*****************************************************************************
+//
+unsigned int OutgoingPacketBuffer::GetMaxPacketsPerTick ( ) const
+{
+	return NETSIM_MAXPACKETSPERTICK;
+}
+
+//*****************************************************************************
+//
+// Sends a full update followed by one packet per tic over the link and returns
+// how long it took (in ms) until the client parsed the full update, or a negative
+// value if the client couldn't recover.
+static double netsim_SimulateFullUpdate( NETSIM_LINK_s &Link, OutgoingPacketBuffer &Buffer )
+{
+	const double dTicTime = 1000.0 / TICRATE;
+	std::vector<bool> Received;
+	int lLastParsed = -1;
+	int lHighestReceived = -1;
+	int lMissingPacketTics = 0;
+	int lLastPacketLossTic = -TICRATE;
+
+	NETBUFFER_s Packet;
+	Packet.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+	for ( unsigned int i = 0; i < 1000; ++i )
+		Packet.ByteStream.WriteByte( i & 0xFF );
+
+	Buffer.Initialize( MAX_UDP_PACKET );
+	for ( unsigned int ulTic = 0; ulTic < NETSIM_MAXTICS; ++ulTic )
+	{
+		Link.dNow = ulTic * dTicTime;
+		Link.ulPacketsThisTick = 0;
+
+		// Deliver everything that arrived by now.
+		while (( Link.Events.empty( ) == false ) && ( Link.Events.top( ).dTime <= Link.dNow ))
+		{
+			const NETSIM_EVENT_s Event = Link.Events.top( );
+			Link.Events.pop( );
+
+			if ( Event.bToClient )
+			{
+				if ( Event.ulPacketNumber >= Received.size( ))
+					Received.resize( Event.ulPacketNumber + 1, false );
+				Received[Event.ulPacketNumber] = true;
+				lHighestReceived = MAX( lHighestReceived, static_cast<int>( Event.ulPacketNumber ));
+				while (( lLastParsed + 1 < static_cast<int>( Received.size( ))) && Received[lLastParsed + 1] )
+					++lLastParsed;
+			}
+			else if ( Event.MissingPackets.size( ) > 0 )
+			{
+				// Like server_MissingPacket, don't allow requests too often.
+				if ( static_cast<int>( ulTic ) <= lLastPacketLossTic + ( TICRATE / 4 ))
+					continue;
+
+				for ( unsigned int i = 0; i < Event.MissingPackets.size( ); ++i )
+				{
+					if ( Buffer.SchedulePacket( Event.MissingPackets[i] ) == false )
+						Link.bAborted = true;
+				}
+				lLastPacketLossTic = ulTic;
+			}
+			else
+				Buffer.Acknowledge( Event.lLastParsed, Event.lHighestReceived, Event.ulReceivedBits );
+		}
+
+		if ( lLastParsed + 1 >= static_cast<int>( Link.Settings.ulNumBurstPackets ))
+		{
+			Buffer.Free( );
+			Packet.Free( );
+			return ( Link.dNow );
+		}
+
+		// The server sends the full update on the first tic, afterwards a packet per tic.
+		for ( unsigned int i = 0; i < (( ulTic == 0 ) ? Link.Settings.ulNumBurstPackets : 1 ); ++i )
+			Buffer.ScheduleUnsentPacket( Packet );
+		Buffer.Tick( );
+		Link.ulPeakPacketsPerTick = MAX( Link.ulPeakPacketsPerTick, Link.ulPacketsThisTick );
+
+		if ( Link.bAborted )
+			break;
+
+		// The client acknowledges what it has every tic.
+		if ( lHighestReceived >= 0 )
+		{
+			NETSIM_EVENT_s Ack;
+			Ack.lLastParsed = lLastParsed;
+			Ack.lHighestReceived = lHighestReceived;
+			Ack.ulReceivedBits = 0;
+			for ( int i = 0; i < NETSIM_ACK_WINDOW; ++i )
+			{
+				const int lPacketNumber = lHighestReceived - 1 - i;
+				if (( lPacketNumber >= 0 ) && Received[lPacketNumber] )
+					Ack.ulReceivedBits |= 1u << i;
+			}
+			netsim_SendToServer( Link, Ack );
+		}
+
+		// And requests the missing packets like CLIENT_CheckForMissingPackets does.
+		if ( lMissingPacketTics > 0 )
+			--lMissingPacketTics;
+		else
+		{
+			NETSIM_EVENT_s Request;
+			for ( int i = lLastParsed + 1; i < lHighestReceived; ++i )
+			{
+				if ( Received[i] == false )
+					Request.MissingPackets.push_back( i );
+			}
+			if ( Request.MissingPackets.size( ) > 0 )
+				netsim_SendToServer( Link, Request );
+			lMissingPacketTics = TICRATE / 4;
+		}
+	}
+
+	Buffer.Free( );
+	Packet.Free( );
+	return ( -1 );
+}
+
+//*****************************************************************************
+//
+// Simulates the full update over the link with and without adaptive pacing.
+// Returns false if it didn't get through in one of them.
+static bool netsim_SimulateLink( const NETSIM_LINKSETTINGS_s &Settings )
+{
+	bool bRecovered = true;
+
+	printf( "Full update of %u packets, %g%% loss, %g ms latency, link of %u packets per tick with a queue of %u packets:\n",
+		Settings.ulNumBurstPackets, Settings.dLossRate * 100, Settings.dLatency, Settings.ulLinkPacketsPerTick, Settings.ulQueueLimit );
+
+	for ( unsigned int ulPass = 0; ulPass < 2; ++ulPass )
+	{
+		NETSIM_LINK_s Link;
+		Link.Settings = Settings;
+		Link.bAdaptive = ( ulPass == 1 );
+		Link.bAborted = false;
+		Link.dNow = 0;
+		Link.dLinkFreeTime = 0;
+		Link.dLinkInterval = 1000.0 / TICRATE / Settings.ulLinkPacketsPerTick;
+		Link.Random.seed( 12345 );
+		Link.ulPacketsThisTick = 0;
+		Link.ulPeakPacketsPerTick = 0;
+		Link.ulNumSent = 0;
+		Link.ulNumQueueDrops = 0;
+		Link.ulNumRandomDrops = 0;
+		g_pLink = &Link;
+
+		OutgoingPacketBuffer Buffer;
+		const double dRecoveryTime = netsim_SimulateFullUpdate( Link, Buffer );
+
+		printf( "%-9s ", Link.bAdaptive ? "adaptive:" : "fixed:" );
+		if ( dRecoveryTime < 0 )
+		{
+			printf( "not recovered" );
+			bRecovered = false;
+		}
+		else
+			printf( "complete after %.0f ms", dRecoveryTime );
+
+		printf( ", %u packets sent (%u retransmitted), %u dropped by the queue, peak of %u packets per tick",
+			Link.ulNumSent, Buffer.GetNumRetransmissions( ), Link.ulNumQueueDrops, Link.ulPeakPacketsPerTick );
+		if ( Link.bAdaptive )
+			printf( ", RTT %.0f ms, loss %.1f%%, %u congestion events, pacing %.1f packets per tick", Buffer.GetSmoothedRTT( ), Buffer.GetLossRate( ) * 100, Buffer.GetNumCongestionEvents( ), Buffer.GetPacingRate( ));
+		printf( "\n" );
+
+		g_pLink = NULL;
+	}
+
+	return ( bRecovered );
+}
+
+//*****************************************************************************
+//
+int main( int argc, char **argv )
+{
+	NETSIM_LINKSETTINGS_s Settings;
+	Settings.dLossRate = 0;
+	Settings.dLatency = 50;
+	Settings.ulNumBurstPackets = 300;
+	Settings.ulLinkPacketsPerTick = 16;
+	Settings.ulQueueLimit = 32;
+
+	if ( argc >= 2 )
+	{
+		Settings.dLossRate = clamp( atof( argv[1] ), 0.0, 90.0 ) / 100;
+		if ( argc >= 3 )
+			Settings.dLatency = MAX( 0.0, atof( argv[2] ));
+		if ( argc >= 4 )
+			Settings.ulNumBurstPackets = clamp( atoi( argv[3] ), 1, PACKET_BUFFER_SIZE / 2 );
+		if ( argc >= 5 )
+			Settings.ulLinkPacketsPerTick = clamp( atoi( argv[4] ), 1, 1000 );
+		if ( argc >= 6 )
+			Settings.ulQueueLimit = clamp( atoi( argv[5] ), 1, 10000 );
+
+		return ( netsim_SimulateLink( Settings ) ? 0 : 1 );
+	}
+
+	// A good link, a lossy one and a slow one with a long delay.
+	bool bRecovered = true;
+	const double adLossRates[] = { 0, 0.05, 0.2 };
+	for ( unsigned int i = 0; i < countof( adLossRates ); ++i )
+	{
+		Settings.dLossRate = adLossRates[i];
+		bRecovered &= netsim_SimulateLink( Settings );
+	}
+
+	Settings.dLossRate = 0.02;
+	Settings.dLatency = 150;
+	Settings.ulLinkPacketsPerTick = 4;
+	bRecovered &= netsim_SimulateLink( Settings );
+
+	return ( bRecovered ? 0 : 1 );
+}
@@ -624,8 +624,7 @@ struct FBlockNode
 {
 	AActor *Me;						// actor this node references
 	int BlockIndex;					// index into blocklinks for the block this node is in
-	FBlockNode **PrevActor;			// previous actor in this block
-	FBlockNode *NextActor;			// next actor in this block
+	int BlockSlot;					// index into the block's Things for this actor
 	FBlockNode **PrevBlock;			// previous block this actor is in
 	FBlockNode *NextBlock;			// next block this actor is in
 
@@ -635,6 +634,26 @@ struct FBlockNode
 	static FBlockNode *FreeBlocks;
 };
 
+// An actor in one block of the blockmap.
+struct FBlockThing
+{
+	AActor *Me;
+	FBlockNode *Node;
+};
+
+// The actors in one block of the blockmap, in the order they were linked in. They
+// are kept in one array, so that going through them doesn't chase a pointer per actor.
+// Unlinking an actor only clears its entry, so that the indices of everybody else and
+// any loop over the block stay valid. P_CompactBlockLinks closes the gaps once per tic.
+// Loops go from the end to the start, the newest actor comes first like it always did.
+struct FBlockLinks
+{
+	TArray<FBlockThing> Things;
+	bool Dirty;
+
+	FBlockLinks() : Dirty(false) {}
+};
+
 class FDecalBase;
 class AInventory;
 
@@ -1187,6 +1206,9 @@ public:
 	// [BB] Last movedir that was sent to the client.
 	BYTE lastMovedir;
 
+	// Clients that missed position updates of this actor because it wasn't relevant to them.
+	QWORD netStaleClients;
+
 	// [BOF] Save more MapThing values for map resets.
 	TMap<PSymbolVariable *, int> savedUserVars;
 
@@ -1418,6 +1440,9 @@ public:
 
 	unsigned short getNewID ( );
 
+	// Returns how many network IDs are still free.
+	unsigned int countFreeIDs ( ) const;
+
 	T* findPointerByID ( const unsigned short netID ) const
 	{
 		if ( isIndexValid ( netID ) == false )
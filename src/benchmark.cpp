@@ -0,0 +1,133 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+//
+// Filename: benchmark.cpp
+//
+// Description: Developer benchmarks, all run through the "benchmark" console
+// command. They are not compiled into release builds.
+//
+//-----------------------------------------------------------------------------
+
+#include "benchmark.h"
+
+#if BUILD_ID != BUILD_RELEASE
+
+#include <string.h>
+#include "doomtype.h"
+#include "c_console.h"
+#include "tarray.h"
+#include "zstring.h"
+
+//*****************************************************************************
+//	VARIABLES
+
+FBenchmark *FBenchmark::s_pFirst = NULL;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+FBenchmark::FBenchmark( const char *pszName, RunFunc Func )
+	: m_pszName( pszName ), m_Func( Func )
+{
+	// The benchmarks register themselves during static initialization, s_pFirst
+	// is already NULL then since it's initialized with a constant.
+	FBenchmark **ppLink = &s_pFirst;
+	while (( *ppLink != NULL ) && ( stricmp( ( *ppLink )->m_pszName, pszName ) < 0 ))
+		ppLink = &( *ppLink )->m_pNext;
+
+	m_pNext = *ppLink;
+	*ppLink = this;
+}
+
+//*****************************************************************************
+//
+FBenchmark *FBenchmark::FindByName( const char *pszName )
+{
+	for ( FBenchmark *pBenchmark = s_pFirst; pBenchmark != NULL; pBenchmark = pBenchmark->m_pNext )
+	{
+		if ( stricmp( pBenchmark->m_pszName, pszName ) == 0 )
+			return ( pBenchmark );
+	}
+
+	return ( NULL );
+}
+
+//*****************************************************************************
+//
+void FBenchmark::PrintNames( void )
+{
+	for ( FBenchmark *pBenchmark = s_pFirst; pBenchmark != NULL; pBenchmark = pBenchmark->m_pNext )
+		Printf( "  %s\n", pBenchmark->m_pszName );
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+CCMD( benchmark )
+{
+	if ( argv.argc( ) < 2 )
+	{
+		Printf( "Usage: benchmark <name> [arguments]\n" );
+		Printf( "Available benchmarks:\n" );
+		FBenchmark::PrintNames( );
+		return;
+	}
+
+	const FBenchmark *pBenchmark = FBenchmark::FindByName( argv[1] );
+	if ( pBenchmark == NULL )
+	{
+		Printf( "Unknown benchmark \"%s\".\n", argv[1] );
+		return;
+	}
+
+	// The benchmark sees its own name as argv[0].
+	TArray<FString> args;
+	for ( int i = 1; i < argv.argc( ); i++ )
+		args.Push( argv[i] );
+
+	const FString commandLine = BuildString( args.Size( ), &args[0] );
+	FCommandLine benchmarkArgv( commandLine );
+	pBenchmark->Run( benchmarkArgv );
+}
+
+#endif // BUILD_ID != BUILD_RELEASE
@@ -0,0 +1,97 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+//
+// Filename: benchmark.h
+//
+// Description: Developer benchmarks, all run through the "benchmark" console
+// command. They are not compiled into release builds.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include "c_dispatch.h"
+#include "version.h"
+
+#if BUILD_ID != BUILD_RELEASE
+
+//*****************************************************************************
+//	DEFINES
+
+// Defines a benchmark that is run with "benchmark <name> [arguments]". Like a
+// console command, the body gets the arguments in argv, starting with the name
+// of the benchmark in argv[0].
+#define BENCHMARK(n) \
+	static void Benchmark_##n( FCommandLine &argv ); \
+	static FBenchmark Benchmark_##n##_Ref( #n, Benchmark_##n ); \
+	static void Benchmark_##n( FCommandLine &argv )
+
+//*****************************************************************************
+//	CLASSES
+
+class FBenchmark
+{
+public:
+	typedef void ( *RunFunc )( FCommandLine &argv );
+
+	FBenchmark( const char *pszName, RunFunc Func );
+
+	const char			*GetName( void ) const { return m_pszName; }
+	void				Run( FCommandLine &argv ) const { m_Func( argv ); }
+
+	static FBenchmark	*FindByName( const char *pszName );
+	static void			PrintNames( void );
+
+private:
+	const char			*m_pszName;
+	RunFunc				m_Func;
+	FBenchmark			*m_pNext;
+
+	// All benchmarks, in a list sorted by name.
+	static FBenchmark	*s_pFirst;
+};
+
+#endif // BUILD_ID != BUILD_RELEASE
+
+#endif // __BENCHMARK_H__
@@ -230,47 +230,51 @@ bool P_BlockThingsIterator (int x, int y, bool(*func)(AActor*), TArray<AActor *>
 	}
 	else
 	{
-		FBlockNode *block;
 		int index = y*bmapwidth + x;
+		FBlockLinks *links = &blocklinks[index];
+		int slot;
 
 		if (actor == NULL)
 		{
-			block = blocklinks[index];
+			slot = links->Things.Size();
 		}
 		else
 		{
-			block = actor->BlockNode;
+			// Only the actors that were linked in before this one.
+			FBlockNode *block = actor->BlockNode;
 			while (block != NULL && block->BlockIndex != index)
 			{
 				block = block->NextBlock;
 			}
-			if (block != NULL)
-			{
-				block = block->NextActor;
-			}
+			slot = block != NULL ? block->BlockSlot : 0;
 		}
-		while (block != NULL)
+		while (slot > 0)
 		{
-			FBlockNode *next = block->NextActor;
+			AActor *me = links->Things[--slot].Me;
 			int i;
 
+			// Unlinked actors leave an empty entry.
+			if (me == NULL)
+			{
+				continue;
+			}
+
 			// Don't recheck things that were already checked
 			for (i = (int)checkarray.Size() - 1; i >= 0; --i)
 			{
-				if (checkarray[i] == block->Me)
+				if (checkarray[i] == me)
 				{
 					break;
 				}
 			}
 			if (i < 0)
 			{
-				checkarray.Push (block->Me);
-				if (!func (block->Me))
+				checkarray.Push (me);
+				if (!func (me))
 				{
 					return false;
 				}
 			}
-			block = next;
 		}
 	}
 	return true;
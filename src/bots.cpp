@@ -80,6 +80,7 @@
 #include "st_stuff.h"
 #include "stats.h"
 #include "sv_commands.h"
+#include "sv_main.h"
 #include "sv_rcon.h"
 #include "team.h"
 #include "vectors.h"
@@ -623,6 +624,7 @@ void BOTS_RemoveBot( ULONG ulPlayerIdx, bool bExitMsg )
 	TEAM_CancelAssistsOfPlayer ( ulPlayerIdx );
 
 	playeringame[ulPlayerIdx] = false;
+	SERVER_MASTER_InvalidateLauncherCache( );
 	
 	// [BB] Run the disconnect scripts now that the bot is leaving the game.
 	if (( players[ulPlayerIdx].bSpectating == false ) ||
@@ -1771,6 +1773,7 @@ CSkullBot::CSkullBot( const char *pszName, const char *pszTeamName, ULONG ulPlay
 
 	// Update the playeringame slot.
 	playeringame[ulPlayerNum] = true;
+	SERVER_MASTER_InvalidateLauncherCache( );
 
 	// Setup the player's userinfo based on the bot's botinfo.
 	// [BB] First clear the userinfo.
@@ -58,6 +58,7 @@
 #include "team.h"
 #include "campaign.h"
 #include "sv_commands.h"
+#include "sv_main.h"
 #include "network.h"
 #include "cl_demo.h"
 #include "m_png.h"
@@ -348,6 +349,10 @@ void FBaseCVar::SetGenericRep (UCVarValue value, ECVarType type)
 	// [TP] Inform RCON clients about server setting changes
 	if (( NETWORK_GetState() == NETSTATE_SERVER ) && ( Flags & ( CVAR_SENSITIVESERVERSETTING | CVAR_SERVERINFO )))
 		SERVERCOMMANDS_SyncCVarToAdmins( *this );
+
+	// Launchers are sent (some of) the server info cvars, so don't hand out old responses.
+	if (( NETWORK_GetState() == NETSTATE_SERVER ) && ( Flags & CVAR_SERVERINFO ))
+		SERVER_MASTER_InvalidateLauncherCache( );
 }
 
 bool FBaseCVar::ToBool (UCVarValue value, ECVarType type)
@@ -440,6 +440,44 @@ void CLIENTCOMMANDS_MissingPacket( void )
 {
 }
 
+//*****************************************************************************
+//
+void CLIENTCOMMANDS_PacketAck( LONG lLastParsedSequence, LONG lHighestReceivedSequence, ULONG ulReceivedBits )
+{
+	CLIENT_GetLocalBuffer( )->ByteStream.WriteByte( CLC_PACKETACK );
+	CLIENT_GetLocalBuffer( )->ByteStream.WriteLong( lLastParsedSequence );
+	CLIENT_GetLocalBuffer( )->ByteStream.WriteLong( lHighestReceivedSequence );
+	CLIENT_GetLocalBuffer( )->ByteStream.WriteLong( ulReceivedBits );
+}
+
+//*****************************************************************************
+//
+void CLIENTCOMMANDS_PlayerMovementAck( const BYTE *pucSequences, const bool *pbAcknowledge )
+{
+	ULONG ulNumPlayers = 0;
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		if ( pbAcknowledge[ulIdx] )
+			ulNumPlayers++;
+	}
+
+	if ( ulNumPlayers == 0 )
+		return;
+
+	CLIENT_GetLocalBuffer( )->ByteStream.WriteByte( CLC_PLAYERMOVEMENTACK );
+	CLIENT_GetLocalBuffer( )->ByteStream.WriteByte( ulNumPlayers );
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		if ( pbAcknowledge[ulIdx] )
+		{
+			CLIENT_GetLocalBuffer( )->ByteStream.WriteByte( ulIdx );
+			CLIENT_GetLocalBuffer( )->ByteStream.WriteByte( pucSequences[ulIdx] );
+		}
+	}
+}
+
 //*****************************************************************************
 //
 void CLIENTCOMMANDS_Pong( unsigned int time )
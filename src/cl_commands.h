@@ -81,6 +81,8 @@ void	CLIENTCOMMANDS_Say( ULONG ulMode, const char *pszString, ULONG ulPlayer = M
 void	CLIENTCOMMANDS_Ignore( const unsigned int player, const bool ignore, const bool doVoice, const int ticks = -1 );
 void	CLIENTCOMMANDS_ClientMove( void );
 void	CLIENTCOMMANDS_MissingPacket( void );
+void	CLIENTCOMMANDS_PacketAck( LONG lLastParsedSequence, LONG lHighestReceivedSequence, ULONG ulReceivedBits );
+void	CLIENTCOMMANDS_PlayerMovementAck( const BYTE *pucSequences, const bool *pbAcknowledge );
 void	CLIENTCOMMANDS_Pong( unsigned int time );
 void	CLIENTCOMMANDS_WeaponSelect( const PClass *pType );
 void	CLIENTCOMMANDS_SendBackupWeaponSelect( void );
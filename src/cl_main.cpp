@@ -216,6 +216,7 @@ CUSTOM_CVAR( Int, cl_backupcommands, 0, CVAR_ARCHIVE )
 // Player functions.
 // [BB] Does not work with the latest ZDoom changes. Check if it's still necessary.
 //static	void	client_SetPlayerPieces( BYTESTREAM_s *pByteStream );
+static	void	client_MovePlayer( player_t *player, int flags, fixed_t x, fixed_t y, fixed_t z, angle_t angle, fixed_t velx, fixed_t vely, fixed_t velz );
 
 // Game commands.
 static	void	client_SetGameMode( BYTESTREAM_s *pByteStream );
@@ -411,6 +412,11 @@ static	LONG				g_lHighestReceivedSequence;
 // Delay for sending a request missing packets.
 static	LONG				g_lMissingPacketTicks;
 
+// What we acknowledged to the server the last time.
+static	LONG				g_lLastAckedParsedSequence;
+static	LONG				g_lLastAckedHighestSequence;
+static	ULONG				g_ulLastAckedReceivedBits;
+
 // Debugging variables.
 static	LONG				g_lLastCmd;
 
@@ -429,6 +435,28 @@ static	bool				g_HasRCONAccess = false;
 // [AK] We are in the process of gaining RCON access to the server.
 static  bool				g_GainingRCONAccess = false;
 
+// The movement of each player as reconstructed from the latest delta compressed updates. These
+// are the baselines the server can refer to and are indexed by the sequence of the update.
+static	struct
+{
+	bool		bValid;
+	BYTE		ucSequence;
+	int			ReceivedTic;
+	fixed_t		X;
+	fixed_t		Y;
+	fixed_t		Z;
+	angle_t		Angle;
+	fixed_t		VelX;
+	fixed_t		VelY;
+	fixed_t		VelZ;
+}							g_PlayerMovementBaselines[MAXPLAYERS][PLAYERDELTA_MAX_BASELINE_AGE];
+
+// The sequence of the latest delta compressed update of each player's movement that we applied, and
+// whether we still need to tell the server about it. The server only uses updates we confirmed as
+// baselines.
+static	BYTE				g_ucAppliedMovementSequence[MAXPLAYERS];
+static	bool				g_bMovementAckPending[MAXPLAYERS];
+
 //*****************************************************************************
 //	FUNCTIONS
 
@@ -448,6 +476,11 @@ void CLIENT_ClearAllPlayers( void )
 
 		// [AK] Delete this player's VoIP channel if it exists.
 		VOIPController::GetInstance( ).RemoveVoIPChannel( ulIdx );
+
+		// Forget the baselines of the player's movement.
+		for ( ULONG ulSequence = 0; ulSequence < PLAYERDELTA_MAX_BASELINE_AGE; ++ulSequence )
+			g_PlayerMovementBaselines[ulIdx][ulSequence].bValid = false;
+		g_bMovementAckPending[ulIdx] = false;
 	}
 
 	// [AK] Also clear out saved chat messages from the server.
@@ -901,6 +934,10 @@ void CLIENT_AttemptConnection( void )
 
 	g_lMissingPacketTicks = 0;
 
+	g_lLastAckedParsedSequence = -1;
+	g_lLastAckedHighestSequence = -1;
+	g_ulLastAckedReceivedBits = 0;
+
 	// [CK] Reset this here since we plan on connecting to a new server
 	CLIENT_SetLatestServerGametic( 0 );
 
@@ -1236,6 +1273,56 @@ void CLIENT_CheckForMissingPackets( void )
 	g_lMissingPacketTicks = ( TICRATE / 4 );
 }
 
+//*****************************************************************************
+//
+// Tells the server which of its packets we have. Besides the last packet
+// we parsed and the highest one we received, a bit is set for each of the 32
+// packets before the highest one that we received. With this, the server can
+// resend lost packets early and adapt how fast it sends to our connection.
+// This goes out together with our movement commands, once per tick.
+//
+void CLIENT_AcknowledgePackets( void )
+{
+	if ( g_lHighestReceivedSequence < 0 )
+		return;
+
+	ULONG ulReceivedBits = 0;
+	for ( ULONG ulIdx = 0; ulIdx < PACKET_BUFFER_SIZE; ulIdx++ )
+	{
+		const LONG lOffset = g_lHighestReceivedSequence - 1 - g_lPacketSequence[ulIdx];
+
+		if (( g_lPacketSequence[ulIdx] > g_lLastParsedSequence ) && ( lOffset >= 0 ) && ( lOffset < 32 ))
+			ulReceivedBits |= ( 1u << lOffset );
+	}
+
+	// Nothing changed since the last acknowledgement.
+	if (( g_lLastParsedSequence == g_lLastAckedParsedSequence )
+		&& ( g_lHighestReceivedSequence == g_lLastAckedHighestSequence )
+		&& ( ulReceivedBits == g_ulLastAckedReceivedBits ))
+	{
+		return;
+	}
+
+	CLIENTCOMMANDS_PacketAck( g_lLastParsedSequence, g_lHighestReceivedSequence, ulReceivedBits );
+	g_lLastAckedParsedSequence = g_lLastParsedSequence;
+	g_lLastAckedHighestSequence = g_lHighestReceivedSequence;
+	g_ulLastAckedReceivedBits = ulReceivedBits;
+}
+
+//*****************************************************************************
+//
+// Tells the server which delta compressed updates of the players' movement we
+// applied since the last time. This goes out once per tick as well. If it
+// gets lost, the server just keeps using older baselines or sends keyframes.
+//
+void CLIENT_AcknowledgePlayerMovement( void )
+{
+	CLIENTCOMMANDS_PlayerMovementAck( g_ucAppliedMovementSequence, g_bMovementAckPending );
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		g_bMovementAckPending[ulIdx] = false;
+}
+
 //*****************************************************************************
 //
 bool CLIENT_ReadPacketHeader( BYTESTREAM_s *pByteStream )
@@ -2495,6 +2582,10 @@ void CLIENT_QuitNetworkGame( const char *pszString )
 
 	g_lMissingPacketTicks = 0;
 
+	g_lLastAckedParsedSequence = -1;
+	g_lLastAckedHighestSequence = -1;
+	g_ulLastAckedReceivedBits = 0;
+
 	// [AK] Since we disconnected, we don't have RCON access anymore.
 	g_HasRCONAccess = false;
 
@@ -3462,6 +3553,11 @@ void ServerCommands::SpawnPlayer::Execute()
 		return;
 	}
 
+	// The server forgets which updates of this player's movement we received when it spawns.
+	for ( ULONG ulSequence = 0; ulSequence < PLAYERDELTA_MAX_BASELINE_AGE; ++ulSequence )
+		g_PlayerMovementBaselines[ulPlayer][ulSequence].bValid = false;
+	g_bMovementAckPending[ulPlayer] = false;
+
 	AActor *pOldNetActor = g_ActorNetIDList.findPointerByID ( netid );
 
 	// If there's already an actor with this net ID, kill it!
@@ -3865,8 +3961,88 @@ void ServerCommands::MovePlayer::Execute()
 		// Don't move the player since the server didn't send any useful position information.
 		return;
 	}
+
+	// [AK] Check if the server sent us this player's velocity on each axis.
+	client_MovePlayer( player, flags, x, y, z, angle, IsMovingX() ? velx : 0, IsMovingY() ? vely : 0, IsMovingZ() ? velz : 0 );
+}
+
+//*****************************************************************************
+//
+void ServerCommands::MovePlayerDelta::Execute()
+{
+	const ULONG ulPlayer = player - players;
+
+	// Check to make sure everything is valid. If not, break out.
+	if ( gamestate != GS_LEVEL )
+	{
+		CLIENT_PrintWarning( "MovePlayerDelta: not in a level\n" );
+		return;
+	}
+
+	if ( baselineAge >= PLAYERDELTA_MAX_BASELINE_AGE )
+	{
+		CLIENT_PrintWarning( "MovePlayerDelta: invalid baseline age %d\n", baselineAge );
+		return;
+	}
+
+	fixed_t newX, newY, newZ, newVelX, newVelY, newVelZ;
+	angle_t newAngle;
+
+	if ( IsKeyframe() )
+	{
+		newX = x;
+		newY = y;
+		newZ = z;
+		newAngle = angle;
+		newVelX = IsKeyframeMovingX() ? velx : 0;
+		newVelY = IsKeyframeMovingY() ? vely : 0;
+		newVelZ = IsKeyframeMovingZ() ? velz : 0;
+	}
 	else
-		player->mo->renderflags &= ~RF_INVISIBLE;
+	{
+		const BYTE ucBaseline = static_cast<BYTE>( sequence - baselineAge );
+		const auto &baseline = g_PlayerMovementBaselines[ulPlayer][ucBaseline % PLAYERDELTA_MAX_BASELINE_AGE];
+
+		// We never got the update this one is based on (or it was too long ago to be the right one).
+		// The server will pick a different baseline or send a keyframe soon, so just wait for that.
+		if (( baseline.bValid == false ) || ( baseline.ucSequence != ucBaseline ) || (( gametic - baseline.ReceivedTic ) > 2 * PLAYERDELTA_MAX_BASELINE_AGE ))
+			return;
+
+		// This has to match the reconstruction in servercommands_MovePlayerDelta exactly.
+		newX = baseline.X + ( HasDeltaX() ? deltaX * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0 );
+		newY = baseline.Y + ( HasDeltaY() ? deltaY * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0 );
+		newZ = baseline.Z + ( HasDeltaZ() ? deltaZ * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0 );
+		newAngle = baseline.Angle + ( HasDeltaAngle() ? static_cast<angle_t>( deltaAngle ) << PLAYERDELTA_ANGLE_SHIFT : 0 );
+		newVelX = ( flags & PLAYER_SENDVELX ) ? baseline.VelX + ( HasDeltaVelX() ? deltaVelX * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0 ) : 0;
+		newVelY = ( flags & PLAYER_SENDVELY ) ? baseline.VelY + ( HasDeltaVelY() ? deltaVelY * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0 ) : 0;
+		newVelZ = ( flags & PLAYER_SENDVELZ ) ? baseline.VelZ + ( HasDeltaVelZ() ? deltaVelZ * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0 ) : 0;
+	}
+
+	// Keep this update around, the server may use it as a baseline later.
+	auto &state = g_PlayerMovementBaselines[ulPlayer][sequence % PLAYERDELTA_MAX_BASELINE_AGE];
+	state.bValid = true;
+	state.ucSequence = static_cast<BYTE>( sequence );
+	state.ReceivedTic = gametic;
+	state.X = newX;
+	state.Y = newY;
+	state.Z = newZ;
+	state.Angle = newAngle;
+	state.VelX = newVelX;
+	state.VelY = newVelY;
+	state.VelZ = newVelZ;
+
+	// Tell the server that we have this update, so that it can use it as a baseline.
+	g_ucAppliedMovementSequence[ulPlayer] = static_cast<BYTE>( sequence );
+	g_bMovementAckPending[ulPlayer] = true;
+
+	client_MovePlayer( player, flags, newX, newY, newZ, newAngle, newVelX, newVelY, newVelZ );
+}
+
+//*****************************************************************************
+//
+static void client_MovePlayer( player_t *player, int flags, fixed_t x, fixed_t y, fixed_t z, angle_t angle, fixed_t velx, fixed_t vely, fixed_t velz )
+{
+	player->mo->renderflags &= ~RF_INVISIBLE;
 
 	// Set the player's XYZ position.
 	// [BB] But don't just set the position, but also properly set floorz and ceilingz, etc.
@@ -3892,10 +4068,9 @@ void ServerCommands::MovePlayer::Execute()
 	player->mo->angle = angle;
 
 	// Set the player's XYZ momentum.
-	// [AK] Check if the server sent us this player's velocity on each axis.
-	player->mo->velx = IsMovingX() ? velx : 0;
-	player->mo->vely = IsMovingY() ? vely : 0;
-	player->mo->velz = IsMovingZ() ? velz : 0;
+	player->mo->velx = velx;
+	player->mo->vely = vely;
+	player->mo->velz = velz;
 
 	// Is the player crouching?
 	player->crouchdir = ( flags & PLAYER_CROUCHING ) ? 1 : -1;
@@ -6937,6 +7112,9 @@ void ServerCommands::SetSomeLineFlags::Execute()
 {
 	line->flags &= ~(ML_BLOCKING|ML_BLOCK_PLAYERS|ML_BLOCKEVERYTHING|ML_RAILING|ML_ADDTRANS);
 	line->flags |= blockFlags;
+
+	// The flags may block sight now.
+	P_InvalidateSightCache ();
 }
 
 //*****************************************************************************
@@ -160,6 +160,8 @@ void				CLIENT_RequestSnapshot( void );
 bool				CLIENT_GetNextPacket( void );
 void				CLIENT_GetPackets( void );
 void				CLIENT_CheckForMissingPackets( void );
+void				CLIENT_AcknowledgePackets( void );
+void				CLIENT_AcknowledgePlayerMovement( void );
 bool				CLIENT_ReadPacketHeader( BYTESTREAM_s *pByteStream );
 void				CLIENT_ParsePacket( BYTESTREAM_s *pByteStream, bool bSequencedPacket );
 void				CLIENT_ProcessCommand( LONG lCommand, BYTESTREAM_s *pByteStream );
@@ -1263,6 +1263,23 @@ void D_ErrorCleanup ()
 	CLIENT_ResetFloodTimers();
 }
 
+//==========================================================================
+//
+// D_IdleCollect
+//
+// Gives the garbage collector the time that's left until the next tic,
+// minus some room for drawing the next frame.
+//
+//==========================================================================
+
+static void D_IdleCollect ()
+{
+	const int ticus = 1000000 / TICRATE;
+	const int leftus = static_cast<int>(( 1. - FIXED2FLOAT( I_GetTimeFrac( NULL ))) * ticus );
+
+	GC::IdleCollect( leftus - ticus / 4 );
+}
+
 //==========================================================================
 //
 // D_DoomLoop
@@ -1320,6 +1337,7 @@ void D_DoomLoop ()
 					I_StartTic( );
 
 				D_Display( );
+				D_IdleCollect( );
 				break;
 			case NETSTATE_SERVER:
 
@@ -1360,6 +1378,7 @@ void D_DoomLoop ()
 				// Update display, next frame, with current state.
 				I_StartTic ();
 				D_Display ();
+				D_IdleCollect ();
 				break;
 			}
 		}
@@ -278,6 +278,19 @@ namespace GC
 	// Does a complete collection.
 	void FullGC();
 
+	// Does some collection work in the time until the next tic, if the collector
+	// is limited to a time budget per tic (gc_ticbudget). Returns true if it did any.
+	bool IdleCollect(int us);
+
+	// Prints and resets the collector's timings and pause histograms.
+	void PrintStats();
+	void ResetStats();
+
+	// Allocates and frees the memory of objects, from pools of blocks of the same
+	// size (dobjpool.cpp).
+	void *AllocObject(size_t size);
+	void FreeObject(void *mem);
+
 	// Handles the grunt work for a write barrier.
 	void Barrier(DObject *pointing, DObject *pointed);
 
@@ -493,12 +506,12 @@ public:
 
 	void *operator new(size_t len)
 	{
-		return M_Malloc(len);
+		return GC::AllocObject(len);
 	}
 
 	void operator delete (void *mem)
 	{
-		M_Free(mem);
+		GC::FreeObject(mem);
 	}
 
 	// GC fiddling
@@ -565,7 +578,7 @@ protected:
 
 	void operator delete (void *mem, EInPlace *)
 	{
-		M_Free (mem);
+		GC::FreeObject (mem);
 	}
 };
 
@@ -74,6 +74,7 @@
 #include "v_video.h"
 #include "menu/menu.h"
 #include "intermission/intermission.h"
+#include "c_cvars.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -106,6 +107,12 @@
 #define GCSWEEPCOST		10
 #define GCFINALIZECOST	100
 
+// How many single steps the time-budgeted collector does between looking at the clock.
+#define GCSTEPSPERCLOCK	8
+
+// The longest the collector works at once when the game is idle, in microseconds.
+#define GCIDLESLICE		1000
+
 // TYPES -------------------------------------------------------------------
 
 // This object is responsible for marking sectors during the propagate
@@ -135,6 +142,11 @@ extern DThinker *NextToThink;
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
+// If this is more than 0, the collector doesn't work for longer than this many
+// microseconds per tic while the game is running. The rest of its work is done while
+// it's waiting for the next tic.
+CVAR(Int, gc_ticbudget, 0, CVAR_ARCHIVE|CVAR_NOSETBYACS)
+
 namespace GC
 {
 size_t AllocBytes;
@@ -155,6 +167,25 @@ size_t Dept;
 
 static DSectorMarker *SectorMarker;
 
+// The threshold the current collection was started at. The time-budgeted collector
+// stops caring about its budget if the memory grows to twice this much.
+static size_t CycleThreshold;
+
+// The tic the time-budgeted collector last worked in, and how long it did.
+static int BudgetTic = -1;
+static double BudgetSpent;
+
+// Telemetry: how long the collector was in each state, how long it held up the game
+// at once (in the tic, and while idle), and the full collections.
+static cycle_t StateCycles[4];
+static const double PauseBuckets[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+static unsigned int PauseCounts[2][countof(PauseBuckets) + 1];
+static double PauseMax[2];
+static double LastPause;
+static unsigned int NumCycles;
+static unsigned int NumFullGCs;
+static cycle_t FullGCCycles;
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -168,6 +199,53 @@ static DSectorMarker *SectorMarker;
 void SetThreshold()
 {
 	Threshold = (Estimate / 100) * Pause;
+	CycleThreshold = Threshold;
+	NumCycles++;
+}
+
+//==========================================================================
+//
+// TrackState
+//
+// Moves the time measurement on to the next state when the state changed.
+//
+//==========================================================================
+
+static inline void TrackState(EGCState &state)
+{
+	if (State != state)
+	{
+		StateCycles[state].Unclock();
+		state = State;
+		StateCycles[state].Clock();
+	}
+}
+
+//==========================================================================
+//
+// RecordPause
+//
+// Adds the time one piece of work took to the pause histograms.
+//
+//==========================================================================
+
+static void RecordPause(double us, bool idle)
+{
+	unsigned int bucket = 0;
+	while (bucket < countof(PauseBuckets) && us >= PauseBuckets[bucket])
+	{
+		bucket++;
+	}
+	PauseCounts[idle][bucket]++;
+	PauseMax[idle] = MAX(PauseMax[idle], us);
+	LastPause = us;
+}
+
+static double ElapsedUS(const cycle_t &clock)
+{
+	cycle_t now = clock;
+	now.Unclock();
+	return now.TimeMS() * 1000;
 }
 
 //==========================================================================
@@ -431,6 +509,81 @@ static size_t SingleStep()
 	}
 }
 
+//==========================================================================
+//
+// RunFor
+//
+// Works on the current collection for about the given number of microseconds,
+// or until it's finished. Marking the roots and finishing the mark phase
+// can't be split up, so they may take longer. Returns how long it took.
+//
+//==========================================================================
+
+static double RunFor(double us, bool idle)
+{
+	cycle_t pause;
+	EGCState state = State;
+	int steps = 0;
+
+	pause.Reset();
+	pause.Clock();
+	StateCycles[state].Clock();
+	for (;;)
+	{
+		SingleStep();
+		TrackState(state);
+		if (State == GCS_Pause)
+		{ // The collection is finished.
+			break;
+		}
+		if (++steps % GCSTEPSPERCLOCK == 0 && ElapsedUS(pause) >= us)
+		{
+			break;
+		}
+	}
+	StateCycles[state].Unclock();
+	pause.Unclock();
+
+	if (State == GCS_Pause)
+	{
+		assert(AllocBytes >= Estimate);
+		SetThreshold();
+	}
+	else
+	{ // Keep CheckGC calling Step until the collection is finished.
+		Threshold = 0;
+	}
+	Dept = 0;
+	StepCount++;
+
+	const double took = pause.TimeMS() * 1000;
+	RecordPause(took, idle);
+	return took;
+}
+
+//==========================================================================
+//
+// IdleCollect
+//
+// Lets the time-budgeted collector use some of the time until the next tic.
+// Returns false if it had nothing to do.
+//
+//==========================================================================
+
+bool IdleCollect(int us)
+{
+	if (gc_ticbudget <= 0 || us <= 0)
+	{
+		return false;
+	}
+	if (State == GCS_Pause && AllocBytes < Threshold)
+	{
+		return false;
+	}
+	RunFor(MIN(us, GCIDLESLICE), true);
+	return true;
+}
+
 //==========================================================================
 //
 // Step
@@ -448,12 +601,37 @@ void Step()
 	{
 		lim = (~(size_t)0) / 2;		// no limit
 	}
+	// Keep the time-budgeted collector within its budget.
+	if (gc_ticbudget > 0 && AllocBytes < CycleThreshold * 2)
+	{
+		if (BudgetTic != gametic)
+		{
+			BudgetTic = gametic;
+			BudgetSpent = 0;
+		}
+		if (BudgetSpent < gc_ticbudget)
+		{
+			BudgetSpent += RunFor(gc_ticbudget - BudgetSpent, false);
+		}
+		return;
+	}
+
 	Dept += AllocBytes - Threshold;
+
+	cycle_t pause;
+	EGCState state = State;
+	pause.Reset();
+	pause.Clock();
+	StateCycles[state].Clock();
 	do
 	{
 		olim = lim;
 		lim -= SingleStep();
+		TrackState(state);
 	} while (olim > lim && State != GCS_Pause);
+	StateCycles[state].Unclock();
+	pause.Unclock();
+	RecordPause(pause.TimeMS() * 1000, false);
 	if (State != GCS_Pause)
 	{
 		if (Dept < GCSTEPSIZE)
@@ -484,6 +662,11 @@ void Step()
 
 void FullGC()
 {
+	// These are not part of the pause histograms, they only happen when the game
+	// stops anyway, e.g. between levels.
+	FullGCCycles.Clock();
+	NumFullGCs++;
+
 	if (State <= GCS_Propagate)
 	{
 		// Reset sweep mark to sweep all elements (returning them to white)
@@ -503,6 +686,7 @@ void FullGC()
 		SingleStep();
 	}
 	SetThreshold();
+	FullGCCycles.Unclock();
 }
 
 //==========================================================================
@@ -724,6 +908,88 @@ ADD_STAT(gc)
 	return out;
 }
 
+//==========================================================================
+//
+// STAT gcpause
+//
+// Shows how long the collector holds up the game.
+//
+//==========================================================================
+
+ADD_STAT(gcpause)
+{
+	FString out;
+	out.Format("Last:%7.0fus  Max tic:%7.0fus  Max idle:%7.0fus",
+		GC::LastPause, GC::PauseMax[0], GC::PauseMax[1]);
+	if (gc_ticbudget > 0)
+	{
+		out.AppendFormat("  Budget:%5.0f/%dus", GC::BudgetTic == gametic ? GC::BudgetSpent : 0., *gc_ticbudget);
+	}
+	return out;
+}
+
+//==========================================================================
+//
+// GC::PrintStats
+//
+// Prints the time spent in each state and the pause histograms.
+//
+//==========================================================================
+
+void GC::PrintStats()
+{
+	static const char *StateNames[] = { "roots", "propagate", "sweep", "finalize" };
+	static const char *PauseNames[] = { "in tic", "idle" };
+	double total = 0;
+
+	for (unsigned int i = 0; i < countof(StateCycles); i++)
+	{
+		total += StateCycles[i].TimeMS();
+	}
+	Printf("%u collections, %d steps, %.2f ms total\n", NumCycles, StepCount, total);
+	for (unsigned int i = 0; i < countof(StateCycles); i++)
+	{
+		Printf("  %-10s %10.2f ms\n", StateNames[i], StateCycles[i].TimeMS());
+	}
+	Printf("%u full collections, %.2f ms total\n", NumFullGCs, FullGCCycles.TimeMS());
+
+	for (int idle = 0; idle < 2; idle++)
+	{
+		Printf("Pauses %s (max %.0f us):\n", PauseNames[idle], PauseMax[idle]);
+		for (unsigned int i = 0; i <= countof(PauseBuckets); i++)
+		{
+			if (i < countof(PauseBuckets))
+			{
+				Printf("  < %5.0f us: %u\n", PauseBuckets[i], PauseCounts[idle][i]);
+			}
+			else
+			{
+				Printf("  >=%5.0f us: %u\n", PauseBuckets[i - 1], PauseCounts[idle][i]);
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+// GC::ResetStats
+//
+//==========================================================================
+
+void GC::ResetStats()
+{
+	for (unsigned int i = 0; i < countof(StateCycles); i++)
+	{
+		StateCycles[i].Reset();
+	}
+	memset(PauseCounts, 0, sizeof(PauseCounts));
+	PauseMax[0] = PauseMax[1] = 0;
+	LastPause = 0;
+	NumCycles = 0;
+	NumFullGCs = 0;
+	FullGCCycles.Reset();
+}
+
 //==========================================================================
 //
 // CCMD gc
@@ -736,7 +1002,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|pause [size]|stepmul [size]|stats|resetstats\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -773,4 +1039,13 @@ CCMD(gc)
 			GC::StepMul = MAX(100, atoi(argv[2]));
 		}
 	}
+	// Telemetry.
+	else if (stricmp(argv[1], "stats") == 0)
+	{
+		GC::PrintStats();
+	}
+	else if (stricmp(argv[1], "resetstats") == 0)
+	{
+		GC::ResetStats();
+	}
 }
@@ -0,0 +1,344 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+//
+// Filename: dobjpool.cpp
+//
+// Description: Gives objects their memory from pools of blocks of the same size.
+//
+// Mods spawn and destroy thousands of actors, puffs and projectiles every second. All
+// objects of one class have the same size, so a freed block can be handed to the next
+// object of that size right away, without going through the heap. Every pool gets its
+// blocks in big slabs, which are never given back. The garbage collector's sweep frees
+// objects with delete, which puts their blocks back into their pools.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include "doomtype.h"
+#include "dobject.h"
+#include "templates.h"
+#include "i_system.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "m_alloc.h"
+#include "doomstat.h"
+#include "p_local.h"
+#include "network.h"
+#include "benchmark.h"
+
+//*****************************************************************************
+//	DEFINES
+
+// Objects up to this size come from pools, one for every multiple of POOL_GRANULARITY.
+#define	POOL_GRANULARITY		16
+#define	POOL_MAX_SIZE			8192
+
+// Pools get their blocks in slabs of this size, or of this many blocks if that's more.
+#define	POOL_SLAB_SIZE			65536
+#define	POOL_MIN_SLAB_BLOCKS	16
+
+//*****************************************************************************
+//	STRUCTURES
+
+struct FObjectPool
+{
+	// Size of the blocks, including the header.
+	size_t			BlockSize;
+
+	// Blocks that are ready to be used, linked through their first bytes.
+	void			*FreeList;
+
+	ULONG			ulNumLive;
+	ULONG			ulPeakLive;
+	ULONG			ulNumSlabs;
+};
+
+// Every block starts with this, so that it can find its way back to its pool. The
+// union keeps the objects behind it as aligned as malloc would.
+union FObjectHeader
+{
+	// NULL if the block was allocated with M_Malloc.
+	FObjectPool		*Pool;
+	double			Align[2];
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+// Allocate objects from the pools. Objects that already exist are freed the way they were allocated.
+CVAR( Bool, gc_objectpools, true, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+static	FObjectPool		*g_pObjectPools[POOL_MAX_SIZE / POOL_GRANULARITY + 1];
+
+// Objects that are too big for the pools, or allocated while they were turned off.
+static	ULONG			g_ulNumUnpooledObjects;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static FObjectPool *objpool_GetPool( const size_t size )
+{
+	const size_t index = ( size + POOL_GRANULARITY - 1 ) / POOL_GRANULARITY;
+
+	if ( g_pObjectPools[index] == NULL )
+	{
+		FObjectPool *pool = new FObjectPool;
+		pool->BlockSize = sizeof( FObjectHeader ) + index * POOL_GRANULARITY;
+		pool->FreeList = NULL;
+		pool->ulNumLive = 0;
+		pool->ulPeakLive = 0;
+		pool->ulNumSlabs = 0;
+		g_pObjectPools[index] = pool;
+	}
+
+	return ( g_pObjectPools[index] );
+}
+
+//*****************************************************************************
+//
+static void objpool_AddSlab( FObjectPool *pool )
+{
+	const size_t numBlocks = MAX<size_t>( POOL_SLAB_SIZE / pool->BlockSize, POOL_MIN_SLAB_BLOCKS );
+	BYTE *slab = static_cast<BYTE *>( malloc( numBlocks * pool->BlockSize ));
+
+	if ( slab == NULL )
+		I_FatalError( "Could not malloc %zu bytes", numBlocks * pool->BlockSize );
+
+	// Link them so that they're handed out in the order they are in memory.
+	for ( size_t i = numBlocks; i-- > 0; )
+	{
+		void *block = slab + i * pool->BlockSize;
+		*static_cast<void **>( block ) = pool->FreeList;
+		pool->FreeList = block;
+	}
+
+	pool->ulNumSlabs++;
+}
+
+//*****************************************************************************
+//
+void *GC::AllocObject( size_t size )
+{
+	FObjectHeader *header;
+
+	if (( gc_objectpools == false ) || ( size > POOL_MAX_SIZE ))
+	{
+		header = static_cast<FObjectHeader *>( M_Malloc( sizeof( FObjectHeader ) + size ));
+		header->Pool = NULL;
+		g_ulNumUnpooledObjects++;
+		return ( header + 1 );
+	}
+
+	FObjectPool *pool = objpool_GetPool( size );
+	if ( pool->FreeList == NULL )
+		objpool_AddSlab( pool );
+
+	header = static_cast<FObjectHeader *>( pool->FreeList );
+	pool->FreeList = *static_cast<void **>( pool->FreeList );
+	header->Pool = pool;
+
+	pool->ulNumLive++;
+	pool->ulPeakLive = MAX( pool->ulPeakLive, pool->ulNumLive );
+
+	// The collector is paced by the memory the objects use, not by the slabs.
+	GC::AllocBytes += pool->BlockSize;
+	return ( header + 1 );
+}
+
+//*****************************************************************************
+//
+void GC::FreeObject( void *mem )
+{
+	if ( mem == NULL )
+		return;
+
+	FObjectHeader *header = static_cast<FObjectHeader *>( mem ) - 1;
+	FObjectPool *pool = header->Pool;
+
+	if ( pool == NULL )
+	{
+		g_ulNumUnpooledObjects--;
+		M_Free( header );
+		return;
+	}
+
+	*reinterpret_cast<void **>( header ) = pool->FreeList;
+	pool->FreeList = header;
+	pool->ulNumLive--;
+	GC::AllocBytes -= pool->BlockSize;
+}
+
+//*****************************************************************************
+//	STATISTICS
+
+ADD_STAT( objpools )
+{
+	// The pools that use the most memory right now.
+	const FObjectPool *biggestPools[8] = { NULL };
+	ULONG ulNumPools = 0;
+	ULONG ulNumLive = 0;
+	ULONG ulPeakLive = 0;
+	size_t liveBytes = 0;
+	size_t slabBytes = 0;
+
+	for ( unsigned int i = 0; i < countof( g_pObjectPools ); i++ )
+	{
+		const FObjectPool *pool = g_pObjectPools[i];
+		if ( pool == NULL )
+			continue;
+
+		ulNumPools++;
+		ulNumLive += pool->ulNumLive;
+		ulPeakLive += pool->ulPeakLive;
+		liveBytes += pool->ulNumLive * pool->BlockSize;
+		slabBytes += pool->ulNumSlabs * MAX<size_t>( POOL_SLAB_SIZE / pool->BlockSize, POOL_MIN_SLAB_BLOCKS ) * pool->BlockSize;
+
+		for ( unsigned int j = 0; j < countof( biggestPools ); j++ )
+		{
+			if (( biggestPools[j] == NULL ) || ( pool->ulNumLive * pool->BlockSize > biggestPools[j]->ulNumLive * biggestPools[j]->BlockSize ))
+			{
+				memmove( &biggestPools[j + 1], &biggestPools[j], ( countof( biggestPools ) - j - 1 ) * sizeof( biggestPools[0] ));
+				biggestPools[j] = pool;
+				break;
+			}
+		}
+	}
+
+	FString out;
+	out.Format( "%lu pools, %lu live (%lu peak), %zuK live, %zuK in slabs, %lu not pooled\n",
+		ulNumPools, ulNumLive, ulPeakLive, ( liveBytes + 1023 ) >> 10, ( slabBytes + 1023 ) >> 10, g_ulNumUnpooledObjects );
+
+	for ( unsigned int j = 0; ( j < countof( biggestPools )) && ( biggestPools[j] != NULL ); j++ )
+	{
+		const FObjectPool *pool = biggestPools[j];
+		out.AppendFormat( "%5zu bytes: %6lu live, %6lu peak, %6zuK\n",
+			pool->BlockSize - sizeof( FObjectHeader ), pool->ulNumLive, pool->ulPeakLive, ( pool->ulNumLive * pool->BlockSize + 1023 ) >> 10 );
+	}
+
+	return ( out );
+}
+
+//*****************************************************************************
+//	BENCHMARKS
+
+#if BUILD_ID != BUILD_RELEASE
+// Spawns and destroys a lot of actors, with and without the pools, and times it.
+// Usage: benchmark spawn [actors] [rounds] [class]
+BENCHMARK( spawn )
+{
+	// Every actor takes a network ID, and a server quits when it runs out of them.
+	if (( gamestate != GS_LEVEL ) || NETWORK_InClientMode( ) || ( NETWORK_GetState( ) == NETSTATE_SERVER ))
+	{
+		Printf( "A level must be running, and this can't be a client or a server.\n" );
+		return;
+	}
+
+	const int maxActors = MIN<int>( 100000, g_ActorNetIDList.countFreeIDs( ) / 2 );
+	if ( maxActors < 1 )
+	{
+		Printf( "There are not enough free network IDs.\n" );
+		return;
+	}
+
+	const int numActors = ( argv.argc( ) > 1 ) ? clamp( atoi( argv[1] ), 1, maxActors ) : MIN( 5000, maxActors );
+	const int numRounds = ( argv.argc( ) > 2 ) ? clamp( atoi( argv[2] ), 1, 1000 ) : 10;
+	const PClass *type = RUNTIME_CLASS( AActor );
+
+	if ( argv.argc( ) > 3 )
+	{
+		type = PClass::FindClass( argv[3] );
+		if (( type == NULL ) || ( type->IsDescendantOf( RUNTIME_CLASS( AActor )) == false ))
+		{
+			Printf( "%s is not an actor class.\n", argv[3] );
+			return;
+		}
+	}
+
+	const bool bUsedPools = gc_objectpools;
+	TArray<AActor *> actors;
+	const fixed_t x = bmaporgx + bmapwidth * MAPBLOCKSIZE / 2;
+	const fixed_t y = bmaporgy + bmapheight * MAPBLOCKSIZE / 2;
+
+	// Take everything else that's dead out of the way first.
+	GC::FullGC( );
+
+	for ( int pass = 0; pass < 2; pass++ )
+	{
+		cycle_t spawnTime, destroyTime, collectTime;
+		spawnTime.Reset( );
+		destroyTime.Reset( );
+		collectTime.Reset( );
+
+		gc_objectpools = ( pass == 0 );
+
+		for ( int round = 0; round < numRounds; round++ )
+		{
+			spawnTime.Clock( );
+			for ( int i = 0; i < numActors; i++ )
+				actors.Push( Spawn( type, x, y, ONFLOORZ, NO_REPLACE ));
+			spawnTime.Unclock( );
+
+			destroyTime.Clock( );
+			for ( unsigned int i = 0; i < actors.Size( ); i++ )
+			{
+				// Monsters and items were counted when they spawned.
+				actors[i]->ClearCounters( );
+				actors[i]->Destroy( );
+			}
+			destroyTime.Unclock( );
+			actors.Clear( );
+
+			collectTime.Clock( );
+			GC::FullGC( );
+			collectTime.Unclock( );
+		}
+
+		Printf( "%s: spawn %.3f ms, destroy %.3f ms, collect %.3f ms\n", ( pass == 0 ) ? "Pools" : "M_Malloc",
+			spawnTime.TimeMS( ), destroyTime.TimeMS( ), collectTime.TimeMS( ));
+	}
+
+	gc_objectpools = bUsedPools;
+	Printf( "%d rounds of %d %s.\n", numRounds, numActors, type->TypeName.GetChars( ));
+}
+#endif
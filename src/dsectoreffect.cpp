@@ -29,6 +29,8 @@
 #include "r_data/r_interpolate.h"
 #include "statnums.h"
 #include "farchive.h"
+// New #includes.
+#include "unlagged.h"
 
 IMPLEMENT_CLASS (DSectorEffect)
 
@@ -172,6 +174,9 @@ DMover::EResult DMover::MovePlane (fixed_t speed, fixed_t dest, int crush,
 	else
 		m_Sector->bCeilingHeightChange = true;
 
+	// Unlagged needs to record the heights of this sector now.
+	UNLAGGED_SectorMoved( m_Sector );
+
 	switch (floorOrCeiling)
 	{
 	case 0:
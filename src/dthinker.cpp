@@ -46,6 +46,10 @@
 // [BB] New #includes.
 #include "cl_demo.h"
 #include "doomstat.h"
+#include "c_cvars.h"
+#include "sv_profile.h"
+#include "p_spec.h"
+#include "benchmark.h"
 
 
 static cycle_t ThinkCycles;
@@ -58,6 +62,38 @@ FThinkerList DThinker::Thinkers[MAX_STATNUM+2];
 FThinkerList DThinker::FreshThinkers[MAX_STATNUM+1];
 bool DThinker::bSerialOverride = false;
 
+// The class index.
+DThinker *DThinker::PendingHead;
+DThinker *DThinker::PendingTail;
+QWORD DThinker::LastLinkStamp;
+TMap<const PClass *, FThinkerClassList *> DThinker::ClassLists;
+TArray<FThinkerClassList *> DThinker::AllClassLists;
+
+// The lists of all classes that descend from a class. Lists are only ever added, so an iterator
+// can keep using these while new classes are indexed.
+struct FThinkerClassMatches
+{
+	FThinkerClassMatches() : NumChecked(0) {}
+
+	TArray<FThinkerClassList *> Lists;
+	unsigned int NumChecked;
+};
+static TMap<const PClass *, FThinkerClassMatches *> ClassMatches;
+
+// How many typed iterations there were and how many thinkers they looked at, with and without
+// the class index. The think stat shows the numbers of the last tic.
+struct FThinkerIteratorStats
+{
+	unsigned int IndexedIterations;
+	unsigned int IndexedVisits;
+	unsigned int LinearIterations;
+	unsigned int LinearVisits;
+};
+static FThinkerIteratorStats IteratorStats, LastIteratorStats;
+
+// Typed iterations over all statnums only visit thinkers of matching classes.
+CVAR (Bool, thinkerindex, true, 0)
+
 void FThinkerList::AddTail(DThinker *thinker)
 {
 	assert(thinker->PrevThinker == NULL && thinker->NextThinker == NULL);
@@ -80,6 +116,9 @@ void FThinkerList::AddTail(DThinker *thinker)
 	GC::WriteBarrier(thinker, Sentinel);
 	GC::WriteBarrier(tail, thinker);
 	GC::WriteBarrier(Sentinel, thinker);
+
+	// Keep the class index in the same order.
+	thinker->MoveToBucket(this);
 }
 
 DThinker *FThinkerList::GetHead() const
@@ -187,10 +226,12 @@ void DThinker::SerializeAll(FArchive &arc, bool hubLoad)
 					else if (thinker->ObjectFlags & OF_JustSpawned)
 					{
 						FreshThinkers[stat].AddTail(thinker);
+						thinker->AddToClassIndex();
 					}
 					else
 					{
 						Thinkers[stat].AddTail(thinker);
+						thinker->AddToClassIndex();
 					}
 					arc << thinker;
 				}
@@ -211,6 +252,12 @@ DThinker::DThinker (int statnum) throw()
 {
 	NextThinker = NULL;
 	PrevThinker = NULL;
+	NextOfClass = NULL;
+	PrevOfClass = NULL;
+	ClassList = NULL;
+	LinkStamp = 0;
+	Bucket = 0;
+	bInClassIndex = false;
 	if (bSerialOverride)
 	{ // The serializer will insert us into the right list
 		return;
@@ -222,11 +269,18 @@ DThinker::DThinker (int statnum) throw()
 		statnum = MAX_STATNUM;
 	}
 	FreshThinkers[statnum].AddTail (this);
+	AddToClassIndex ();
 }
 
 DThinker::DThinker(no_link_type foo) throw()
 {
 	foo;	// Avoid unused argument warnings.
+	NextOfClass = NULL;
+	PrevOfClass = NULL;
+	ClassList = NULL;
+	LinkStamp = 0;
+	Bucket = 0;
+	bInClassIndex = false;
 }
 
 DThinker::~DThinker ()
@@ -242,6 +296,7 @@ void DThinker::Destroy ()
 	{
 		Remove();
 	}
+	RemoveFromClassIndex();
 	Super::Destroy();
 }
 
@@ -411,8 +466,15 @@ void DThinker::RunThinkers ()
 
 	ThinkCycles.Reset();
 
+	// Iterations happen all over the place, so the statistics are per tic.
+	LastIteratorStats = IteratorStats;
+	memset (&IteratorStats, 0, sizeof(IteratorStats));
+
 	ThinkCycles.Clock();
 
+	// Also measure this for the server tic profile.
+	FServerProfileScope ProfileScope( SPS_THINKERS );
+
 	// Tick every thinker left from last time
 	for (i = STAT_FIRST_THINKING; i <= MAX_STATNUM; ++i)
 	{
@@ -483,6 +545,253 @@ void DThinker::Tick ()
 {
 }
 
+//==========================================================================
+//
+// FThinkerClassList :: FThinkerClassList
+//
+//==========================================================================
+
+FThinkerClassList::FThinkerClassList ()
+{
+	Type = NULL;
+	memset (Heads, 0, sizeof(Heads));
+	memset (Tails, 0, sizeof(Tails));
+	Count = 0;
+}
+
+//==========================================================================
+//
+// DThinker :: AddToClassIndex
+//
+// Puts the thinker on the pending list, UpdateClassIndex will move it to
+// the list of its class.
+//
+//==========================================================================
+
+void DThinker::AddToClassIndex ()
+{
+	if (bInClassIndex)
+	{
+		return;
+	}
+	bInClassIndex = true;
+	ClassList = NULL;
+	NextOfClass = NULL;
+	PrevOfClass = PendingTail;
+	if (PendingTail != NULL)
+	{
+		PendingTail->NextOfClass = this;
+	}
+	else
+	{
+		PendingHead = this;
+	}
+	PendingTail = this;
+}
+
+//==========================================================================
+//
+// DThinker :: RemoveFromClassIndex
+//
+//==========================================================================
+
+void DThinker::RemoveFromClassIndex ()
+{
+	if (!bInClassIndex)
+	{
+		return;
+	}
+
+	UnlinkFromClassList();
+	if (ClassList != NULL)
+	{
+		ClassList->Count--;
+	}
+
+	// The links are left alone, so that an iterator that just returned
+	// this thinker can still find its place, see NextInBucket.
+	ClassList = NULL;
+	bInClassIndex = false;
+}
+
+//==========================================================================
+//
+// DThinker :: UnlinkFromClassList
+//
+// Takes the thinker out of its bucket, or the pending list.
+//
+//==========================================================================
+
+void DThinker::UnlinkFromClassList ()
+{
+	DThinker *&head = (ClassList != NULL) ? ClassList->Heads[Bucket] : PendingHead;
+	DThinker *&tail = (ClassList != NULL) ? ClassList->Tails[Bucket] : PendingTail;
+
+	if (PrevOfClass != NULL)
+	{
+		PrevOfClass->NextOfClass = NextOfClass;
+	}
+	else
+	{
+		head = NextOfClass;
+	}
+	if (NextOfClass != NULL)
+	{
+		NextOfClass->PrevOfClass = PrevOfClass;
+	}
+	else
+	{
+		tail = PrevOfClass;
+	}
+}
+
+//==========================================================================
+//
+// DThinker :: LinkToClassList
+//
+// Puts the thinker into its bucket, ordered by when it was linked into
+// its stat list. That's almost always at the end.
+//
+//==========================================================================
+
+void DThinker::LinkToClassList ()
+{
+	DThinker *prev = ClassList->Tails[Bucket];
+
+	while (prev != NULL && prev->LinkStamp > LinkStamp)
+	{
+		prev = prev->PrevOfClass;
+	}
+
+	DThinker *next = (prev != NULL) ? prev->NextOfClass : ClassList->Heads[Bucket];
+
+	PrevOfClass = prev;
+	NextOfClass = next;
+	if (prev != NULL)
+	{
+		prev->NextOfClass = this;
+	}
+	else
+	{
+		ClassList->Heads[Bucket] = this;
+	}
+	if (next != NULL)
+	{
+		next->PrevOfClass = this;
+	}
+	else
+	{
+		ClassList->Tails[Bucket] = this;
+	}
+}
+
+//==========================================================================
+//
+// DThinker :: MoveToBucket
+//
+// Called whenever the thinker was added to a stat list. Pending thinkers
+// only remember where they belong.
+//
+//==========================================================================
+
+void DThinker::MoveToBucket (const FThinkerList *list)
+{
+	int bucket;
+
+	if (list >= &FreshThinkers[0] && list <= &FreshThinkers[MAX_STATNUM])
+	{
+		bucket = int(list - FreshThinkers) * 2 + 1;
+	}
+	else
+	{
+		assert(list >= &Thinkers[0] && list <= &Thinkers[MAX_STATNUM+1]);
+		bucket = int(list - Thinkers) * 2;
+	}
+
+	if (ClassList != NULL)
+	{
+		UnlinkFromClassList();
+	}
+	Bucket = bucket;
+	LinkStamp = ++LastLinkStamp;
+	if (ClassList != NULL)
+	{
+		LinkToClassList();
+	}
+}
+
+//==========================================================================
+//
+// DThinker :: UpdateClassIndex
+//
+// Moves all pending thinkers to the lists of their classes.
+//
+//==========================================================================
+
+void DThinker::UpdateClassIndex ()
+{
+	DThinker *node = PendingHead;
+
+	PendingHead = PendingTail = NULL;
+	while (node != NULL)
+	{
+		DThinker *next = node->NextOfClass;
+		const PClass *type = node->GetClass();
+		FThinkerClassList **pList = ClassLists.CheckKey(type);
+		FThinkerClassList *list;
+
+		if (pList != NULL)
+		{
+			list = *pList;
+		}
+		else
+		{
+			list = new FThinkerClassList;
+			list->Type = type;
+			ClassLists[type] = list;
+			AllClassLists.Push(list);
+		}
+
+		node->ClassList = list;
+		node->LinkToClassList();
+		list->Count++;
+		node = next;
+	}
+}
+
+//==========================================================================
+//
+// DThinker :: GetClassLists
+//
+// Returns the lists of all indexed classes that descend from type.
+//
+//==========================================================================
+
+const TArray<FThinkerClassList *> &DThinker::GetClassLists (const PClass *type)
+{
+	FThinkerClassMatches **pMatches = ClassMatches.CheckKey(type);
+	FThinkerClassMatches *matches;
+
+	if (pMatches != NULL)
+	{
+		matches = *pMatches;
+	}
+	else
+	{
+		matches = new FThinkerClassMatches;
+		ClassMatches[type] = matches;
+	}
+
+	for (; matches->NumChecked < AllClassLists.Size(); ++matches->NumChecked)
+	{
+		if (AllClassLists[matches->NumChecked]->Type->IsDescendantOf(type))
+		{
+			matches->Lists.Push(AllClassLists[matches->NumChecked]);
+		}
+	}
+	return matches->Lists;
+}
+
 size_t DThinker::PropagateMark()
 {
 	assert(NextThinker != NULL && !(NextThinker->ObjectFlags & OF_EuthanizeMe));
@@ -507,6 +816,7 @@ FThinkerIterator::FThinkerIterator (const PClass *type, int statnum)
 	m_ParentType = type;
 	m_CurrThinker = DThinker::Thinkers[m_Stat].GetHead();
 	m_SearchingFresh = false;
+	InitClassIndex ();
 }
 
 FThinkerIterator::FThinkerIterator (const PClass *type, int statnum, DThinker *prev)
@@ -522,6 +832,8 @@ FThinkerIterator::FThinkerIterator (const PClass *type, int statnum, DThinker *p
 		m_SearchStats = false;
 	}
 	m_ParentType = type;
+	// Continuing after a thinker is only supported in the stat lists.
+	m_ClassLists = NULL;
 	if (prev == NULL || (prev->NextThinker->ObjectFlags & OF_Sentinel))
 	{
 		Reinit();
@@ -533,8 +845,163 @@ FThinkerIterator::FThinkerIterator (const PClass *type, int statnum, DThinker *p
 	}
 }
 
+//==========================================================================
+//
+// FThinkerIterator :: InitClassIndex
+//
+// Uses the class index, unless the iteration is limited to one statnum
+// anyway, or nearly every thinker matches. The thinkers of all matching
+// classes are merged so that they come in the same order as in the stat
+// lists, which gets expensive with many classes, so those iterations use
+// the stat lists too.
+//
+//==========================================================================
+
+void FThinkerIterator::InitClassIndex ()
+{
+	m_ClassLists = NULL;
+
+	if (!thinkerindex || !m_SearchStats || m_ParentType == NULL ||
+		m_ParentType == RUNTIME_CLASS(DThinker) || m_ParentType == RUNTIME_CLASS(AActor))
+	{
+		IteratorStats.LinearIterations++;
+		return;
+	}
+
+	DThinker::UpdateClassIndex();
+	const TArray<FThinkerClassList *> &lists = DThinker::GetClassLists(m_ParentType);
+	if (lists.Size() > MAX_INDEXED_CLASSES)
+	{
+		IteratorStats.LinearIterations++;
+		return;
+	}
+
+	m_ClassLists = &lists;
+	EnterBucket(STAT_FIRST_THINKING*2);
+	IteratorStats.IndexedIterations++;
+}
+
+//==========================================================================
+//
+// FThinkerIterator :: EnterBucket
+//
+//==========================================================================
+
+void FThinkerIterator::EnterBucket (int bucket)
+{
+	m_Bucket = bucket;
+	m_LastStamp = 0;
+	m_BucketDone = false;
+	memset (m_LastOfClass, 0, sizeof(m_LastOfClass));
+}
+
+//==========================================================================
+//
+// FThinkerIterator :: NextInBucket
+//
+// Returns the thinker of a matching class that comes next in the current
+// bucket, i.e. the one that was linked into the stat list first.
+//
+//==========================================================================
+
+DThinker *FThinkerIterator::NextInBucket ()
+{
+	DThinker *best = NULL;
+	unsigned int bestIndex = 0;
+
+	for (unsigned int i = 0; i < m_ClassLists->Size(); ++i)
+	{
+		FThinkerClassList *list = (*m_ClassLists)[i];
+		if (list->Heads[m_Bucket] == NULL)
+		{
+			continue;
+		}
+
+		// Continue after the last thinker of this class. If that one has been destroyed
+		// since, continue after the one that was before it. If it has been moved to
+		// another list, search the whole bucket.
+		DThinker *last = (i < MAX_INDEXED_CLASSES) ? m_LastOfClass[i] : NULL;
+		while (last != NULL && !last->bInClassIndex)
+		{
+			last = last->PrevOfClass;
+		}
+		if (last != NULL && (last->ClassList != list || last->Bucket != m_Bucket || last->LinkStamp > m_LastStamp))
+		{
+			last = NULL;
+		}
+
+		DThinker *node = (last != NULL) ? last->NextOfClass : list->Heads[m_Bucket];
+		while (node != NULL && node->LinkStamp <= m_LastStamp)
+		{
+			IteratorStats.IndexedVisits++;
+			node = node->NextOfClass;
+		}
+
+		if (node != NULL && (best == NULL || node->LinkStamp < best->LinkStamp))
+		{
+			best = node;
+			bestIndex = i;
+		}
+	}
+
+	if (best != NULL)
+	{
+		m_LastStamp = best->LinkStamp;
+		m_BucketDone = (best->NextThinker != NULL && (best->NextThinker->ObjectFlags & OF_Sentinel));
+		if (bestIndex < MAX_INDEXED_CLASSES)
+		{
+			m_LastOfClass[bestIndex] = best;
+		}
+	}
+	return best;
+}
+
+//==========================================================================
+//
+// FThinkerIterator :: NextIndexed
+//
+// Goes through the buckets in the same order as Next goes through the
+// stat lists.
+//
+//==========================================================================
+
+DThinker *FThinkerIterator::NextIndexed ()
+{
+	for (;;)
+	{
+		// Thinkers that were created in the meantime are found, too.
+		if (DThinker::PendingHead != NULL)
+		{
+			DThinker::UpdateClassIndex();
+			m_ClassLists = &DThinker::GetClassLists(m_ParentType);
+		}
+
+		// Once the end of the stat list has been reached, thinkers that are added to it
+		// aren't found anymore, just like in the stat list.
+		DThinker *thinker = m_BucketDone ? NULL : NextInBucket();
+		if (thinker != NULL)
+		{
+			return thinker;
+		}
+
+		// Like the stat lists, start over after the last one.
+		if (m_Bucket >= MAX_STATNUM*2+1)
+		{
+			EnterBucket(STAT_FIRST_THINKING*2);
+			return NULL;
+		}
+		EnterBucket(m_Bucket + 1);
+	}
+}
+
 void FThinkerIterator::Reinit ()
 {
+	if (m_ClassLists != NULL)
+	{
+		// Like the stat lists, start over at the current statnum.
+		EnterBucket(m_Bucket & ~1);
+		return;
+	}
 	m_CurrThinker = DThinker::Thinkers[m_Stat].GetHead();
 	m_SearchingFresh = false;
 }
@@ -545,6 +1012,11 @@ DThinker *FThinkerIterator::Next ()
 	{
 		return NULL;
 	}
+	// Only visit the thinkers of matching classes.
+	if (m_ClassLists != NULL)
+	{
+		return NextIndexed();
+	}
 	do
 	{
 		do
@@ -555,6 +1027,7 @@ DThinker *FThinkerIterator::Next ()
 				{
 					DThinker *thinker = m_CurrThinker;
 					m_CurrThinker = thinker->NextThinker;
+					IteratorStats.LinearVisits++;
 					if (thinker->IsKindOf(m_ParentType))
 					{
 						return thinker;
@@ -586,3 +1059,87 @@ ADD_STAT (think)
 	out.Format ("Think time = %04.1f ms", ThinkCycles.TimeMS());
 	return out;
 }
+
+ADD_STAT (thinkerindex)
+{
+	FString out;
+	out.Format ("Indexed iterations = %u (%u visited), linear iterations = %u (%u visited), %u classes",
+		LastIteratorStats.IndexedIterations, LastIteratorStats.IndexedVisits,
+		LastIteratorStats.LinearIterations, LastIteratorStats.LinearVisits, DThinker::GetNumIndexedClasses());
+	return out;
+}
+
+//*****************************************************************************
+//
+#if BUILD_ID != BUILD_RELEASE
+template <class T> static unsigned int thinker_Count( void )
+{
+	TThinkerIterator<T>	Iterator;
+	unsigned int		count = 0;
+
+	while ( Iterator.Next( ) != NULL )
+		count++;
+
+	return ( count );
+}
+
+//*****************************************************************************
+//
+// Compares the typed thinker iterations SERVER_UpdateSectors does for every joining client
+// with and without the class index. Pads the map with actors (20000 by default) to simulate
+// a busy map.
+// Usage: benchmark thinkers [actors]
+BENCHMARK( thinkers )
+{
+	// Every actor takes a network ID, and a server quits when it runs out of them.
+	if (( gamestate != GS_LEVEL ) || NETWORK_InClientMode( ) || ( NETWORK_GetState( ) == NETSTATE_SERVER ))
+	{
+		Printf( "A level must be running, and this can't be a client or a server.\n" );
+		return;
+	}
+
+	const int maxActors = MIN<int>( 100000, g_ActorNetIDList.countFreeIDs( ) / 2 );
+	const int numActors = ( argv.argc( ) > 1 ) ? clamp( atoi( argv[1] ), 0, maxActors ) : clamp( 20000, 0, maxActors );
+	const fixed_t x = bmaporgx + bmapwidth * MAPBLOCKSIZE / 2;
+	const fixed_t y = bmaporgy + bmapheight * MAPBLOCKSIZE / 2;
+
+	TArray<AActor *> padding;
+	for ( int i = 0; i < numActors; ++i )
+		padding.Push( Spawn( RUNTIME_CLASS( AActor ), x, y, ONFLOORZ, NO_REPLACE ));
+
+	const bool bUseIndex = thinkerindex;
+	cycle_t times[2];
+	unsigned int found[2] = { 0, 0 };
+
+	for ( int mode = 0; mode < 2; ++mode )
+	{
+		thinkerindex = ( mode == 1 );
+		times[mode].Reset( );
+		times[mode].Clock( );
+		for ( int i = 0; i < 100; ++i )
+		{
+			found[mode] += thinker_Count<DPolyAction>( );
+			found[mode] += thinker_Count<DFireFlicker>( );
+			found[mode] += thinker_Count<DFlicker>( );
+			found[mode] += thinker_Count<DLightFlash>( );
+			found[mode] += thinker_Count<DStrobe>( );
+			found[mode] += thinker_Count<DGlow>( );
+			found[mode] += thinker_Count<DGlow2>( );
+			found[mode] += thinker_Count<DPhased>( );
+		}
+		times[mode].Unclock( );
+	}
+	thinkerindex = bUseIndex;
+
+	for ( unsigned int i = 0; i < padding.Size( ); ++i )
+	{
+		// Monsters and items were counted when they spawned.
+		padding[i]->ClearCounters( );
+		padding[i]->Destroy( );
+	}
+
+	Printf( "%d extra actors, %u matching thinkers per update\n", numActors, found[1] / 100 );
+	Printf( "  stat lists:  %.4f ms per update\n", times[0].TimeMS( ) / 100 );
+	Printf( "  class index: %.4f ms per update\n", times[1].TimeMS( ) / 100 );
+}
+#endif
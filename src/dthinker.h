@@ -59,6 +59,22 @@ struct FThinkerList
 	DThinker *Sentinel;
 };
 
+// All thinkers of one class, see FThinkerIterator. There is one doubly linked
+// list for each stat list, Thinkers[statnum] goes in bucket statnum*2 and
+// FreshThinkers[statnum] in bucket statnum*2+1. Each list is in the same order as
+// the stat list itself.
+struct FThinkerClassList
+{
+	enum { NUM_BUCKETS = (MAX_STATNUM+1)*2+1 };
+
+	FThinkerClassList();
+
+	const PClass *Type;
+	DThinker *Heads[NUM_BUCKETS];
+	DThinker *Tails[NUM_BUCKETS];
+	unsigned int Count;
+};
+
 class DThinker : public DObject
 {
 	DECLARE_CLASS (DThinker, DObject)
@@ -80,6 +96,7 @@ public:
 	static void MarkRoots();
 
 	static DThinker *FirstThinker (int statnum);
+	static unsigned int GetNumIndexedClasses () { return AllClassLists.Size(); }
 
 private:
 	enum no_link_type { NO_LINK };
@@ -90,6 +107,21 @@ private:
 	static void SaveList(FArchive &arc, DThinker *node);
 	void Remove();
 
+	// The class index. New thinkers don't know their final class yet while they are being
+	// constructed, so they are put on a pending list first and sorted in on the next typed iteration.
+	void AddToClassIndex();
+	void RemoveFromClassIndex();
+	void UnlinkFromClassList();
+	void LinkToClassList();
+	void MoveToBucket(const FThinkerList *list);
+	static void UpdateClassIndex();
+	static const TArray<FThinkerClassList *> &GetClassLists (const PClass *type);
+
+	static DThinker *PendingHead, *PendingTail;
+	static QWORD LastLinkStamp;
+	static TMap<const PClass *, FThinkerClassList *> ClassLists;
+	static TArray<FThinkerClassList *> AllClassLists;
+
 	static FThinkerList Thinkers[MAX_STATNUM+2];		// Current thinkers
 	static FThinkerList FreshThinkers[MAX_STATNUM+1];	// Newly created thinkers
 	static bool bSerialOverride;
@@ -99,6 +131,14 @@ private:
 	friend class DObject;
 
 	DThinker *NextThinker, *PrevThinker;
+
+	// The thinker's links in the class index, the list it is in (NULL while pending), the
+	// bucket of the stat list it is in and when it was put there.
+	DThinker *NextOfClass, *PrevOfClass;
+	FThinkerClassList *ClassList;
+	QWORD LinkStamp;
+	WORD Bucket;
+	bool bInClassIndex;
 };
 
 class FThinkerIterator
@@ -111,6 +151,21 @@ private:
 	bool m_SearchStats;
 	bool m_SearchingFresh;
 
+	// When using the class index, the lists of all classes that match m_ParentType, the
+	// bucket that is being searched, the stamp of the last thinker returned from it, whether
+	// that was the end of its stat list and the last thinker returned of each class.
+	enum { MAX_INDEXED_CLASSES = 32 };
+	const TArray<FThinkerClassList *> *m_ClassLists;
+	int m_Bucket;
+	QWORD m_LastStamp;
+	bool m_BucketDone;
+	DThinker *m_LastOfClass[MAX_INDEXED_CLASSES];
+
+	void InitClassIndex ();
+	void EnterBucket (int bucket);
+	DThinker *NextInBucket ();
+	DThinker *NextIndexed ();
+
 public:
 	FThinkerIterator (const PClass *type, int statnum=MAX_STATNUM+1);
 	FThinkerIterator (const PClass *type, int statnum, DThinker *prev);
@@ -113,6 +113,8 @@
 #include "a_lightning.h"
 #include "po_man.h"
 #include "voicechat.h"
+#include "unlagged.h"
+#include "sv_profile.h"
 
 #include <zlib.h>
 
@@ -1615,7 +1617,16 @@ void G_Ticker ()
 		// Now that we're done parsing the multiple packets the server has sent our way, check
 		// to see if any packets are missing.
 		if (( NETWORK_GetState( ) == NETSTATE_CLIENT ) && ( CLIENT_GetConnectionState( ) >= CTS_ATTEMPTINGAUTHENTICATION ))
+		{
 			CLIENT_CheckForMissingPackets( );
+
+			// The server only accepts this once we're authenticated.
+			if ( CLIENT_GetConnectionState( ) >= CTS_REQUESTINGSNAPSHOT )
+			{
+				CLIENT_AcknowledgePackets( );
+				CLIENT_AcknowledgePlayerMovement( );
+			}
+		}
 	}
 
 	// If we're playing back a demo, read packets and ticcmds now.
@@ -1743,7 +1754,10 @@ void G_Ticker ()
 			( P_CheckTickerPaused( ) == false ))
 		{
 			// Update some general bot stuff.
-			BOTS_Tick( );
+			{
+				FServerProfileScope Scope( SPS_BOTS );
+				BOTS_Tick( );
+			}
 
 			// Tick the duel module.
 			DUEL_Tick( );
@@ -3802,6 +3816,9 @@ void GAME_ResetMap( bool bRunEnterScripts )
 		}
 	}
 
+	// The sectors jumped back to their initial heights, their recorded heights are useless now.
+	UNLAGGED_ResetSectors( );
+
 	// Reset the sky properties of the map.
 	pLevelInfo = level.info;//FindLevelInfo( level.mapname );
 	if ( pLevelInfo )
@@ -106,8 +106,10 @@
 #include "gi.h"
 #include "survival.h"
 #include "network/nettraffic.h"
+#include "sv_relevance.h"
 #include "chat.h"
 #include "scoreboard.h"
+#include "unlagged.h"
 #include <set> // [CK] For CCMD listmusic
 
 #include "g_hub.h"
@@ -1132,6 +1134,10 @@ void G_DoLoadLevel (int position, bool autosave)
 	// [BB] Reset the net traffic measurements when a new map starts.
 	NETTRAFFIC_Reset();
 
+	// The positions the clients missed belong to the old map.
+	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
+		SERVER_RELEVANCE_Reset( );
+
 	// [AK] Reset the end level delay if it's not already zero.
 	GAME_SetEndLevelDelay( 0, false );
 
@@ -2345,6 +2351,9 @@ void G_SerializeLevel (FArchive &arc, bool hubLoad)
 				players[i].mo->SetupWeaponSlots();
 			}
 		}
+
+		// The sectors may be at different heights than when the map was loaded.
+		UNLAGGED_ResetSectors( );
 	}
 	// [BB] The server doesn't have a Renderer.
 	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
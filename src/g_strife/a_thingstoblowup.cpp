@@ -92,6 +92,8 @@ DEFINE_ACTION_FUNCTION(AActor, A_LightGoesOut)
 	fixed_t oldtheight = sec->floorplane.Zat0();
 	newheight = sec->FindLowestFloorSurrounding(&spot);
 	sec->floorplane.d = sec->floorplane.PointToDist (spot, newheight);
+	// Unlagged needs to record the heights of this sector now.
+	UNLAGGED_SectorMoved( sec );
 	fixed_t newtheight = sec->floorplane.Zat0();
 	sec->ChangePlaneTexZ(sector_t::floor, newtheight - oldtheight);
 
@@ -45,7 +45,7 @@ namespace skulltag {
 
 	public:
 
-		/** Decodes data read from an input buffer and stores the result in the output buffer.
+		/** Encodes data read from an input buffer and stores the result in the output buffer.
 		 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
 		virtual int encode(
 			unsigned char const * const input,	/**< in: pointer to the first byte to encode. */
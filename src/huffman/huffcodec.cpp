@@ -23,6 +23,7 @@
  * THE SOFTWARE.
  */
 
+#include <assert.h>
 #include "huffcodec.h"
 
 /** Prevents naming convention problems via encapsulation. */
@@ -72,6 +73,7 @@ namespace skulltag {
 		// recursive Huffman tree builder.
 		buildTree( root, treeData, 0, dataLength, codeTable, 256 );
 		huffResourceOwner = true;
+		buildLookupTables();
 	}
 	
 
@@ -88,6 +90,7 @@ namespace skulltag {
 		root = treeRootNode;
 		codeTable = leafCodeTable;
 		huffResourceOwner = false;
+		buildLookupTables();
 	}
 	
 	/** Checks the ownership state of this HuffmanCodec's resources.
@@ -103,6 +106,49 @@ namespace skulltag {
 		reverseBits = false;
 		expandable = true;
 		huffResourceOwner = false;
+		lookupBits = 0;
+		lookupTable = 0;
+		for ( int i = 0; i < 256; i++ ){
+			streamCode[i] = 0;
+			streamCodeLength[i] = 0;
+		}
+	}
+
+	/** Builds the decode lookup table and the stream order code table from the Huffman tree.
+	 * Must be called after the tree and the codeTable are set up. */
+	void HuffmanCodec::buildLookupTables(){
+		// A tree without branches can't encode anything, leave the tables empty.
+		if ( (root == 0) || (root->branch == 0) ) return;
+
+		// Size the table to hold the longest code, but keep it small enough to stay in the cache.
+		// Longer codes are finished off by walking the tree from the node the table points to.
+		lookupBits = 0;
+		maxCodeLength( root, lookupBits );
+		lookupBits -= root->bitCount;
+		if ( lookupBits > 12 ) lookupBits = 12;
+
+		int const tableSize = 1 << lookupBits;
+		lookupTable = new HuffmanNode const *[ tableSize ];
+		for ( int i = 0; i < tableSize; i++ ){
+			// Walk the tree using the bits of the index, first bit read is the least significant one.
+			HuffmanNode const * node = root;
+			for ( int bit = 0; (bit < lookupBits) && (node->branch != 0); bit++ )
+				node = &(node->branch[ (i >> bit) & 0x01 ]);
+			lookupTable[i] = node;
+		}
+
+		// The codes in the tree are stored most significant bit first, flip them into stream order.
+		for ( int i = 0; i < 256; i++ ){
+			HuffmanNode const * node = codeTable[i];
+			if ( node == 0 ) continue;
+			// streamCode can't hold longer codes.
+			assert( node->bitCount <= 32 );
+			unsigned int code = 0;
+			for ( int bit = 0; bit < node->bitCount; bit++ )
+				code |= ( (node->code >> bit) & 0x01 ) << ( node->bitCount - 1 - bit );
+			streamCode[i] = code;
+			streamCodeLength[i] = (unsigned char)node->bitCount;
+		}
 	}
 	
 	/** Increases a codeLength up to the longest Huffman code bit length found in the node or any of its children. <br>
@@ -206,9 +252,10 @@ namespace skulltag {
 		return index;
 	}
 
-	/** Decodes data read from an input buffer and stores the result in the output buffer.
+	/** Encodes data one Huffman code at a time through the BitWriter. <br>
+	 * Produces the same output as encode(); kept as a reference implementation for verification.
 	 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
-	int HuffmanCodec::encode(
+	int HuffmanCodec::encodeBitwise(
 		unsigned char const * const input,	/**< in: pointer to the first byte to encode. */
 		unsigned char * const output,		/**< out: pointer to an output buffer to store data. */
 		int const &inLength,				/**< in: number of bytes of input buffer to encoded. */
@@ -238,16 +285,17 @@ namespace skulltag {
 		}
 
 		return bytesWritten;
-	} // end function encode
+	} // end function encodeBitwise
 
-	/** Decodes data read from an input buffer and stores the result in the output buffer.
+	/** Decodes data by walking the Huffman tree one bit at a time. <br>
+	 * Produces the same output as decode(); kept as a reference implementation for verification.
 	 * @return number of bytes stored in the output buffer or -1 if an error occurs while decoding. */
-	int HuffmanCodec::decode(
+	int HuffmanCodec::decodeBitwise(
 		unsigned char const * const input,	/**< in: pointer to data that needs decoding. */
 		unsigned char * const output,		/**< out: pointer to output buffer to store decoded data. */
 		int const &inLength,				/**< in: number of bytes of input buffer to read. */
 		int const &outLength				/**< in: maximum length of data to output. */
-	){
+	) const {
 		if ( inLength < 1 ) return 0;
 		int bitsAvailable = ((inLength-1) << 3) - (0xff & input[0]);
 		int rIndex = 1;		// read index of input buffer.
@@ -284,6 +332,137 @@ namespace skulltag {
 			bitsAvailable--;	// decrement total bits left
 		}
 
+		return wIndex;
+	} // end function decodeBitwise
+
+	/** Encodes data read from an input buffer and stores the result in the output buffer.
+	 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
+	int HuffmanCodec::encode(
+		unsigned char const * const input,	/**< in: pointer to the first byte to encode. */
+		unsigned char * const output,		/**< out: pointer to an output buffer to store data. */
+		int const &inLength,				/**< in: number of bytes of input buffer to encoded. */
+		int const &outLength				/**< in: maximum length of data to output. */
+	) const {
+		unsigned char const * const inputs[1] = { input };
+		return encodeSegments( inputs, &inLength, 1, output, outLength );
+	} // end function encode
+
+	/** Encodes several buffers as if they were one block of data, so a packet
+	 * can be encoded from its parts without copying them together first.
+	 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
+	int HuffmanCodec::encodeSegments(
+		unsigned char const * const * inputs,	/**< in: pointers to the first byte of each buffer to encode. */
+		int const * inLengths,					/**< in: number of bytes to encode from each buffer. */
+		int const &numSegments,					/**< in: number of buffers. */
+		unsigned char * const output,			/**< out: pointer to an output buffer to store data. */
+		int const &outLength					/**< in: maximum length of data to output. */
+	) const {
+		int inLength = 0;
+		for ( int i = 0; i < numSegments; i++ ) inLength += inLengths[i];
+
+		// if not expandable Limit output to input length.
+		int const limit = ( expandable || ((inLength + 1) >= outLength) ) ? outLength : inLength + 1;
+		// nothing fits into the output buffer, only empty input succeeds.
+		if ( limit < 1 ) return ( inLength > 0 ) ? -1 : 0;
+
+		unsigned char * out = output + 1; // reserve place for padding signal.
+		unsigned char * const outEnd = output + limit;
+
+		/* Codes are collected in stream order in the low end of a 64 bit buffer and written out
+		 * 32 bits at a time. Writing the first bit into the least significant bit of a byte gives
+		 * the same result as writing it into the most significant one and reversing the byte,
+		 * so the bits only need to be reversed here when the old compatibility mode is off. */
+		unsigned long long bitBuffer = 0;
+		int bitCount = 0;
+
+		for ( int segment = 0; segment < numSegments; segment++ ){
+			unsigned char const * const input = inputs[segment];
+			int const length = inLengths[segment];
+
+			for ( int i = 0; i < length; i++ ){
+				int const value = 0xff & input[i];
+				bitBuffer |= (unsigned long long)streamCode[ value ] << bitCount;
+				bitCount += streamCodeLength[ value ];
+
+				if ( bitCount >= 32 ){
+					// bail if the output buffer can't hold another 32 bits.
+					if ( (outEnd - out) < 4 ) return -1;
+					for ( int j = 0; j < 4; j++ ){
+						unsigned char const byte = (unsigned char)( bitBuffer & 0xff );
+						*out++ = reverseBits ? byte : reverseMap[ byte ];
+						bitBuffer >>= 8;
+					}
+					bitCount -= 32;
+				}
+			}
+		}
+
+		// write the remaining bits, the last byte is padded out with zeros.
+		int const remainingBytes = (bitCount + 7) >> 3;
+		if ( (outEnd - out) < remainingBytes ) return -1;
+		for ( int j = 0; j < remainingBytes; j++ ){
+			unsigned char const byte = (unsigned char)( bitBuffer & 0xff );
+			*out++ = reverseBits ? byte : reverseMap[ byte ];
+			bitBuffer >>= 8;
+		}
+
+		// write padding signal byte to begining of stream.
+		output[0] = (unsigned char)( (8 - (bitCount & 7)) & 7 );
+
+		return (int)( out - output );
+	} // end function encodeSegments
+
+	/** Decodes data read from an input buffer and stores the result in the output buffer.
+	 * @return number of bytes stored in the output buffer or -1 if an error occurs while decoding. */
+	int HuffmanCodec::decode(
+		unsigned char const * const input,	/**< in: pointer to data that needs decoding. */
+		unsigned char * const output,		/**< out: pointer to output buffer to store decoded data. */
+		int const &inLength,				/**< in: number of bytes of input buffer to read. */
+		int const &outLength				/**< in: maximum length of data to output. */
+	){
+		if ( inLength < 1 ) return 0;
+		if ( lookupTable == 0 ) return 0;
+		int bitsAvailable = ((inLength-1) << 3) - (0xff & input[0]);
+		int rIndex = 1;		// read index of input buffer.
+		int wIndex = 0;		// write index of output buffer.
+		int const lookupMask = (1 << lookupBits) - 1;
+		int const rootBits = root->bitCount;
+
+		/* Bits are kept in stream order in the low end of a 64 bit buffer. Bytes have
+		 * their bits reversed on the way in unless the old compatibility mode is on, see encode(). */
+		unsigned long long bitBuffer = 0;
+		int bitCount = 0;
+
+		while ( bitsAvailable > 0 ){
+			// Top up the bit buffer.
+			while ( (bitCount <= 56) && (rIndex < inLength) ){
+				unsigned char const byte = input[rIndex++];
+				bitBuffer |= (unsigned long long)( reverseBits ? byte : reverseMap[ byte ] ) << bitCount;
+				bitCount += 8;
+			}
+
+			// Look up the next code, finish it off bit by bit if it is longer than the table.
+			HuffmanNode const * node = lookupTable[ bitBuffer & lookupMask ];
+			int bitsUsed = lookupBits;
+			while ( (node->branch != 0) && (bitsUsed < bitsAvailable) ){
+				node = &(node->branch[ (bitBuffer >> bitsUsed) & 0x01 ]);
+				bitsUsed++;
+			}
+			if ( node->branch == 0 ) bitsUsed = node->bitCount - rootBits;
+
+			// Stop at an incomplete code in the padding at the end of the stream.
+			if ( (node->branch != 0) || (bitsUsed > bitsAvailable) ) break;
+
+			// buffer overflow prevention
+			if ( wIndex >= outLength ) return wIndex;
+			// Output leaf node's value.
+			output[ wIndex++ ] = (unsigned char)(node->value & 0xff);
+
+			bitBuffer >>= bitsUsed;
+			bitCount -= bitsUsed;
+			bitsAvailable -= bitsUsed;
+		}
+
 		return wIndex;
 	} // end function decode
 
@@ -301,6 +480,7 @@ namespace skulltag {
 	/** Destructor - frees resources. */
 	HuffmanCodec::~HuffmanCodec() {
 		delete writer;
+		delete[] lookupTable;
 		//check for resource ownership before deletion
 		if ( huffmanResourceOwner() ){
 			delete[] codeTable;
@@ -67,6 +67,21 @@ namespace skulltag {
 		/** Number of bits the shortest huffman code in the tree has. */
 		int shortestCode;	
 
+		/** Number of input bits used to index the decode lookup table. */
+		int lookupBits;
+
+		/** Decode lookup table with (1 << lookupBits) entries. <br>
+		 * The table is indexed by the next lookupBits bits of input in stream order (the first bit read is
+		 * the least significant bit of the index). Each entry points to the leaf that the bits decode to, or
+		 * to the branch node reached after lookupBits bits if the code is longer than the table. */
+		HuffmanNode const ** lookupTable;
+
+		/** Huffman codes of each byte value in stream order (first bit to output is the least significant bit). */
+		unsigned int streamCode[256];
+
+		/** Number of bits in each of the codes stored in streamCode. */
+		unsigned char streamCodeLength[256];
+
 	public:	
 
 		/** Creates a new HuffmanCodec from the Huffman tree data.
@@ -86,7 +101,7 @@ namespace skulltag {
 		/** Frees resources used internally by this HuffmanCodec. */
 		virtual ~HuffmanCodec();
 
-		/** Decodes data read from an input buffer and stores the result in the output buffer.
+		/** Encodes data read from an input buffer and stores the result in the output buffer.
 		 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
 		virtual int encode(
 			unsigned char const * const input,	/**< in: pointer to the first byte to encode. */
@@ -95,6 +110,17 @@ namespace skulltag {
 			int const &outLength				/**< in: maximum length of data to output. */
 		) const;
 
+		/** Encodes several buffers one after the other as if they were a single block of data. <br>
+		 * Produces the same output as encode() on the concatenated buffers.
+		 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
+		int encodeSegments(
+			unsigned char const * const * inputs,	/**< in: pointers to the first byte of each buffer to encode. */
+			int const * inLengths,					/**< in: number of bytes to encode from each buffer. */
+			int const &numSegments,					/**< in: number of buffers. */
+			unsigned char * const output,			/**< out: pointer to an output buffer to store data. */
+			int const &outLength					/**< in: maximum length of data to output. */
+		) const;
+
 		/** Decodes data read from an input buffer and stores the result in the output buffer.
 		 * @return number of bytes stored in the output buffer or -1 if an error occurs while decoding. */
 		virtual int decode(
@@ -104,6 +130,26 @@ namespace skulltag {
 			int const &outLength				/**< in: maximum length of data to output. */
 		);
 
+		/** Encodes data one Huffman code at a time through the BitWriter. <br>
+		 * Produces the same output as encode(); kept as a reference implementation for verification.
+		 * @return number of bytes stored in the output buffer or -1 if an error occurs while encoding. */
+		int encodeBitwise(
+			unsigned char const * const input,	/**< in: pointer to the first byte to encode. */
+			unsigned char * const output,		/**< out: pointer to an output buffer to store data. */
+			int const &inLength,				/**< in: number of bytes of input buffer to encoded. */
+			int const &outLength				/**< in: maximum length of data to output. */
+		) const;
+
+		/** Decodes data by walking the Huffman tree one bit at a time. <br>
+		 * Produces the same output as decode(); kept as a reference implementation for verification.
+		 * @return number of bytes stored in the output buffer or -1 if an error occurs while decoding. */
+		int decodeBitwise(
+			unsigned char const * const input,	/**< in: pointer to data that needs decoding. */
+			unsigned char * const output,		/**< out: pointer to output buffer to store decoded data. */
+			int const &inLength,				/**< in: number of bytes of input buffer to read. */
+			int const &outLength				/**< in: maximum length of data to output. */
+		) const;
+
 		/** Enables or Disables backwards bit ordering of bytes.
 		 * @param backwards  "true" enables reversed bit order bytes, "false" uses standard byte bit ordering. */
 		void reversedBytes( bool backwards );
@@ -176,6 +222,10 @@ namespace skulltag {
 		/** Perform initialization procedures common to all constructors. */
 		void init();
 
+		/** Builds the decode lookup table and the stream order code table from the Huffman tree.
+		 * Must be called after the tree and the codeTable are set up. */
+		void buildLookupTables();
+
 	}; // end class Huffman Codec.
 } // end namespace skulltag
 
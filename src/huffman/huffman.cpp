@@ -25,6 +25,7 @@
 
 // required for atexit()
 #include <stdlib.h>
+#include <string.h>
 
 #include "huffman.h"
 #include "huffcodec.h"
@@ -95,6 +96,11 @@ void HUFFMAN_Destruct(){
 	__codec = NULL;
 }
 
+/** Returns the HuffmanCodec Object used by HUFFMAN_Encode() and HUFFMAN_Decode(). */
+HuffmanCodec * HUFFMAN_GetCodec(){
+	return __codec;
+}
+
 /** Applies Huffman encoding to a block of data. */
 void HUFFMAN_Encode(
 	/** in: Pointer to start of data that is to be encoded. */
@@ -129,6 +135,50 @@ void HUFFMAN_Encode(
 	}
 } // end function HUFFMAN_Encode
 
+/** Applies Huffman encoding to several blocks of data, the result is the same as
+ * encoding them from one buffer. */
+void HUFFMAN_EncodeSegments(
+	/** in: Pointers to the start of each block of data that is to be encoded. */
+	unsigned char const * const * inputBuffers,
+	/** in: Number of chars to read from each of the inputBuffers. */
+	int const * inputBufferSizes,
+	/** in: Number of blocks. */
+	int const &numInputBuffers,
+	/** out: Pointer to destination buffer where encoded data will be stored. */
+	unsigned char * const outputBuffer,
+	/**< in+out: Max chars to write into outputBuffer. <br>
+	 * 		Upon return holds the number of chars stored or 0 if an error occurs. */
+	int * outputBufferSize
+){
+	int bytesWritten = __codec->encodeSegments( inputBuffers, inputBufferSizes, numInputBuffers, outputBuffer, *outputBufferSize );
+
+	// expansion occured -- provide backwards compatibility
+	if ( bytesWritten < 0 ){
+		int inputBufferSize = 0;
+		for ( int i = 0; i < numInputBuffers; i++ ) inputBufferSize += inputBufferSizes[i];
+
+		// check buffer sizes
+		if ( *outputBufferSize < (inputBufferSize + 1) ){
+			// outputBuffer too small, return "no bytes written"
+			*outputBufferSize = 0;
+			return;
+		}
+
+		// perform the unencoded copy
+		unsigned char * out = outputBuffer + 1;
+		for ( int i = 0; i < numInputBuffers; i++ ){
+			memcpy( out, inputBuffers[i], inputBufferSizes[i] );
+			out += inputBufferSizes[i];
+		}
+		// supply the "unencoded" signal and bytesWritten
+		outputBuffer[0] = 0xff;
+		*outputBufferSize = inputBufferSize + 1;
+	} else {
+		// assign the bytesWritten return value
+		*outputBufferSize = bytesWritten;
+	}
+} // end function HUFFMAN_EncodeSegments
+
 /** Decodes a block of data that is Huffman encoded. */
 void HUFFMAN_Decode(
 	unsigned char const * const inputBuffer,	/**< in: Pointer to start of data that is to be decoded. */
@@ -36,6 +36,9 @@ void HUFFMAN_Construct();
 /** Releases resources allocated by the HuffmanCodec. */
 void HUFFMAN_Destruct();
 
+/** Returns the HuffmanCodec Object used by HUFFMAN_Encode() and HUFFMAN_Decode(). */
+skulltag::HuffmanCodec * HUFFMAN_GetCodec();
+
 /** Applies Huffman encoding to a block of data. */
 void HUFFMAN_Encode(
 	unsigned char const * const inputBuffer,	/**< in: Pointer to start of data that is to be encoded. */
@@ -44,6 +47,15 @@ void HUFFMAN_Encode(
 	int *outputBufferSize						/**< in+out: Max chars to write into outputBuffer. Upon return holds the number of chars stored or 0 if an error occurs. */
 );
 
+/** Applies Huffman encoding to several blocks of data as if they were one. */
+void HUFFMAN_EncodeSegments(
+	unsigned char const * const * inputBuffers,	/**< in: Pointers to the start of each block of data that is to be encoded. */
+	int const * inputBufferSizes,				/**< in: Number of chars to read from each of the inputBuffers. */
+	int const &numInputBuffers,					/**< in: Number of blocks. */
+	unsigned char * const outputBuffer,			/**< out: Pointer to destination buffer where encoded data will be stored. */
+	int *outputBufferSize						/**< in+out: Max chars to write into outputBuffer. Upon return holds the number of chars stored or 0 if an error occurs. */
+);
+
 /** Decodes a block of data that is Huffman encoded. */
 void HUFFMAN_Decode(
 	unsigned char const * const inputBuffer,	/**< in: Pointer to start of data that is to be decoded. */
@@ -50,6 +50,12 @@
 
 #include "networkheaders.h"
 
+// Linux can read and write several datagrams with a single system call.
+#ifdef __linux__
+#define NETWORK_BATCHED_IO
+#include <sys/epoll.h>
+#endif
+
 // [BB] Special things necessary for NETWORK_GetLocalAddress() under Linux.
 #ifdef __unix__
 #include <net/if.h>
@@ -69,6 +75,8 @@
 #include <set>
 #include <vector>
 #include <string>
+#include <thread>
+#include <atomic>
 #include "../GeoIP/GeoIP.h"
 
 #include "c_console.h"
@@ -84,6 +92,7 @@
 #include "sbar.h"
 #include "v_video.h"
 #include "version.h"
+#include "benchmark.h"
 #include "g_level.h"
 #include "p_lnspec.h"
 #include "cmdlib.h"
@@ -92,6 +101,7 @@
 #include "d_netinf.h"
 
 #include "md5.h"
+#include "stats.h"
 #include "network/sv_auth.h"
 #include "doomerrors.h"
 
@@ -192,6 +202,99 @@ static	USHORT			g_usLocalPort;
 // Buffer for the Huffman encoding.
 static	UCHAR			g_ucHuffmanBuffer[131072];
 
+#ifdef NETWORK_BATCHED_IO
+// Number of datagrams that are read or written with a single system call.
+#define	NETWORK_BATCH_SIZE			32
+
+// A set of datagrams that is read by recvmmsg or written by sendmmsg at once.
+template <size_t PacketSize>
+struct NetworkPacketBatch
+{
+	mmsghdr		Headers[NETWORK_BATCH_SIZE];
+	iovec		IOVectors[NETWORK_BATCH_SIZE];
+	sockaddr	Addresses[NETWORK_BATCH_SIZE];
+	UCHAR		aucData[NETWORK_BATCH_SIZE][PacketSize];
+
+	// Number of datagrams in the batch.
+	unsigned int	NumPackets;
+
+	// Index of the next datagram to hand out (only used when receiving).
+	unsigned int	Position;
+};
+
+// Datagrams received from the network socket that still have to be processed.
+// The slots are big enough to detect packets that exceed g_NetworkMessage.
+static	NetworkPacketBatch<32768>			g_ReceiveBatch;
+
+// Encoded datagrams that are waiting to be sent by NETWORK_EndPacketBatch.
+static	NetworkPacketBatch<MAX_UDP_PACKET>	g_SendBatch;
+
+// Are outgoing packets currently collected in g_SendBatch?
+static	bool			g_bBatchingPackets = false;
+#endif
+
+// Read and write datagrams in batches when hosting a server (only available under Linux).
+CVAR( Bool, sv_batchedio, true, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// Time (I_MSTime) at which the packet in g_NetworkMessage arrived.
+static	unsigned int	g_PacketArrivalTime = 0;
+
+// A datagram that the receive thread read from the network socket and already decoded.
+struct RECEIVEDPACKET_s
+{
+	// Who sent the datagram?
+	NETADDRESS_s	Address;
+
+	// Time (I_MSTime) at which the datagram was read from the socket.
+	unsigned int	ArrivalTime;
+
+	// Size of the datagram on the wire.
+	LONG			lNumBytes;
+
+	// Size of the decoded data.
+	LONG			lDecodedNumBytes;
+
+	// The decoded data, g_NetworkMessage.ulMaxSize bytes.
+	UCHAR			*pucData;
+};
+
+// Number of datagrams the receive thread can queue up before it has to drop them.
+#define	RECEIVE_QUEUE_SIZE			256
+
+// Single producer (the receive thread), single consumer (NETWORK_GetPackets) queue.
+// Each side only writes its own index, the slots between head and tail belong to the consumer.
+static	RECEIVEDPACKET_s			g_ReceiveQueue[RECEIVE_QUEUE_SIZE];
+static	std::atomic<unsigned int>	g_ReceiveQueueHead( 0 );
+static	std::atomic<unsigned int>	g_ReceiveQueueTail( 0 );
+
+// Number of datagrams the receive thread had to drop because the queue was full.
+static	std::atomic<unsigned int>	g_ReceiveQueueDrops( 0 );
+
+static	std::thread					g_ReceiveThread;
+static	std::atomic<bool>			g_bReceiveThreadRunning( false );
+
+// Copy of the auth server address for the receive thread. Resolving the cached address
+// isn't thread safe, so the main thread does that before starting the thread.
+static	NETADDRESS_s				g_ReceiveThreadAuthServerAddress;
+
+#ifdef __linux__
+// Used by NETWORK_WaitForPackets to wait for the network socket.
+static	int						g_WaitEpollFD = -1;
+static	SOCKET					g_WaitEpollSocket = INVALID_SOCKET;
+#endif
+
+// Read, timestamp and decode incoming packets in a separate thread when hosting a server.
+CUSTOM_CVAR( Bool, sv_receivethread, false, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	if ( self )
+		NETWORK_StartReceiveThread( );
+	else
+		NETWORK_StopReceiveThread( );
+}
+
 // Our local address;
 NETADDRESS_s	g_LocalAddress;
 
@@ -251,6 +354,14 @@ static	bool			network_GenerateLumpMD5HashAndWarnIfNeeded( const int LumpNum, con
 static	void			network_CheckIfDuplicateLump( const int LumpNum ); // [AK]
 static	void			network_AddSpritesToList( std::set<AUTHENTICATELUMP_s> &list, const char *name, const std::set<char> frames, const LumpAuthenticationMode mode ); // [AK]
 static	void			network_ParseLumpAuthenticationMode( FScanner &sc, LumpAuthenticationMode &mode );
+static	int				network_ProcessReceivedPacket( const UCHAR *pucData, LONG lNumBytes, const sockaddr &SocketFrom );
+static	int				network_GetQueuedPacket( void );
+static	void			network_ReceiveThread( void );
+#ifdef NETWORK_BATCHED_IO
+static	bool			network_UseBatchedIO( void );
+static	int				network_GetBatchedPacket( void );
+static	void			network_SendPacketBatch( void );
+#endif
 
 //*****************************************************************************
 //	FUNCTIONS
@@ -726,12 +837,33 @@ void NETWORK_Construct( USHORT usPort, bool bAllocateLANSocket )
 	// [BB] Now that the network is initialized, set up what's necessary
 	// to communicate with the authentication server.
 	NETWORK_AUTH_Construct();
+
+	if (( NETWORK_GetState( ) == NETSTATE_SERVER ) && sv_receivethread )
+		NETWORK_StartReceiveThread( );
 }
 
 //*****************************************************************************
 //
 void NETWORK_Destruct( void )
 {
+	// The receive thread uses the network message buffer size and the socket.
+	NETWORK_StopReceiveThread( );
+
+#ifdef __linux__
+	if ( g_WaitEpollFD != -1 )
+	{
+		close( g_WaitEpollFD );
+		g_WaitEpollFD = -1;
+		g_WaitEpollSocket = INVALID_SOCKET;
+	}
+#endif
+
+	for ( unsigned int i = 0; i < RECEIVE_QUEUE_SIZE; ++i )
+	{
+		delete[] g_ReceiveQueue[i].pucData;
+		g_ReceiveQueue[i].pucData = NULL;
+	}
+
 	// Free the network message buffer.
 	g_NetworkMessage.Free();
 
@@ -748,7 +880,6 @@ void NETWORK_Destruct( void )
 int NETWORK_GetPackets( void )
 {
 	LONG				lNumBytes;
-	INT					iDecodedNumBytes = g_NetworkMessage.ulMaxSize;
 	sockaddr			SocketFrom;
 	INT					iSocketFromLength;
 
@@ -758,48 +889,77 @@ int NETWORK_GetPackets( void )
 	if ( g_NetworkSocket == INVALID_SOCKET )
 		return ( 0 );
 
+	// The receive thread already read and decoded the packets.
+	if ( g_bReceiveThreadRunning )
+		return ( network_GetQueuedPacket( ));
+
+#ifdef NETWORK_BATCHED_IO
+	// Hand out the datagrams one by one, but read them from the socket in batches.
+	if ( network_UseBatchedIO( ))
+		return ( network_GetBatchedPacket( ));
+#endif
+
+	// Keep reading until we get a packet we can use or the socket is empty. Returning 0
+	// while there's still something in the socket would make NETWORK_WaitForPackets wake
+	// up right away again.
+	for ( ;; )
+	{
 #ifdef	WIN32
-	lNumBytes = recvfrom( g_NetworkSocket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0, &SocketFrom, &iSocketFromLength );
+		lNumBytes = recvfrom( g_NetworkSocket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0, &SocketFrom, &iSocketFromLength );
 #else
-	lNumBytes = recvfrom( g_NetworkSocket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0, &SocketFrom, (socklen_t *)&iSocketFromLength );
+		lNumBytes = recvfrom( g_NetworkSocket, (char *)g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), 0, &SocketFrom, (socklen_t *)&iSocketFromLength );
 #endif
 
-	// If the number of bytes returned is -1, an error has occured.
-	if ( lNumBytes == -1 ) 
-	{ 
+		// If the number of bytes returned is -1, an error has occured.
+		if ( lNumBytes == -1 ) 
+		{ 
 #ifdef __WIN32__
-		errno = WSAGetLastError( );
+			errno = WSAGetLastError( );
 
-		if ( errno == WSAEWOULDBLOCK )
-			return ( false );
+			if ( errno == WSAEWOULDBLOCK )
+				return ( false );
 
-		// Connection reset by peer. Doesn't mean anything to the server.
-		if ( errno == WSAECONNRESET )
-			return ( false );
+			// Connection reset by peer. Doesn't mean anything to the server.
+			if ( errno == WSAECONNRESET )
+				continue;
 
-		if ( errno == WSAEMSGSIZE )
-		{
-			Printf( "NETWORK_GetPackets:  WARNING! Oversized packet from %s\n", g_AddressFrom.ToString() );
-			return ( false );
-		}
+			if ( errno == WSAEMSGSIZE )
+			{
+				Printf( "NETWORK_GetPackets:  WARNING! Oversized packet from %s\n", g_AddressFrom.ToString() );
+				continue;
+			}
 
-		Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
-		return ( false );
-#else
-		if ( errno == EWOULDBLOCK )
+			Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
 			return ( false );
+#else
+			if ( errno == EWOULDBLOCK )
+				return ( false );
 
-		if ( errno == ECONNREFUSED )
-			return ( false );
+			if ( errno == ECONNREFUSED )
+				continue;
 
-		Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
-		return ( false );
+			Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
+			return ( false );
 #endif
+		}
+
+		// No packets or an error, so don't process anything.
+		if ( lNumBytes <= 0 )
+			continue;
+
+		const int iDecodedSize = network_ProcessReceivedPacket( g_ucHuffmanBuffer, lNumBytes, SocketFrom );
+		if ( iDecodedSize > 0 )
+			return ( iDecodedSize );
 	}
+}
 
-	// No packets or an error, so don't process anything.
-	if ( lNumBytes <= 0 )
-		return ( 0 );
+//*****************************************************************************
+//
+static int network_ProcessReceivedPacket( const UCHAR *pucData, LONG lNumBytes, const sockaddr &SocketFrom )
+{
+	INT					iDecodedNumBytes = g_NetworkMessage.ulMaxSize;
+
+	g_PacketArrivalTime = I_MSTime( );
 
 	// Record this for our statistics window.
 	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
@@ -816,14 +976,14 @@ int NETWORK_GetPackets( void )
 	// [BB] Communication with the auth server is not Huffman-encoded.
 	if ( g_AddressFrom.Compare( NETWORK_AUTH_GetCachedServerAddress() ) == false )
 	{
-		HUFFMAN_Decode( g_ucHuffmanBuffer, (unsigned char *)g_NetworkMessage.pbData, lNumBytes, &iDecodedNumBytes );
+		HUFFMAN_Decode( pucData, (unsigned char *)g_NetworkMessage.pbData, lNumBytes, &iDecodedNumBytes );
 		g_NetworkMessage.ulCurrentSize = iDecodedNumBytes;
 	}
 	else
 	{
 		// [BB] We don't need to decode, so we just copy the data.
 		// Not very efficient, but this keeps the changes at a minimum for now.
-		memcpy ( g_NetworkMessage.pbData, g_ucHuffmanBuffer, lNumBytes );
+		memcpy ( g_NetworkMessage.pbData, pucData, lNumBytes );
 		g_NetworkMessage.ulCurrentSize = lNumBytes;
 	}
 	g_NetworkMessage.ByteStream.pbStream = g_NetworkMessage.pbData;
@@ -834,6 +994,366 @@ int NETWORK_GetPackets( void )
 	return ( g_NetworkMessage.ulCurrentSize );
 }
 
+//*****************************************************************************
+//
+static int network_GetQueuedPacket( void )
+{
+	// Skip the packets we can't use, returning 0 while there are still packets queued
+	// would leave them for the next wake up.
+	for ( ;; )
+	{
+		const unsigned int head = g_ReceiveQueueHead.load( std::memory_order_relaxed );
+
+		// Nothing new from the receive thread.
+		if ( head == g_ReceiveQueueTail.load( std::memory_order_acquire ))
+			return ( 0 );
+
+		const RECEIVEDPACKET_s &packet = g_ReceiveQueue[head % RECEIVE_QUEUE_SIZE];
+		int result = 0;
+
+		// Record this for our statistics window.
+		SERVER_STATISTIC_AddToInboundDataTransfer( packet.lNumBytes );
+
+		// If the number of bytes we're receiving exceeds our buffer size, ignore the packet.
+		// The same goes for packets that decoded to nothing.
+		if (( packet.lNumBytes < static_cast<LONG>(g_NetworkMessage.ulMaxSize) ) && ( packet.lDecodedNumBytes > 0 ))
+		{
+			g_AddressFrom = packet.Address;
+			g_PacketArrivalTime = packet.ArrivalTime;
+
+			memcpy( g_NetworkMessage.pbData, packet.pucData, packet.lDecodedNumBytes );
+			g_NetworkMessage.ulCurrentSize = packet.lDecodedNumBytes;
+			g_NetworkMessage.ByteStream.pbStream = g_NetworkMessage.pbData;
+			g_NetworkMessage.ByteStream.pbStreamEnd = g_NetworkMessage.ByteStream.pbStream + g_NetworkMessage.ulCurrentSize;
+			g_NetworkMessage.ByteStream.bitBuffer = NULL;
+			g_NetworkMessage.ByteStream.bitShift = -1;
+			result = g_NetworkMessage.ulCurrentSize;
+		}
+
+		// Hand the slot back to the receive thread.
+		g_ReceiveQueueHead.store( head + 1, std::memory_order_release );
+
+		if ( result > 0 )
+			return ( result );
+	}
+}
+
+//*****************************************************************************
+//
+static void network_ReceiveThread( void )
+{
+	static UCHAR	aucBuffer[sizeof( g_ucHuffmanBuffer )];
+	const LONG		lMaxSize = g_NetworkMessage.ulMaxSize;
+
+	while ( g_bReceiveThreadRunning )
+	{
+		// Block until there is something to read. Wake up regularly to check
+		// whether the thread should stop.
+		fd_set			fdset;
+		struct timeval	timeout;
+
+		FD_ZERO( &fdset );
+		FD_SET( g_NetworkSocket, &fdset );
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 100000;
+		if ( select( static_cast<int>( g_NetworkSocket ) + 1, &fdset, NULL, NULL, &timeout ) <= 0 )
+			continue;
+
+		// The socket is non-blocking, read until it's empty.
+		while ( g_bReceiveThreadRunning )
+		{
+			sockaddr	SocketFrom;
+#ifdef	WIN32
+			INT			iSocketFromLength = sizeof( SocketFrom );
+#else
+			socklen_t	iSocketFromLength = sizeof( SocketFrom );
+#endif
+			const LONG lNumBytes = recvfrom( g_NetworkSocket, (char *)aucBuffer, sizeof( aucBuffer ), 0, &SocketFrom, &iSocketFromLength );
+
+			// Errors are handled like "no more data", NETWORK_GetPackets ignores them too.
+			if ( lNumBytes <= 0 )
+				break;
+
+			const unsigned int arrivalTime = I_MSTime( );
+			const unsigned int tail = g_ReceiveQueueTail.load( std::memory_order_relaxed );
+
+			if ( tail - g_ReceiveQueueHead.load( std::memory_order_acquire ) >= RECEIVE_QUEUE_SIZE )
+			{
+				++g_ReceiveQueueDrops;
+				continue;
+			}
+
+			RECEIVEDPACKET_s &packet = g_ReceiveQueue[tail % RECEIVE_QUEUE_SIZE];
+			packet.Address.LoadFromSocketAddress( SocketFrom );
+			packet.ArrivalTime = arrivalTime;
+			packet.lNumBytes = lNumBytes;
+			packet.lDecodedNumBytes = 0;
+
+			if ( lNumBytes < lMaxSize )
+			{
+				// [BB] Communication with the auth server is not Huffman-encoded.
+				if ( packet.Address.Compare( g_ReceiveThreadAuthServerAddress ) == false )
+				{
+					INT iDecodedNumBytes = lMaxSize;
+					HUFFMAN_Decode( aucBuffer, packet.pucData, lNumBytes, &iDecodedNumBytes );
+					packet.lDecodedNumBytes = iDecodedNumBytes;
+				}
+				else
+				{
+					memcpy( packet.pucData, aucBuffer, lNumBytes );
+					packet.lDecodedNumBytes = lNumBytes;
+				}
+			}
+
+			// Publish the slot to NETWORK_GetPackets.
+			g_ReceiveQueueTail.store( tail + 1, std::memory_order_release );
+		}
+	}
+}
+
+//*****************************************************************************
+//
+void NETWORK_StartReceiveThread( void )
+{
+	// Only start once the network is initialized.
+	if ( g_bReceiveThreadRunning || ( g_NetworkSocket == INVALID_SOCKET ) || ( g_NetworkMessage.pbData == NULL ))
+		return;
+
+	for ( unsigned int i = 0; i < RECEIVE_QUEUE_SIZE; ++i )
+	{
+		if ( g_ReceiveQueue[i].pucData == NULL )
+			g_ReceiveQueue[i].pucData = new UCHAR[g_NetworkMessage.ulMaxSize];
+	}
+
+	g_ReceiveThreadAuthServerAddress = NETWORK_AUTH_GetCachedServerAddress( );
+	g_ReceiveQueueHead = 0;
+	g_ReceiveQueueTail = 0;
+	g_ReceiveQueueDrops = 0;
+	g_bReceiveThreadRunning = true;
+	g_ReceiveThread = std::thread( network_ReceiveThread );
+}
+
+//*****************************************************************************
+//
+void NETWORK_StopReceiveThread( void )
+{
+	if ( g_bReceiveThreadRunning == false )
+		return;
+
+	g_bReceiveThreadRunning = false;
+	g_ReceiveThread.join( );
+
+	// Whatever is still queued is dropped, just like the socket would drop it.
+	g_ReceiveQueueHead.store( g_ReceiveQueueTail.load( ));
+}
+
+//*****************************************************************************
+//
+bool NETWORK_IsReceiveThreadRunning( void )
+{
+	return ( g_bReceiveThreadRunning );
+}
+
+//*****************************************************************************
+//
+unsigned int NETWORK_GetReceiveQueueDrops( void )
+{
+	return ( g_ReceiveQueueDrops );
+}
+
+//*****************************************************************************
+//
+// Blocks until a packet can be read from the network socket or until ulTimeoutMS
+// milliseconds have passed. Returns false on timeout. While the receive thread is running,
+// it is the one reading the socket, so this only sleeps. The wait is level-triggered, so
+// the socket needs to be drained with NETWORK_GetPackets first, otherwise this returns
+// right away.
+//
+bool NETWORK_WaitForPackets( ULONG ulTimeoutMS )
+{
+	if ( g_bReceiveThreadRunning || ( g_NetworkSocket == INVALID_SOCKET ))
+	{
+		I_Sleep( ulTimeoutMS );
+		return ( false );
+	}
+
+#ifdef __linux__
+	if (( g_WaitEpollFD == -1 ) || ( g_WaitEpollSocket != g_NetworkSocket ))
+	{
+		if ( g_WaitEpollFD != -1 )
+			close( g_WaitEpollFD );
+
+		g_WaitEpollFD = epoll_create1( EPOLL_CLOEXEC );
+		g_WaitEpollSocket = g_NetworkSocket;
+
+		struct epoll_event event;
+		memset( &event, 0, sizeof( event ));
+		event.events = EPOLLIN;
+		if (( g_WaitEpollFD == -1 ) || ( epoll_ctl( g_WaitEpollFD, EPOLL_CTL_ADD, g_NetworkSocket, &event ) == -1 ))
+		{
+			if ( g_WaitEpollFD != -1 )
+				close( g_WaitEpollFD );
+			g_WaitEpollFD = -1;
+			I_Sleep( ulTimeoutMS );
+			return ( false );
+		}
+	}
+
+	struct epoll_event event;
+	return ( epoll_wait( g_WaitEpollFD, &event, 1, static_cast<int>( ulTimeoutMS )) > 0 );
+#else
+	struct timeval	timeout;
+	fd_set			fdset;
+
+	FD_ZERO( &fdset );
+	FD_SET( g_NetworkSocket, &fdset );
+	timeout.tv_sec = ulTimeoutMS / 1000;
+	timeout.tv_usec = ( ulTimeoutMS % 1000 ) * 1000;
+	return ( select( static_cast<int>( g_NetworkSocket ) + 1, &fdset, NULL, NULL, &timeout ) > 0 );
+#endif
+}
+
+//*****************************************************************************
+//
+unsigned int NETWORK_GetPacketArrivalTime( void )
+{
+	return ( g_PacketArrivalTime );
+}
+
+#ifdef NETWORK_BATCHED_IO
+//*****************************************************************************
+//
+static bool network_UseBatchedIO( void )
+{
+	return (( sv_batchedio ) && ( NETWORK_GetState( ) == NETSTATE_SERVER ));
+}
+
+//*****************************************************************************
+//
+static int network_GetBatchedPacket( void )
+{
+	for ( ;; )
+	{
+		while ( g_ReceiveBatch.Position < g_ReceiveBatch.NumPackets )
+		{
+			const unsigned int i = g_ReceiveBatch.Position++;
+			const LONG lNumBytes = g_ReceiveBatch.Headers[i].msg_len;
+
+			// Skip empty datagrams instead of stopping, there may be more in the batch.
+			if ( lNumBytes <= 0 )
+				continue;
+
+			// The datagram didn't fit into the slot, so it's too big for us anyway.
+			if ( g_ReceiveBatch.Headers[i].msg_hdr.msg_flags & MSG_TRUNC )
+			{
+				SERVER_STATISTIC_AddToInboundDataTransfer( lNumBytes );
+				continue;
+			}
+
+			// An oversized datagram or one that decodes to nothing isn't the end of the batch either.
+			const int iDecodedSize = network_ProcessReceivedPacket( g_ReceiveBatch.aucData[i], lNumBytes, g_ReceiveBatch.Addresses[i] );
+			if ( iDecodedSize > 0 )
+				return ( iDecodedSize );
+		}
+
+		// Everything that was read last time has been processed, drain the socket again.
+		// Only stop once the socket is empty, so that NETWORK_WaitForPackets doesn't wake up
+		// right away for datagrams we left behind.
+		g_ReceiveBatch.NumPackets = g_ReceiveBatch.Position = 0;
+
+		for ( unsigned int i = 0; i < NETWORK_BATCH_SIZE; ++i )
+		{
+			g_ReceiveBatch.IOVectors[i].iov_base = g_ReceiveBatch.aucData[i];
+			g_ReceiveBatch.IOVectors[i].iov_len = sizeof( g_ReceiveBatch.aucData[i] );
+			memset( &g_ReceiveBatch.Headers[i], 0, sizeof( g_ReceiveBatch.Headers[i] ));
+			g_ReceiveBatch.Headers[i].msg_hdr.msg_iov = &g_ReceiveBatch.IOVectors[i];
+			g_ReceiveBatch.Headers[i].msg_hdr.msg_iovlen = 1;
+			g_ReceiveBatch.Headers[i].msg_hdr.msg_name = &g_ReceiveBatch.Addresses[i];
+			g_ReceiveBatch.Headers[i].msg_hdr.msg_namelen = sizeof( g_ReceiveBatch.Addresses[i] );
+		}
+
+		const int iNumPackets = recvmmsg( g_NetworkSocket, g_ReceiveBatch.Headers, NETWORK_BATCH_SIZE, MSG_DONTWAIT, NULL );
+
+		// If the number of packets returned is -1, an error has occured.
+		if ( iNumPackets == -1 )
+		{
+			if ( errno == EWOULDBLOCK )
+				return ( 0 );
+
+			// A pending ICMP error from an earlier send, the datagrams behind it are still there.
+			if ( errno == ECONNREFUSED )
+				continue;
+
+			Printf( "NETWORK_GetPackets: WARNING!: Error #%d: %s\n", errno, strerror( errno ));
+			return ( 0 );
+		}
+
+		if ( iNumPackets <= 0 )
+			return ( 0 );
+
+		g_ReceiveBatch.NumPackets = iNumPackets;
+	}
+}
+
+//*****************************************************************************
+//
+static void network_SendPacketBatch( void )
+{
+	unsigned int ulNumSent = 0;
+
+	while ( ulNumSent < g_SendBatch.NumPackets )
+	{
+		const int iResult = sendmmsg( g_NetworkSocket, &g_SendBatch.Headers[ulNumSent], g_SendBatch.NumPackets - ulNumSent, 0 );
+
+		// The first datagram of the remaining ones couldn't be sent. Report the error like
+		// NETWORK_LaunchPacket does, drop it and go on with the rest.
+		if ( iResult <= 0 )
+		{
+			if (( errno != EWOULDBLOCK ) && ( errno != ECONNREFUSED ))
+			{
+				NETADDRESS_s Address;
+				Address.LoadFromSocketAddress( g_SendBatch.Addresses[ulNumSent] );
+				Printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
+				Printf( "NETWORK_LaunchPacket: Address %s\n", Address.ToString() );
+			}
+
+			ulNumSent++;
+			continue;
+		}
+
+		// Record this for our statistics window.
+		for ( int i = 0; i < iResult; ++i )
+			SERVER_STATISTIC_AddToOutboundDataTransfer( g_SendBatch.Headers[ulNumSent + i].msg_len );
+
+		ulNumSent += iResult;
+	}
+
+	g_SendBatch.NumPackets = 0;
+}
+#endif
+
+//*****************************************************************************
+//
+void NETWORK_BeginPacketBatch( void )
+{
+#ifdef NETWORK_BATCHED_IO
+	if (( g_NetworkSocket != INVALID_SOCKET ) && network_UseBatchedIO( ))
+		g_bBatchingPackets = true;
+#endif
+}
+
+//*****************************************************************************
+//
+void NETWORK_EndPacketBatch( void )
+{
+#ifdef NETWORK_BATCHED_IO
+	if ( g_SendBatch.NumPackets > 0 )
+		network_SendPacketBatch( );
+
+	g_bBatchingPackets = false;
+#endif
+}
+
 //*****************************************************************************
 //
 int NETWORK_GetLANPackets( void )
@@ -933,32 +1453,108 @@ NETADDRESS_s NETWORK_GetFromAddress( void )
 //*****************************************************************************
 //
 void NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address )
+{
+	NETPACKETSEGMENT_s	Segment;
+
+	pBuffer->ulCurrentSize = pBuffer->CalcSize();
+
+	Segment.pbData = pBuffer->pbData;
+	Segment.ulSize = pBuffer->ulCurrentSize;
+	NETWORK_LaunchPacket( &Segment, 1, Address );
+}
+
+//*****************************************************************************
+//
+// Huffman encodes the segments as one packet and returns the encoded size, or 0
+// if the output buffer is too small.
+//
+int NETWORK_EncodePacket( const NETPACKETSEGMENT_s *pSegments, ULONG ulNumSegments, UCHAR *pucOutput, int iOutputSize )
+{
+	static TArray<const unsigned char *>	SegmentData;
+	static TArray<int>						SegmentSizes;
+
+	SegmentData.Resize( ulNumSegments );
+	SegmentSizes.Resize( ulNumSegments );
+	for ( ULONG ulIdx = 0; ulIdx < ulNumSegments; ulIdx++ )
+	{
+		SegmentData[ulIdx] = pSegments[ulIdx].pbData;
+		SegmentSizes[ulIdx] = pSegments[ulIdx].ulSize;
+	}
+
+	HUFFMAN_EncodeSegments( &SegmentData[0], &SegmentSizes[0], ulNumSegments, pucOutput, &iOutputSize );
+	return ( iOutputSize );
+}
+
+//*****************************************************************************
+//
+// Sends the segments as one packet. They are encoded straight from where they
+// are, so the caller doesn't need to copy them into one buffer first.
+//
+void NETWORK_LaunchPacket( const NETPACKETSEGMENT_s *pSegments, ULONG ulNumSegments, NETADDRESS_s Address )
 {
 	LONG				lNumBytes;
 	INT					iNumBytesOut = sizeof(g_ucHuffmanBuffer);
+	ULONG				ulPacketSize = 0;
 
-	pBuffer->ulCurrentSize = pBuffer->CalcSize();
+	for ( ULONG ulIdx = 0; ulIdx < ulNumSegments; ulIdx++ )
+		ulPacketSize += pSegments[ulIdx].ulSize;
 
 	// Nothing to do.
-	if ( pBuffer->ulCurrentSize == 0 )
+	if ( ulPacketSize == 0 )
 		return;
 
 	// Convert the IP address to a socket address.
 	struct sockaddr_in SocketAddress;
 	Address.ToSocketAddress( reinterpret_cast<sockaddr&>(SocketAddress) );
 
+	UCHAR *pucOutput = g_ucHuffmanBuffer;
+
+#ifdef NETWORK_BATCHED_IO
+	// While batching, encode the packet straight into the next free slot of the batch.
+	// Packets that might not fit into a slot are sent right away.
+	const bool bBatched = g_bBatchingPackets && ( ulPacketSize < MAX_UDP_PACKET );
+	if ( bBatched )
+	{
+		pucOutput = g_SendBatch.aucData[g_SendBatch.NumPackets];
+		iNumBytesOut = sizeof( g_SendBatch.aucData[g_SendBatch.NumPackets] );
+	}
+#endif
+
 	// [BB] Communication with the auth server is not Huffman-encoded.
 	if ( Address.Compare( NETWORK_AUTH_GetCachedServerAddress() ) == false )
-		HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, g_ucHuffmanBuffer, pBuffer->ulCurrentSize, &iNumBytesOut );
+		iNumBytesOut = NETWORK_EncodePacket( pSegments, ulNumSegments, pucOutput, iNumBytesOut );
 	else
 	{
 		// [BB] We don't need to encode, so we just copy the data.
 		// Not very efficient, but this keeps the changes at a minimum for now.
-		memcpy ( g_ucHuffmanBuffer, pBuffer->pbData, pBuffer->ulCurrentSize );
-		iNumBytesOut = pBuffer->ulCurrentSize;
+		iNumBytesOut = 0;
+		for ( ULONG ulIdx = 0; ulIdx < ulNumSegments; ulIdx++ )
+		{
+			memcpy ( pucOutput + iNumBytesOut, pSegments[ulIdx].pbData, pSegments[ulIdx].ulSize );
+			iNumBytesOut += pSegments[ulIdx].ulSize;
+		}
 	}
 
-	lNumBytes = sendto( g_NetworkSocket, (const char*)g_ucHuffmanBuffer, iNumBytesOut, 0, reinterpret_cast<sockaddr*>(&SocketAddress), sizeof( SocketAddress ));
+#ifdef NETWORK_BATCHED_IO
+	if ( bBatched )
+	{
+		const unsigned int i = g_SendBatch.NumPackets++;
+		memcpy( &g_SendBatch.Addresses[i], &SocketAddress, sizeof( SocketAddress ));
+		g_SendBatch.IOVectors[i].iov_base = pucOutput;
+		g_SendBatch.IOVectors[i].iov_len = iNumBytesOut;
+		memset( &g_SendBatch.Headers[i], 0, sizeof( g_SendBatch.Headers[i] ));
+		g_SendBatch.Headers[i].msg_hdr.msg_iov = &g_SendBatch.IOVectors[i];
+		g_SendBatch.Headers[i].msg_hdr.msg_iovlen = 1;
+		g_SendBatch.Headers[i].msg_hdr.msg_name = &g_SendBatch.Addresses[i];
+		g_SendBatch.Headers[i].msg_hdr.msg_namelen = sizeof( SocketAddress );
+
+		if ( g_SendBatch.NumPackets == NETWORK_BATCH_SIZE )
+			network_SendPacketBatch( );
+		return;
+	}
+#endif
+
+	lNumBytes = sendto( g_NetworkSocket, (const char*)pucOutput, iNumBytesOut, 0, reinterpret_cast<sockaddr*>(&SocketAddress), sizeof( SocketAddress ));
 
 	// If sendto returns -1, there was an error.
 	if ( lNumBytes == -1 )
@@ -2015,6 +2611,121 @@ CCMD( netstate )
 	}
 }
 
+//*****************************************************************************
+//
+#if BUILD_ID != BUILD_RELEASE
+// Round-trips packet data through both the lookup table codec and the bitwise
+// reference implementation, checks that they agree and compares their speed. The packets
+// are read from a file (e.g. a demo, which holds the payload of captured server packets)
+// or generated if no file is given.
+BENCHMARK( huffman )
+{
+	skulltag::HuffmanCodec *codec = HUFFMAN_GetCodec( );
+	if ( codec == NULL )
+	{
+		Printf( "The Huffman codec is not initialized.\n" );
+		return;
+	}
+
+	TArray<BYTE> corpus;
+	int packetSize = 1024;
+
+	if ( argv.argc( ) > 1 )
+	{
+		FILE *file = fopen( argv[1], "rb" );
+		if ( file == NULL )
+		{
+			Printf( "Couldn't open %s.\n", argv[1] );
+			return;
+		}
+
+		BYTE buffer[4096];
+		size_t numBytes;
+		while (( numBytes = fread( buffer, 1, sizeof( buffer ), file )) > 0 )
+		{
+			for ( size_t i = 0; i < numBytes; ++i )
+				corpus.Push( buffer[i] );
+		}
+		fclose( file );
+
+		if ( argv.argc( ) > 2 )
+			packetSize = clamp( atoi( argv[2] ), 1, MAX_UDP_PACKET - 1 );
+	}
+	else
+	{
+		// Mostly small values with the occasional random byte, which resembles real packets.
+		for ( int i = 0; i < 1024 * 1024; ++i )
+			corpus.Push( ( M_Random( ) < 96 ) ? M_Random( ) : ( M_Random( ) & 0x0F ));
+	}
+
+	if ( corpus.Size( ) == 0 )
+	{
+		Printf( "Nothing to benchmark.\n" );
+		return;
+	}
+
+	BYTE encoded[2][MAX_UDP_PACKET * 2];
+	BYTE decoded[2][MAX_UDP_PACKET];
+	cycle_t encodeTime[2], decodeTime[2];
+	ULONG ulNumPackets = 0;
+	ULONG ulNumMismatches = 0;
+	ULONG ulEncodedBytes = 0;
+
+	for ( int i = 0; i < 2; ++i )
+	{
+		encodeTime[i].Reset( );
+		decodeTime[i].Reset( );
+	}
+
+	for ( unsigned int offset = 0; offset < corpus.Size( ); offset += packetSize )
+	{
+		const int inLength = MIN<int>( packetSize, corpus.Size( ) - offset );
+		const BYTE *input = &corpus[offset];
+		int encodedLength[2], decodedLength[2];
+
+		encodeTime[0].Clock( );
+		encodedLength[0] = codec->encode( input, encoded[0], inLength, sizeof( encoded[0] ));
+		encodeTime[0].Unclock( );
+
+		encodeTime[1].Clock( );
+		encodedLength[1] = codec->encodeBitwise( input, encoded[1], inLength, sizeof( encoded[1] ));
+		encodeTime[1].Unclock( );
+
+		ulNumPackets++;
+
+		if (( encodedLength[0] != encodedLength[1] ) || (( encodedLength[0] > 0 ) && ( memcmp( encoded[0], encoded[1], encodedLength[0] ) != 0 )))
+		{
+			ulNumMismatches++;
+			continue;
+		}
+
+		// The data expanded, HUFFMAN_Encode would send it unencoded.
+		if ( encodedLength[0] < 0 )
+			continue;
+
+		ulEncodedBytes += encodedLength[0];
+
+		decodeTime[0].Clock( );
+		decodedLength[0] = codec->decode( encoded[0], decoded[0], encodedLength[0], sizeof( decoded[0] ));
+		decodeTime[0].Unclock( );
+
+		decodeTime[1].Clock( );
+		decodedLength[1] = codec->decodeBitwise( encoded[1], decoded[1], encodedLength[1], sizeof( decoded[1] ));
+		decodeTime[1].Unclock( );
+
+		if (( decodedLength[0] != inLength ) || ( decodedLength[1] != inLength )
+			|| ( memcmp( decoded[0], input, inLength ) != 0 ) || ( memcmp( decoded[1], input, inLength ) != 0 ))
+		{
+			ulNumMismatches++;
+		}
+	}
+
+	Printf( "%lu packets, %u bytes (%lu encoded), %lu mismatches.\n", ulNumPackets, corpus.Size( ), ulEncodedBytes, ulNumMismatches );
+	Printf( "Encode: %.3f ms (bitwise: %.3f ms)\n", encodeTime[0].TimeMS( ), encodeTime[1].TimeMS( ));
+	Printf( "Decode: %.3f ms (bitwise: %.3f ms)\n", decodeTime[0].TimeMS( ), decodeTime[1].TimeMS( ));
+}
+#endif
+
 //*****************************************************************************
 //
 #if BUILD_ID != BUILD_RELEASE
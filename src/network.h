@@ -95,6 +95,26 @@ enum
 	PLAYER_ONLIFT		= 1 << 7,
 };
 
+// Flags for the fields of SERVERCOMMANDS_MovePlayer's delta compressed update that differ from the baseline.
+enum
+{
+	PLAYERDELTA_X		= 1 << 0,
+	PLAYERDELTA_Y		= 1 << 1,
+	PLAYERDELTA_Z		= 1 << 2,
+	PLAYERDELTA_ANGLE	= 1 << 3,
+	PLAYERDELTA_VELX	= 1 << 4,
+	PLAYERDELTA_VELY	= 1 << 5,
+	PLAYERDELTA_VELZ	= 1 << 6,
+};
+
+// Position and velocity deltas are sent in 1/256 map units, angle deltas with 16 bits of precision.
+#define	PLAYERDELTA_POSITION_SHIFT		8
+#define	PLAYERDELTA_ANGLE_SHIFT			16
+
+// The oldest baseline a delta compressed player update may refer to, in tics. The client keeps as many
+// updates per player around.
+#define	PLAYERDELTA_MAX_BASELINE_AGE	32
+
 /* [BB] This is not used anywhere anymore.
 // Should we use huffman compression?
 #define	USE_HUFFMAN_COMPRESSION
@@ -338,6 +358,16 @@ int				NETWORK_GetPackets( void );
 int				NETWORK_GetLANPackets( void );
 NETADDRESS_s	NETWORK_GetFromAddress( void );
 void			NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address );
+void			NETWORK_LaunchPacket( const NETPACKETSEGMENT_s *pSegments, ULONG ulNumSegments, NETADDRESS_s Address );
+int				NETWORK_EncodePacket( const NETPACKETSEGMENT_s *pSegments, ULONG ulNumSegments, UCHAR *pucOutput, int iOutputSize );
+void			NETWORK_BeginPacketBatch( void );
+void			NETWORK_EndPacketBatch( void );
+void			NETWORK_StartReceiveThread( void );
+void			NETWORK_StopReceiveThread( void );
+bool			NETWORK_IsReceiveThreadRunning( void );
+unsigned int	NETWORK_GetReceiveQueueDrops( void );
+unsigned int	NETWORK_GetPacketArrivalTime( void );
+bool			NETWORK_WaitForPackets( ULONG ulTimeoutMS );
 NETADDRESS_s	NETWORK_GetLocalAddress( void );
 NETADDRESS_s	NETWORK_GetCachedLocalAddress( void );
 NETBUFFER_s		*NETWORK_GetNetworkMessageBuffer( void );
@@ -47,6 +47,11 @@
 //-----------------------------------------------------------------------------
 
 #include "netcommand.h"
+#include "nettraffic.h"
+#include "c_cvars.h"
+
+// Store commands that are sent to several clients only once (see BroadcastJournal).
+CVAR( Bool, sv_broadcastjournal, true, CVAR_ARCHIVE|CVAR_NOSETBYACS )
 
 //*****************************************************************************
 //
@@ -297,7 +302,7 @@ BYTESTREAM_s& NetCommand::getBytestreamForClient( ULONG i ) const
 
 //*****************************************************************************
 //
-void NetCommand::sendCommandToClients ( ULONG ulPlayerExtra, ServerCommandFlags flags )
+void NetCommand::sendCommandToClients ( ULONG ulPlayerExtra, ServerCommandFlags flags, QWORD skippedClients )
 {
 	const SVC command = static_cast<SVC>( _buffer.pbData[0] );
 
@@ -307,8 +312,24 @@ void NetCommand::sendCommandToClients ( ULONG ulPlayerExtra, ServerCommandFlags
 	if ( ( flags == 0 ) && ( ulPlayerExtra == MAXPLAYERS ) && ( command != SVC_MAPAUTHENTICATE ) && ( command != SVC_DISCONNECTPLAYER ) )
 		flags |= SVCF_SKIP_CLIENTS_WITHOUT_FULLUPDATE;
 
+	// Commands for a single client are written to its buffer right away.
+	if (( sv_broadcastjournal == false ) || ( flags & SVCF_ONLYTHISCLIENT ))
+	{
+		for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
+		{
+			if (( skippedClients & ( static_cast<QWORD>( 1 ) << *it )) == 0 )
+				sendCommandToOneClient( *it );
+		}
+		return;
+	}
+
+	const unsigned int journalCommand = SERVER_GetBroadcastJournal( ).addCommand( _buffer.pbData, _buffer.ulCurrentSize );
+
 	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
-		sendCommandToOneClient( *it );
+	{
+		if (( skippedClients & ( static_cast<QWORD>( 1 ) << *it )) == 0 )
+			referenceCommandForOneClient( *it, journalCommand );
+	}
 }
 
 //*****************************************************************************
@@ -330,6 +351,41 @@ void NetCommand::sendCommandToOneClient( ULONG i )
 	}
 
 	writeCommandToStream( getBytestreamForClient( i ));
+	NETTRAFFIC_AddCommandTraffic( _buffer.pbData, _buffer.ulCurrentSize, i, _unreliable == false );
+}
+
+//*****************************************************************************
+//
+// Like sendCommandToOneClient, but only refers to the command stored in the broadcast journal.
+//
+void NetCommand::referenceCommandForOneClient( ULONG i, unsigned int command )
+{
+	BroadcastJournal &journal = SERVER_GetBroadcastJournal( );
+	const bool reliable = ( _unreliable == false );
+
+	// Same check as SERVER_CheckClientBuffer, but including the commands this client
+	// already has in the journal.
+	unsigned int bufferSize = getBufferForClient( i ).CalcSize() + journal.getPendingSize( i, reliable );
+	if ( bufferSize + _buffer.ulCurrentSize + 5 >= SERVER_GetMaxPacketSize( ) )
+	{
+		SERVER_SendClientPacket( i, reliable );
+		bufferSize = 0;
+	}
+
+	// [BB] 5 = 1 + 4 (SVC_HEADER + packet number)
+	const unsigned int estimateSize = bufferSize + _buffer.ulCurrentSize + 5;
+	if ( estimateSize >= SERVER_GetMaxPacketSize( ) )
+		SERVER_PrintWarning ( "NetCommand %s created a packet to client %lu exceeding sv_maxpacketsize (%d >= %lu)!\n", getHeaderAsString(), i, estimateSize, SERVER_GetMaxPacketSize( ));
+
+	journal.addReference( i, reliable, command );
+	NETTRAFFIC_AddCommandTraffic( _buffer.pbData, _buffer.ulCurrentSize, i, reliable );
+
+	// Counted like SERVER_CheckClientBuffer counts the commands written directly.
+	if ( reliable )
+		SERVER_GetClient( i )->ulReliableBytesWritten += _buffer.ulCurrentSize;
+
+	// The bytes aren't written to the client's buffer yet, but should still be counted.
+	NETWORK_AddToTrafficMeasurement( _buffer.ulCurrentSize );
 }
 
 //*****************************************************************************
@@ -355,3 +411,229 @@ int NetCommand::calcSize() const
 {
 	return _buffer.CalcSize();
 }
+
+//*****************************************************************************
+//
+BroadcastJournal::BroadcastJournal ( )
+{
+	clear();
+}
+
+//*****************************************************************************
+//
+void BroadcastJournal::clear ( )
+{
+	_data.Clear();
+	_commands.Clear();
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		for ( int reliable = 0; reliable < 2; ++reliable )
+			discard( ulIdx, !!reliable );
+	}
+}
+
+//*****************************************************************************
+//
+// Copies the commands (but not the references) of another journal, e.g. to replay a tic.
+//
+void BroadcastJournal::copyCommands ( const BroadcastJournal &journal )
+{
+	clear();
+	_data = journal._data;
+	_commands = journal._commands;
+}
+
+//*****************************************************************************
+//
+unsigned int BroadcastJournal::addCommand ( const BYTE *data, const unsigned int size )
+{
+	Command command;
+	command.position = _data.Reserve( size );
+	command.size = size;
+	command.numRecipients = 0;
+	memcpy( &_data[command.position], data, size );
+	return _commands.Push( command );
+}
+
+//*****************************************************************************
+//
+void BroadcastJournal::addReference ( const ULONG ulClient, const bool bReliable, const unsigned int command )
+{
+	Command &entry = _commands[command];
+	TArray<Span> &pending = _pending[ulClient][bReliable];
+
+	entry.numRecipients++;
+	_pendingSize[ulClient][bReliable] += entry.size;
+
+	// Most clients get the same commands in the same order, so usually
+	// the new command directly follows the last one.
+	if (( pending.Size() > 0 ) && ( pending.Last().position + pending.Last().size == entry.position ))
+	{
+		pending.Last().size += entry.size;
+		return;
+	}
+
+	Span span;
+	span.position = entry.position;
+	span.size = entry.size;
+	pending.Push( span );
+}
+
+//*****************************************************************************
+//
+unsigned int BroadcastJournal::getPendingSize ( const ULONG ulClient, const bool bReliable ) const
+{
+	return _pendingSize[ulClient][bReliable];
+}
+
+//*****************************************************************************
+//
+// Writes as many of the referenced commands as fit to the stream and returns the number of
+// bytes written. The commands that don't fit stay referenced.
+//
+unsigned int BroadcastJournal::flush ( const ULONG ulClient, const bool bReliable, BYTESTREAM_s &ByteStream )
+{
+	TArray<Span> &pending = _pending[ulClient][bReliable];
+	const unsigned int maxSize = static_cast<unsigned int>( ByteStream.pbStreamEnd - ByteStream.pbStream );
+	unsigned int size = 0;
+	unsigned int i;
+
+	for ( i = 0; i < pending.Size(); ++i )
+	{
+		const unsigned int fit = fitCommands( pending[i], maxSize - size );
+		if ( fit > 0 )
+		{
+			memcpy( ByteStream.pbStream, &_data[pending[i].position], fit );
+
+			// These bytes were already counted when they were referenced.
+			ByteStream.AdvancePointer( fit, false );
+			size += fit;
+		}
+
+		if ( fit < pending[i].size )
+		{
+			pending[i].position += fit;
+			pending[i].size -= fit;
+			break;
+		}
+	}
+
+	if ( i > 0 )
+		pending.Delete( 0, i );
+	_pendingSize[ulClient][bReliable] -= size;
+	return size;
+}
+
+//*****************************************************************************
+//
+// Like flush, but instead of copying the referenced commands, adds segments
+// pointing to them in the journal. These are valid until the next command is added.
+// The commands that would make the segments exceed maxSize stay referenced for the
+// next packet.
+//
+unsigned int BroadcastJournal::gather ( const ULONG ulClient, const bool bReliable, const unsigned int maxSize, TArray<NETPACKETSEGMENT_s> &segments )
+{
+	TArray<Span> &pending = _pending[ulClient][bReliable];
+	unsigned int size = 0;
+	unsigned int i;
+
+	for ( i = 0; i < pending.Size(); ++i )
+	{
+		const unsigned int fit = fitCommands( pending[i], maxSize - size );
+		if ( fit > 0 )
+		{
+			NETPACKETSEGMENT_s segment;
+			segment.pbData = &_data[pending[i].position];
+			segment.ulSize = fit;
+			segments.Push( segment );
+			size += fit;
+		}
+
+		if ( fit < pending[i].size )
+		{
+			pending[i].position += fit;
+			pending[i].size -= fit;
+			break;
+		}
+	}
+
+	if ( i > 0 )
+		pending.Delete( 0, i );
+	_pendingSize[ulClient][bReliable] -= size;
+	return size;
+}
+
+//*****************************************************************************
+//
+// Returns how many bytes from the start of the span make up whole commands that fit
+// into maxSize. Commands are never split, the client parses every packet on its own.
+//
+unsigned int BroadcastJournal::fitCommands ( const Span &span, const unsigned int maxSize ) const
+{
+	if ( span.size <= maxSize )
+		return span.size;
+
+	// The commands are stored one after the other, find the first one that ends
+	// behind maxSize. Everything in front of it fits.
+	const unsigned int end = span.position + maxSize;
+	unsigned int low = 0;
+	unsigned int high = _commands.Size();
+
+	while ( low < high )
+	{
+		const unsigned int middle = ( low + high ) / 2;
+		if ( _commands[middle].position + _commands[middle].size <= end )
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	if (( low >= _commands.Size() ) || ( _commands[low].position <= span.position ))
+		return 0;
+
+	return _commands[low].position - span.position;
+}
+
+//*****************************************************************************
+//
+void BroadcastJournal::discard ( const ULONG ulClient, const bool bReliable )
+{
+	_pending[ulClient][bReliable].Clear();
+	_pendingSize[ulClient][bReliable] = 0;
+}
+
+//*****************************************************************************
+//
+unsigned int BroadcastJournal::getNumCommands ( ) const
+{
+	return _commands.Size();
+}
+
+//*****************************************************************************
+//
+unsigned int BroadcastJournal::getSize ( ) const
+{
+	return _data.Size();
+}
+
+//*****************************************************************************
+//
+const BYTE *BroadcastJournal::getCommandData ( const unsigned int command ) const
+{
+	return &_data[_commands[command].position];
+}
+
+//*****************************************************************************
+//
+unsigned int BroadcastJournal::getCommandSize ( const unsigned int command ) const
+{
+	return _commands[command].size;
+}
+
+//*****************************************************************************
+//
+unsigned int BroadcastJournal::getCommandNumRecipients ( const unsigned int command ) const
+{
+	return _commands[command].numRecipients;
+}
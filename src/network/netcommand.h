@@ -76,6 +76,57 @@ public:
 	ULONG operator++ ( );
 };
 
+/**
+ * \brief Stores the commands that are sent to several clients only once per tic.
+ *
+ * Instead of copying a broadcast command into the packet buffer of every client, the
+ * command is added to the journal and the clients only keep references to it. The
+ * references are resolved when the client's packet is assembled, so the packets sent
+ * are the same as if the commands had been copied right away. Since every direct write
+ * to a client's buffer flushes the references first, the referenced commands always
+ * come after the bytes already in the buffer.
+ */
+class BroadcastJournal {
+	struct Command
+	{
+		unsigned int position;
+		unsigned int size;
+		unsigned int numRecipients;
+	};
+
+	// A contiguous part of the journal a client still needs to get.
+	struct Span
+	{
+		unsigned int position;
+		unsigned int size;
+	};
+
+	TArray<BYTE>	_data;
+	TArray<Command>	_commands;
+	TArray<Span>	_pending[MAXPLAYERS][2];
+	unsigned int	_pendingSize[MAXPLAYERS][2];
+
+	unsigned int fitCommands ( const Span &span, const unsigned int maxSize ) const;
+
+public:
+	BroadcastJournal ( );
+
+	void clear ( );
+	void copyCommands ( const BroadcastJournal &journal );
+	unsigned int addCommand ( const BYTE *data, const unsigned int size );
+	void addReference ( const ULONG ulClient, const bool bReliable, const unsigned int command );
+	unsigned int getPendingSize ( const ULONG ulClient, const bool bReliable ) const;
+	unsigned int flush ( const ULONG ulClient, const bool bReliable, BYTESTREAM_s &ByteStream );
+	unsigned int gather ( const ULONG ulClient, const bool bReliable, const unsigned int maxSize, TArray<NETPACKETSEGMENT_s> &segments );
+	void discard ( const ULONG ulClient, const bool bReliable );
+
+	unsigned int getNumCommands ( ) const;
+	unsigned int getSize ( ) const;
+	const BYTE *getCommandData ( const unsigned int command ) const;
+	unsigned int getCommandSize ( const unsigned int command ) const;
+	unsigned int getCommandNumRecipients ( const unsigned int command ) const;
+};
+
 /**
  * \brief Creates and sends network commands to the clients.
  *
@@ -106,8 +157,9 @@ public:
 	void writeCommandToStream ( BYTESTREAM_s &ByteStream ) const;
 	NETBUFFER_s& getBufferForClient( ULONG i ) const;
 	BYTESTREAM_s& getBytestreamForClient( ULONG i ) const;
-	void sendCommandToClients ( ULONG ulPlayerExtra = MAXPLAYERS, ServerCommandFlags flags = 0 );
+	void sendCommandToClients ( ULONG ulPlayerExtra = MAXPLAYERS, ServerCommandFlags flags = 0, QWORD skippedClients = 0 );
 	void sendCommandToOneClient( ULONG i );
+	void referenceCommandForOneClient( ULONG i, unsigned int command );
 	bool isUnreliable() const;
 	void setUnreliable ( bool a );
 	int calcSize() const;
@@ -49,6 +49,9 @@
 #include "network.h"
 #include "c_dispatch.h"
 #include "p_acs.h"
+#include "sv_main.h"
+#include "d_player.h"
+#include "network_enums.h"
 
 #include <map>
 #include <vector>
@@ -70,6 +73,80 @@ std::map<int, int> g_ACSScriptTrafficMap;
 
 CVAR( Bool, sv_measureoutboundtraffic, false, 0 )
 
+// Bytes of commands that were sent to the clients, split into reliable and unreliable.
+struct COMMANDTRAFFIC_s
+{
+	QWORD	qwReliableBytes;
+	QWORD	qwUnreliableBytes;
+	ULONG	ulNumCommands;
+
+	QWORD GetBytes ( ) const
+	{
+		return qwReliableBytes + qwUnreliableBytes;
+	}
+
+	void Add ( const ULONG ulSize, const bool bReliable )
+	{
+		if ( bReliable )
+			qwReliableBytes += ulSize;
+		else
+			qwUnreliableBytes += ulSize;
+		ulNumCommands++;
+	}
+
+	void Add ( const COMMANDTRAFFIC_s &Other )
+	{
+		qwReliableBytes += Other.qwReliableBytes;
+		qwUnreliableBytes += Other.qwUnreliableBytes;
+		ulNumCommands += Other.ulNumCommands;
+	}
+};
+
+// The extended commands are counted after the normal ones.
+enum
+{
+	NUM_TRAFFIC_COMMANDS = NUM_SERVER_COMMANDS + NUM_SVC2_COMMANDS,
+};
+
+// The command traffic caused within some time.
+struct COMMANDTRAFFICSTATS_s
+{
+	COMMANDTRAFFIC_s	Commands[NUM_TRAFFIC_COMMANDS];
+	COMMANDTRAFFIC_s	Clients[MAXPLAYERS];
+
+	// Commands that weren't sent while an actor was ticking are counted for NULL.
+	TMap<const PClass*, COMMANDTRAFFIC_s>	ActorClasses;
+
+	void Clear ( )
+	{
+		memset( Commands, 0, sizeof( Commands ));
+		memset( Clients, 0, sizeof( Clients ));
+		ActorClasses.Clear();
+	}
+
+	void Add ( const COMMANDTRAFFICSTATS_s &Other )
+	{
+		for ( unsigned int i = 0; i < NUM_TRAFFIC_COMMANDS; i++ )
+			Commands[i].Add( Other.Commands[i] );
+
+		for ( unsigned int i = 0; i < MAXPLAYERS; i++ )
+			Clients[i].Add( Other.Clients[i] );
+
+		TMap<const PClass*, COMMANDTRAFFIC_s>::ConstIterator it( Other.ActorClasses );
+		TMap<const PClass*, COMMANDTRAFFIC_s>::ConstPair *pair;
+		while ( it.NextPair( pair ))
+			ActorClasses[pair->Key].Add( pair->Value );
+	}
+};
+
+// The command traffic is always counted, for the current second, the last second
+// and since the last clearcommandtraffic.
+static	COMMANDTRAFFICSTATS_s	g_CurrentCommandTraffic;
+static	COMMANDTRAFFICSTATS_s	g_LastSecondCommandTraffic;
+static	COMMANDTRAFFICSTATS_s	g_TotalCommandTraffic;
+
+const PClass	*g_pNetTrafficActorClass = NULL;
+
 //*****************************************************************************
 //
 void NETTRAFFIC_AddActorTraffic ( const AActor* pActor, const int BytesUsed )
@@ -104,6 +181,161 @@ void NETTRAFFIC_Reset ( )
 	g_ACSScriptTrafficMap.clear();
 }
 
+//*****************************************************************************
+//
+// Counts a command that is sent to a client, by its header, the client and the class
+// of the actor that caused it.
+//
+void NETTRAFFIC_AddCommandTraffic ( const BYTE *pbCommand, const ULONG ulSize, const ULONG ulClient, const bool bReliable )
+{
+	if (( ulSize == 0 ) || ( ulClient >= MAXPLAYERS ))
+		return;
+
+	unsigned int index = pbCommand[0];
+	if (( index == SVC_EXTENDEDCOMMAND ) && ( ulSize > 1 ))
+		index = NUM_SERVER_COMMANDS + pbCommand[1];
+
+	if ( index < NUM_TRAFFIC_COMMANDS )
+		g_CurrentCommandTraffic.Commands[index].Add( ulSize, bReliable );
+
+	g_CurrentCommandTraffic.Clients[ulClient].Add( ulSize, bReliable );
+	g_CurrentCommandTraffic.ActorClasses[g_pNetTrafficActorClass].Add( ulSize, bReliable );
+}
+
+//*****************************************************************************
+//
+// Forgets the traffic of a client that left, so that it isn't counted for the next one.
+//
+void NETTRAFFIC_ResetClient ( const ULONG ulClient )
+{
+	if ( ulClient >= MAXPLAYERS )
+		return;
+
+	memset( &g_CurrentCommandTraffic.Clients[ulClient], 0, sizeof( COMMANDTRAFFIC_s ));
+	memset( &g_LastSecondCommandTraffic.Clients[ulClient], 0, sizeof( COMMANDTRAFFIC_s ));
+	memset( &g_TotalCommandTraffic.Clients[ulClient], 0, sizeof( COMMANDTRAFFIC_s ));
+}
+
+//*****************************************************************************
+//
+// Called once per second.
+//
+void NETTRAFFIC_Tick ( )
+{
+	g_TotalCommandTraffic.Add( g_CurrentCommandTraffic );
+
+	memcpy( g_LastSecondCommandTraffic.Commands, g_CurrentCommandTraffic.Commands, sizeof( g_CurrentCommandTraffic.Commands ));
+	memcpy( g_LastSecondCommandTraffic.Clients, g_CurrentCommandTraffic.Clients, sizeof( g_CurrentCommandTraffic.Clients ));
+	g_LastSecondCommandTraffic.ActorClasses.TransferFrom( g_CurrentCommandTraffic.ActorClasses );
+	g_CurrentCommandTraffic.Clear();
+}
+
+//*****************************************************************************
+//
+static const char *nettraffic_GetCommandName ( const unsigned int index )
+{
+	if ( index < NUM_SERVER_COMMANDS )
+		return GetStringSVC( static_cast<SVC>( index ));
+
+	return GetStringSVC2( static_cast<SVC2>( index - NUM_SERVER_COMMANDS ));
+}
+
+//*****************************************************************************
+//
+static void nettraffic_PrintTopTalkers ( const char *title, std::vector<std::pair<FString, COMMANDTRAFFIC_s>> &talkers, const unsigned int count )
+{
+	std::sort( talkers.begin(), talkers.end(), []( const std::pair<FString, COMMANDTRAFFIC_s> &a, const std::pair<FString, COMMANDTRAFFIC_s> &b )
+	{
+		return a.second.GetBytes() > b.second.GetBytes();
+	});
+
+	Printf ( "\n%s (top %u of %u):\n", title, static_cast<unsigned int>( MIN<size_t>( count, talkers.size() )), static_cast<unsigned int>( talkers.size() ));
+	Printf ( "%10s %10s %10s %8s  %s\n", "bytes", "reliable", "unreliable", "commands", "name" );
+
+	for ( unsigned int i = 0; ( i < count ) && ( i < talkers.size() ); i++ )
+	{
+		const COMMANDTRAFFIC_s &traffic = talkers[i].second;
+		Printf ( "%10llu %10llu %10llu %8lu  %s\n", static_cast<unsigned long long>( traffic.GetBytes() ),
+			static_cast<unsigned long long>( traffic.qwReliableBytes ), static_cast<unsigned long long>( traffic.qwUnreliableBytes ),
+			traffic.ulNumCommands, talkers[i].first.GetChars() );
+	}
+}
+
+//*****************************************************************************
+//
+// Prints which commands, clients and actor classes caused the most outbound traffic
+// in the last second, or since the last clearcommandtraffic with "total".
+//
+CCMD( dumpcommandtraffic )
+{
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	bool bTotal = false;
+	unsigned int count = 10;
+
+	for ( int i = 1; i < argv.argc(); i++ )
+	{
+		if ( stricmp( argv[i], "total" ) == 0 )
+			bTotal = true;
+		else
+			count = MAX( atoi( argv[i] ), 1 );
+	}
+
+	// The total doesn't include the current second yet.
+	COMMANDTRAFFICSTATS_s totalStats;
+	if ( bTotal )
+	{
+		totalStats.Clear();
+		totalStats.Add( g_TotalCommandTraffic );
+		totalStats.Add( g_CurrentCommandTraffic );
+	}
+
+	const COMMANDTRAFFICSTATS_s &stats = bTotal ? totalStats : g_LastSecondCommandTraffic;
+	std::vector<std::pair<FString, COMMANDTRAFFIC_s>> talkers;
+
+	Printf ( "Outbound command traffic %s:\n", bTotal ? "since it was cleared" : "in the last second" );
+
+	for ( unsigned int i = 0; i < NUM_TRAFFIC_COMMANDS; i++ )
+	{
+		if ( stats.Commands[i].ulNumCommands > 0 )
+			talkers.push_back( std::make_pair( FString( nettraffic_GetCommandName( i )), stats.Commands[i] ));
+	}
+	nettraffic_PrintTopTalkers ( "Commands", talkers, count );
+
+	talkers.clear();
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		if ( stats.Clients[ulIdx].ulNumCommands == 0 )
+			continue;
+
+		FString name;
+		if ( SERVER_IsValidClient( ulIdx ))
+			name.Format( "%lu: %s", ulIdx, players[ulIdx].userinfo.GetName() );
+		else
+			name.Format( "%lu", ulIdx );
+
+		talkers.push_back( std::make_pair( name, stats.Clients[ulIdx] ));
+	}
+	nettraffic_PrintTopTalkers ( "Clients", talkers, count );
+
+	talkers.clear();
+	TMap<const PClass*, COMMANDTRAFFIC_s>::ConstIterator it( stats.ActorClasses );
+	TMap<const PClass*, COMMANDTRAFFIC_s>::ConstPair *pair;
+	while ( it.NextPair( pair ))
+		talkers.push_back( std::make_pair( FString( pair->Key ? pair->Key->TypeName.GetChars() : "(no actor)" ), pair->Value ));
+	nettraffic_PrintTopTalkers ( "Actor classes", talkers, count );
+}
+
+//*****************************************************************************
+//
+CCMD( clearcommandtraffic )
+{
+	g_CurrentCommandTraffic.Clear();
+	g_LastSecondCommandTraffic.Clear();
+	g_TotalCommandTraffic.Clear();
+}
+
 //*****************************************************************************
 //
 CCMD( dumptrafficmeasure )
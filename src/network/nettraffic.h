@@ -53,5 +53,31 @@
 void	NETTRAFFIC_AddActorTraffic ( const AActor* pActor, const int BytesUsed );
 void	NETTRAFFIC_AddACSScriptTraffic ( const int ScriptNum, const int BytesUsed );
 void	NETTRAFFIC_Reset ( );
+void	NETTRAFFIC_AddCommandTraffic ( const BYTE *pbCommand, const ULONG ulSize, const ULONG ulClient, const bool bReliable );
+void	NETTRAFFIC_ResetClient ( const ULONG ulClient );
+void	NETTRAFFIC_Tick ( );
+
+// The class of the actor that is ticking right now, the commands it causes are counted for it.
+extern	const PClass	*g_pNetTrafficActorClass;
+
+//*****************************************************************************
+//
+// Attributes the commands that are sent within its scope to the class of an actor.
+class FNetTrafficActorScope
+{
+public:
+	FNetTrafficActorScope ( const AActor *pActor ) : m_pPreviousClass( g_pNetTrafficActorClass )
+	{
+		g_pNetTrafficActorClass = pActor->GetClass();
+	}
+
+	~FNetTrafficActorScope ( )
+	{
+		g_pNetTrafficActorClass = m_pPreviousClass;
+	}
+
+private:
+	const PClass	*m_pPreviousClass;
+};
 
 #endif	// __NETTRAFFIC_H__
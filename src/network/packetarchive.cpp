@@ -48,11 +48,16 @@
 //
 //-----------------------------------------------------------------------------
 
-#include "../sv_main.h"
-#include "../network.h"
+#include <cmath>
+#include "../doomtype.h"
+#include "../doomdef.h"
+#include "../templates.h"
 #include "../network_enums.h" 
 #include "packetarchive.h"
 
+// Every stored packet begins with the SVC_HEADER byte and its sequence number.
+static const size_t PACKETARCHIVE_HEADER_SIZE = 5;
+
 //*****************************************************************************
 //
 PacketArchive::PacketArchive() :
@@ -74,7 +79,7 @@ void PacketArchive::Initialize( size_t maxPacketSize )
 {
 	if ( _initialized == false )
 	{
-		_packetData.Init( maxPacketSize * PACKET_BUFFER_SIZE, BUFFERTYPE_WRITE );
+		_packetData.Init(( maxPacketSize + PACKETARCHIVE_HEADER_SIZE ) * PACKET_BUFFER_SIZE, BUFFERTYPE_WRITE );
 		Clear();
 		_initialized = true;
 	}
@@ -93,15 +98,23 @@ void PacketArchive::Free()
 
 //*****************************************************************************
 //
-unsigned int PacketArchive::StorePacket( const NETBUFFER_s& packet )
+// The packet is stored together with its header, so it can be sent right from
+// the archive. The segments are copied one after the other, this is the only copy
+// of a reliable packet that is made before it's encoded.
+//
+unsigned int PacketArchive::StorePacket( const NETPACKETSEGMENT_s *segments, unsigned int numSegments )
 {
 	if ( _initialized == false )
 		return 0;
 
+	size_t packetSize = PACKETARCHIVE_HEADER_SIZE;
+	for ( unsigned int i = 0; i < numSegments; ++i )
+		packetSize += segments[i].ulSize;
+
 	_packetData.ulCurrentSize = _packetData.CalcSize();
 
 	// If we've reached the end of our reliable packets buffer, start writing at the beginning.
-	if (( _packetData.ulCurrentSize + packet.CalcSize() ) >= _packetData.ulMaxSize )
+	if (( _packetData.ulCurrentSize + packetSize ) >= _packetData.ulMaxSize )
 	{
 		_packetData.ByteStream.pbStream = _packetData.pbData;
 		_packetData.ulCurrentSize = 0;
@@ -112,10 +125,21 @@ unsigned int PacketArchive::StorePacket( const NETBUFFER_s& packet )
 	unsigned int i = _sequenceNumber % PACKET_BUFFER_SIZE;
 	_records[i].position = _packetData.ulCurrentSize;
 	_records[i].sequenceNumber = _sequenceNumber;
+	_records[i].lastSendTime = 0;
+	_records[i].transmissions = 0;
+	_records[i].acknowledged = false;
+	_records[i].scheduled = false;
 
 	// Write what we want to send out to our reliable packets buffer, so that it can be
 	// retransmitted later if necessary. Also save the size.
-	_records[i].size = packet.WriteTo( _packetData.ByteStream );
+	_packetData.ByteStream.WriteHeader( SVC_HEADER );
+	_packetData.ByteStream.WriteLong( _sequenceNumber );
+	for ( unsigned int segment = 0; segment < numSegments; ++segment )
+	{
+		if ( segments[segment].ulSize > 0 )
+			_packetData.ByteStream.WriteBuffer( segments[segment].pbData, segments[segment].ulSize );
+	}
+	_records[i].size = packetSize;
 
 	return _sequenceNumber++;
 }
@@ -130,7 +154,11 @@ void PacketArchive::Clear()
 	_sequenceNumber = 0;
 
 	for ( size_t i = 0; i < countof( _records ); ++i )
+	{
 		_records[i].position = _records[i].size = _records[i].sequenceNumber = 0;
+		_records[i].lastSendTime = _records[i].transmissions = 0;
+		_records[i].acknowledged = _records[i].scheduled = false;
+	}
 }
 
 //*****************************************************************************
@@ -169,21 +197,57 @@ bool PacketArchive::FindPacket( unsigned int packetNumber, const BYTE*& data, si
 
 //*****************************************************************************
 //
-CUSTOM_CVAR( Int, sv_maxpacketspertick, 64, CVAR_ARCHIVE )
+// Unlike FindPacket, this only finds packets that are still stored in
+// their slot, which is all we need to track the acknowledgements.
+PacketArchive::Record *PacketArchive::FindRecord( unsigned int packetNumber )
 {
-	if ( self <= 0 )
-	{
-		Printf( "sv_maxpacketspertick must be positive.\n" );
-		self = 64;
-	}
+	if (( _initialized == false ) || ( packetNumber >= _sequenceNumber ))
+		return NULL;
+
+	Record *record = &_records[packetNumber % PACKET_BUFFER_SIZE];
+	return ( record->sequenceNumber == packetNumber ) ? record : NULL;
 }
 
+//*****************************************************************************
+//	CONSTANTS
+
+// The round trip time we assume before we measured it (in ms).
+static const double PACKETARCHIVE_INITIAL_RTT = 250.0;
+
+// The retransmission timeout never exceeds this (in ms).
+static const unsigned int PACKETARCHIVE_MAX_RTO = 2000;
+
+// The timeout doubles with every timeout in a row (RFC 6298), up to this (in ms).
+static const unsigned int PACKETARCHIVE_MAX_BACKOFF_RTO = 8000;
+
+// How many packets are sent again at most when the timeout expires.
+static const unsigned int PACKETARCHIVE_MAX_TIMEOUT_RETRANSMISSIONS = 4;
+
+// The pacing starts at this many packets per tick and never gets slower than the minimum.
+static const double PACKETARCHIVE_INITIAL_PACING_RATE = 16.0;
+static const double PACKETARCHIVE_MIN_PACING_RATE = 4.0;
+
+// The duration of a tick (in ms).
+static const double PACKETARCHIVE_TICK_TIME = 1000.0 / TICRATE;
+
+// How many packets before the highest received one the acknowledgement bitmap covers.
+static const int PACKETARCHIVE_ACK_WINDOW = 32;
+
+// A packet is only considered lost if this many later packets arrived, to allow
+// for some reordering on the way.
+static const int PACKETARCHIVE_REORDER_THRESHOLD = 3;
+
+// The packets waiting to be sent are already in the archive. To make sure they
+// aren't overwritten before they're sent, no more than this many may wait.
+static const unsigned int PACKETARCHIVE_MAX_UNSENT_PACKETS = PACKET_BUFFER_SIZE / 2;
+
 //*****************************************************************************
 //
 OutgoingPacketBuffer::OutgoingPacketBuffer ( )
 {
 	_packetsSentThisTick = 0;
 	_clientIdx = MAXPLAYERS;
+	ResetAcknowledgement();
 }
 
 //*****************************************************************************
@@ -193,25 +257,113 @@ void OutgoingPacketBuffer::SetClientIndex ( const unsigned int ClientIdx )
 	_clientIdx = ClientIdx;
 }
 
+//*****************************************************************************
+//
+void OutgoingPacketBuffer::ResetAcknowledgement ( )
+{
+	_receivedAck = false;
+	_oldestUnacknowledged = 0;
+	_highestAcknowledged = 0;
+	_lastCongestionTime = 0;
+	_lastTimeoutTime = 0;
+	_numTimeouts = 0;
+	_smoothedRTT = PACKETARCHIVE_INITIAL_RTT;
+	_RTTVariance = PACKETARCHIVE_INITIAL_RTT / 2;
+	_minRTT = 0;
+	_latestRTT = 0;
+	_packetsDeliveredThisTick = 0;
+	_deliveryHistoryIndex = 0;
+	for ( unsigned int i = 0; i < countof( _deliveryHistory ); ++i )
+		_deliveryHistory[i] = 0;
+	_lossRate = 0;
+	_slowStart = true;
+	_pacingRate = PACKETARCHIVE_INITIAL_PACING_RATE;
+	_pacingCredit = 0;
+	_packetAllowance = static_cast<unsigned int> ( PACKETARCHIVE_INITIAL_PACING_RATE );
+	_numRetransmissions = 0;
+	_numCongestionEvents = 0;
+}
+
+//*****************************************************************************
+//
+unsigned int OutgoingPacketBuffer::GetPacketLimit ( ) const
+{
+	const unsigned int maxPackets = GetMaxPacketsPerTick();
+
+	if ( UsesAdaptivePacing() == false )
+		return maxPackets;
+
+	return MIN ( maxPackets, _packetAllowance );
+}
+
+//*****************************************************************************
+//
+// The most packets the client received in one of the last ticks. The maximum
+// is used because a tick might be short of packets if we had nothing to send.
+//
+unsigned int OutgoingPacketBuffer::GetDeliveryRate ( ) const
+{
+	unsigned int rate = 0;
+	for ( unsigned int i = 0; i < countof( _deliveryHistory ); ++i )
+		rate = MAX ( rate, _deliveryHistory[i] );
+	return rate;
+}
+
+//*****************************************************************************
+//
+unsigned int OutgoingPacketBuffer::GetRetransmissionTimeout ( ) const
+{
+	const unsigned int minTimeout = 2 * 1000 / TICRATE;
+	unsigned int timeout = clamp ( static_cast<unsigned int> ( _smoothedRTT + 4 * _RTTVariance ), minTimeout, PACKETARCHIVE_MAX_RTO );
+
+	// Back off while the client doesn't answer.
+	for ( unsigned int i = 0; ( i < _numTimeouts ) && ( timeout < PACKETARCHIVE_MAX_BACKOFF_RTO ); ++i )
+		timeout *= 2;
+
+	return MIN ( timeout, PACKETARCHIVE_MAX_BACKOFF_RTO );
+}
+
 //*****************************************************************************
 //
 void OutgoingPacketBuffer::ScheduleUnsentPacket ( const NETBUFFER_s &Packet )
 {
-	if ( ( _unsentPackets.Size () == 0 ) && ( _packetsSentThisTick < static_cast<unsigned int> ( sv_maxpacketspertick ) ) )
+	NETPACKETSEGMENT_s segment;
+	segment.pbData = Packet.pbData;
+	segment.ulSize = Packet.CalcSize();
+	ScheduleUnsentPacket( &segment, 1 );
+}
+
+//*****************************************************************************
+//
+// The packet goes into the archive right away, even if it has to wait
+// until it may be sent. The sequence numbers still follow the order in which
+// the packets go out.
+//
+void OutgoingPacketBuffer::ScheduleUnsentPacket ( const NETPACKETSEGMENT_s *segments, unsigned int numSegments )
+{
+	const unsigned int packetNumber = this->StorePacket ( segments, numSegments );
+
+	if ( ( _unsentPackets.Size () == 0 ) && ( _packetsSentThisTick < GetPacketLimit() ) )
 	{
 		++_packetsSentThisTick;
-		const int packetNumber = this->StorePacket ( Packet );
-		SendPacket( packetNumber, SERVER_GetClient ( _clientIdx )->Address );
+		SendPacket( packetNumber );
+		return;
 	}
-	else
+
+	// If too many packets are waiting, the oldest has to go out now.
+	if ( _unsentPackets.Size () >= PACKETARCHIVE_MAX_UNSENT_PACKETS )
 	{
-		_unsentPackets.Push ( Packet );
+		++_packetsSentThisTick;
+		SendPacket( _unsentPackets[0] );
+		_unsentPackets.Delete( 0 );
 	}
+
+	_unsentPackets.Push ( packetNumber );
 }
 
 //*****************************************************************************
 //
-bool OutgoingPacketBuffer::SendPacket( unsigned int packetNumber, const NETADDRESS_s &Address ) const
+bool OutgoingPacketBuffer::SendPacket( unsigned int packetNumber )
 {
 	// Find the packet from the saved packet archive.
 	const BYTE* packetData;
@@ -222,15 +374,20 @@ bool OutgoingPacketBuffer::SendPacket( unsigned int packetNumber, const NETADDRE
 	if ( found == false )
 		return false;
 
-	// Now that we've found the packet, send it.
-	NETBUFFER_s TempBuffer;
-	TempBuffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
-	TempBuffer.ByteStream.WriteHeader( SVC_HEADER );
-	TempBuffer.ByteStream.WriteLong( packetNumber );
-	if ( packetSize > 0 )
-		TempBuffer.ByteStream.WriteBuffer( packetData, packetSize );
-	NETWORK_LaunchPacket( &TempBuffer, Address );
-	TempBuffer.Free();
+	// Remember when we sent it, this is what the round trip time is measured against.
+	Record *record = FindRecord( packetNumber );
+	if ( record != NULL )
+	{
+		if ( record->transmissions > 0 )
+			++_numRetransmissions;
+
+		record->lastSendTime = GetTime();
+		record->transmissions++;
+		record->scheduled = false;
+	}
+
+	// Now that we've found the packet, send it. It's stored with its header already.
+	LaunchPacket( packetNumber, packetData, packetSize );
 	return true;
 }
 
@@ -238,25 +395,234 @@ bool OutgoingPacketBuffer::SendPacket( unsigned int packetNumber, const NETADDRE
 //
 bool OutgoingPacketBuffer::SchedulePacket ( unsigned int packetNumber )
 {
-	if ( ( _scheduledPacketIndices.Size() == 0 ) && ( _packetsSentThisTick < static_cast<unsigned int> ( sv_maxpacketspertick ) ) )
+	// The packet is already on its way again, or the client told us that
+	// it got it in the meantime.
+	Record *record = FindRecord( packetNumber );
+	if (( record != NULL ) && ( record->acknowledged || record->scheduled ))
+		return true;
+
+	if ( ( _scheduledPacketIndices.Size() == 0 ) && ( _packetsSentThisTick < GetPacketLimit() ) )
 	{
 		++_packetsSentThisTick;
-		return SendPacket( packetNumber, SERVER_GetClient ( _clientIdx )->Address );
+		return SendPacket( packetNumber );
 	}
 	else
 	{
 		_scheduledPacketIndices.Push ( packetNumber );
+		if ( record != NULL )
+			record->scheduled = true;
 		const BYTE* packetData;
 		size_t packetSize;
 		return this->FindPacket( packetNumber, packetData, packetSize );
 	}
 }
 
+//*****************************************************************************
+//
+void OutgoingPacketBuffer::QueueRetransmission ( Record *record )
+{
+	record->scheduled = true;
+	_scheduledPacketIndices.Push ( record->sequenceNumber );
+}
+
+//*****************************************************************************
+//
+// If we send faster than the link can carry, the packets pile up in a queue
+// until it overflows. In that case, the round trip time grew and we slow down
+// to the rate at which the client actually receives our packets. Random losses
+// of a bad link on the other hand don't get better by sending slower. This is
+// done only once per round trip, since all the losses of one round trip have
+// the same cause.
+//
+void OutgoingPacketBuffer::OnLoss ( unsigned int now )
+{
+	if ( _latestRTT <= _minRTT + PACKETARCHIVE_TICK_TIME )
+		return;
+
+	if (( _numCongestionEvents > 0 ) && ( now - _lastCongestionTime < _smoothedRTT ))
+		return;
+
+	_pacingRate = MAX ( PACKETARCHIVE_MIN_PACING_RATE, MIN ( _pacingRate, static_cast<double> ( GetDeliveryRate() )));
+	_pacingCredit = 0;
+	_slowStart = false;
+	_lastCongestionTime = now;
+	++_numCongestionEvents;
+}
+
+//*****************************************************************************
+//
+// The client tells us the last packet it parsed, the highest packet it
+// received and which of the PACKETARCHIVE_ACK_WINDOW packets before that one
+// it has. Bit i of receivedBits stands for packet highestReceived - 1 - i.
+//
+void OutgoingPacketBuffer::Acknowledge ( int lastParsed, int highestReceived, unsigned int receivedBits )
+{
+	if ( UsesAdaptivePacing() == false )
+		return;
+
+	// Ignore anything that doesn't fit the packets we sent, e.g. acknowledgements
+	// that still refer to the packets before a map change.
+	if (( highestReceived < 0 ) || ( lastParsed > highestReceived ) || ( static_cast<unsigned int> ( highestReceived ) >= GetSequenceNumber() ))
+		return;
+
+	const unsigned int now = GetTime();
+	unsigned int numAcked = 0;
+	unsigned int numLost = 0;
+	int newestSample = -1;
+	_receivedAck = true;
+
+	// Everything the client parsed arrived.
+	if ( lastParsed >= 0 )
+	{
+		unsigned int first = _oldestUnacknowledged;
+		if ( static_cast<unsigned int> ( lastParsed ) >= first + PACKET_BUFFER_SIZE )
+			first = lastParsed - PACKET_BUFFER_SIZE + 1;
+
+		for ( unsigned int packet = first; packet <= static_cast<unsigned int> ( lastParsed ); ++packet )
+		{
+			Record *record = FindRecord( packet );
+			if (( record == NULL ) || record->acknowledged )
+				continue;
+
+			record->acknowledged = true;
+			++numAcked;
+			if ( record->transmissions == 1 )
+				newestSample = packet;
+		}
+	}
+
+	// Now go through the bitmap. The packets that are reported missing are sent
+	// again unless we already did that within the last round trip.
+	for ( int i = -1; i < PACKETARCHIVE_ACK_WINDOW; ++i )
+	{
+		const int packet = highestReceived - 1 - i;
+		if ( packet <= lastParsed )
+			break;
+
+		Record *record = FindRecord( packet );
+		if (( record == NULL ) || record->acknowledged )
+			continue;
+
+		if (( i == -1 ) || ( receivedBits & ( 1u << i )))
+		{
+			record->acknowledged = true;
+			++numAcked;
+			if (( record->transmissions == 1 ) && ( packet > newestSample ))
+				newestSample = packet;
+		}
+		else if (( packet + PACKETARCHIVE_REORDER_THRESHOLD <= highestReceived )
+			&& ( record->scheduled == false )
+			&& ( now - record->lastSendTime >= _smoothedRTT ))
+		{
+			QueueRetransmission( record );
+			++numLost;
+		}
+	}
+
+	// Update the round trip estimate like TCP does (RFC 6298). Retransmitted
+	// packets aren't sampled, we can't tell which transmission was acknowledged.
+	if ( newestSample >= 0 )
+	{
+		const double sample = now - FindRecord( newestSample )->lastSendTime;
+		_latestRTT = sample;
+		if ( _minRTT > 0 )
+		{
+			_minRTT = MIN ( _minRTT, sample );
+			_RTTVariance = 0.75 * _RTTVariance + 0.25 * fabs( _smoothedRTT - sample );
+			_smoothedRTT = 0.875 * _smoothedRTT + 0.125 * sample;
+		}
+		else
+		{
+			_minRTT = _smoothedRTT = MAX ( sample, 1.0 );
+			_RTTVariance = sample / 2;
+		}
+	}
+
+	for ( unsigned int i = 0; i < numAcked + numLost; ++i )
+		_lossRate += (( i < numLost ? 1.0 : 0.0 ) - _lossRate ) / 32;
+
+	// The client is answering again, so the timeout doesn't need to back off anymore.
+	if ( numAcked > 0 )
+		_numTimeouts = 0;
+
+	// How far the highest received packet advanced tells the delivery rate. Unlike
+	// the acknowledged packets, this isn't held back by the packets that are missing.
+	if ( static_cast<unsigned int> ( highestReceived ) > _highestAcknowledged )
+	{
+		_packetsDeliveredThisTick += highestReceived - _highestAcknowledged;
+		_highestAcknowledged = highestReceived;
+	}
+
+	while ( _oldestUnacknowledged < GetSequenceNumber() )
+	{
+		const Record *record = FindRecord( _oldestUnacknowledged );
+		if (( record != NULL ) && ( record->acknowledged == false ))
+			break;
+		++_oldestUnacknowledged;
+	}
+
+	// Until the link is congested the first time, the rate doubles every round trip.
+	if ( _slowStart )
+		_pacingRate = MIN ( static_cast<double> ( GetMaxPacketsPerTick() ), _pacingRate + numAcked * PACKETARCHIVE_TICK_TIME / MAX ( _smoothedRTT, PACKETARCHIVE_TICK_TIME ));
+
+	if ( numLost > 0 )
+		OnLoss( now );
+}
+
+//*****************************************************************************
+//
+// Catches the losses the acknowledgements can't tell us about: The last
+// packets of a burst, and the first packet the client is still missing.
+//
+void OutgoingPacketBuffer::DetectLosses ( )
+{
+	const unsigned int now = GetTime();
+	const unsigned int timeout = GetRetransmissionTimeout();
+	unsigned int numLost = 0;
+
+	// After a timeout, nothing is sent again until the (doubled) timeout expired
+	// once more, like TCP's single retransmission timer.
+	if (( _numTimeouts > 0 ) && ( now - _lastTimeoutTime < timeout ))
+		return;
+
+	for ( unsigned int packet = _oldestUnacknowledged; ( packet < GetSequenceNumber() ) && ( numLost < PACKETARCHIVE_MAX_TIMEOUT_RETRANSMISSIONS ); ++packet )
+	{
+		// Between these two the client might have packets it doesn't report,
+		// those are left to the missing packet requests.
+		if (( packet > _oldestUnacknowledged ) && ( packet <= _highestAcknowledged ))
+			continue;
+
+		Record *record = FindRecord( packet );
+		if (( record == NULL ) || record->acknowledged || record->scheduled || ( record->transmissions == 0 ))
+			continue;
+
+		if ( now - record->lastSendTime >= timeout )
+		{
+			QueueRetransmission( record );
+			++numLost;
+		}
+	}
+
+	if ( numLost > 0 )
+	{
+		_lossRate += ( 1.0 - _lossRate ) / 32;
+		_lastTimeoutTime = now;
+		++_numTimeouts;
+		OnLoss( now );
+	}
+}
+
 //*****************************************************************************
 //
 void OutgoingPacketBuffer::ClearScheduling ( )
 {
 	_packetsSentThisTick = 0;
+	for ( unsigned int i = 0; i < _scheduledPacketIndices.Size(); ++i )
+	{
+		Record *record = FindRecord( _scheduledPacketIndices[i] );
+		if ( record != NULL )
+			record->scheduled = false;
+	}
 	_scheduledPacketIndices.Clear();
 }
 
@@ -264,11 +630,10 @@ void OutgoingPacketBuffer::ClearScheduling ( )
 //
 void OutgoingPacketBuffer::Clear ( )
 {
-	PacketArchive::Clear();
 	ClearScheduling();
-	for ( unsigned int i = 0; i < _unsentPackets.Size(); ++i )
-		_unsentPackets[i].Free();
+	PacketArchive::Clear();
 	_unsentPackets.Clear();
+	ResetAcknowledgement();
 }
 
 //*****************************************************************************
@@ -278,15 +643,13 @@ void OutgoingPacketBuffer::ForceSendAll()
 	for ( unsigned int i = 0; i < _scheduledPacketIndices.Size(); ++i )
 	{
 		++_packetsSentThisTick;
-		SendPacket( _scheduledPacketIndices[i], SERVER_GetClient ( _clientIdx )->Address );
+		SendPacket( _scheduledPacketIndices[i] );
 	}
 	_scheduledPacketIndices.Clear();
 	for ( unsigned int i = 0; i < _unsentPackets.Size(); ++i )
 	{
 		++_packetsSentThisTick;
-		const int packetNumber = this->StorePacket ( _unsentPackets[i] );
-		SendPacket ( packetNumber, SERVER_GetClient (_clientIdx)->Address );
-		_unsentPackets[i].Free ();
+		SendPacket ( _unsentPackets[i] );
 	}
 	_unsentPackets.Clear();
 }
@@ -295,30 +658,64 @@ void OutgoingPacketBuffer::ForceSendAll()
 //
 void OutgoingPacketBuffer::Tick ( )
 {
+	const bool adaptive = UsesAdaptivePacing();
+
+	if ( adaptive && _receivedAck )
+		DetectLosses();
+
+	const unsigned int packetLimit = GetPacketLimit();
+
 	{
-		const int packetsToSend = MIN ( sv_maxpacketspertick - static_cast<int> ( _packetsSentThisTick ), static_cast<int> ( _scheduledPacketIndices.Size () ) );
-		for ( int i = 0; i < packetsToSend; ++i )
+		unsigned int i = 0;
+		for ( ; ( i < _scheduledPacketIndices.Size() ) && ( _packetsSentThisTick < packetLimit ); ++i )
 		{
+			// Don't resend what arrived in the meantime.
+			Record *record = FindRecord( _scheduledPacketIndices[i] );
+			if (( record != NULL ) && record->acknowledged )
+			{
+				record->scheduled = false;
+				continue;
+			}
+
 			++_packetsSentThisTick;
-			if ( SendPacket( _scheduledPacketIndices[i], SERVER_GetClient( _clientIdx )->Address) == false )
+			if ( SendPacket( _scheduledPacketIndices[i] ) == false )
 			{
-				SERVER_KickPlayer( _clientIdx, "Too many missed packets.");
+				Abort( "Too many missed packets." );
 				return;
 			}
 		}
-		_scheduledPacketIndices.Delete( 0, packetsToSend );
+		_scheduledPacketIndices.Delete( 0, i );
 	}
 
 	{
-		const int unsentPacketsToSend = MIN ( sv_maxpacketspertick - static_cast<int> ( _packetsSentThisTick ), static_cast<int> ( _unsentPackets.Size () ) );
+		const int unsentPacketsToSend = MIN ( static_cast<int> ( packetLimit ) - static_cast<int> ( _packetsSentThisTick ), static_cast<int> ( _unsentPackets.Size () ) );
 		for ( int i = 0; i < unsentPacketsToSend; ++i )
 		{
 			++_packetsSentThisTick;
-			const int packetNumber = this->StorePacket ( _unsentPackets[i] );
-			SendPacket ( packetNumber, SERVER_GetClient( _clientIdx )->Address );
-			_unsentPackets[i].Free ();
+			SendPacket ( _unsentPackets[i] );
 		}
-		_unsentPackets.Delete( 0, unsentPacketsToSend );
+		if ( unsentPacketsToSend > 0 )
+			_unsentPackets.Delete( 0, unsentPacketsToSend );
+	}
+
+	if ( adaptive && _receivedAck )
+	{
+		_deliveryHistory[_deliveryHistoryIndex++ % countof( _deliveryHistory )] = _packetsDeliveredThisTick;
+		_packetsDeliveredThisTick = 0;
+	}
+
+	// Without losses in the last round trip, slowly speed up again. The pacing rate
+	// is fractional, whatever is left of a packet carries over to the next tick.
+	if ( adaptive )
+	{
+		const double maxRate = GetMaxPacketsPerTick();
+		if (( _slowStart == false ) && ( GetTime() - _lastCongestionTime >= _smoothedRTT ))
+			_pacingRate *= 1 + PACKETARCHIVE_TICK_TIME / ( 8 * _smoothedRTT );
+		_pacingRate = MIN ( maxRate, _pacingRate );
+
+		_pacingCredit = MIN ( _pacingCredit + _pacingRate, maxRate );
+		_packetAllowance = static_cast<unsigned int> ( _pacingCredit );
+		_pacingCredit -= _packetAllowance;
 	}
 
 	_packetsSentThisTick = 0;
@@ -60,17 +60,25 @@ public:
 	void Initialize( size_t maxPacketSize );
 	void Free();
 	void Clear();
-	unsigned int StorePacket( const NETBUFFER_s& packet );
+	unsigned int StorePacket( const NETPACKETSEGMENT_s *segments, unsigned int numSegments );
 	bool FindPacket( unsigned int packetNumber, const BYTE*& data, size_t& size ) const;
 
-private:
+protected:
 	struct Record
 	{
 		size_t position; // The position of this packet within _packetData.
 		size_t size; // The packet size of the stored packet.
 		unsigned int sequenceNumber; // The corresponding sequence number of this packet.
+		unsigned int lastSendTime; // When this packet was last put on the wire (in ms).
+		unsigned int transmissions; // How often this packet was sent, zero if it never was.
+		bool acknowledged; // The client confirmed that it received this packet.
+		bool scheduled; // This packet is waiting to be retransmitted.
 	};
 
+	Record *FindRecord( unsigned int packetNumber );
+	unsigned int GetSequenceNumber() const { return _sequenceNumber; }
+
+private:
 	// Buffer containing all data of the saved packets.
 	NETBUFFER_s _packetData;
 
@@ -90,22 +98,85 @@ private:
 //
 // @author Benjamin Berkels
 //
+// Besides the missing packet requests, the client acknowledges the
+// packets it received with a selective acknowledgement bitmap. From these
+// the buffer measures the round trip time and loss of the link, which
+// drive both the retransmissions and the number of packets sent per tick.
+//
 //==========================================================================
 class OutgoingPacketBuffer : public PacketArchive
 {
 	unsigned int _packetsSentThisTick;
 	unsigned int _clientIdx;
 	TArray<unsigned int> _scheduledPacketIndices;
-	TArray<NETBUFFER_s> _unsentPackets;
-private:
-	bool SendPacket( unsigned int packetNumber, const NETADDRESS_s &Address ) const;
+	// Packets that are stored in the archive already, but weren't sent yet.
+	TArray<unsigned int> _unsentPackets;
+
+	// Selective acknowledgement state.
+	bool _receivedAck;
+	unsigned int _oldestUnacknowledged;
+	unsigned int _highestAcknowledged;
+	unsigned int _lastCongestionTime;
+
+	// When the retransmission timeout last expired, and how often it did in a row.
+	unsigned int _lastTimeoutTime;
+	unsigned int _numTimeouts;
+
+	// Link estimates (in ms), the loss rate is a moving average between 0 and 1.
+	double _smoothedRTT;
+	double _RTTVariance;
+	double _minRTT;
+	double _latestRTT;
+	double _lossRate;
+
+	// How many packets the client received in each of the last ticks.
+	unsigned int _deliveryHistory[8];
+	unsigned int _deliveryHistoryIndex;
+	unsigned int _packetsDeliveredThisTick;
+
+	// How many packets we may send per tick, and the fractional part carried over.
+	// In the slow start, the pacing rate grows until the link is congested the first time.
+	bool _slowStart;
+	double _pacingRate;
+	double _pacingCredit;
+	unsigned int _packetAllowance;
+
+	unsigned int _numRetransmissions;
+	unsigned int _numCongestionEvents;
+
+	void ResetAcknowledgement();
+	bool SendPacket( unsigned int packetNumber );
+	unsigned int GetPacketLimit() const;
+	unsigned int GetDeliveryRate() const;
+	unsigned int GetRetransmissionTimeout() const;
+	void QueueRetransmission( Record *record );
+	void DetectLosses();
+	void OnLoss( unsigned int now );
+
+	// These talk to the real client and are defined in sv_main.cpp. The network
+	// simulator (server-netsim) defines its own instead.
+	void LaunchPacket( unsigned int packetNumber, const BYTE *data, size_t size );
+	void Abort( const char *reason );
+	unsigned int GetTime() const;
+	bool UsesAdaptivePacing() const;
+	unsigned int GetMaxPacketsPerTick() const;
+
 public:
 	OutgoingPacketBuffer ( );
 	void SetClientIndex ( const unsigned int ClientIdx );
 	void ScheduleUnsentPacket ( const NETBUFFER_s &Packet );
+	void ScheduleUnsentPacket ( const NETPACKETSEGMENT_s *segments, unsigned int numSegments );
 	bool SchedulePacket( unsigned int packetNumber );
+	void Acknowledge( int lastParsed, int highestReceived, unsigned int receivedBits );
 	void ClearScheduling();
 	void ForceSendAll();
 	void Clear();
 	void Tick ( );
+
+	double GetSmoothedRTT() const { return _smoothedRTT; }
+	double GetLossRate() const { return _lossRate; }
+	double GetPacingRate() const { return _pacingRate; }
+	unsigned int GetNumRetransmissions() const { return _numRetransmissions; }
+	unsigned int GetNumCongestionEvents() const { return _numCongestionEvents; }
+	unsigned int GetNumUnsentPackets() const { return _unsentPackets.Size(); }
 };
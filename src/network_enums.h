@@ -396,6 +396,8 @@ BEGIN_ENUM( SVC2 )
 	ENUM_ELEMENT ( SVC2_RCONACCESS ),
 	// [TRSR] Command for syncing Domination point state.
 	ENUM_ELEMENT ( SVC2_SETDOMINATIONPOINTSTATE ),
+	// Delta compressed player movement.
+	ENUM_ELEMENT ( SVC2_MOVEPLAYERDELTA ),
 
 	ENUM_ELEMENT ( NUM_SVC2_COMMANDS ),
 }
@@ -466,6 +468,8 @@ BEGIN_ENUM( CLC )
 	ENUM_ELEMENT( CLC_SETVOIPCHANNELVOLUME ),
 	ENUM_ELEMENT( CLC_CONVERSATIONREPLY ),
 	ENUM_ELEMENT( CLC_CONVERSATIONCLOSE ),
+	ENUM_ELEMENT( CLC_PACKETACK ),
+	ENUM_ELEMENT( CLC_PLAYERMOVEMENTACK ),
 
 	ENUM_ELEMENT( NUM_CLIENT_COMMANDS )
 }
@@ -180,6 +180,16 @@ int NETWORK_StopTrafficMeasurement ( )
 	return g_OutboundBytesMeasured;
 }
 
+//*****************************************************************************
+//
+// Counts bytes that are sent without being written by NETWORK_Write* right now.
+//
+void NETWORK_AddToTrafficMeasurement ( int NumBytes )
+{
+	if ( g_MeasuringOutboundTraffic )
+		g_OutboundBytesMeasured += NumBytes;
+}
+
 //================================================================================
 // IO read functions
 //================================================================================
@@ -1072,6 +1082,135 @@ time_t IPFileParser::readExpirationDate( FILE *pFile )
 	return mktime( pTimeInfo );
 }
 
+//*****************************************************************************
+//
+// Converts an octet string the way IPStringArray::SetFrom would have written it into its
+// value. Returns false for anything else (wildcards, leading zeros, garbage), since such a string
+// can never compare equal to the octet of a real address.
+static bool networkshared_ParseOctet( const char *pszOctet, BYTE &octet )
+{
+	const size_t length = strlen( pszOctet );
+
+	if (( length == 0 ) || ( length > 3 ) || (( length > 1 ) && ( pszOctet[0] == '0' )))
+		return false;
+
+	int value = 0;
+	for ( size_t i = 0; i < length; ++i )
+	{
+		if (( pszOctet[i] < '0' ) || ( pszOctet[i] > '9' ))
+			return false;
+
+		value = value * 10 + ( pszOctet[i] - '0' );
+	}
+
+	if ( value > 255 )
+		return false;
+
+	octet = static_cast<BYTE>( value );
+	return true;
+}
+
+//*****************************************************************************
+//
+// Returns the node for the given octet below node, or 0 if there is none (the root is
+// never anybody's child).
+unsigned int IPList::getIndexChild( const IndexNode &node, BYTE octet ) const
+{
+	const auto it = std::lower_bound( node.children.begin(), node.children.end(), std::make_pair( octet, 0u ));
+	return (( it != node.children.end( )) && ( it->first == octet )) ? it->second : 0;
+}
+
+//*****************************************************************************
+//
+// Builds the octet trie from scratch. Entries that contain an octet that isn't a wildcard
+// and isn't a plain number can only match addresses given as such odd strings too. Those are
+// left out, lookups of odd addresses fall back to scanning the list.
+void IPList::rebuildIndex() const
+{
+	_index.clear();
+	_index.push_back( IndexNode( ));
+	_index[0].wildcardChild = 0;
+	_index[0].firstEntry = static_cast<ULONG>( _ipVector.size( ));
+
+	for ( ULONG ulIdx = 0; ulIdx < _ipVector.size( ); ulIdx++ )
+	{
+		const IPStringArray &szIP = _ipVector[ulIdx].szIP;
+		unsigned int octetKey[4];
+		bool bIndexable = true;
+
+		// Match what IPStringArray::Matches treats as a wildcard.
+		for ( int i = 0; ( i < 4 ) && bIndexable; ++i )
+		{
+			BYTE octet;
+
+			if ( szIP[i][0] == '*' )
+				octetKey[i] = 256;
+			else if ( networkshared_ParseOctet( szIP[i], octet ))
+				octetKey[i] = octet;
+			else
+				bIndexable = false;
+		}
+
+		if ( bIndexable == false )
+			continue;
+
+		unsigned int nodeIdx = 0;
+		for ( int i = 0; i < 4; ++i )
+		{
+			unsigned int childIdx = ( octetKey[i] == 256 ) ? _index[nodeIdx].wildcardChild : getIndexChild( _index[nodeIdx], static_cast<BYTE>( octetKey[i] ));
+
+			if ( childIdx == 0 )
+			{
+				childIdx = static_cast<unsigned int>( _index.size( ));
+				_index.push_back( IndexNode( ));
+				_index[childIdx].wildcardChild = 0;
+				_index[childIdx].firstEntry = static_cast<ULONG>( _ipVector.size( ));
+
+				// Careful, push_back may have moved the parent.
+				IndexNode &parent = _index[nodeIdx];
+				if ( octetKey[i] == 256 )
+					parent.wildcardChild = childIdx;
+				else
+				{
+					const auto child = std::make_pair( static_cast<BYTE>( octetKey[i] ), childIdx );
+					parent.children.insert( std::lower_bound( parent.children.begin( ), parent.children.end( ), child ), child );
+				}
+			}
+
+			nodeIdx = childIdx;
+		}
+
+		// Entries are visited in order, so the first one to reach a leaf is the first match.
+		if ( _index[nodeIdx].firstEntry == _ipVector.size( ))
+			_index[nodeIdx].firstEntry = ulIdx;
+	}
+
+	_indexDirty = false;
+}
+
+//*****************************************************************************
+//
+// Returns the smallest index of an entry below nodeIdx that matches the remaining octets,
+// or size() if there is none. With exactOnly, wildcard entries are ignored.
+ULONG IPList::findInIndex( const BYTE *octets, unsigned int nodeIdx, int depth, bool exactOnly ) const
+{
+	const IndexNode &node = _index[nodeIdx];
+
+	if ( depth == 4 )
+		return node.firstEntry;
+
+	ULONG ulFirst = size( );
+
+	const unsigned int childIdx = getIndexChild( node, octets[depth] );
+	if ( childIdx != 0 )
+		ulFirst = findInIndex( octets, childIdx, depth + 1, exactOnly );
+
+	if (( exactOnly == false ) && ( node.wildcardChild != 0 ))
+		ulFirst = (std::min)( ulFirst, findInIndex( octets, node.wildcardChild, depth + 1, exactOnly ));
+
+	return ulFirst;
+}
+
 //*****************************************************************************
 //
 void IPList::copy( IPList &destination )
@@ -1095,6 +1234,7 @@ bool IPList::clearAndLoadFromFile( const char *Filename )
 	IPFileParser parser( 65536 );
 
 	success = parser.parseIPList( Filename, _ipVector );
+	_indexDirty = true;
 	if ( !success )
 		_error = parser.getErrorMessage();
 
@@ -1148,6 +1288,17 @@ void IPList::removeExpiredEntries( void )
 //
 ULONG IPList::getFirstMatchingEntryIndex( const IPStringArray &szAddress ) const
 {
+	// Addresses made from a NETADDRESS_s (i.e. nearly all of them) can use the index.
+	BYTE octets[4];
+	if ( networkshared_ParseOctet( szAddress[0], octets[0] ) && networkshared_ParseOctet( szAddress[1], octets[1] )
+		&& networkshared_ParseOctet( szAddress[2], octets[2] ) && networkshared_ParseOctet( szAddress[3], octets[3] ))
+	{
+		if ( _indexDirty )
+			rebuildIndex( );
+
+		return findInIndex( octets, 0, 0, false );
+	}
+
 	for ( ULONG ulIdx = 0; ulIdx < _ipVector.size(); ulIdx++ )
 	{
 		if ( szAddress.Matches ( _ipVector[ulIdx].szIP ) )
@@ -1220,9 +1371,11 @@ IPADDRESSBAN_s IPList::getEntry( const ULONG ulIdx ) const
 //
 ULONG IPList::getEntryIndex( const NETADDRESS_s &Address ) const
 {
-	IPStringArray szAddress;
-	szAddress.SetFrom ( Address );
-	return doesEntryExist( szAddress );
+	// Only entries without wildcards can be equal to an actual address.
+	if ( _indexDirty )
+		rebuildIndex( );
+
+	return findInIndex( Address.abIP, 0, 0, true );
 }
 
 //*****************************************************************************
@@ -1333,6 +1486,7 @@ void IPList::addEntry( const IPStringArray &szAddress, const char *pszPlayerName
 	newIPEntry.szComment[127] = 0;
 	newIPEntry.tExpirationDate = tExpiration;
 	_ipVector.push_back( newIPEntry );
+	_indexDirty = true;
 
 	// Finally, append the IP to the file.
 	if ( (pFile = fopen( _filename.c_str(), "a" )) )
@@ -1402,6 +1556,7 @@ void IPList::removeEntry( ULONG ulEntryIdx )
 			_ipVector[ulIdx] = _ipVector[ulIdx+1];
 
 	_ipVector.pop_back();
+	_indexDirty = true;
 	rewriteListToFile ();
 }
 
@@ -1488,12 +1643,127 @@ struct ASCENDINGIPSORT_S
 void IPList::sort()
 {
 	std::sort( _ipVector.begin(), _ipVector.end(), ASCENDINGIPSORT_S() );
+	_indexDirty = true;
 }
 
 //=============================================================================
 // QueryIPQueue
 //=============================================================================
 
+//=============================================================================
+//
+// getKey
+//
+// Returns the IP of the address (ignoring the port) as a single number.
+//
+//=============================================================================
+
+unsigned int QueryIPQueue::getKey( const NETADDRESS_s &Address )
+{
+	return ( static_cast<unsigned int>( Address.abIP[0] ) << 24 ) | ( static_cast<unsigned int>( Address.abIP[1] ) << 16 )
+		| ( static_cast<unsigned int>( Address.abIP[2] ) << 8 ) | static_cast<unsigned int>( Address.abIP[3] );
+}
+
+//=============================================================================
+//
+// getHomeSlot
+//
+// Returns the slot where the search for the given IP starts (Fibonacci hashing).
+//
+//=============================================================================
+
+unsigned int QueryIPQueue::getHomeSlot( const unsigned int ip )
+{
+	return (( ip * 2654435769u ) >> 22 ) & ( NUM_HASH_SLOTS - 1 );
+}
+
+//=============================================================================
+//
+// findSlot
+//
+// Returns the slot that holds the given IP, or NUM_HASH_SLOTS if it's not in the queue.
+//
+//=============================================================================
+
+unsigned int QueryIPQueue::findSlot( const unsigned int ip ) const
+{
+	// There are always empty slots, so this terminates.
+	for ( unsigned int i = getHomeSlot( ip ); _hashSlots[i].count != 0; i = ( i + 1 ) & ( NUM_HASH_SLOTS - 1 ))
+	{
+		if ( _hashSlots[i].ip == ip )
+			return i;
+	}
+
+	return NUM_HASH_SLOTS;
+}
+
+//=============================================================================
+//
+// insertIP
+//
+// Counts one more queue entry for the given IP.
+//
+//=============================================================================
+
+void QueryIPQueue::insertIP( const unsigned int ip )
+{
+	unsigned int i = getHomeSlot( ip );
+
+	while (( _hashSlots[i].count != 0 ) && ( _hashSlots[i].ip != ip ))
+		i = ( i + 1 ) & ( NUM_HASH_SLOTS - 1 );
+
+	_hashSlots[i].ip = ip;
+	_hashSlots[i].count++;
+}
+
+//=============================================================================
+//
+// releaseIP
+//
+// Counts one queue entry less for the given IP and removes it from the hash set once no
+// entry is left. Uses backward shift deletion, so no tombstones are needed.
+//
+//=============================================================================
+
+void QueryIPQueue::releaseIP( const unsigned int ip )
+{
+	unsigned int hole = findSlot( ip );
+
+	if ( hole == NUM_HASH_SLOTS )
+		return;
+
+	if ( --_hashSlots[hole].count != 0 )
+		return;
+
+	for ( unsigned int i = ( hole + 1 ) & ( NUM_HASH_SLOTS - 1 ); _hashSlots[i].count != 0; i = ( i + 1 ) & ( NUM_HASH_SLOTS - 1 ))
+	{
+		// Move the entry into the hole, unless its home slot lies cyclically in (hole, i].
+		const unsigned int home = getHomeSlot( _hashSlots[i].ip );
+		const bool bHomeAfterHole = ( i > hole ) ? (( home > hole ) && ( home <= i )) : (( home > hole ) || ( home <= i ));
+
+		if ( bHomeAfterHole == false )
+		{
+			_hashSlots[hole] = _hashSlots[i];
+			_hashSlots[i].count = 0;
+			hole = i;
+		}
+	}
+}
+
+//=============================================================================
+//
+// advanceHead
+//
+// Drops the oldest entry.
+//
+//=============================================================================
+
+void QueryIPQueue::advanceHead( )
+{
+	releaseIP( getKey( _IPQueue[_queueHead].Address ));
+	_queueHead = ( _queueHead + 1 ) % MAX_QUERY_IPS;
+}
+
 //=============================================================================
 //
 // adjustHead
@@ -1505,7 +1775,7 @@ void IPList::sort()
 void QueryIPQueue::adjustHead( const unsigned long currentTime )
 {
 	while (( _queueHead != _queueTail ) && ( currentTime >= _IPQueue[_queueHead].nextAllowedTime ))
-		_queueHead = ( _queueHead + 1 ) % MAX_QUERY_IPS;
+		advanceHead( );
 }
 
 //=============================================================================
@@ -1518,15 +1788,7 @@ void QueryIPQueue::adjustHead( const unsigned long currentTime )
 
 bool QueryIPQueue::addressInQueue( const NETADDRESS_s AddressFrom ) const
 {
-	// Search through the queue.
-	for ( unsigned int i = _queueHead; i != _queueTail; i = ( i + 1 ) % MAX_QUERY_IPS )
-	{
-		if ( AddressFrom.CompareNoPort( _IPQueue[i].Address ))
-			return true;
-	}
-
-	// Not found, or the queue is empty.
-	return false;
+	return ( findSlot( getKey( AddressFrom )) != NUM_HASH_SLOTS );
 }
 
 //=============================================================================
@@ -1557,6 +1819,7 @@ void QueryIPQueue::addAddress( const NETADDRESS_s AddressFrom, const unsigned lo
 	_IPQueue[_queueTail].Address = AddressFrom;
 	_IPQueue[_queueTail].nextAllowedTime = currentTime + _entryLength;
 	_queueTail = ( _queueTail + 1 ) % MAX_QUERY_IPS;
+	insertIP( getKey( AddressFrom ));
 
 	// Is the queue full?
 	if ( _queueTail == _queueHead )
@@ -1564,6 +1827,6 @@ void QueryIPQueue::addAddress( const NETADDRESS_s AddressFrom, const unsigned lo
 		if ( errorOut )
 			*errorOut << "WARNING! The IP flood queue is full.\n";
 
-		_queueHead = ( _queueHead + 1 ) % MAX_QUERY_IPS; // [RC] Start removing older entries.
+		advanceHead( ); // [RC] Start removing older entries.
 	}
 }
@@ -399,12 +399,25 @@ struct NETBUFFER_s
 	LONG			WriteTo( BYTESTREAM_s &ByteStream ) const;
 };
 
+//*****************************************************************************
+// A part of a packet. A packet can be sent from several parts without copying
+// them into one buffer first.
+struct NETPACKETSEGMENT_s
+{
+	// The data of this part.
+	const BYTE		*pbData;
+
+	// How many bytes of data there are.
+	ULONG			ulSize;
+};
+
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 //-- PROTOTYPES ------------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
 void			NETWORK_StartTrafficMeasurement ( );
 int				NETWORK_StopTrafficMeasurement ( );
+void			NETWORK_AddToTrafficMeasurement ( int NumBytes );
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 //-- CLASSES ---------------------------------------------------------------------------------------------------------------------------------------
@@ -464,10 +477,23 @@ private:
 
 class IPList
 {
+	// A node of the octet trie that indexes _ipVector. Wildcard octets get their own child,
+	// the leaves (depth 4) know the first entry that has exactly their pattern.
+	struct IndexNode
+	{
+		std::vector<std::pair<BYTE, unsigned int> >	children; // Sorted by octet.
+		unsigned int								wildcardChild;
+		ULONG										firstEntry;
+	};
+
 	std::vector<IPADDRESSBAN_s>		_ipVector;
 	std::string						_filename;
 	std::string						_error;
 
+	// Rebuilt lazily on the first lookup after _ipVector changed.
+	mutable std::vector<IndexNode>	_index;
+	mutable bool					_indexDirty = true;
+
 //*************************************************************************
 public:
 	bool			clearAndLoadFromFile( const char *Filename );
@@ -491,16 +517,20 @@ public:
 	void			removeExpiredEntries( void ); // [RC]
 
 	unsigned int	size() const { return static_cast<unsigned int>( _ipVector.size( )); }
-	void			clear() { _ipVector.clear(); }
-	void			push_back ( IPADDRESSBAN_s &IP ) { _ipVector.push_back(IP); }
+	void			clear() { _ipVector.clear(); _indexDirty = true; }
+	void			push_back ( IPADDRESSBAN_s &IP ) { _ipVector.push_back(IP); _indexDirty = true; }
 	const char		*getErrorMessage() const { return _error.c_str(); }
 	const char		*getFilename() const { return _filename.c_str(); } // [AK]
 
-	std::vector<IPADDRESSBAN_s>&	getVector() { return _ipVector; }
+	// The caller may change the entries, so the index has to be rebuilt afterwards.
+	std::vector<IPADDRESSBAN_s>&	getVector() { _indexDirty = true; return _ipVector; }
 
 //*************************************************************************
 private:
 	bool rewriteListToFile ();
+	void rebuildIndex () const;
+	unsigned int getIndexChild ( const IndexNode &node, BYTE octet ) const;
+	ULONG findInIndex ( const BYTE *octets, unsigned int nodeIdx, int depth, bool exactOnly ) const;
 };
 
 //==========================================================================
@@ -525,12 +555,26 @@ class QueryIPQueue
 
 	};
 
+	// A slot of the hash set of IPs in the queue. An IP can be in the queue more than once,
+	// so we count how often. Slots with a count of zero are empty.
+	struct QUERY_IP_SLOT_t
+	{
+		unsigned int		ip;
+		unsigned int		count;
+	};
+
 	// The maximum number of entries that we can store.
 	static const unsigned int	MAX_QUERY_IPS = 512;
 
+	// Number of hash slots, a power of two that keeps the load factor at 1/2 or below.
+	static const unsigned int	NUM_HASH_SLOTS = 1024;
+
 	// The array of IPs.
 	STORED_QUERY_IP_t			_IPQueue[MAX_QUERY_IPS];
 
+	// Open addressing (linear probing) hash set of the IPs between head and tail.
+	QUERY_IP_SLOT_t				_hashSlots[NUM_HASH_SLOTS];
+
 	// Head and tail of the queue.
 	unsigned int				_queueHead;
 	unsigned int				_queueTail;
@@ -538,10 +582,19 @@ class QueryIPQueue
 	// How long entries will last (seconds).
 	unsigned int				_entryLength;
 
+	static unsigned int	getKey( const NETADDRESS_s &Address );
+	static unsigned int	getHomeSlot( const unsigned int ip );
+	unsigned int		findSlot( const unsigned int ip ) const;
+	void				insertIP( const unsigned int ip );
+	void				releaseIP( const unsigned int ip );
+	void				advanceHead( );
+
 //*************************************************************************
 public:
 	QueryIPQueue( int entryLength ) : _queueHead( 0 ), _queueTail( 0 ), _entryLength( entryLength )
 	{
+		for ( unsigned int i = 0; i < NUM_HASH_SLOTS; ++i )
+			_hashSlots[i].count = 0;
 	}
 
 	void	adjustHead( const unsigned long currentTime );
@@ -96,6 +96,7 @@
 #include "sv_ban.h"
 #include "joinqueue.h"
 #include "domination.h" // [TRSR]
+#include "sv_profile.h"
 
 #include "g_shared/a_pickups.h"
 
@@ -3598,6 +3599,9 @@ void DACSThinker::Serialize (FArchive &arc)
 
 void DACSThinker::Tick ()
 {
+	// Measure the time the scripts take for the server tic profile.
+	FServerProfileScope ProfileScope( SPS_ACS );
+
 	DLevelScript *script = Scripts;
 
 	while (script)
@@ -11302,6 +11306,8 @@ scriptwait:
 						SERVERCOMMANDS_SetSomeLineFlags( line );
 				}
 
+				// The flags may block sight now.
+				P_InvalidateSightCache ();
 				sp -= 2;
 			}
 			break;
@@ -1398,13 +1398,15 @@ bool P_LookForMonsters (AActor *actor)
 AActor *LookForTIDInBlock (AActor *lookee, int index, void *extparams)
 {
 	FLookExParams *params = (FLookExParams *)extparams;
-	FBlockNode *block;
+	FBlockLinks *block = &blocklinks[index];
 	AActor *link;
 	AActor *other;
 	
-	for (block = blocklinks[index]; block != NULL; block = block->NextActor)
+	for (int i = block->Things.Size() - 1; i >= 0; --i)
 	{
-		link = block->Me;
+		// Unlinked actors leave an empty entry.
+		if ((link = block->Things[i].Me) == NULL)
+			continue;
 
         if (!(link->flags & MF_SHOOTABLE))
 			continue;			// not shootable (observer or dead)
@@ -1568,14 +1570,16 @@ bool P_LookForTID (AActor *actor, INTBOOL allaround, FLookExParams *params)
 
 AActor *LookForEnemiesInBlock (AActor *lookee, int index, void *extparam)
 {
-	FBlockNode *block;
+	FBlockLinks *block = &blocklinks[index];
 	AActor *link;
 	AActor *other;
 	FLookExParams *params = (FLookExParams *)extparam;
 	
-	for (block = blocklinks[index]; block != NULL; block = block->NextActor)
+	for (int i = block->Things.Size() - 1; i >= 0; --i)
 	{
-		link = block->Me;
+		// Unlinked actors leave an empty entry.
+		if ((link = block->Things[i].Me) == NULL)
+			continue;
 
         if (!(link->flags & MF_SHOOTABLE))
 			continue;			// not shootable (observer or dead)
@@ -36,6 +36,8 @@
 #include "templates.h"
 #include "p_local.h"
 #include "p_lnspec.h"
+// New #includes.
+#include "unlagged.h"
 
 enum
 {
@@ -99,6 +101,8 @@ static bool MoveCeiling(sector_t *sector, int crush, fixed_t move)
 
 	// [BB] Ceiling height was changed.
 	sector->bCeilingHeightChange = true;
+	// Unlagged needs to record the heights of this sector now.
+	UNLAGGED_SectorMoved( sector );
 
 	if (P_ChangeSector(sector, crush, move, 1, true)) return false;
 
@@ -117,6 +121,8 @@ static bool MoveFloor(sector_t *sector, int crush, fixed_t move)
 
 	// [BB] Floor height was changed.
 	sector->bFloorHeightChange = true;
+	// Unlagged needs to record the heights of this sector now.
+	UNLAGGED_SectorMoved( sector );
 
 	if (P_ChangeSector(sector, crush, move, 0, true)) return false;
 
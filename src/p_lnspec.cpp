@@ -2868,6 +2868,9 @@ FUNC(LS_Line_SetBlocking)
 		if ( NETWORK_GetState() == NETSTATE_SERVER )
 			SERVERCOMMANDS_SetSomeLineFlags( line );
 	}
+
+	// The flags may block sight now.
+	P_InvalidateSightCache ();
 	return true;
 }
 
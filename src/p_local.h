@@ -321,7 +321,8 @@ class FBlockThingsIterator
 
 	int curx, cury;
 
-	FBlockNode *block;
+	FBlockLinks *block;
+	int blockslot;
 
 	int Buckets[32];
 
@@ -462,6 +463,8 @@ enum ESightFlags
 };
 
 void	P_ResetSightCounters (bool full);
+void	P_ResetSightCache ();
+void	P_InvalidateSightCache (); // Must be called when anything that can block sight moves.
 void	P_ResetSpawnCounters( void ); // [BC]
 bool	P_TalkFacing (AActor *player);
 void	P_UseLines (player_t* player);
@@ -579,7 +582,9 @@ extern int				bmapwidth;
 extern int				bmapheight; 	// in mapblocks
 extern fixed_t			bmaporgx;
 extern fixed_t			bmaporgy;		// origin of block map
-extern FBlockNode**		blocklinks; 	// for thing chains
+extern FBlockLinks*		blocklinks; 	// for thing chains
+
+void P_CompactBlockLinks ();
 
 
 
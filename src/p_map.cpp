@@ -66,6 +66,8 @@
 #include "unlagged.h"
 #include "d_netinf.h"
 #include "v_video.h"
+#include "stats.h"
+#include "benchmark.h"
 
 // [BB] Helper function to handle ZADF_UNBLOCK_PLAYERS.
 bool P_CheckUnblock ( AActor *pActor1, AActor *pActor2 )
@@ -102,6 +104,9 @@ static FRandom pr_tracebleed("TraceBleed");
 static FRandom pr_checkthing("CheckThing");
 static FRandom pr_lineattack("LineAttack");
 static FRandom pr_crunch("DoCrunch");
+#if BUILD_ID != BUILD_RELEASE
+static FRandom pr_checkpositionbenchmark("CheckPositionBenchmark");
+#endif
 
 static int		tmunstuck;     /* killough 8/1/98: whether to allow unsticking */
 
@@ -6498,6 +6503,9 @@ bool P_ChangeSector(sector_t *sector, int crunch, int amt, int floorOrCeil, bool
 	void(*iterator2)(AActor *, FChangePosition *) = NULL;
 	msecnode_t *n;
 
+	// Sight checks through this sector may turn out differently now.
+	P_InvalidateSightCache ();
+
 	cpos.nofit = false;
 	cpos.crushchange = crunch;
 	cpos.moveamt = abs(amt);
@@ -7049,3 +7057,86 @@ bool P_ActivateThingSpecial(AActor * thing, AActor * trigger, bool death)
 	// Returns the result
 	return res;
 }
+
+//*****************************************************************************
+//
+#if BUILD_ID != BUILD_RELEASE
+// Spawns a crowd of solid actors all over the map, moves them around a little
+// for some tics and times P_CheckPosition and the relinking into the blockmap.
+// Usage: benchmark checkposition [actors] [tics]
+BENCHMARK( checkposition )
+{
+	// Every actor takes a network ID, and a server quits when it runs out of them.
+	if (( gamestate != GS_LEVEL ) || NETWORK_InClientMode( ) || ( NETWORK_GetState( ) == NETSTATE_SERVER ) || ( blocklinks == NULL ))
+	{
+		Printf( "A level must be running, and this can't be a client or a server.\n" );
+		return;
+	}
+
+	const int maxActors = MIN<int>( 100000, g_ActorNetIDList.countFreeIDs( ) / 2 );
+	if ( maxActors < 1 )
+	{
+		Printf( "There are not enough free network IDs.\n" );
+		return;
+	}
+
+	const int numActors = ( argv.argc( ) > 1 ) ? clamp( atoi( argv[1] ), 1, maxActors ) : MIN( 5000, maxActors );
+	const int numTics = ( argv.argc( ) > 2 ) ? clamp( atoi( argv[2] ), 1, 3500 ) : 35;
+	TArray<AActor *> actors;
+	cycle_t checkTime, moveTime, compactTime;
+	int numChecks = 0;
+	int numMoves = 0;
+
+	checkTime.Reset( );
+	moveTime.Reset( );
+	compactTime.Reset( );
+
+	for ( int i = 0; i < numActors; i++ )
+	{
+		const fixed_t x = bmaporgx + ( pr_checkpositionbenchmark( bmapwidth * MAPBLOCKUNITS ) << FRACBITS );
+		const fixed_t y = bmaporgy + ( pr_checkpositionbenchmark( bmapheight * MAPBLOCKUNITS ) << FRACBITS );
+		AActor *mo = Spawn( RUNTIME_CLASS( AActor ), x, y, ONFLOORZ, NO_REPLACE );
+
+		// Like a monster, as far as P_CheckPosition is concerned.
+		mo->UnlinkFromWorld( );
+		mo->flags |= MF_SOLID|MF_SHOOTABLE;
+		mo->radius = 20 * FRACUNIT;
+		mo->height = 56 * FRACUNIT;
+		mo->LinkToWorld( );
+		actors.Push( mo );
+	}
+
+	for ( int tic = 0; tic < numTics; tic++ )
+	{
+		for ( unsigned int i = 0; i < actors.Size( ); i++ )
+		{
+			AActor *mo = actors[i];
+			const fixed_t x = mo->x + (( pr_checkpositionbenchmark( 33 ) - 16 ) << FRACBITS );
+			const fixed_t y = mo->y + (( pr_checkpositionbenchmark( 33 ) - 16 ) << FRACBITS );
+
+			checkTime.Clock( );
+			const bool bFits = P_CheckPosition( mo, x, y );
+			checkTime.Unclock( );
+			numChecks++;
+
+			// Move them even if they don't fit, they're only here to be moved around.
+			moveTime.Clock( );
+			mo->SetOrigin( x, y, mo->z );
+			moveTime.Unclock( );
+			numMoves += bFits;
+		}
+
+		compactTime.Clock( );
+		P_CompactBlockLinks( );
+		compactTime.Unclock( );
+	}
+
+	for ( unsigned int i = 0; i < actors.Size( ); i++ )
+		actors[i]->Destroy( );
+	P_CompactBlockLinks( );
+
+	Printf( "%d actors, %d tics, %d of %d moves fit.\n", numActors, numTics, numMoves, numChecks );
+	Printf( "P_CheckPosition: %.3f ms (%.3f us per call)\n", checkTime.TimeMS( ), checkTime.TimeMS( ) * 1000 / numChecks );
+	Printf( "Relinking: %.3f ms, compacting the blockmap: %.3f ms\n", moveTime.TimeMS( ), compactTime.TimeMS( ));
+}
+#endif
@@ -47,6 +47,9 @@
 
 static AActor *RoughBlockCheck (AActor *mo, int index, void *);
 
+// The blocks with entries of unlinked actors in them.
+static TArray<int> DirtyBlockLinks;
+
 
 //==========================================================================
 //
@@ -308,11 +311,15 @@ void AActor::UnlinkFromWorld ()
 
 		while (block != NULL)
 		{
-			if (block->NextActor != NULL)
+			// Only clear the entry, P_CompactBlockLinks removes it.
+			FBlockLinks *links = &blocklinks[block->BlockIndex];
+			links->Things[block->BlockSlot].Me = NULL;
+			links->Things[block->BlockSlot].Node = NULL;
+			if (!links->Dirty)
 			{
-				block->NextActor->PrevActor = block->PrevActor;
+				links->Dirty = true;
+				DirtyBlockLinks.Push (block->BlockIndex);
 			}
-			*(block->PrevActor) = block->NextActor;
 			FBlockNode *next = block->NextBlock;
 			block->Release ();
 			block = next;
@@ -411,16 +418,12 @@ void AActor::LinkToWorld (sector_t *sec)
 			{
 				for (int x = x1; x <= x2; ++x)
 				{
-					FBlockNode **link = &blocklinks[y*bmapwidth + x];
+					FBlockLinks *links = &blocklinks[y*bmapwidth + x];
 					FBlockNode *node = FBlockNode::Create (this, x, y);
 
 					// Link in to block
-					if ((node->NextActor = *link) != NULL)
-					{
-						(*link)->PrevActor = &node->NextActor;
-					}
-					node->PrevActor = link;
-					*link = node;
+					FBlockThing thing = { this, node };
+					node->BlockSlot = links->Things.Push (thing);
 
 					// Link in to actor
 					node->PrevBlock = alink;
@@ -627,9 +630,8 @@ FBlockNode *FBlockNode::Create (AActor *who, int x, int y)
 		block = new FBlockNode;
 	}
 	block->BlockIndex = x + y*bmapwidth;
+	block->BlockSlot = -1;
 	block->Me = who;
-	block->NextActor = NULL;
-	block->PrevActor = NULL;
 	block->PrevBlock = NULL;
 	block->NextBlock = NULL;
 	return block;
@@ -641,6 +643,45 @@ void FBlockNode::Release ()
 	FreeBlocks = this;
 }
 
+//==========================================================================
+//
+// P_CompactBlockLinks
+//
+// Removes the entries of unlinked actors from the blocks. This moves the
+// others, so it must not be called while anything loops over a block.
+//
+//==========================================================================
+
+void P_CompactBlockLinks ()
+{
+	const int count = bmapwidth*bmapheight;
+
+	for (unsigned int i = 0; i < DirtyBlockLinks.Size(); ++i)
+	{
+		// The list may still have blocks of the previous level.
+		if (blocklinks == NULL || DirtyBlockLinks[i] >= count || !blocklinks[DirtyBlockLinks[i]].Dirty)
+		{
+			continue;
+		}
+
+		FBlockLinks *links = &blocklinks[DirtyBlockLinks[i]];
+		unsigned int numthings = 0;
+
+		for (unsigned int j = 0; j < links->Things.Size(); ++j)
+		{
+			if (links->Things[j].Me != NULL)
+			{
+				links->Things[numthings] = links->Things[j];
+				links->Things[numthings].Node->BlockSlot = numthings;
+				numthings++;
+			}
+		}
+		links->Things.Resize (numthings);
+		links->Dirty = false;
+	}
+	DirtyBlockLinks.Clear();
+}
+
 //
 // BLOCK MAP ITERATORS
 // For each line/thing in the given mapblock,
@@ -789,6 +830,7 @@ FBlockThingsIterator::FBlockThingsIterator()
 	miny = maxy = 0;
 	ClearHash();
 	block = NULL;
+	blockslot = 0;
 }
 
 FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int _maxy)
@@ -838,12 +880,14 @@ void FBlockThingsIterator::StartBlock(int x, int y)
 	cury = y; 
 	if (x >= 0 && y >= 0 && x < bmapwidth && y <bmapheight)
 	{
-		block = blocklinks[y*bmapwidth + x];
+		block = &blocklinks[y*bmapwidth + x];
+		blockslot = block->Things.Size();
 	}
 	else
 	{
 		// invalid block
 		block = NULL;
+		blockslot = 0;
 	}
 }
 
@@ -870,14 +914,20 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 {
 	for (;;)
 	{
-		while (block != NULL)
+		while (blockslot > 0)
 		{
-			AActor *me = block->Me;
-			FBlockNode *mynode = block;
+			// Actors linked in since this block was started are at the end and not
+			// returned anymore, actors unlinked since then have an empty entry.
+			const FBlockThing &thing = block->Things[--blockslot];
+			AActor *me = thing.Me;
+			FBlockNode *mynode = thing.Node;
 			HashEntry *entry;
 			int i;
 
-			block = block->NextActor;
+			if (me == NULL)
+			{
+				continue;
+			}
 			// Don't recheck things that were already checked
 			if (mynode->NextBlock == NULL && mynode->PrevBlock == &me->BlockNode)
 			{ // This actor doesn't span blocks, so we know it can only ever be checked once.
@@ -1522,19 +1572,21 @@ AActor *P_BlockmapSearch (AActor *mo, int distance, AActor *(*check)(AActor*, in
 static AActor *RoughBlockCheck (AActor *mo, int index, void *param)
 {
 	bool onlyseekable = param != NULL;
-	FBlockNode *link;
+	FBlockLinks *links = &blocklinks[index];
 
-	for (link = blocklinks[index]; link != NULL; link = link->NextActor)
+	for (int i = links->Things.Size() - 1; i >= 0; --i)
 	{
-		if (link->Me != mo)
+		AActor *link = links->Things[i].Me;
+
+		if (link != NULL && link != mo)
 		{
-			if (onlyseekable && !mo->CanSeek(link->Me))
+			if (onlyseekable && !mo->CanSeek(link))
 			{
 				continue;
 			}
-			if (mo->IsOkayToAttack (link->Me))
+			if (mo->IsOkayToAttack (link))
 			{
-				return link->Me;
+				return link;
 			}
 		}
 	}
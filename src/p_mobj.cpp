@@ -3958,6 +3958,9 @@ void AActor::Tick ()
 	// [BB] Start to measure how much outbound net traffic this call of AActor::Tick() needs.
 	NETWORK_StartTrafficMeasurement ( );
 
+	// The commands sent while this actor ticks are always counted for its class.
+	FNetTrafficActorScope TrafficScope ( this );
+
 	// [RH] Data for Heretic/Hexen scrolling sectors
 	static const BYTE HexenScrollDirs[8] = { 64, 0, 192, 128, 96, 32, 224, 160 };
 	static const BYTE HexenSpeedMuls[3] = { 5, 10, 25 };
@@ -4826,6 +4829,23 @@ unsigned short IDList<T>::getNewID( void )
 	return ( id );
 }
 
+//*****************************************************************************
+//
+template <typename T>
+unsigned int IDList<T>::countFreeIDs( void ) const
+{
+	unsigned int numFree = 0;
+
+	// [BB] ID zero is reserved.
+	for ( unsigned int i = 1; i <= ( std::numeric_limits<unsigned short>::max )( ); i++ )
+	{
+		if ( _entries[i].bFree )
+			numFree++;
+	}
+
+	return ( numFree );
+}
+
 template class IDList<AActor>;
 
 // [BB] AActor::FreeNetID
@@ -0,0 +1,731 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: p_reject.cpp
+//
+// Description: Builds a REJECT matrix for maps that don't ship a usable one.
+//
+// Sight is only blocked by one-sided lines in the map plane (heights and polyobjects
+// can only block it further), so two sectors can't see each other if no straight line
+// leads from one to the other through two-sided lines only. The sectors are the cells
+// and the two-sided lines the portals between them. For each sector, the portals a
+// line of sight could pass through are followed like Quake's vis does it: the windings
+// of the portals are clipped by the separating lines between the first portal and the
+// last one. Everything is clipped with a small margin, so the matrix never rejects a
+// pair that the full sight check would allow.
+//
+// The sectors are processed in parallel, and the result is cached on disk, keyed by
+// the map's checksum.
+//
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <limits.h>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <zlib.h>
+#include "doomtype.h"
+#include "doomdef.h"
+#include "templates.h"
+#include "p_local.h"
+#include "p_setup.h"
+#include "r_state.h"
+#include "c_cvars.h"
+#include "cmdlib.h"
+#include "m_misc.h"
+#include "m_swap.h"
+#include "i_system.h"
+#include "network.h"
+
+//*****************************************************************************
+//	DEFINES
+
+// Change this when the builder changes, so that old cache files aren't used anymore.
+#define	REJECT_CACHE_VERSION		1
+
+// Points this close (in map units) to the wrong side of a clipping line are kept.
+#define	REJECT_EPSILON				( 1.0 / 16 )
+
+// Separating lines through points closer than this (in map units) aren't used.
+#define	REJECT_MIN_SEPARATOR_LENGTH	1.0
+
+// How much further (in map units) a window is widened when two flows through a portal are merged.
+#define	REJECT_MERGE_GROWTH			8.0
+
+// How many portals the flow out of one sector may visit, and how long a chain of portals
+// may get, before we give up and let the sector see everything it's connected to.
+#define	REJECT_MAX_PORTALS_PER_SECTOR	( 1 << 20 )
+#define	REJECT_MAX_DEPTH				1024
+
+// Maps with more sectors don't get a REJECT built. The matrix grows with the square of
+// the number of sectors (8 MB at this limit), and so does the time the flow can take.
+#define	REJECT_MAX_SECTORS				8192
+
+//*****************************************************************************
+//	STRUCTURES
+
+// A point in map units.
+typedef struct
+{
+	double			x;
+	double			y;
+
+} REJECTPOINT_s;
+
+// A segment that a line of sight could still pass through.
+typedef struct
+{
+	REJECTPOINT_s	Start;
+	REJECTPOINT_s	End;
+
+} REJECTWINDING_s;
+
+// A two-sided line, seen from one side. It leads into the sector on the left of Start -> End.
+typedef struct
+{
+	REJECTWINDING_s	Winding;
+	ULONG			ulFromSector;
+	ULONG			ulToSector;
+	ULONG			ulLine;
+
+} REJECTPORTAL_s;
+
+// The widest windows a flow has left on a portal so far.
+typedef struct
+{
+	REJECTWINDING_s	Source;
+	REJECTWINDING_s	Pass;
+
+	// The flow they belong to.
+	ULONG			ulRoot;
+
+} REJECTFLOWSTATE_s;
+
+//*****************************************************************************
+//	VARIABLES
+
+// Build a REJECT for maps that don't have one. Clients never do, they leave the sight
+// checks that matter to the server.
+CVAR( Bool, genreject, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG )
+
+// All portals, sorted by the sector they lead out of.
+static	TArray<REJECTPORTAL_s>	g_RejectPortals;
+static	TArray<ULONG>			g_ulFirstSectorPortal;
+
+// Which sectors are connected through portals at all.
+static	TArray<ULONG>			g_ulSectorComponent;
+
+// One row per sector, a bit is set for each sector it may be able to see.
+static	TArray<BYTE>			g_RejectVisibility;
+static	ULONG					g_ulRejectRowSize;
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	double	reject_PointSide( const REJECTWINDING_s &Line, const REJECTPOINT_s &Point );
+static	bool	reject_ClipWinding( REJECTWINDING_s &Winding, const REJECTWINDING_s &Line, bool bKeepLeft );
+static	bool	reject_ClipToSeparators( const REJECTWINDING_s &Source, const REJECTWINDING_s &Pass, REJECTWINDING_s &Target );
+static	bool	reject_MergeWinding( REJECTWINDING_s &Winding, const REJECTWINDING_s &Other, const REJECTWINDING_s &Line );
+
+//*****************************************************************************
+//	CLASSES
+
+// Follows the portals out of one sector at a time, each thread has its own.
+class FRejectFlow
+{
+public:
+	FRejectFlow( ) : m_ulSector( 0 ), m_ulRoot( 0 ), m_ulNumVisited( 0 ), m_bGaveUp( false )
+	{
+		m_States.Resize( g_RejectPortals.Size( ));
+		for ( unsigned int i = 0; i < m_States.Size( ); i++ )
+			m_States[i].ulRoot = 0;
+	}
+
+	void FlowSector( const ULONG ulSector )
+	{
+		m_ulSector = ulSector;
+		m_ulNumVisited = 0;
+		m_bGaveUp = false;
+		setVisible( ulSector );
+
+		for ( ULONG ulIdx = g_ulFirstSectorPortal[ulSector]; ( ulIdx < g_ulFirstSectorPortal[ulSector + 1] ) && ( m_bGaveUp == false ); ulIdx++ )
+		{
+			const REJECTPORTAL_s &Portal = g_RejectPortals[ulIdx];
+
+			m_ulRoot++;
+			flow( Portal.Winding, Portal, Portal.Winding, ulIdx, 0 );
+		}
+	}
+
+private:
+	ULONG						m_ulSector;
+	ULONG						m_ulRoot;
+	ULONG						m_ulNumVisited;
+	bool						m_bGaveUp;
+	TArray<REJECTFLOWSTATE_s>	m_States;
+
+	void setVisible( const ULONG ulTarget )
+	{
+		g_RejectVisibility[m_ulSector * g_ulRejectRowSize + ( ulTarget >> 3 )] |= ( 1 << ( ulTarget & 7 ));
+	}
+
+	// Too expensive to follow, so the sector may see everything it's connected to.
+	void giveUp( )
+	{
+		for ( ULONG ulIdx = 0; ulIdx < static_cast<ULONG>( numsectors ); ulIdx++ )
+		{
+			if ( g_ulSectorComponent[ulIdx] == g_ulSectorComponent[m_ulSector] )
+				setVisible( ulIdx );
+		}
+
+		m_bGaveUp = true;
+	}
+
+	// A line of sight came through the source portal and may cross the pass portal
+	// where its winding still is, so it can reach the sector behind the pass portal.
+	void flow( REJECTWINDING_s Source, const REJECTPORTAL_s &SourcePortal, REJECTWINDING_s Pass, const ULONG ulPassPortal, const int iDepth )
+	{
+		const REJECTPORTAL_s &PassPortal = g_RejectPortals[ulPassPortal];
+		REJECTFLOWSTATE_s &State = m_States[ulPassPortal];
+
+		// Many chains of portals lead to the same one, especially in open areas. Only
+		// the windows they leave on the source and the pass matter for what comes after
+		// it, so they are merged. This only lets more lines of sight through.
+		if ( State.ulRoot == m_ulRoot )
+		{
+			const bool bGrewSource = reject_MergeWinding( State.Source, Source, SourcePortal.Winding );
+			const bool bGrewPass = reject_MergeWinding( State.Pass, Pass, PassPortal.Winding );
+
+			if (( bGrewSource == false ) && ( bGrewPass == false ))
+				return;
+
+			Source = State.Source;
+			Pass = State.Pass;
+		}
+		else
+		{
+			State.Source = Source;
+			State.Pass = Pass;
+			State.ulRoot = m_ulRoot;
+		}
+
+		setVisible( PassPortal.ulToSector );
+
+		if (( ++m_ulNumVisited > REJECT_MAX_PORTALS_PER_SECTOR ) || ( iDepth >= REJECT_MAX_DEPTH ))
+		{
+			giveUp( );
+			return;
+		}
+
+		const bool bFirstPortal = ( &PassPortal == &SourcePortal );
+		const ULONG ulSector = PassPortal.ulToSector;
+
+		for ( ULONG ulIdx = g_ulFirstSectorPortal[ulSector]; ( ulIdx < g_ulFirstSectorPortal[ulSector + 1] ) && ( m_bGaveUp == false ); ulIdx++ )
+		{
+			const REJECTPORTAL_s &TargetPortal = g_RejectPortals[ulIdx];
+
+			// A straight line can't cross the same line twice.
+			if (( TargetPortal.ulLine == PassPortal.ulLine ) || ( TargetPortal.ulLine == SourcePortal.ulLine ))
+				continue;
+
+			// The line of sight stays in front of every portal it went through.
+			REJECTWINDING_s Target = TargetPortal.Winding;
+			if (( reject_ClipWinding( Target, SourcePortal.Winding, true ) == false )
+				|| ( reject_ClipWinding( Target, PassPortal.Winding, true ) == false ))
+			{
+				continue;
+			}
+
+			// It crosses the target from the right, so it came from there.
+			REJECTWINDING_s NewSource = Source;
+			if ( reject_ClipWinding( NewSource, TargetPortal.Winding, false ) == false )
+				continue;
+
+			// It went through the source, then through the pass, and the other way around.
+			if (( bFirstPortal == false )
+				&& (( reject_ClipToSeparators( NewSource, Pass, Target ) == false )
+					|| ( reject_ClipToSeparators( Target, Pass, NewSource ) == false )))
+			{
+				continue;
+			}
+
+			flow( NewSource, SourcePortal, Target, ulIdx, iDepth + 1 );
+		}
+	}
+};
+
+//*****************************************************************************
+//	FUNCTIONS
+
+// Returns the distance of the point from the line, positive on its left side.
+static double reject_PointSide( const REJECTWINDING_s &Line, const REJECTPOINT_s &Point )
+{
+	const double dX = Line.End.x - Line.Start.x;
+	const double dY = Line.End.y - Line.Start.y;
+
+	return ( dX * ( Point.y - Line.Start.y ) - dY * ( Point.x - Line.Start.x )) / sqrt( dX * dX + dY * dY );
+}
+
+//*****************************************************************************
+//
+// Cuts off the part of the winding that is on the wrong side of the line, keeping a
+// margin of REJECT_EPSILON. Returns false if nothing is left.
+static bool reject_ClipWinding( REJECTWINDING_s &Winding, const REJECTWINDING_s &Line, const bool bKeepLeft )
+{
+	double dStart = reject_PointSide( Line, Winding.Start );
+	double dEnd = reject_PointSide( Line, Winding.End );
+
+	if ( bKeepLeft == false )
+	{
+		dStart = -dStart;
+		dEnd = -dEnd;
+	}
+
+	if (( dStart >= -REJECT_EPSILON ) && ( dEnd >= -REJECT_EPSILON ))
+		return ( true );
+	if (( dStart < -REJECT_EPSILON ) && ( dEnd < -REJECT_EPSILON ))
+		return ( false );
+
+	const double dFrac = ( -REJECT_EPSILON - dStart ) / ( dEnd - dStart );
+	REJECTPOINT_s Cut;
+	Cut.x = Winding.Start.x + dFrac * ( Winding.End.x - Winding.Start.x );
+	Cut.y = Winding.Start.y + dFrac * ( Winding.End.y - Winding.Start.y );
+
+	if ( dStart < -REJECT_EPSILON )
+		Winding.Start = Cut;
+	else
+		Winding.End = Cut;
+
+	return ( true );
+}
+
+//*****************************************************************************
+//
+// Widens the winding on the line so that it also covers the other one. It's widened by
+// REJECT_MERGE_GROWTH more on each side that grew, so that a flow doesn't need to be
+// followed again for every small step. Returns false if it already covered it.
+static bool reject_MergeWinding( REJECTWINDING_s &Winding, const REJECTWINDING_s &Other, const REJECTWINDING_s &Line )
+{
+	const double dX = Line.End.x - Line.Start.x;
+	const double dY = Line.End.y - Line.Start.y;
+	const double dLengthSquared = dX * dX + dY * dY;
+	const double dGrowth = REJECT_MERGE_GROWTH / sqrt( dLengthSquared );
+
+	// Both windings are parts of the line and point the same way, so compare where along it they are.
+	double dStart = (( Winding.Start.x - Line.Start.x ) * dX + ( Winding.Start.y - Line.Start.y ) * dY ) / dLengthSquared;
+	double dEnd = (( Winding.End.x - Line.Start.x ) * dX + ( Winding.End.y - Line.Start.y ) * dY ) / dLengthSquared;
+	const double dOtherStart = (( Other.Start.x - Line.Start.x ) * dX + ( Other.Start.y - Line.Start.y ) * dY ) / dLengthSquared;
+	const double dOtherEnd = (( Other.End.x - Line.Start.x ) * dX + ( Other.End.y - Line.Start.y ) * dY ) / dLengthSquared;
+	bool bGrew = false;
+
+	if ( dOtherStart < dStart - 1e-9 )
+	{
+		dStart = MAX( 0.0, dOtherStart - dGrowth );
+		Winding.Start.x = Line.Start.x + dStart * dX;
+		Winding.Start.y = Line.Start.y + dStart * dY;
+		bGrew = true;
+	}
+
+	if ( dOtherEnd > dEnd + 1e-9 )
+	{
+		dEnd = MIN( 1.0, dOtherEnd + dGrowth );
+		Winding.End.x = Line.Start.x + dEnd * dX;
+		Winding.End.y = Line.Start.y + dEnd * dY;
+		bGrew = true;
+	}
+
+	return ( bGrew );
+}
+
+//*****************************************************************************
+//
+// Clips the target to where a line through the source and then the pass can reach it.
+// This is the region bounded by the separating lines: lines through an end of the
+// source and an end of the pass that have the source on one side and the pass on the
+// other. A line of sight crosses such a line between the source and the pass, so
+// after the pass, it stays on the side of the pass.
+static bool reject_ClipToSeparators( const REJECTWINDING_s &Source, const REJECTWINDING_s &Pass, REJECTWINDING_s &Target )
+{
+	const REJECTPOINT_s *pSourcePoints[2] = { &Source.Start, &Source.End };
+	const REJECTPOINT_s *pPassPoints[2] = { &Pass.Start, &Pass.End };
+
+	// A source that was clipped to a point only has one end.
+	const bool bSourceIsPoint = ( fabs( Source.End.x - Source.Start.x ) + fabs( Source.End.y - Source.Start.y ) < 1e-3 );
+
+	for ( int i = 0; i < 2; i++ )
+	{
+		for ( int j = 0; j < 2; j++ )
+		{
+			REJECTWINDING_s Separator;
+			Separator.Start = *pSourcePoints[i];
+			Separator.End = *pPassPoints[j];
+
+			const double dX = Separator.End.x - Separator.Start.x;
+			const double dY = Separator.End.y - Separator.Start.y;
+			if ( dX * dX + dY * dY < REJECT_MIN_SEPARATOR_LENGTH * REJECT_MIN_SEPARATOR_LENGTH )
+				continue;
+
+			const double dSource = bSourceIsPoint ? 0 : reject_PointSide( Separator, *pSourcePoints[1 - i] );
+			const double dPass = reject_PointSide( Separator, *pPassPoints[1 - j] );
+
+			// The source must be completely on one side and the pass clearly on the other.
+			bool bKeepLeft;
+			if (( dSource <= 0 ) && ( dPass > REJECT_EPSILON ))
+				bKeepLeft = true;
+			else if (( dSource >= 0 ) && ( dPass < -REJECT_EPSILON ))
+				bKeepLeft = false;
+			else
+				continue;
+
+			if ( reject_ClipWinding( Target, Separator, bKeepLeft ) == false )
+				return ( false );
+		}
+	}
+
+	return ( true );
+}
+
+//*****************************************************************************
+//
+// The portal graph only describes the map if every line faces the sector it belongs to.
+// Check this with the subsectors: all segs of one must be on sides of the same sector.
+static bool reject_SectorsAreConsistent( void )
+{
+	if (( numsubsectors == 0 ) || ( subsectors == NULL ))
+		return ( false );
+
+	for ( int i = 0; i < numsubsectors; i++ )
+	{
+		const sector_t *pSector = NULL;
+
+		for ( DWORD j = 0; j < subsectors[i].numlines; j++ )
+		{
+			const seg_t *pSeg = subsectors[i].firstline + j;
+
+			if (( pSeg->linedef == NULL ) || ( pSeg->sidedef == NULL ))
+				continue;
+
+			if ( pSector == NULL )
+				pSector = pSeg->sidedef->sector;
+			else if ( pSeg->sidedef->sector != pSector )
+				return ( false );
+		}
+	}
+
+	return ( true );
+}
+
+//*****************************************************************************
+//
+static void reject_BuildPortals( void )
+{
+	TArray<REJECTPORTAL_s> Portals;
+
+	for ( int i = 0; i < numlines; i++ )
+	{
+		const line_t *pLine = &lines[i];
+
+		// Crossing a line between parts of the same sector doesn't lead anywhere new.
+		if (( pLine->frontsector == NULL ) || ( pLine->backsector == NULL ) || ( pLine->frontsector == pLine->backsector ))
+			continue;
+
+		// Nothing can see through a line without length.
+		if (( pLine->v1->x == pLine->v2->x ) && ( pLine->v1->y == pLine->v2->y ))
+			continue;
+
+		REJECTPORTAL_s Portal;
+		Portal.Winding.Start.x = FIXED2DBL( pLine->v1->x );
+		Portal.Winding.Start.y = FIXED2DBL( pLine->v1->y );
+		Portal.Winding.End.x = FIXED2DBL( pLine->v2->x );
+		Portal.Winding.End.y = FIXED2DBL( pLine->v2->y );
+		Portal.ulLine = i;
+
+		// The back sector is on the left side of the line.
+		Portal.ulFromSector = ULONG( pLine->frontsector - sectors );
+		Portal.ulToSector = ULONG( pLine->backsector - sectors );
+		Portals.Push( Portal );
+
+		std::swap( Portal.Winding.Start, Portal.Winding.End );
+		std::swap( Portal.ulFromSector, Portal.ulToSector );
+		Portals.Push( Portal );
+	}
+
+	// Sort them by the sector they lead out of.
+	g_ulFirstSectorPortal.Resize( numsectors + 1 );
+	memset( &g_ulFirstSectorPortal[0], 0, sizeof( ULONG ) * ( numsectors + 1 ));
+
+	for ( unsigned int i = 0; i < Portals.Size( ); i++ )
+		g_ulFirstSectorPortal[Portals[i].ulFromSector + 1]++;
+	for ( int i = 0; i < numsectors; i++ )
+		g_ulFirstSectorPortal[i + 1] += g_ulFirstSectorPortal[i];
+
+	TArray<ULONG> ulNextPortal;
+	ulNextPortal.Resize( numsectors );
+	memcpy( &ulNextPortal[0], &g_ulFirstSectorPortal[0], sizeof( ULONG ) * numsectors );
+
+	g_RejectPortals.Resize( Portals.Size( ));
+	for ( unsigned int i = 0; i < Portals.Size( ); i++ )
+		g_RejectPortals[ulNextPortal[Portals[i].ulFromSector]++] = Portals[i];
+
+	// Find out which sectors are connected at all.
+	TArray<ULONG> Stack;
+	g_ulSectorComponent.Resize( numsectors );
+	for ( int i = 0; i < numsectors; i++ )
+		g_ulSectorComponent[i] = ULONG_MAX;
+
+	for ( int i = 0; i < numsectors; i++ )
+	{
+		if ( g_ulSectorComponent[i] != ULONG_MAX )
+			continue;
+
+		g_ulSectorComponent[i] = i;
+		Stack.Push( i );
+
+		ULONG ulSector;
+		while ( Stack.Pop( ulSector ))
+		{
+			for ( ULONG ulIdx = g_ulFirstSectorPortal[ulSector]; ulIdx < g_ulFirstSectorPortal[ulSector + 1]; ulIdx++ )
+			{
+				const ULONG ulTarget = g_RejectPortals[ulIdx].ulToSector;
+
+				if ( g_ulSectorComponent[ulTarget] == ULONG_MAX )
+				{
+					g_ulSectorComponent[ulTarget] = i;
+					Stack.Push( ulTarget );
+				}
+			}
+		}
+	}
+}
+
+//*****************************************************************************
+//
+static void reject_FlowSectors( std::atomic<int> *pNextSector )
+{
+	FRejectFlow Flow;
+	int iSector;
+
+	while (( iSector = ( *pNextSector )++ ) < numsectors )
+		Flow.FlowSector( iSector );
+}
+
+//*****************************************************************************
+//
+static FString reject_GetCacheName( const BYTE *pbChecksum, const bool bCreate )
+{
+	FString Path = M_GetCachePath( bCreate );
+	Path += "/reject";
+	if ( bCreate )
+		CreatePath( Path );
+
+	Path += "/";
+	for ( int i = 0; i < 16; i++ )
+		Path.AppendFormat( "%02x", pbChecksum[i] );
+	Path += ".rej";
+	return ( Path );
+}
+
+//*****************************************************************************
+//
+static BYTE *reject_LoadFromCache( const BYTE *pbChecksum, const ULONG ulSize )
+{
+	FILE *pFile = fopen( reject_GetCacheName( pbChecksum, false ), "rb" );
+	if ( pFile == NULL )
+		return ( NULL );
+
+	// Header: "REJC", version, number of sectors, map checksum and the uncompressed size.
+	BYTE abHeader[4 + 4 + 4 + 16 + 4];
+	BYTE *pbReject = NULL;
+	TArray<BYTE> Compressed;
+	long lSize;
+
+	if (( fread( abHeader, 1, sizeof( abHeader ), pFile ) != sizeof( abHeader ))
+		|| ( memcmp( abHeader, "REJC", 4 ) != 0 )
+		|| ( LittleLong( *reinterpret_cast<DWORD *>( abHeader + 4 )) != REJECT_CACHE_VERSION )
+		|| ( LittleLong( *reinterpret_cast<DWORD *>( abHeader + 8 )) != static_cast<DWORD>( numsectors ))
+		|| ( memcmp( abHeader + 12, pbChecksum, 16 ) != 0 )
+		|| ( LittleLong( *reinterpret_cast<DWORD *>( abHeader + 28 )) != ulSize ))
+	{
+		fclose( pFile );
+		return ( NULL );
+	}
+
+	fseek( pFile, 0, SEEK_END );
+	lSize = ftell( pFile ) - static_cast<long>( sizeof( abHeader ));
+	fseek( pFile, sizeof( abHeader ), SEEK_SET );
+
+	if ( lSize > 0 )
+	{
+		Compressed.Resize( lSize );
+		if ( fread( &Compressed[0], 1, lSize, pFile ) == static_cast<size_t>( lSize ))
+		{
+			uLongf outlen = ulSize;
+			pbReject = new BYTE[ulSize];
+
+			if (( uncompress( pbReject, &outlen, &Compressed[0], lSize ) != Z_OK ) || ( outlen != ulSize ))
+			{
+				delete[] pbReject;
+				pbReject = NULL;
+			}
+		}
+	}
+
+	fclose( pFile );
+	return ( pbReject );
+}
+
+//*****************************************************************************
+//
+static void reject_SaveToCache( const BYTE *pbChecksum, const BYTE *pbReject, const ULONG ulSize )
+{
+	uLongf outlen = compressBound( ulSize );
+	TArray<BYTE> Compressed;
+	Compressed.Resize( outlen );
+
+	if ( compress( &Compressed[0], &outlen, pbReject, ulSize ) != Z_OK )
+		return;
+
+	BYTE abHeader[4 + 4 + 4 + 16 + 4];
+	memcpy( abHeader, "REJC", 4 );
+	*reinterpret_cast<DWORD *>( abHeader + 4 ) = LittleLong( static_cast<DWORD>( REJECT_CACHE_VERSION ));
+	*reinterpret_cast<DWORD *>( abHeader + 8 ) = LittleLong( static_cast<DWORD>( numsectors ));
+	memcpy( abHeader + 12, pbChecksum, 16 );
+	*reinterpret_cast<DWORD *>( abHeader + 28 ) = LittleLong( static_cast<DWORD>( ulSize ));
+
+	FILE *pFile = fopen( reject_GetCacheName( pbChecksum, true ), "wb" );
+	if ( pFile == NULL )
+		return;
+
+	fwrite( abHeader, 1, sizeof( abHeader ), pFile );
+	fwrite( &Compressed[0], 1, outlen, pFile );
+	fclose( pFile );
+}
+
+//*****************************************************************************
+//
+// Builds rejectmatrix for a map that doesn't have a usable REJECT lump, or loads
+// it from the cache. Leaves it NULL if the map's sectors don't allow it.
+//
+void P_BuildReject( MapData *map )
+{
+	if (( genreject == false ) || ( numsectors <= 0 ) || NETWORK_InClientMode( ))
+		return;
+
+	if ( numsectors > REJECT_MAX_SECTORS )
+	{
+		DPrintf( "Not building REJECT, the map has more than %d sectors\n", REJECT_MAX_SECTORS );
+		return;
+	}
+
+	const ULONG ulSize = ( static_cast<ULONG>( numsectors ) * numsectors + 7 ) >> 3;
+	BYTE abChecksum[16];
+	map->GetChecksum( abChecksum );
+
+	if (( rejectmatrix = reject_LoadFromCache( abChecksum, ulSize )) != NULL )
+	{
+		DPrintf( "Loaded REJECT from the cache\n" );
+		return;
+	}
+
+	if ( reject_SectorsAreConsistent( ) == false )
+	{
+		DPrintf( "Not building REJECT, some lines don't face their sectors\n" );
+		return;
+	}
+
+	const unsigned int startTime = I_FPSTime( );
+	reject_BuildPortals( );
+
+	g_ulRejectRowSize = ( numsectors + 7 ) >> 3;
+	g_RejectVisibility.Resize( numsectors * g_ulRejectRowSize );
+	memset( &g_RejectVisibility[0], 0, g_RejectVisibility.Size( ));
+
+	// Each thread takes the next sector that is left.
+	std::atomic<int> nextSector( 0 );
+	const unsigned int numThreads = clamp<unsigned int>( std::thread::hardware_concurrency( ), 1, 64 );
+	TArray<std::thread *> Threads;
+
+	for ( unsigned int i = 1; i < numThreads; i++ )
+		Threads.Push( new std::thread( reject_FlowSectors, &nextSector ));
+	reject_FlowSectors( &nextSector );
+
+	for ( unsigned int i = 0; i < Threads.Size( ); i++ )
+	{
+		Threads[i]->join( );
+		delete Threads[i];
+	}
+
+	// Both sectors must be able to see each other, since sight doesn't depend on the
+	// direction in the map plane.
+	rejectmatrix = new BYTE[ulSize];
+	memset( rejectmatrix, 0, ulSize );
+
+	for ( ULONG i = 0; i < static_cast<ULONG>( numsectors ); i++ )
+	{
+		const BYTE *pbRow = &g_RejectVisibility[i * g_ulRejectRowSize];
+
+		for ( ULONG j = 0; j < static_cast<ULONG>( numsectors ); j++ )
+		{
+			const BYTE *pbColumn = &g_RejectVisibility[j * g_ulRejectRowSize];
+
+			if ((( pbRow[j >> 3] & ( 1 << ( j & 7 ))) == 0 ) || (( pbColumn[i >> 3] & ( 1 << ( i & 7 ))) == 0 ))
+			{
+				const ULONG ulBit = i * numsectors + j;
+				rejectmatrix[ulBit >> 3] |= ( 1 << ( ulBit & 7 ));
+			}
+		}
+	}
+
+	g_RejectPortals.Clear( );
+	g_RejectPortals.ShrinkToFit( );
+	g_ulFirstSectorPortal.Clear( );
+	g_ulFirstSectorPortal.ShrinkToFit( );
+	g_ulSectorComponent.Clear( );
+	g_ulSectorComponent.ShrinkToFit( );
+	g_RejectVisibility.Clear( );
+	g_RejectVisibility.ShrinkToFit( );
+
+	DPrintf( "REJECT generation took %.3f sec (%d sectors, %u threads)\n", ( I_FPSTime( ) - startTime ) * 0.001, numsectors, numThreads );
+	reject_SaveToCache( abChecksum, rejectmatrix, ulSize );
+}
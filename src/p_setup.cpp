@@ -87,6 +87,7 @@
 #include "joinqueue.h"
 #include "cl_demo.h"
 #include "domination.h"
+#include "unlagged.h"
 
 // [BB] New #includes..
 #include "gl/dynlights/gl_dynlight.h"
@@ -189,7 +190,7 @@ fixed_t 		bmaporgy;
 int				bmapnegx;		// min negs of block map before wrapping
 int				bmapnegy;
 
-FBlockNode**	blocklinks;		// for thing chains
+FBlockLinks*	blocklinks;		// for thing chains
 
 
 // REJECT
@@ -3187,8 +3188,7 @@ void P_LoadBlockMap (MapData * map)
 
 	// clear out mobj chains
 	count = bmapwidth*bmapheight;
-	blocklinks = new FBlockNode *[count];
-	memset (blocklinks, 0, count*sizeof(*blocklinks));
+	blocklinks = new FBlockLinks[count];
 	blockmap = blockmaplump+4;
 
 	// [BC] Also, build the node list for the bot pathing module.
@@ -4356,6 +4356,11 @@ void P_SetupLevel (char *lumpname, int position)
 
 	times[11].Clock();
 	P_LoadReject (map, buildmap);
+	// Most maps ship an empty REJECT lump, build one for them if genreject is on.
+	if (rejectmatrix == NULL && !buildmap)
+	{
+		P_BuildReject (map);
+	}
 	times[11].Unclock();
 
 	times[12].Clock();
@@ -4464,6 +4469,9 @@ void P_SetupLevel (char *lumpname, int position)
 	// set up world state
 	P_SpawnSpecials ();
 
+	// Unlagged only records the heights of sectors that move, so record the initial ones now.
+	UNLAGGED_ResetSectors( );
+
 	// This must be done BEFORE the PolyObj Spawn!!!
 	// [BB] The server may not execute this
 	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
@@ -4659,6 +4667,7 @@ void P_SetupLevel (char *lumpname, int position)
 	MEDAL_ResetFirstFragAwarded( );
 
 	P_ResetSightCounters (true);
+	P_ResetSightCache ();
 	//Printf ("free memory: 0x%x\n", Z_FreeMemory());
 
 	if (showloadtimes)
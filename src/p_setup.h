@@ -128,6 +128,9 @@ bool P_CheckNodes(MapData * map, bool rebuilt, int buildtime);
 bool P_CheckForGLNodes();
 void P_SetRenderSector();
 
+// Builds a REJECT for maps that don't have a usable one (p_reject.cpp).
+void P_BuildReject (MapData *map);
+
 
 struct sidei_t	// [RH] Only keep BOOM sidedef init stuff around for init
 {
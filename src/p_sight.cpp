@@ -39,12 +39,32 @@ This uses specialized forms of the maputils routines for optimized performance
 */
 
 // Performance meters
-static int sightcounts[6];
+static int sightcounts[7];
 static cycle_t SightCycles;
 static cycle_t MaxSightCycles;
 
 static TArray<intercept_t> intercepts (128);
 
+// Monsters, bots and ACS check the same pairs of actors again and again in one tic.
+// The result of the trace only depends on where both actors are and on the map, so it's
+// remembered until the tic ends or a sector or polyobject moves.
+enum { SIGHTCACHE_SIZE = 1024 };
+
+struct FSightCacheEntry
+{
+	const AActor *t1, *t2;
+	fixed_t x1, y1, z1, height1;
+	fixed_t x2, y2, z2, height2;
+	int flags;
+	unsigned int generation;
+	bool result;
+};
+
+static FSightCacheEntry SightCache[SIGHTCACHE_SIZE];
+static unsigned int SightCacheGeneration = 1;
+static int sightcachecounts[2];		// hits, misses
+static cycle_t SightTraceCycles;
+
 class SightCheck
 {
 	fixed_t sightzstart;				// eye z of looker
@@ -663,6 +683,9 @@ bool P_CheckSight (const AActor *t1, const AActor *t2, int flags)
 		return false;
 	}
 
+	// Count all checks, so that the share of the rejected ones can be shown.
+	sightcounts[6]++;
+
 	const sector_t *s1 = t1->Sector;
 	const sector_t *s2 = t2->Sector;
 	int pnum = int(s1 - sectors) * numsectors + int(s2 - sectors);
@@ -716,10 +739,41 @@ sightcounts[0]++;
 	// An unobstructed LOS is possible.
 	// Now look from eyes of t1 to any part of t2.
 
-	validcount++;
+	// Everything before this consumes random numbers or is cheap, so only the trace is cached.
 	{
-		SightCheck s(t1, t2, flags);
-		res = s.P_SightPathTraverse (t1->x, t1->y, t2->x, t2->y);
+		FSightCacheEntry *entry = &SightCache[(((size_t)t1 >> 4) * 31 + ((size_t)t2 >> 4) + flags) & (SIGHTCACHE_SIZE - 1)];
+
+		if (entry->generation == SightCacheGeneration && entry->t1 == t1 && entry->t2 == t2 && entry->flags == flags &&
+			entry->x1 == t1->x && entry->y1 == t1->y && entry->z1 == t1->z && entry->height1 == t1->height &&
+			entry->x2 == t2->x && entry->y2 == t2->y && entry->z2 == t2->z && entry->height2 == t2->height)
+		{
+			sightcachecounts[0]++;
+			res = entry->result;
+			goto done;
+		}
+
+		SightTraceCycles.Clock();
+		validcount++;
+		{
+			SightCheck s(t1, t2, flags);
+			res = s.P_SightPathTraverse (t1->x, t1->y, t2->x, t2->y);
+		}
+		SightTraceCycles.Unclock();
+		sightcachecounts[1]++;
+
+		entry->t1 = t1;
+		entry->t2 = t2;
+		entry->x1 = t1->x;
+		entry->y1 = t1->y;
+		entry->z1 = t1->z;
+		entry->height1 = t1->height;
+		entry->x2 = t2->x;
+		entry->y2 = t2->y;
+		entry->z2 = t2->z;
+		entry->height2 = t2->height;
+		entry->flags = flags;
+		entry->generation = SightCacheGeneration;
+		entry->result = res;
 	}
 
 done:
@@ -730,9 +784,33 @@ done:
 ADD_STAT (sight)
 {
 	FString out;
-	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d%4d\n",
+	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d%4d, reject %d/%d (%d%%)%s\n",
 		SightCycles.TimeMS(), MaxSightCycles.TimeMS(),
-		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[3], sightcounts[4], sightcounts[5]);
+		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[3], sightcounts[4], sightcounts[5],
+		sightcounts[0], sightcounts[6], sightcounts[6] > 0 ? sightcounts[0] * 100 / sightcounts[6] : 0,
+		rejectmatrix == NULL ? ", no REJECT" : "");
+	return out;
+}
+
+// The traces are only the same while the map doesn't change.
+void P_InvalidateSightCache ()
+{
+	if (++SightCacheGeneration == 0)
+	{
+		memset (SightCache, 0, sizeof(SightCache));
+		SightCacheGeneration = 1;
+	}
+}
+
+ADD_STAT (sightcache)
+{
+	FString out;
+	const int checks = sightcachecounts[0] + sightcachecounts[1];
+	// Each hit saved about as much time as a trace took on average.
+	const double saved = sightcachecounts[1] > 0 ? SightTraceCycles.TimeMS() * sightcachecounts[0] / sightcachecounts[1] : 0;
+	out.Format ("hits %d/%d (%d%%), traces %04.1f ms, %04.1f ms saved\n",
+		sightcachecounts[0], checks, checks > 0 ? sightcachecounts[0] * 100 / checks : 0,
+		SightTraceCycles.TimeMS(), saved);
 	return out;
 }
 
@@ -750,4 +828,12 @@ void P_ResetSightCounters (bool full)
 	memset (sightcounts, 0, sizeof(sightcounts));
 }
 
+// Called once per tic, also on the server, and when a level starts.
+void P_ResetSightCache ()
+{
+	SightTraceCycles.Reset();
+	memset (sightcachecounts, 0, sizeof(sightcachecounts));
+	P_InvalidateSightCache ();
+}
+
 
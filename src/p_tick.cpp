@@ -127,6 +127,12 @@ void P_Ticker (void)
 
 	P_NewPspriteTick();
 
+	// Nothing loops over the blockmap between tics, so the unlinked actors can be removed now.
+	P_CompactBlockLinks ();
+
+	// The sight cache only holds the traces of one tic.
+	P_ResetSightCache ();
+
 	// [BC] Server doesn't need any of this.
 	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
 	{
@@ -1323,6 +1323,8 @@ bool FPolyObj::MovePolyobj (int x, int y, bool force)
 	FBoundingBox oldbounds = Bounds;
 	UnLinkPolyobj ();
 	DoMovePolyobj (x, y);
+	// Its lines may block sight somewhere else now.
+	P_InvalidateSightCache ();
 
 	if (!force)
 	{
@@ -1410,6 +1412,8 @@ bool FPolyObj::RotatePolyobj (angle_t angle)
 	an = (this->angle+angle)>>ANGLETOFINESHIFT;
 
 	UnLinkPolyobj();
+	// Its lines may block sight somewhere else now.
+	P_InvalidateSightCache ();
 
 	for(unsigned i=0;i < Vertices.Size(); i++)
 	{
@@ -1496,7 +1500,7 @@ void FPolyObj::UnLinkPolyobj ()
 bool FPolyObj::CheckMobjBlocking (side_t *sd)
 {
 	static TArray<AActor *> checker;
-	FBlockNode *block;
+	FBlockLinks *block;
 	AActor *mobj;
 	int i, j, k;
 	int left, right, top, bottom;
@@ -1531,9 +1535,14 @@ bool FPolyObj::CheckMobjBlocking (side_t *sd)
 	{
 		for (i = left; i <= right; i++)
 		{
-			for (block = blocklinks[j+i]; block != NULL; block = block->NextActor)
+			block = &blocklinks[j+i];
+			for (int l = block->Things.Size()-1; l >= 0; --l)
 			{
-				mobj = block->Me;
+				// Unlinked actors leave an empty entry.
+				if ((mobj = block->Things[l].Me) == NULL)
+				{
+					continue;
+				}
 				for (k = (int)checker.Size()-1; k >= 0; --k)
 				{
 					if (checker[k] == mobj)
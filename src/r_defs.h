@@ -814,6 +814,10 @@ struct sector_t
 	// [BC] Has the height changed during the course of the level?
 	bool		bCeilingHeightChange;
 	bool		bFloorHeightChange;
+
+	// Is this sector in unlagged's list of moving sectors, and when did it move last?
+	bool		bUnlaggedMoving;
+	int			unlaggedLastMoveTic;
 	secplane_t	SavedCeilingPlane;
 	secplane_t	SavedFloorPlane;
 	fixed_t		SavedCeilingTexZ;
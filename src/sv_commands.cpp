@@ -82,6 +82,7 @@
 #include "decallib.h"
 #include "network/netcommand.h"
 #include "network/servercommands.h"
+#include "sv_relevance.h"
 #include "maprotation.h"
 #include "voicechat.h"
 #include "d_netinf.h"
@@ -92,6 +93,60 @@ CVAR (Bool, sv_showwarnings, false, CVAR_GLOBALCONFIG|CVAR_ARCHIVE)
 EXTERN_CVAR( Float, sv_aircontrol )
 EXTERN_CVAR( Bool, sv_unlimited_pickup )
 
+// Send player movement as deltas against an update the client already received.
+CVAR( Bool, sv_deltamovement, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG )
+
+// How often (in tics) a player's movement is sent in full, even if a baseline is available.
+CUSTOM_CVAR( Int, sv_deltakeyframeinterval, 35, CVAR_ARCHIVE|CVAR_GLOBALCONFIG )
+{
+	if ( self < 1 )
+		self = 1;
+}
+
+//*****************************************************************************
+//	DEFINES
+
+// How many of the updates of a player sent to a client are kept as possible baselines.
+#define	PLAYERMOVEMENTHISTORY_SIZE		16
+
+//*****************************************************************************
+//	STRUCTURES
+
+// The movement of a player as a client reconstructs it from an update.
+struct PLAYERMOVEMENTSTATE_s
+{
+	int			Gametic;
+	fixed_t		X;
+	fixed_t		Y;
+	fixed_t		Z;
+	angle_t		Angle;
+	fixed_t		VelX;
+	fixed_t		VelY;
+	fixed_t		VelZ;
+};
+
+// The latest movement updates of a player that were sent to a client.
+struct PLAYERMOVEMENTHISTORY_s
+{
+	PLAYERMOVEMENTSTATE_s	States[PLAYERMOVEMENTHISTORY_SIZE];
+
+	// Number of valid entries in States and the index the next update is stored at.
+	ULONG					ulNumStates;
+	ULONG					ulNextState;
+
+	// The gametic the last keyframe was sent at.
+	int						LastKeyframe;
+
+	// The gametic of the latest update the client confirmed it applied.
+	int						AcknowledgedTic;
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+// Indexed by the client first and the player second.
+static	PLAYERMOVEMENTHISTORY_s		g_PlayerMovementHistory[MAXPLAYERS][MAXPLAYERS];
+
 //*****************************************************************************
 //	FUNCTIONS
 
@@ -300,6 +355,10 @@ void SERVERCOMMANDS_SpawnPlayer( ULONG ulPlayer, LONG lPlayerState, ULONG ulPlay
 	command.SetMorphStyle( players[ulPlayer].MorphStyle );
 	command.sendCommandToClients( ulPlayerExtra, flags );
 
+	// The clients reset their baselines of this player's movement.
+	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
+		g_PlayerMovementHistory[*it][ulPlayer].ulNumStates = 0;
+
 	// [BB]: If the player still has any cheats activated from the last level, tell
 	// him about it. Not doing this leads for example to jerky movement on client side
 	// in case of NOCLIP.
@@ -308,6 +367,198 @@ void SERVERCOMMANDS_SpawnPlayer( ULONG ulPlayer, LONG lPlayerState, ULONG ulPlay
 		SERVERCOMMANDS_SetPlayerCheats( ulPlayer, ulPlayer, SVCF_ONLYTHISCLIENT );
 }
 
+//*****************************************************************************
+//
+// Rounds the difference between a value and its baseline to the given precision. Returns false
+// if the result doesn't fit into a short.
+static bool servercommands_QuantizeDelta( SQWORD Difference, int Shift, int &Delta )
+{
+	Difference += static_cast<SQWORD>( 1 ) << ( Shift - 1 );
+	Difference >>= Shift;
+
+	if (( Difference < SHRT_MIN ) || ( Difference > SHRT_MAX ))
+		return false;
+
+	Delta = static_cast<int>( Difference );
+	return true;
+}
+
+//*****************************************************************************
+//
+// Finds the update of ulPlayer that ulClient confirmed it applied, if it is still recent enough to be
+// used as a baseline. The client drops every delta that is based on an update it didn't apply, so nothing
+// else may be used, even if it was most likely received.
+static const PLAYERMOVEMENTSTATE_s *servercommands_FindMovementBaseline( ULONG ulClient, ULONG ulPlayer )
+{
+	const PLAYERMOVEMENTHISTORY_s &history = g_PlayerMovementHistory[ulClient][ulPlayer];
+
+	if (( gametic - history.LastKeyframe ) >= sv_deltakeyframeinterval )
+		return NULL;
+
+	if (( gametic - history.AcknowledgedTic ) >= PLAYERDELTA_MAX_BASELINE_AGE )
+		return NULL;
+
+	for ( ULONG ulIdx = 0; ulIdx < history.ulNumStates; ++ulIdx )
+	{
+		const PLAYERMOVEMENTSTATE_s &state = history.States[( history.ulNextState + PLAYERMOVEMENTHISTORY_SIZE - 1 - ulIdx ) % PLAYERMOVEMENTHISTORY_SIZE];
+
+		if ( state.Gametic == history.AcknowledgedTic )
+			return &state;
+	}
+
+	return NULL;
+}
+
+//*****************************************************************************
+//
+// Called when ulClient tells us that it applied the update of ulPlayer's movement with the given sequence.
+// The sequence only identifies the update among the ones that are still in the history.
+void SERVERCOMMANDS_AcknowledgePlayerMovement( ULONG ulClient, ULONG ulPlayer, BYTE ucSequence )
+{
+	if (( ulClient >= MAXPLAYERS ) || ( ulPlayer >= MAXPLAYERS ))
+		return;
+
+	PLAYERMOVEMENTHISTORY_s &history = g_PlayerMovementHistory[ulClient][ulPlayer];
+
+	for ( ULONG ulIdx = 0; ulIdx < history.ulNumStates; ++ulIdx )
+	{
+		const PLAYERMOVEMENTSTATE_s &state = history.States[( history.ulNextState + PLAYERMOVEMENTHISTORY_SIZE - 1 - ulIdx ) % PLAYERMOVEMENTHISTORY_SIZE];
+
+		if (( state.Gametic & 0xFF ) == ucSequence )
+		{
+			// Acknowledgements may arrive out of order.
+			if ( state.Gametic > history.AcknowledgedTic )
+				history.AcknowledgedTic = state.Gametic;
+			return;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+// Sends the movement of ulPlayer to ulClient relative to an update the client already acknowledged,
+// or as a keyframe if there is none. Returns false if nothing was sent because ulClient was already
+// sent an update of ulPlayer during this tic.
+static bool servercommands_MovePlayerDelta( ULONG ulPlayer, ULONG ulClient, ULONG ulPlayerFlags )
+{
+	PLAYERMOVEMENTHISTORY_s &history = g_PlayerMovementHistory[ulClient][ulPlayer];
+	const AActor *pActor = players[ulPlayer].mo;
+
+	// The sequence of an update is derived from the gametic, so there can only be one per tic.
+	if (( history.ulNumStates > 0 ) && ( history.States[( history.ulNextState + PLAYERMOVEMENTHISTORY_SIZE - 1 ) % PLAYERMOVEMENTHISTORY_SIZE].Gametic == gametic ))
+	{
+		history.ulNumStates = 0;
+		return false;
+	}
+
+	// The history was reset, so whatever the client confirmed before doesn't count anymore.
+	if ( history.ulNumStates == 0 )
+		history.AcknowledgedTic = -PLAYERDELTA_MAX_BASELINE_AGE;
+
+	const PLAYERMOVEMENTSTATE_s *pBaseline = servercommands_FindMovementBaseline( ulClient, ulPlayer );
+	const fixed_t velx = ( ulPlayerFlags & PLAYER_SENDVELX ) ? pActor->velx : 0;
+	const fixed_t vely = ( ulPlayerFlags & PLAYER_SENDVELY ) ? pActor->vely : 0;
+	const fixed_t velz = ( ulPlayerFlags & PLAYER_SENDVELZ ) ? pActor->velz : 0;
+	int delta[7] = { 0 };
+	ULONG ulFields = 0;
+
+	if ( pBaseline != NULL )
+	{
+		const SQWORD differences[7] =
+		{
+			static_cast<SQWORD>( pActor->x ) - pBaseline->X,
+			static_cast<SQWORD>( pActor->y ) - pBaseline->Y,
+			static_cast<SQWORD>( pActor->z ) - pBaseline->Z,
+			static_cast<SDWORD>( pActor->angle - pBaseline->Angle ),
+			static_cast<SQWORD>( velx ) - pBaseline->VelX,
+			static_cast<SQWORD>( vely ) - pBaseline->VelY,
+			static_cast<SQWORD>( velz ) - pBaseline->VelZ,
+		};
+
+		for ( ULONG ulIdx = 0; ulIdx < 7; ++ulIdx )
+		{
+			const int shift = ( ulIdx == 3 ) ? PLAYERDELTA_ANGLE_SHIFT : PLAYERDELTA_POSITION_SHIFT;
+
+			// If the player moved too far since the baseline, send a keyframe instead.
+			if ( servercommands_QuantizeDelta( differences[ulIdx], shift, delta[ulIdx] ) == false )
+			{
+				pBaseline = NULL;
+				break;
+			}
+
+			if ( delta[ulIdx] != 0 )
+				ulFields |= 1 << ulIdx;
+		}
+	}
+
+	// Remember the movement the way the client will reconstruct it, so that the rounding errors of
+	// the deltas don't add up.
+	PLAYERMOVEMENTSTATE_s &state = history.States[history.ulNextState];
+	state.Gametic = gametic;
+
+	if ( pBaseline != NULL )
+	{
+		state.X = pBaseline->X + delta[0] * ( 1 << PLAYERDELTA_POSITION_SHIFT );
+		state.Y = pBaseline->Y + delta[1] * ( 1 << PLAYERDELTA_POSITION_SHIFT );
+		state.Z = pBaseline->Z + delta[2] * ( 1 << PLAYERDELTA_POSITION_SHIFT );
+		state.Angle = pBaseline->Angle + ( static_cast<angle_t>( delta[3] ) << PLAYERDELTA_ANGLE_SHIFT );
+		state.VelX = ( ulPlayerFlags & PLAYER_SENDVELX ) ? pBaseline->VelX + delta[4] * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0;
+		state.VelY = ( ulPlayerFlags & PLAYER_SENDVELY ) ? pBaseline->VelY + delta[5] * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0;
+		state.VelZ = ( ulPlayerFlags & PLAYER_SENDVELZ ) ? pBaseline->VelZ + delta[6] * ( 1 << PLAYERDELTA_POSITION_SHIFT ) : 0;
+	}
+	else
+	{
+		state.X = pActor->x;
+		state.Y = pActor->y;
+		state.Z = pActor->z;
+		state.Angle = pActor->angle;
+		state.VelX = velx;
+		state.VelY = vely;
+		state.VelZ = velz;
+		ulFields = 0;
+		history.LastKeyframe = gametic;
+	}
+
+	ServerCommands::MovePlayerDelta command;
+	command.SetPlayer( &players[ulPlayer] );
+	command.SetFlags( ulPlayerFlags );
+	command.SetSequence( gametic & 0xFF );
+	command.SetBaselineAge( pBaseline ? ( gametic - pBaseline->Gametic ) : 0 );
+	command.SetFields( ulFields );
+	command.SetX( state.X );
+	command.SetY( state.Y );
+	command.SetZ( state.Z );
+	command.SetAngle( state.Angle );
+	command.SetVelx( state.VelX );
+	command.SetVely( state.VelY );
+	command.SetVelz( state.VelZ );
+	command.SetDeltaX( delta[0] );
+	command.SetDeltaY( delta[1] );
+	command.SetDeltaZ( delta[2] );
+	command.SetDeltaAngle( delta[3] );
+	command.SetDeltaVelX( delta[4] );
+	command.SetDeltaVelY( delta[5] );
+	command.SetDeltaVelZ( delta[6] );
+	command.sendCommandToClients( ulClient, SVCF_ONLYTHISCLIENT );
+
+	history.ulNextState = ( history.ulNextState + 1 ) % PLAYERMOVEMENTHISTORY_SIZE;
+	if ( history.ulNumStates < PLAYERMOVEMENTHISTORY_SIZE )
+		history.ulNumStates++;
+
+	return true;
+}
+
+//*****************************************************************************
+//
+void SERVERCOMMANDS_ClearMovementHistory( ULONG ulClient )
+{
+	if ( ulClient >= MAXPLAYERS )
+		return;
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ++ulIdx )
+		g_PlayerMovementHistory[ulClient][ulIdx].ulNumStates = 0;
+}
+
 //*****************************************************************************
 //
 void SERVERCOMMANDS_MovePlayer( ULONG ulPlayer, ULONG ulPlayerExtra, ServerCommandFlags flags )
@@ -358,9 +609,16 @@ void SERVERCOMMANDS_MovePlayer( ULONG ulPlayer, ULONG ulPlayerExtra, ServerComma
 	for ( ClientIterator it ( ulPlayerExtra, flags ); it.notAtEnd(); ++it )
 	{
 		if ( SERVER_IsPlayerVisible( *it, ulPlayer ))
-			fullCommand.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+		{
+			if (( sv_deltamovement == false ) || ( servercommands_MovePlayerDelta( ulPlayer, *it, ulPlayerFlags | PLAYER_VISIBLE ) == false ))
+				fullCommand.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+		}
 		else
+		{
+			// The client doesn't know where the player is anymore, so the next update must be a keyframe.
+			g_PlayerMovementHistory[*it][ulPlayer].ulNumStates = 0;
 			stubCommand.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+		}
 	}
 }
 
@@ -1634,7 +1892,10 @@ void SERVERCOMMANDS_MoveThing( AActor *actor, ULONG bits, ULONG ulPlayerExtra, S
 	command.SetVelZ( actor->velz );
 	command.SetPitch( actor->pitch );
 	command.SetMovedir( actor->movedir );
-	command.sendCommandToClients( ulPlayerExtra, flags );
+
+	// Clients the actor isn't relevant to get its position later (see sv_relevance.cpp).
+	const QWORD skippedClients = SERVER_RELEVANCE_GetSkippedClients( actor, flags == 0 );
+	command.BuildNetCommand( ).sendCommandToClients( ulPlayerExtra, flags, skippedClients );
 
 	// [BB] Only mark something as updated, if it the update was sent to all players.
 	if ( flags == 0 )
@@ -1676,13 +1937,45 @@ void SERVERCOMMANDS_MoveThingExact( AActor *actor, ULONG bits, ULONG ulPlayerExt
 	command.SetVelZ( actor->velz );
 	command.SetPitch( actor->pitch );
 	command.SetMovedir( actor->movedir );
-	command.sendCommandToClients( ulPlayerExtra, flags );
+
+	// Clients the actor isn't relevant to get its position later (see sv_relevance.cpp).
+	const QWORD skippedClients = SERVER_RELEVANCE_GetSkippedClients( actor, flags == 0 );
+	command.BuildNetCommand( ).sendCommandToClients( ulPlayerExtra, flags, skippedClients );
 
 	// [BB] Only mark something as updated, if it the update was sent to all players.
 	if ( flags == 0 )
 		ActorNetPositionUpdated ( actor, bits );
 }
 
+//*****************************************************************************
+//
+// Sends the complete position of an actor to a client that missed some of its position
+// updates. The client also gets the last position the other clients got, so that the position
+// reuse of the following updates (see CheckPositionReuse) works for it again.
+//
+void SERVERCOMMANDS_ResyncThingPosition( AActor *actor, ULONG ulClient )
+{
+	if ( !EnsureActorHasNetID (actor) )
+		return;
+
+	ServerCommands::MoveThingExact command;
+	command.SetActor( actor );
+	command.SetBits( CM_X|CM_Y|CM_Z|CM_LAST_X|CM_LAST_Y|CM_LAST_Z|CM_NOLAST|CM_ANGLE|CM_VELX|CM_VELY|CM_VELZ|CM_PITCH|CM_MOVEDIR );
+	command.SetNewX( actor->x );
+	command.SetNewY( actor->y );
+	command.SetNewZ( actor->z );
+	command.SetLastX( actor->lastX );
+	command.SetLastY( actor->lastY );
+	command.SetLastZ( actor->lastZ );
+	command.SetAngle( actor->angle );
+	command.SetVelX( actor->velx );
+	command.SetVelY( actor->vely );
+	command.SetVelZ( actor->velz );
+	command.SetPitch( actor->pitch );
+	command.SetMovedir( actor->movedir );
+	command.sendCommandToClients( ulClient, SVCF_ONLYTHISCLIENT );
+}
+
 //*****************************************************************************
 //
 void SERVERCOMMANDS_KillThing( AActor *pActor, AActor *pSource, AActor *pInflictor )
@@ -90,6 +90,7 @@
 #include "possession.h"
 #include "s_sndseq.h"
 #include "version.h"
+#include "benchmark.h"
 #include "v_text.h"
 #include "w_wad.h"
 #include "p_acs.h"
@@ -122,6 +123,10 @@
 #include "p_conversation.h"
 #include "p_enemy.h"
 #include "network/packetarchive.h"
+#include "network/netcommand.h"
+#include "network/nettraffic.h"
+#include "sv_relevance.h"
+#include "sv_profile.h"
 #include "p_lnspec.h"
 #include "unlagged.h"
 #include "scoreboard.h"
@@ -147,6 +152,8 @@ static	bool	server_Ignore( BYTESTREAM_s *pByteStream );
 static	bool	server_Say( BYTESTREAM_s *pByteStream );
 static	bool	server_ClientMove( BYTESTREAM_s *pByteStream, bool bSentBackup );
 static	bool	server_MissingPacket( BYTESTREAM_s *pByteStream );
+static	bool	server_PacketAck( BYTESTREAM_s *pByteStream );
+static	bool	server_PlayerMovementAck( BYTESTREAM_s *pByteStream );
 static	bool	server_UpdateClientPing( BYTESTREAM_s *pByteStream );
 static	bool	server_WeaponSelect( BYTESTREAM_s *pByteStream, bool bSentBackup );
 static	bool	server_Taunt( BYTESTREAM_s *pByteStream );
@@ -188,6 +195,27 @@ static  void	server_LogPacket( BYTESTREAM_s *pByteStream, NETADDRESS_s Address,
 // Global array of clients.
 static	CLIENT_s		g_aClients[MAXPLAYERS];
 
+// Hash traits to use NETADDRESS_s (IP and port) as TMap key.
+struct ClientAddressHashTraits
+{
+	hash_t Hash( const NETADDRESS_s &key )
+	{
+		const hash_t ip = ( key.abIP[0] << 24 ) | ( key.abIP[1] << 16 ) | ( key.abIP[2] << 8 ) | key.abIP[3];
+		return ( ip * 2654435761u ) ^ key.usPort;
+	}
+
+	int Compare( const NETADDRESS_s &left, const NETADDRESS_s &right )
+	{
+		return ( left.Compare( right ) == false );
+	}
+};
+
+typedef TMap<NETADDRESS_s, ULONG, ClientAddressHashTraits> ClientAddressMap;
+
+// Maps the addresses of all non-free client slots to the client index, so that
+// incoming packets don't have to be compared to every client slot.
+static	ClientAddressMap	g_ClientAddressMap;
+
 // The last client we received a packet from.
 static	LONG			g_lCurrentClient;
 
@@ -230,6 +258,28 @@ static	LONG		g_lMaxInboundDataTransfer = 0;
 static	LONG		g_lCurrentInboundDataTransfer = 0;
 static	LONG		g_lInboundDataTransferLastSecond = 0;
 
+// Tic scheduling statistics. The jitter is how late (in ms) a tic started compared
+// to when it was due, an overrun is a tic that had to be run late enough to catch up.
+static	ULONG		g_ulCurrentTicJitterSum = 0;
+static	ULONG		g_ulCurrentTicJitterMax = 0;
+static	ULONG		g_ulCurrentNumTics = 0;
+static	ULONG		g_ulCurrentTicOverruns = 0;
+static	ULONG		g_ulAverageTicJitterLastSecond = 0;
+static	ULONG		g_ulMaxTicJitterLastSecond = 0;
+static	ULONG		g_ulTicOverrunsLastSecond = 0;
+static	QWORD		g_qwTotalTicOverruns = 0;
+
+// How many launcher queries were answered, and how many of those from the response cache.
+static	QWORD		g_qwTotalLauncherResponses = 0;
+static	QWORD		g_qwTotalCachedLauncherResponses = 0;
+
+// Commands sent to several clients this tic, and a copy of the busiest tic so far
+// for the benchmarks.
+static	BroadcastJournal	g_BroadcastJournal;
+#if BUILD_ID != BUILD_RELEASE
+static	BroadcastJournal	g_BusiestBroadcastTic;
+#endif
+
 // This is the current font the "screen" is using when it displays messages.
 static	char		g_szCurrentFont[16];
 
@@ -291,6 +341,9 @@ CVAR( Int, sv_showcommands, 0, CVAR_ARCHIVE|CVAR_DEBUGONLY )
 CVAR( Bool, sv_noplayertimeout, false, CVAR_NOSETBYACS|CVAR_DEBUGONLY ) // [SB]
 CVAR( Bool, sv_printconnectionmessages, true, CVAR_ARCHIVE|CVAR_NOSETBYACS ) // [SB]
 
+// How many bytes of a full update we send to a client per tic, 0 sends all of it at once.
+CVAR( Int, sv_fullupdatebytespertic, 8192, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
 //*****************************************************************************
 //
 CUSTOM_CVAR( String, sv_adminlistfile, "adminlist.txt", CVAR_ARCHIVE|CVAR_SENSITIVESERVERSETTING|CVAR_NOSETBYACS )
@@ -380,6 +433,21 @@ CUSTOM_CVAR( Int, sv_maxpacketsize, 1024, CVAR_ARCHIVE | CVAR_SERVERINFO )
 		Printf( "The server must be restarted before this change will take effect.\n" );
 }
 
+//*****************************************************************************
+//
+CUSTOM_CVAR( Int, sv_maxpacketspertick, 64, CVAR_ARCHIVE )
+{
+	if ( self <= 0 )
+	{
+		Printf( "sv_maxpacketspertick must be positive.\n" );
+		self = 64;
+	}
+}
+
+// Pace the packets by the measured round trip time and loss of each client.
+// sv_maxpacketspertick still is the upper limit.
+CVAR( Bool, sv_adaptivepacing, true, CVAR_ARCHIVE )
+
 //*****************************************************************************
 // [TP] Whether to enforce command limits. Set this false to disable
 // flood protection.
@@ -543,6 +611,7 @@ void SERVER_Construct( void )
 		// This is currently an open slot.
 		g_aClients[ulIdx].State = CLS_FREE;
 	}
+	g_ClientAddressMap.Clear();
 
 	// If they used "-host <#>", make <#> the max number of players.
 	pszMaxClients = Args->CheckValue( "-host" );
@@ -623,6 +692,7 @@ void SERVER_Destruct( void )
 		if ( SERVER_IsValidClient( ulIdx ))
 		{
 			SERVER_KickPlayer( ulIdx, "Server is shutting down" );
+			g_BroadcastJournal.flush( ulIdx, true, g_aClients[ulIdx].PacketBuffer.ByteStream );
 			NETWORK_LaunchPacket( &SERVER_GetClient( ulIdx )->PacketBuffer, SERVER_GetClient( ulIdx )->Address );
 		}
 
@@ -705,16 +775,47 @@ void SERVER_Tick( void )
 	const unsigned int previousTics = static_cast<unsigned>( g_GameTicShift + g_GameTime / MS_PER_TIC );
 	unsigned int deltaTics = server_GetDeltaTicks( nowTime, previousTics );
 
+	// The time at which the next tic is due.
+	const double nextTicTime = ( previousTics + 1 - g_GameTicShift ) * MS_PER_TIC;
+
 	while ( deltaTics == 0 )
 	{
 		// [BB] Recieve packets whenever possible (not only once each tic) to allow
 		// for an accurate ping measurement.
-		SERVER_GetPackets( );
+		// The receive thread already timestamps the packets when they arrive.
+		if ( NETWORK_IsReceiveThreadRunning( ) == false )
+			SERVER_GetPackets( );
+
+		// Sleep until either the next tic is due or a packet arrives, instead of
+		// waking up every millisecond. The timeout is clamped in case the timer wrapped.
+		const double timeLeft = ceil( nextTicTime - nowTime );
+
+		// Let the garbage collector work while there's nothing else to do, but keep a
+		// millisecond for the packets.
+		if (( timeLeft > 1 ) && GC::IdleCollect( static_cast<int>(( timeLeft - 1 ) * 1000 )))
+		{
+			deltaTics = server_GetDeltaTicks( nowTime, previousTics );
+			continue;
+		}
 
-		I_Sleep( 1 );
+		const ULONG ulTimeout = static_cast<ULONG>( clamp<double>( timeLeft, 1.0, ceil( MS_PER_TIC )));
+
+		NETWORK_WaitForPackets( ulTimeout );
 		deltaTics = server_GetDeltaTicks( nowTime, previousTics );
 	}
 
+	// Keep track of how punctual the tics are.
+	if ( nowTime >= nextTicTime )
+	{
+		const ULONG ulJitter = static_cast<ULONG>( nowTime - nextTicTime );
+		g_ulCurrentTicJitterSum += ulJitter;
+		g_ulCurrentTicJitterMax = MAX( g_ulCurrentTicJitterMax, ulJitter );
+	}
+	g_ulCurrentNumTics++;
+
+	if ( deltaTics > 1 )
+		g_ulCurrentTicOverruns += deltaTics - 1;
+
 #ifdef NO_SERVER_GUI
 	// console input
 	char *cmd = I_ConsoleInput();
@@ -733,8 +834,14 @@ void SERVER_Tick( void )
 	{
 		//DObject::BeginFrame ();
 
+		// Measure how long the stages of this tic take.
+		SERVER_PROFILE_BeginTic( );
+
 		// Recieve packets.
-		SERVER_GetPackets( );
+		{
+			FServerProfileScope Scope( SPS_GETPACKETS );
+			SERVER_GetPackets( );
+		}
 
 		// [AK] After receiving packets, check if we didn't receive a movement
 		// command from an in-game players during this gametic. If that's the
@@ -757,9 +864,15 @@ void SERVER_Tick( void )
 
 		// We have to record player positions before their mobj moves.
 		// [BB] Tick the unlagged module.
-		UNLAGGED_Tick( );
+		{
+			FServerProfileScope Scope( SPS_UNLAGGED );
+			UNLAGGED_Tick( );
+		}
 
-		G_Ticker ();
+		{
+			FServerProfileScope Scope( SPS_TICKER );
+			G_Ticker ();
+		}
 
 		// However we need to spawn the unlagged debug actors here i.e. after having processed their
 		// movement commands which updated their last server gametic.
@@ -804,22 +917,43 @@ void SERVER_Tick( void )
 		SERVER_CheckTimeouts( );
 
 		// Send out player's true position, etc.
-		SERVER_WriteCommands( );
+		{
+			FServerProfileScope Scope( SPS_WRITECOMMANDS );
+			SERVER_WriteCommands( );
+		}
 
-		// Check everyone's PacketBuffer for anything that needs to be sent.
-		SERVER_SendOutPackets( );
+		// Continue the full updates of the clients that are still joining.
+		{
+			FServerProfileScope Scope( SPS_FULLUPDATES );
+			SERVER_TickFullUpdates( );
+		}
 
-		// [BB] Send out sheduled packets, respecting sv_maxpacketspertick.
-		for ( unsigned int i = 0; i < MAXPLAYERS; i++ )
 		{
-			if ( g_aClients[i].State == CLS_FREE )
-				continue;
+			FServerProfileScope Scope( SPS_SENDPACKETS );
+
+			// Collect all packets that go out to the clients this tic and send them together.
+			NETWORK_BeginPacketBatch( );
+
+			// Check everyone's PacketBuffer for anything that needs to be sent.
+			SERVER_SendOutPackets( );
+
+			// [BB] Send out sheduled packets, respecting sv_maxpacketspertick.
+			for ( unsigned int i = 0; i < MAXPLAYERS; i++ )
+			{
+				if ( g_aClients[i].State == CLS_FREE )
+					continue;
+
+				SERVER_GetClient ( i )->SavedPackets.Tick ( );
+			}
 
-			SERVER_GetClient ( i )->SavedPackets.Tick ( );
+			NETWORK_EndPacketBatch( );
 		}
 
 		// Potentially send an update to the master server.
-		SERVER_MASTER_Tick( );
+		{
+			FServerProfileScope Scope( SPS_MASTER );
+			SERVER_MASTER_Tick( );
+		}
 
 		// Time out any old RCON sessions.
 		SERVER_RCON_Tick( );
@@ -881,10 +1015,25 @@ void SERVER_Tick( void )
 			g_lInboundDataTransferLastSecond = g_lCurrentInboundDataTransfer;
 			g_lCurrentInboundDataTransfer = 0;
 
+			// Update the tic scheduling statistics.
+			g_ulAverageTicJitterLastSecond = ( g_ulCurrentNumTics > 0 ) ? g_ulCurrentTicJitterSum / g_ulCurrentNumTics : 0;
+			g_ulMaxTicJitterLastSecond = g_ulCurrentTicJitterMax;
+			g_ulTicOverrunsLastSecond = g_ulCurrentTicOverruns;
+			g_qwTotalTicOverruns += g_ulCurrentTicOverruns;
+			g_ulCurrentTicJitterSum = 0;
+			g_ulCurrentTicJitterMax = 0;
+			g_ulCurrentNumTics = 0;
+			g_ulCurrentTicOverruns = 0;
+
+			// Start counting the command traffic of the next second.
+			NETTRAFFIC_Tick( );
+
 			// Update the form.
 			SERVERCONSOLE_UpdateStatistics( );
 		}
 
+		SERVER_PROFILE_EndTic( );
+
 		//DObject::EndFrame ();
 	}
 /*
@@ -936,49 +1085,85 @@ void SERVER_SendOutPackets( void )
 		if ( SERVER_IsValidClient( ulIdx ) == false )
 			continue;
 
-		if ( g_aClients[ulIdx].PacketBuffer.CalcSize() > 0 )
+		if (( g_aClients[ulIdx].PacketBuffer.CalcSize() > 0 ) || ( g_BroadcastJournal.getPendingSize( ulIdx, true ) > 0 ))
 			SERVER_SendClientPacket( ulIdx, true );
 
-		if ( g_aClients[ulIdx].UnreliablePacketBuffer.CalcSize() > 0 )
+		if (( g_aClients[ulIdx].UnreliablePacketBuffer.CalcSize() > 0 ) || ( g_BroadcastJournal.getPendingSize( ulIdx, false ) > 0 ))
 			SERVER_SendClientPacket( ulIdx, false );
 	}
+
+	// Clients that weren't sent anything keep the commands in their buffers, as before.
+	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		g_BroadcastJournal.flush( ulIdx, true, g_aClients[ulIdx].PacketBuffer.ByteStream );
+		g_BroadcastJournal.flush( ulIdx, false, g_aClients[ulIdx].UnreliablePacketBuffer.ByteStream );
+	}
+
+#if BUILD_ID != BUILD_RELEASE
+	// Keep the busiest tic around for "benchmark broadcast".
+	if ( g_BroadcastJournal.getSize( ) > g_BusiestBroadcastTic.getSize( ))
+		g_BusiestBroadcastTic.copyCommands( g_BroadcastJournal );
+#endif
+
+	g_BroadcastJournal.clear( );
 }
 
 //*****************************************************************************
 //
 void SERVER_SendClientPacket( ULONG ulClient, bool bReliable )
 {
-    NETBUFFER_s		TempBuffer;
-	BYTE			abData[MAX_UDP_PACKET];
-	CLIENT_s		*pClient;
+	static TArray<NETPACKETSEGMENT_s>	Segments;
+	static const BYTE					abUnreliableHeader[1] = { SVC_UNRELIABLEPACKET };
+	NETPACKETSEGMENT_s					Segment;
+	CLIENT_s							*pClient;
 
 	pClient = SERVER_GetClient( ulClient );
 	if ( pClient == NULL )
 		return;
 
-	if ( bReliable )
+	// The packet is put together from the client's buffer and the commands in the
+	// broadcast journal where they are. A reliable packet is copied into the client's
+	// packet archive once and sent from there, an unreliable one is encoded right away.
+	NETBUFFER_s &Buffer = bReliable ? pClient->PacketBuffer : pClient->UnreliablePacketBuffer;
+
+	// The commands from the journal that don't fit go into further packets.
+	do
 	{
-		pClient->SavedPackets.ScheduleUnsentPacket( pClient->PacketBuffer );
-		pClient->PacketBuffer.Clear();
-		return;
-	}
+		Segments.Clear( );
 
-	TempBuffer.pbData = abData;
-	TempBuffer.ulMaxSize = sizeof( abData );
-	TempBuffer.ulCurrentSize = 0;
-	TempBuffer.BufferType = BUFFERTYPE_WRITE;
-	TempBuffer.ByteStream.pbStream = abData;
-	TempBuffer.ByteStream.pbStreamEnd = TempBuffer.ByteStream.pbStream + TempBuffer.ulMaxSize;
+		// Write the header.
+		ULONG ulSize = 0;
+		if ( bReliable == false )
+		{
+			Segment.pbData = abUnreliableHeader;
+			Segment.ulSize = sizeof( abUnreliableHeader );
+			Segments.Push( Segment );
+			ulSize += Segment.ulSize;
+		}
 
-	// Write the header to our temporary buffer.
-	TempBuffer.ByteStream.WriteByte( SVC_UNRELIABLEPACKET );
+		// Then the body of the message, the commands from the broadcast journal come last.
+		Segment.pbData = Buffer.pbData;
+		Segment.ulSize = Buffer.CalcSize( );
+		Segments.Push( Segment );
+		ulSize += Segment.ulSize;
 
-	// Write the body of the message to our temporary buffer.
-	pClient->UnreliablePacketBuffer.WriteTo ( TempBuffer.ByteStream );
+		if (( g_BroadcastJournal.gather( ulClient, bReliable, ( ulSize < MAX_UDP_PACKET ) ? MAX_UDP_PACKET - ulSize : 0, Segments ) == 0 ) &&
+			( Segment.ulSize == 0 ) && ( g_BroadcastJournal.getPendingSize( ulClient, bReliable ) > 0 ))
+		{
+			// The next command doesn't even fit into an empty packet.
+			SERVER_PrintWarning( "SERVER_SendClientPacket: A command to client %lu doesn't fit into a packet, dropping the %u bytes left in the broadcast journal!\n", ulClient, g_BroadcastJournal.getPendingSize( ulClient, bReliable ));
+			g_BroadcastJournal.discard( ulClient, bReliable );
+			break;
+		}
 
-	// Finally, send the packet, and clear the buffer.
-	NETWORK_LaunchPacket( &TempBuffer, pClient->Address );
-	pClient->UnreliablePacketBuffer.Clear();
+		// Finally, send the packet, and clear the buffer.
+		if ( bReliable )
+			pClient->SavedPackets.ScheduleUnsentPacket( &Segments[0], Segments.Size( ));
+		else
+			NETWORK_LaunchPacket( &Segments[0], Segments.Size( ), pClient->Address );
+		Buffer.Clear();
+	}
+	while ( g_BroadcastJournal.getPendingSize( ulClient, bReliable ) > 0 );
 }
 
 //*****************************************************************************
@@ -993,10 +1178,20 @@ void SERVER_CheckClientBuffer( ULONG ulClient, ULONG ulSize, bool bReliable )
 		return;
 
 	if ( bReliable )
+	{
 		pBuffer = &pClient->PacketBuffer;
+		pClient->ulReliableBytesWritten += ulSize;
+	}
 	else
 		pBuffer = &pClient->UnreliablePacketBuffer;
 
+	// The caller is going to write to the buffer directly, so the commands
+	// referenced in the broadcast journal must be written first. If they don't
+	// all fit, they're sent right away.
+	g_BroadcastJournal.flush( ulClient, bReliable, pBuffer->ByteStream );
+	if ( g_BroadcastJournal.getPendingSize( ulClient, bReliable ) > 0 )
+		SERVER_SendClientPacket( ulClient, bReliable );
+
 	// Make sure we have enough room for the upcoming message. If not, send
 	// out the current buffer and clear the packet.
 	pBuffer->ulCurrentSize = pBuffer->ByteStream.pbStream - pBuffer->pbData;
@@ -1010,6 +1205,53 @@ void SERVER_CheckClientBuffer( ULONG ulClient, ULONG ulSize, bool bReliable )
 	}
 }
 
+//*****************************************************************************
+//
+// These connect the packet archive of each client to the client itself. They live
+// here, so that the packet archive can also be built without the rest of the server.
+void OutgoingPacketBuffer::LaunchPacket ( unsigned int packetNumber, const BYTE *data, size_t size )
+{
+	NETPACKETSEGMENT_s segment;
+	segment.pbData = data;
+	segment.ulSize = size;
+	NETWORK_LaunchPacket( &segment, 1, SERVER_GetClient( _clientIdx )->Address );
+}
+
+//*****************************************************************************
+//
+void OutgoingPacketBuffer::Abort ( const char *reason )
+{
+	SERVER_KickPlayer( _clientIdx, reason );
+}
+
+//*****************************************************************************
+//
+unsigned int OutgoingPacketBuffer::GetTime ( ) const
+{
+	return I_MSTime( );
+}
+
+//*****************************************************************************
+//
+bool OutgoingPacketBuffer::UsesAdaptivePacing ( ) const
+{
+	return sv_adaptivepacing;
+}
+
+//*****************************************************************************
+//
+unsigned int OutgoingPacketBuffer::GetMaxPacketsPerTick ( ) const
+{
+	return sv_maxpacketspertick;
+}
+
+//*****************************************************************************
+//
+BroadcastJournal &SERVER_GetBroadcastJournal( void )
+{
+	return ( g_BroadcastJournal );
+}
+
 //*****************************************************************************
 //
 LONG SERVER_FindFreeClientSlot( void )
@@ -1042,16 +1284,12 @@ LONG SERVER_FindFreeClientSlot( void )
 //
 LONG SERVER_FindClientByAddress( NETADDRESS_s Address )
 {
-	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-	{
-	   if ( g_aClients[ulIdx].State == CLS_FREE )
-	       continue;
+	// Only clients that are not free are in the map.
+	const ULONG *pulIdx = g_ClientAddressMap.CheckKey( Address );
+
+	if ( pulIdx != NULL )
+		return ( *pulIdx );
 
-	   // If the client's address matches the given IP, return the client's index.
-	   if ( g_aClients[ulIdx].Address.Compare( Address ))
-	       return ( ulIdx );
-	}
-	
 	return ( -1 );
 }
 
@@ -1359,6 +1597,7 @@ void SERVER_SendChatMessage( ULONG ulPlayer, ULONG ulMode, const char *pszString
 void SERVER_RequestClientToAuthenticate( ULONG ulClient )
 {
 	g_aClients[ulClient].PacketBuffer.Clear();
+	g_BroadcastJournal.discard( ulClient, true );
 	g_aClients[ulClient].PacketBuffer.ByteStream.WriteByte( SVCC_AUTHENTICATE );
 	g_aClients[ulClient].PacketBuffer.ByteStream.WriteString( level.mapname );
 	// [CK] This lets the client start off with a reasonable gametic. In case
@@ -1392,6 +1631,7 @@ void SERVER_AuthenticateClientLevel( BYTESTREAM_s *pByteStream )
 
 	// Tell the client his level was authenticated.
 	g_aClients[g_lCurrentClient].PacketBuffer.Clear();
+	g_BroadcastJournal.discard( g_lCurrentClient, true );
 	g_aClients[g_lCurrentClient].PacketBuffer.ByteStream.WriteByte( SVCC_MAPLOAD );
 	// [BB] Also tell him the game mode, otherwise the client can't decide whether 3D floors should be spawned or not.
 	g_aClients[g_lCurrentClient].PacketBuffer.ByteStream.WriteByte( GAMEMODE_GetCurrentMode( ) );
@@ -1429,7 +1669,6 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 	ULONG								ulIdx;
 	ULONG								ulState;
 	ULONG								ulCountdownTicks;
-	AInventory							*pInventory;
 
 	// If the client hasn't authenticated his level, don't accept this connection.
 	if ( g_aClients[g_lCurrentClient].State < CLS_AUTHENTICATED )
@@ -1451,6 +1690,7 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 
 	// This player is now in the game.
 	playeringame[g_lCurrentClient] = true;
+	SERVER_MASTER_InvalidateLauncherCache( );
 
 	// [BB] If necessary, spawn a voodoo doll for the player.
 	if ( COOP_PlayersVoodooDollsNeedToBeSpawned ( g_lCurrentClient ) )
@@ -1484,6 +1724,7 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 
 	// Clear out the client's netbuffer.
 	g_aClients[g_lCurrentClient].PacketBuffer.Clear();
+	g_BroadcastJournal.discard( g_lCurrentClient, true );
 
 	// Tell the client that we're about to send him a snapshot of the level.
 	SERVERCOMMANDS_BeginSnapshot( g_lCurrentClient );
@@ -1643,75 +1884,8 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 	SERVERCOMMANDS_SyncMapRotation(g_lCurrentClient, SVCF_ONLYTHISCLIENT );
 	SERVERCOMMANDS_SetNextMapPosition( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
 
-	// Send a snapshot of the level.
-	SERVER_SendFullUpdate( g_lCurrentClient );
-
-	// If we need to start this client's enter scripts, do that now.
-	if ( g_aClients[g_lCurrentClient].bRunEnterScripts )
-	{
-		FBehavior::StaticStartTypedScripts( SCRIPT_Enter, players[g_lCurrentClient].mo, true );
-		g_aClients[g_lCurrentClient].bRunEnterScripts = false;
-	}
-
-	if ( GAMEMODE_GetCurrentFlags() & GMF_USETEAMITEM )
-	{
-		// In ST/CTF games, let the incoming player know who has flags/skulls.
-		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-		{
-			if ( SERVER_IsValidClient( ulIdx ) == false )
-				continue;
-
-			// Player shouldn't have a flag/skull if he's not on a team...
-			if (( players[ulIdx].bOnTeam == false ) || ( players[ulIdx].mo == NULL ))
-				continue;
-
-			// See if this player is carrying the opponents flag/skull.
-			pInventory = TEAM_FindOpposingTeamsItemInPlayersInventory ( &players[ulIdx] );
-			if ( pInventory )
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-			// See if the player is carrying the white flag in OFCTF.
-			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "WhiteFlag" ), true );
-			if (( oneflagctf ) && ( pInventory ))
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-		}
-
-		// Also let the client know if flags/skulls are on the ground.
-		for ( ulIdx = 0; ulIdx < teams.Size( ); ulIdx++ )
-			SERVERCOMMANDS_SetTeamReturnTicks( ulIdx, TEAM_GetReturnTicks( ulIdx ), g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-		SERVERCOMMANDS_SetTeamReturnTicks( teams.Size( ), TEAM_GetReturnTicks( teams.Size( ) ), g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-	}
-
-	// If we're playing terminator, potentially tell the client who's holding the terminator
-	// artifact.
-	if ( terminator )
-	{
-		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-		{
-			if (( playeringame[ulIdx] == false ) || ( players[ulIdx].mo == NULL ))
-				continue;
-
-			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "PowerTerminatorArtifact" ));
-			if ( pInventory )
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-		}
-	}
-
-	// If we're playing possession/team possession, potentially tell the client who's holding
-	// the possession artifact.
-	if ( possession || teampossession )
-	{
-		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-		{
-			if (( playeringame[ulIdx] == false ) || ( players[ulIdx].mo == NULL ))
-				continue;
-
-			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "PowerPossessionArtifact" ));
-			if ( pInventory )
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-		}
-	}
+	// Send a snapshot of the level. Who carries the items is sent once the actors are.
+	SERVER_SendFullUpdate( g_lCurrentClient, FUF_ITEMOWNERS );
 
 	// Check and see if this is a disconnected player. If so, restore his fragcount.
 	SavedPlayerInfo *savedInfo = SERVER_SAVE_GetSavedInfo( players[g_lCurrentClient].userinfo.GetName( ), g_aClients[g_lCurrentClient].Address );
@@ -2028,6 +2202,12 @@ void SERVER_SetupNewConnection( BYTESTREAM_s *pByteStream, bool bNewPlayer )
 	g_aClients[lClient].SavedPackets.Clear();
 	g_aClients[lClient].PacketBuffer.Clear();
 	g_aClients[lClient].UnreliablePacketBuffer.Clear();
+	g_BroadcastJournal.discard( lClient, true );
+	g_BroadcastJournal.discard( lClient, false );
+	SERVER_CancelFullUpdate( lClient );
+	g_aClients[lClient].FullUpdate.ulFollowUps = 0;
+	NETTRAFFIC_ResetClient( lClient );
+	SERVER_RELEVANCE_ResetClient( lClient );
 
 	// Who is connecting?
 	// [SB] Only print if sv_printconnectionmessages is enabled.
@@ -2038,6 +2218,7 @@ void SERVER_SetupNewConnection( BYTESTREAM_s *pByteStream, bool bNewPlayer )
 	// Setup the client.
 	g_aClients[lClient].State = CLS_CHALLENGE;
 	g_aClients[lClient].Address = AddressFrom;
+	g_ClientAddressMap[AddressFrom] = lClient;
 
 	{
 		// Make sure the version matches.
@@ -2445,6 +2626,7 @@ void SERVER_ConnectionError( NETADDRESS_s Address, const char *pszMessage, ULONG
 //
 void SERVER_ClientError( ULONG ulClient, ULONG ulErrorCode )
 {
+	g_BroadcastJournal.flush( ulClient, true, g_aClients[ulClient].PacketBuffer.ByteStream );
 	g_aClients[ulClient].PacketBuffer.ByteStream.WriteByte( SVCC_ERROR );
 	g_aClients[ulClient].PacketBuffer.ByteStream.WriteByte( ulErrorCode );
 
@@ -2532,384 +2714,209 @@ void SERVER_ClientError( ULONG ulClient, ULONG ulErrorCode )
 
 //*****************************************************************************
 //
-void SERVER_SendFullUpdate( ULONG ulClient )
+// Does the client need to know about this actor when it receives a full update?
+//
+static bool server_ShouldSendActorInFullUpdate( AActor *pActor )
 {
-	AActor						*pActor;
-	ULONG						ulIdx;
-	player_t*					pPlayer;
-	AInventory					*pInventory;
-	TThinkerIterator<AActor>	Iterator;
+	// If the actor doesn't have a network ID, don't spawn it (it
+	// probably isn't important).
+	if ( pActor->NetID == 0 )
+		return false;
 
-	// Send active players to the client.
-	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-	{
-		if (( ulClient == ulIdx ) || ( playeringame[ulIdx] == false ))
-			continue;
+	// [BB] The other clients already have destroyed this actor, so don't spawn it.
+	if ( pActor->NetworkFlags & NETFL_DESTROYED_ON_CLIENT )
+		return false;
 
-		pPlayer = &players[ulIdx];
-		if ( pPlayer->mo == NULL )
-			continue;
+	// Don't spawn players, items about to be deleted, inventory items
+	// that have an owner, or items that the client spawns himself.
+	if (( pActor->IsKindOf( RUNTIME_CLASS( APlayerPawn ))) ||
+		( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HoldAndDestroy") ) ||	// S_HOLDANDDESTROY
+		( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("Held") ) || // S_HELD
+		( pActor->NetworkFlags & NETFL_ALLOWCLIENTSPAWN ))
+	{
+		return false;
+	}
 
-		// [BB] To properly spawn the players the client already needs to know the userinfo, e.g. the handicap value.
-		SERVERCOMMANDS_SetAllPlayerUserInfo( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-		// [BB] Make sure that morphed players are spawned as morphed.
-		SERVERCOMMANDS_SpawnPlayer( ulIdx, PST_REBORNNOINVENTORY, ulClient, SVCF_ONLYTHISCLIENT, !!( pPlayer->morphTics ) );
-		// [BB] Since the player possibly lost something from his default inventory, destory everything
-		// he is spawned with on the client. Everything the client has to know about the inventory is
-		// handled below.
-		SERVERCOMMANDS_DestroyAllInventory( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+	// [BB] Don't spawn things hidden by AActor::HideOrDestroyIfSafe().
+	// The clients don't need them at all, since the server will tell
+	// them to spawn a new actor during GAME_ResetMap anyway.
+	if ( !( pActor->IsKindOf( RUNTIME_CLASS( AInventory ) ) )
+	     && ( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideIndefinitely") ) // S_HIDEINDEFINITELY 
+	   )
+	{
+		return false;
+	}
 
-		// Also send this player's team.
-		if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS )
-			SERVERCOMMANDS_SetPlayerTeam( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+	return true;
+}
 
-		// Check if we need to tell the incoming player about any powerups this player may have.
-		// [BB] Also tell about all the ammo, weapons, backpacks and keys this player has.
-		// [BB] Keys need to be handled carefully. In order to display them properly in ST's fullscrenn HUD
-		// in coop spy, they need to be given in reverse order.
-		TArray<AInventory *> keys;
-		for ( pInventory = pPlayer->mo->Inventory; pInventory != NULL; pInventory = pInventory->Inventory )
+//*****************************************************************************
+//
+// Tells the client to spawn this actor, and everything it needs to know about it.
+//
+static void server_SendActorFullUpdate( AActor *pActor, ULONG ulClient )
+{
+	// Spawn a missile. Missiles must be handled differently because they have
+	// velocity.
+	if ( pActor->flags & MF_MISSILE )
+	{
+		SERVERCOMMANDS_SpawnMissile( pActor, ulClient, SVCF_ONLYTHISCLIENT );
+	}
+	// Tell the client to spawn this thing.
+	else
+	{
+		// [EP] Handle level-spawned actors which didn't move yet on X/Y axes.
+		bool shouldLevelSpawn = false;
+		if ((pActor->STFlags & STFL_LEVELSPAWNED) != 0)
 		{
-			if ( pInventory->IsKindOf( RUNTIME_CLASS( APowerup )))
-			{
-				SERVERCOMMANDS_GivePowerup( ulIdx, static_cast<APowerup *>( pInventory ), ulClient, SVCF_ONLYTHISCLIENT );
-
-				// [BB] If it's a rune, we need to explicitly set its icon since it was set by the RuneGiver.
-				if ( pInventory == pInventory->Owner->Rune )
-				{
-					SERVERCOMMANDS_SetInventoryIcon( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
-				}
-			}
-			// [WS] Inform clients of their PowerupGiver items.
-			else if ( pInventory->IsKindOf( RUNTIME_CLASS( AAmmo )) || pInventory->IsKindOf( RUNTIME_CLASS( AWeapon ))
-				|| pInventory->IsKindOf( RUNTIME_CLASS( ABackpackItem ))
-				|| pInventory->IsKindOf( RUNTIME_CLASS( APowerupGiver )) )
-			{
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
-				// [BB] Ammo max amount needs to be handled explicitly.
-				if ( pInventory->IsKindOf( RUNTIME_CLASS( AAmmo ) ) )
-					SERVERCOMMANDS_SetPlayerAmmoCapacity( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
-			}
-			else if ( pInventory->IsKindOf( RUNTIME_CLASS( AKey )) )
-				keys.Push ( pInventory );
-			else if ( pInventory->IsA( RUNTIME_CLASS( AWeaponHolder )) )
-			{
-				// [Dusk] Inform the client of weapon holders
-				SERVERCOMMANDS_GiveWeaponHolder( ulIdx, static_cast<AWeaponHolder *>( pInventory ), ulClient, SVCF_ONLYTHISCLIENT );
-			}
+			shouldLevelSpawn = (pActor->x == pActor->SpawnPoint[0] 
+				&& pActor->y == pActor->SpawnPoint[1]);
 		}
-		// [BB] Now give the keys we just collected from the inventory in reverse order.
-		while ( keys.Size() )
+		if ( shouldLevelSpawn )
 		{
-			keys.Pop( pInventory );
-			SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+			SERVERCOMMANDS_LevelSpawnThing( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 		}
-
-		// Also if this player is currently dead, let the incoming player know that.
-		if ( pPlayer->mo->health <= 0 )
-			SERVERCOMMANDS_ThingIsCorpse( pPlayer->mo, ulClient, SVCF_ONLYTHISCLIENT );
-		// [BB] SERVERCOMMANDS_SpawnPlayer instructs the client to spawn a player
-		// with default health. So we still need to send the correct current health value
-		// (if the player is not dead). Also set the armor and the corresponding max bonuses.
 		else
 		{
-			SERVERCOMMANDS_SetPlayerHealthAndMaxHealthBonus( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-			SERVERCOMMANDS_SetPlayerArmorAndMaxArmorBonus( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-			// [BB] Also send all non-default flag values.
-			SERVERCOMMANDS_UpdateThingFlagsNotAtDefaults( pPlayer->mo, ulClient, SVCF_ONLYTHISCLIENT );
-
-			// [BB] If the player is in its SeeState, let the client know.
-			if ( ( pPlayer->mo->SeeState != NULL ) && ( pPlayer->mo->InStateSequence(pPlayer->mo->state, pPlayer->mo->SeeState) ) )
-				SERVERCOMMANDS_SetPlayerState( ulIdx, STATE_PLAYER_SEE, ulClient, SVCF_ONLYTHISCLIENT);
+			SERVERCOMMANDS_SpawnThing( pActor, ulClient, SVCF_ONLYTHISCLIENT );
+		}
+		// [BB] If the thing is not at its spawn point, let the client know about the spawn point.
+		if ( ( pActor->x != pActor->SpawnPoint[0] )
+			|| ( pActor->y != pActor->SpawnPoint[1] )
+			|| ( pActor->z != pActor->SpawnPoint[2] )
+			)
+		{
+			SERVERCOMMANDS_SetThingSpawnPoint( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 		}
 
-		// [BB] Clients need to know the active weapons of other players, so send it.
-		SERVERCOMMANDS_WeaponChange( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+		// [BB] Since the monster movement is client side, the client needs to be
+		// informed about the velocity and the current state. If the frame is not
+		// set, the client thinks the actor is in its spawn state.
+		{
 
-		// [geNia] Clients need to know player's current skin in ACS.
-		SERVERCOMMANDS_SetPlayerACSSkin( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+			if ( (pActor->InSpawnState() == false)
+				 && !(( pActor->health <= 0 ) && ( pActor->flags & MF_COUNTKILL )) // [BB] Corpses are handled later.
+				 )
+			{
+				SERVERCOMMANDS_SetThingFrame( pActor, pActor->state, ulClient, SVCF_ONLYTHISCLIENT, false );
+			}
 
-		// [BB] It's possible that the MaxHealth property was changed dynamically with ACS, so send it.
-		SERVERCOMMANDS_SetPlayerMaxHealth( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+			// [WS/BB] Always inform client of the actor's lastX/Y/Z.
+			ULONG ulBits = CM_LAST_X|CM_LAST_Y|CM_LAST_Z;
 
-		// [BB] Send the number of lives left.
-		SERVERCOMMANDS_SetPlayerLivesLeft( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+			if ( pActor->velx != 0 )
+				ulBits |= CM_VELX;
 
-		// [BB] Send this player's statuses to the new client.
-		SERVERCOMMANDS_SetPlayerStatus( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+			if ( pActor->vely != 0 )
+				ulBits |= CM_VELY;
 
-		// [BB] If this player has any cheats, also inform the new client.
-		if( players[ulIdx].cheats )
-			SERVERCOMMANDS_SetPlayerCheats(  ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+			if ( pActor->velz != 0 )
+				ulBits |= CM_VELZ;
 
-		// [Dusk] Hexen armor values
-		SERVERCOMMANDS_SyncHexenArmorSlots( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-
-		// [WS] Update the player's properties if they changed.
-		SERVER_UpdateActorProperties( players[ulIdx].mo, ulClient );
-
-		// [TP] Update the player's TID, if there is one.
-		if ( players[ulIdx].mo->tid )
-			SERVERCOMMANDS_SetThingTID( players[ulIdx].mo, ulClient, SVCF_ONLYTHISCLIENT );
-
-		// [AK] Update the player's country index if they're not a bot, they aren't hiding it, and it isn't "N/A".
-		if (( players[ulIdx].bIsBot == false ) && ( g_aClients[ulIdx].bWantHideCountry == false ) && ( players[ulIdx].ulCountryIndex > 0 ))
-			SERVERCOMMANDS_SetPlayerCountry( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-
-		// [TP] Account name.
-		if ( g_aClients[ulIdx].WantHideAccount == false )
-			SERVERCOMMANDS_SetPlayerAccountName( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-	}
-
-	// Server may have already picked a team for the incoming player. If so, tell him!
-	if (( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS ) && players[ulClient].bOnTeam )
-		SERVERCOMMANDS_SetPlayerTeam( ulClient, ulClient, SVCF_ONLYTHISCLIENT );
+			if ( pActor->pitch != 0 )
+				ulBits |= CM_PITCH;
 
-	// [AK] In case this player's already dead, let them know how much time they
-	// have left until they can respawn again.
-	if ( players[ulClient].playerstate == PST_DEAD )
-		SERVERCOMMANDS_SetLocalPlayerRespawnDelayTime( ulClient );
+			if ( pActor->movedir != 0 )
+				ulBits |= CM_MOVEDIR;
 
-	// [BB] This game mode uses teams, so inform the incoming player about the scores/wins/frags of the teams.
-	if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS )
-	{
-		for ( ulIdx = 0; ulIdx < teams.Size( ); ulIdx++ )
-		{
-			if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNWINS )
-				SERVERCOMMANDS_SetTeamScore( ulIdx, TEAMSCORE_WINS, false, ulClient, SVCF_ONLYTHISCLIENT );
-			else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNPOINTS )
-				SERVERCOMMANDS_SetTeamScore( ulIdx, TEAMSCORE_POINTS, false, ulClient, SVCF_ONLYTHISCLIENT );
-			else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNFRAGS )
-				SERVERCOMMANDS_SetTeamScore( ulIdx, TEAMSCORE_FRAGS, false, ulClient, SVCF_ONLYTHISCLIENT );
+			if ( ulBits != 0 )
+				SERVERCOMMANDS_MoveThingExact( pActor, ulBits, ulClient, SVCF_ONLYTHISCLIENT );
 		}
-	}
 
-	// [BB] Tell individual player scores/wins/frags/kills to the client.
-	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-	{
-		if ( playeringame[ulIdx] == false )
-			continue;
+		// If it's important to update this thing's arguments, do that now.
+		// [BB] Wouldn't it be better, if this is done for all things, for which
+		// at least one of the arguments is not equal to zero?
+		// [BC] It's not necessarily important for clients to know this, such
+		// as with invasion spawners. You can do it if you want, though! It would
+		// probably save headache later on.
+		//if ( pActor->NetworkFlags & NETFL_UPDATEARGUMENTS )
+		// [BB] I don't want to export NETFL_UPDATEARGUMENTS to DECORATE, so we have
+		// to tell the clients all the arguments.
+		if ( ( pActor->args[0] != 0 )
+			|| ( pActor->args[1] != 0 )
+			|| ( pActor->args[2] != 0 )
+			|| ( pActor->args[3] != 0 )
+			|| ( pActor->args[4] != 0 ) )
+			SERVERCOMMANDS_SetThingArguments( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
-		// [BB] In all cooperative game modes players get kills, otherwise they get frags
-		// (even if the game mode is not won with frags).
-		if ( GAMEMODE_GetCurrentFlags() & GMF_COOPERATIVE )
-			SERVERCOMMANDS_SetPlayerKillCount( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-		else
-			SERVERCOMMANDS_SetPlayerFrags( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+		// [BB] Clients need to know the SectorAction specials to predict them.
+		// [EP] Spectators need to know the allowed specials to use them.
+		if ( ( NETWORK_IsClientPredictedSpecial ( pActor->special ) || GAMEMODE_IsSpectatorAllowedSpecial ( pActor->special ) )
+			&& pActor->IsKindOf( PClass::FindClass( "SectorAction" ) ) )
+			SERVERCOMMANDS_SetThingSpecial ( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
-		if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNWINS )
-			SERVERCOMMANDS_SetPlayerWins( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-		else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNPOINTS )
-			SERVERCOMMANDS_SetPlayerPoints( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+		// [BB] Some things like AMovingCamera rely on the AActor tid.
+		// So tell it to the client. I have no idea if this has unwanted side
+		// effects. Has to be checked.
+		if ( pActor->tid != 0 )
+			SERVERCOMMANDS_SetThingTID( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
-		// [AK] Tell the client how many times this player died.
-		SERVERCOMMANDS_SetPlayerDeaths( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
-	}
+		// If this thing's translation has been altered, tell the client.
+		if ( pActor->Translation != 0 )
+			SERVERCOMMANDS_SetThingTranslation( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
-	// Send Domination State
-	if ( domination )
-	{
-		for ( unsigned int i = 0; i < level.info->SectorInfo.Points.Size(); i++ )
+		// This item has been picked up, and is in its hidden, respawn state. Let
+		// the client know that.
+		if (( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideDoomish") ) ||	// S_HIDEDOOMISH
+			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideSpecial") ) ||	// S_HIDESPECIAL
+			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideIndefinitely") ))
 		{
-			SERVERCOMMANDS_SetDominationPointOwner( i, level.info->SectorInfo.Points[i].owner, false, ulClient, SVCF_ONLYTHISCLIENT );
-			SERVERCOMMANDS_SetDominationPointState( i, level.info->SectorInfo.Points[i], ulClient, SVCF_ONLYTHISCLIENT );
+			SERVERCOMMANDS_HideThing( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 		}
-	}
 
-	// If we're in duel mode, tell the client how many duels have taken place.
-	if ( duel )
-		SERVERCOMMANDS_SetDuelNumDuels( ulClient, SVCF_ONLYTHISCLIENT );
+		// Let the clients know if an object is dormant or not.
+		if ( pActor->IsActive( ) == false )
+			SERVERCOMMANDS_ThingDeactivate( pActor, NULL, ulClient, SVCF_ONLYTHISCLIENT );
 
-	// Send the level time.
-	if ( timelimit )
-		SERVERCOMMANDS_SetMapTime( ulClient, SVCF_ONLYTHISCLIENT );
-
-	// Go through all the items on the map, and tell the client to spawn those of which
-	// are important.
-	while (( pActor = Iterator.Next( )))
-	{
-		// If the actor doesn't have a network ID, don't spawn it (it
-		// probably isn't important).
-		if ( pActor->NetID == 0 )
-			continue;
-
-		// [BB] The other clients already have destroyed this actor, so don't spawn it.
-		if ( pActor->NetworkFlags & NETFL_DESTROYED_ON_CLIENT )
-			continue;
-
-		// Don't spawn players, items about to be deleted, inventory items
-		// that have an owner, or items that the client spawns himself.
-		if (( pActor->IsKindOf( RUNTIME_CLASS( APlayerPawn ))) ||
-			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HoldAndDestroy") ) ||	// S_HOLDANDDESTROY
-			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("Held") ) || // S_HELD
-			( pActor->NetworkFlags & NETFL_ALLOWCLIENTSPAWN ))
+		// [BB] Active ActorMovers need to be synced with the client.
+		if ( pActor->IsKindOf( PClass::FindClass( "ActorMover" ) ) && pActor->IsActive( ) )
 		{
-			continue;
+			static_cast<APathFollower *> ( pActor )->SyncWithClient ( ulClient );
+			SERVERCOMMANDS_ThingActivate( pActor, NULL, ulClient, SVCF_ONLYTHISCLIENT );
 		}
 
-		// [BB] Don't spawn things hidden by AActor::HideOrDestroyIfSafe().
-		// The clients don't need them at all, since the server will tell
-		// them to spawn a new actor during GAME_ResetMap anyway.
-		if ( !( pActor->IsKindOf( RUNTIME_CLASS( AInventory ) ) )
-		     && ( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideIndefinitely") ) // S_HIDEINDEFINITELY 
-		   )
-		{
-			continue;
-		}
-
-		// Spawn a missile. Missiles must be handled differently because they have
-		// velocity.
-		if ( pActor->flags & MF_MISSILE )
-		{
-			SERVERCOMMANDS_SpawnMissile( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-		}
-		// Tell the client to spawn this thing.
-		else
-		{
-			// [EP] Handle level-spawned actors which didn't move yet on X/Y axes.
-			bool shouldLevelSpawn = false;
-			if ((pActor->STFlags & STFL_LEVELSPAWNED) != 0)
-			{
-				shouldLevelSpawn = (pActor->x == pActor->SpawnPoint[0] 
-					&& pActor->y == pActor->SpawnPoint[1]);
-			}
-			if ( shouldLevelSpawn )
-			{
-				SERVERCOMMANDS_LevelSpawnThing( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-			}
-			else
-			{
-				SERVERCOMMANDS_SpawnThing( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-			}
-			// [BB] If the thing is not at its spawn point, let the client know about the spawn point.
-			if ( ( pActor->x != pActor->SpawnPoint[0] )
-				|| ( pActor->y != pActor->SpawnPoint[1] )
-				|| ( pActor->z != pActor->SpawnPoint[2] )
-				)
-			{
-				SERVERCOMMANDS_SetThingSpawnPoint( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-			}
-
-			// [BB] Since the monster movement is client side, the client needs to be
-			// informed about the velocity and the current state. If the frame is not
-			// set, the client thinks the actor is in its spawn state.
-			{
-
-				if ( (pActor->InSpawnState() == false)
-					 && !(( pActor->health <= 0 ) && ( pActor->flags & MF_COUNTKILL )) // [BB] Corpses are handled later.
-					 )
-				{
-					SERVERCOMMANDS_SetThingFrame( pActor, pActor->state, ulClient, SVCF_ONLYTHISCLIENT, false );
-				}
-
-				// [WS/BB] Always inform client of the actor's lastX/Y/Z.
-				ULONG ulBits = CM_LAST_X|CM_LAST_Y|CM_LAST_Z;
+		// Update the water level of the actor, but not if it's a player!
+		if (( pActor->waterlevel > 0 ) && ( pActor->player == NULL ))
+			SERVERCOMMANDS_SetThingWaterLevel( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
-				if ( pActor->velx != 0 )
-					ulBits |= CM_VELX;
+		// [WS] Update the actor's properties if they changed.
+		SERVER_UpdateActorProperties( pActor, ulClient );
 
-				if ( pActor->vely != 0 )
-					ulBits |= CM_VELY;
+		// If any of this actor's flags have changed during the course of the level, notify
+		// the client.
+		// [BB] InterpolationPoint abuses the MF_AMBUSH flag, so we have to exclude this class here.
+		if ( pActor->IsKindOf( PClass::FindClass( "InterpolationPoint" ) ) == false )
+			SERVERCOMMANDS_UpdateThingFlagsNotAtDefaults( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
-				if ( pActor->velz != 0 )
-					ulBits |= CM_VELZ;
-
-				if ( pActor->pitch != 0 )
-					ulBits |= CM_PITCH;
-
-				if ( pActor->movedir != 0 )
-					ulBits |= CM_MOVEDIR;
-
-				if ( ulBits != 0 )
-					SERVERCOMMANDS_MoveThingExact( pActor, ulBits, ulClient, SVCF_ONLYTHISCLIENT );
-			}
-
-			// If it's important to update this thing's arguments, do that now.
-			// [BB] Wouldn't it be better, if this is done for all things, for which
-			// at least one of the arguments is not equal to zero?
-			// [BC] It's not necessarily important for clients to know this, such
-			// as with invasion spawners. You can do it if you want, though! It would
-			// probably save headache later on.
-			//if ( pActor->NetworkFlags & NETFL_UPDATEARGUMENTS )
-			// [BB] I don't want to export NETFL_UPDATEARGUMENTS to DECORATE, so we have
-			// to tell the clients all the arguments.
-			if ( ( pActor->args[0] != 0 )
-				|| ( pActor->args[1] != 0 )
-				|| ( pActor->args[2] != 0 )
-				|| ( pActor->args[3] != 0 )
-				|| ( pActor->args[4] != 0 ) )
-				SERVERCOMMANDS_SetThingArguments( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-
-			// [BB] Clients need to know the SectorAction specials to predict them.
-			// [EP] Spectators need to know the allowed specials to use them.
-			if ( ( NETWORK_IsClientPredictedSpecial ( pActor->special ) || GAMEMODE_IsSpectatorAllowedSpecial ( pActor->special ) )
-				&& pActor->IsKindOf( PClass::FindClass( "SectorAction" ) ) )
-				SERVERCOMMANDS_SetThingSpecial ( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-
-			// [BB] Some things like AMovingCamera rely on the AActor tid.
-			// So tell it to the client. I have no idea if this has unwanted side
-			// effects. Has to be checked.
-			if ( pActor->tid != 0 )
-				SERVERCOMMANDS_SetThingTID( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-
-			// If this thing's translation has been altered, tell the client.
-			if ( pActor->Translation != 0 )
-				SERVERCOMMANDS_SetThingTranslation( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-
-			// This item has been picked up, and is in its hidden, respawn state. Let
-			// the client know that.
-			if (( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideDoomish") ) ||	// S_HIDEDOOMISH
-				( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideSpecial") ) ||	// S_HIDESPECIAL
-				( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideIndefinitely") ))
-			{
-				SERVERCOMMANDS_HideThing( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-			}
-
-			// Let the clients know if an object is dormant or not.
-			if ( pActor->IsActive( ) == false )
-				SERVERCOMMANDS_ThingDeactivate( pActor, NULL, ulClient, SVCF_ONLYTHISCLIENT );
-
-			// [BB] Active ActorMovers need to be synced with the client.
-			if ( pActor->IsKindOf( PClass::FindClass( "ActorMover" ) ) && pActor->IsActive( ) )
-			{
-				static_cast<APathFollower *> ( pActor )->SyncWithClient ( ulClient );
-				SERVERCOMMANDS_ThingActivate( pActor, NULL, ulClient, SVCF_ONLYTHISCLIENT );
-			}
-
-			// Update the water level of the actor, but not if it's a player!
-			if (( pActor->waterlevel > 0 ) && ( pActor->player == NULL ))
-				SERVERCOMMANDS_SetThingWaterLevel( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-
-			// [WS] Update the actor's properties if they changed.
-			SERVER_UpdateActorProperties( pActor, ulClient );
-
-			// If any of this actor's flags have changed during the course of the level, notify
-			// the client.
-			// [BB] InterpolationPoint abuses the MF_AMBUSH flag, so we have to exclude this class here.
-			if ( pActor->IsKindOf( PClass::FindClass( "InterpolationPoint" ) ) == false )
-				SERVERCOMMANDS_UpdateThingFlagsNotAtDefaults( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-
-			// [BB] Now that the ammo amount from weapon pickups is handled on the server
-			// this shouldn't be necessary anymore. Remove after thorough testing.
-			// If this is a weapon, tell the client how much ammo it gives.
-			//if ( pActor->IsKindOf( RUNTIME_CLASS( AWeapon )))
-			//	SERVERCOMMANDS_SetWeaponAmmoGive( pActor, ulClient, SVCF_ONLYTHISCLIENT );
-		}
+		// [BB] Now that the ammo amount from weapon pickups is handled on the server
+		// this shouldn't be necessary anymore. Remove after thorough testing.
+		// If this is a weapon, tell the client how much ammo it gives.
+		//if ( pActor->IsKindOf( RUNTIME_CLASS( AWeapon )))
+		//	SERVERCOMMANDS_SetWeaponAmmoGive( pActor, ulClient, SVCF_ONLYTHISCLIENT );
+	}
 
-		// Check and see if it's important that the client know the angle of the object.
-		if ( pActor->angle != 0 )
-			SERVERCOMMANDS_SetThingAngle( pActor, ulClient, SVCF_ONLYTHISCLIENT );
+	// Check and see if it's important that the client know the angle of the object.
+	if ( pActor->angle != 0 )
+		SERVERCOMMANDS_SetThingAngle( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
-		// Spawned monster is a corpse.
-		if (( pActor->health <= 0 ) && ( pActor->flags & MF_COUNTKILL ))
-		{
-			SERVERCOMMANDS_ThingIsCorpse( pActor, ulClient, SVCF_ONLYTHISCLIENT );
+	// Spawned monster is a corpse.
+	if (( pActor->health <= 0 ) && ( pActor->flags & MF_COUNTKILL ))
+	{
+		SERVERCOMMANDS_ThingIsCorpse( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
-			// [Dusk/BB] Actor is not normally dead, let clients know the proper frame.
-			if ( pActor->InState (pActor->FindState (NAME_Death)) == false )
-				SERVERCOMMANDS_SetThingFrame( pActor, pActor->state, ulClient, SVCF_ONLYTHISCLIENT, false );
-		}
+		// [Dusk/BB] Actor is not normally dead, let clients know the proper frame.
+		if ( pActor->InState (pActor->FindState (NAME_Death)) == false )
+			SERVERCOMMANDS_SetThingFrame( pActor, pActor->state, ulClient, SVCF_ONLYTHISCLIENT, false );
 	}
+}
+
+//*****************************************************************************
+//
+// Sends the rest of the full update once the client knows all the actors.
+//
+static void server_FinishFullUpdate( ULONG ulClient )
+{
+	ULONG	ulIdx;
 
 	// Tell clients the found/total item/secrets count.
 	if ( GAMEMODE_GetCurrentFlags() & GMF_COOPERATIVE )
@@ -2966,6 +2973,10 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 	SERVERCOMMANDS_SyncPlayerMedalCounts( ulClient, SVCF_ONLYTHISCLIENT );
 
 	// [BB] Let the client know that the full update is completed.
+	// This always starts a new packet, so that tools that don't parse the server's
+	// commands (like the server load test) can still find it.
+	if (( g_aClients[ulClient].PacketBuffer.CalcSize( ) > 0 ) || ( g_BroadcastJournal.getPendingSize( ulClient, true ) > 0 ))
+		SERVER_SendClientPacket( ulClient, true );
 	SERVERCOMMANDS_FullUpdateCompleted( ulClient );
 	// [BB] The client will let us know that it received the update.
 	SERVER_GetClient ( ulClient )->bFullUpdateIncomplete = true;
@@ -2982,24 +2993,510 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 			const PlayerValue DefaultVal = pair->Value.GetDefaultValue( );
 
 			// [AK] First, tell them to reset everyone's values to default.
-			SERVERCOMMANDS_ResetCustomPlayerValue( pair->Value, MAXPLAYERS, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
+			SERVERCOMMANDS_ResetCustomPlayerValue( pair->Value, MAXPLAYERS, ulClient, SVCF_ONLYTHISCLIENT );
 
 			for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
 			{
 				// [AK] Ignore the client themselves, or invalid players.
-				if (( ulIdx == static_cast<ULONG>( g_lCurrentClient )) || ( PLAYER_IsValidPlayer( ulIdx ) == false ))
+				if (( ulIdx == ulClient) || ( PLAYER_IsValidPlayer( ulIdx ) == false ))
 					continue;
 
 				// [AK] Don't bother sending out values that are already equal to the default value.
 				if ( pair->Value.GetValue( ulIdx ) == DefaultVal )
 					continue;
 
-				SERVERCOMMANDS_SetCustomPlayerValue( pair->Value, ulIdx, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-			}
-		}
+				SERVERCOMMANDS_SetCustomPlayerValue( pair->Value, ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+			}
+		}
+	}
+}
+
+//*****************************************************************************
+//
+// Does what has to wait until the client knows all actors of its full update, as
+// requested by the FUF_* flags passed to SERVER_SendFullUpdate.
+//
+static void server_FollowUpFullUpdate( ULONG ulClient )
+{
+	ULONG		ulIdx;
+	AInventory	*pInventory;
+	const ULONG	ulFollowUps = g_aClients[ulClient].FullUpdate.ulFollowUps;
+
+	g_aClients[ulClient].FullUpdate.ulFollowUps = 0;
+
+	if ( ulFollowUps & FUF_SELECTWEAPON )
+	{
+		// [BB] If the player doesn't have a ReadyWeapon for some reason, try to give him
+		// his starting weapon so that we can tell him to select it.
+		if ( ( players[ulClient].ReadyWeapon == NULL ) && players[ulClient].mo )
+		{
+			pInventory = players[ulClient].mo->FindInventory ( players[ulClient].StartingWeaponName );
+			if ( pInventory && pInventory->IsKindOf( RUNTIME_CLASS( AWeapon ) ) )
+				players[ulClient].ReadyWeapon =  static_cast<AWeapon *>( pInventory );
+		}
+		// [BB] To sync the weapon state clear the player's weapon on the server now. Before this
+		// tell the client which weapon he is using. This will also make him tell us that he is bringing
+		// up a wepaon.
+		SERVERCOMMANDS_WeaponChange( ulClient, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [BB] If the client has a weapon, we just requested him to bring it up.
+		if ( players[ulClient].ReadyWeapon )
+		{
+				SERVER_GetClient ( ulClient )->bWeaponChangeRequested = true;
+				SERVER_GetClient ( ulClient )->bLastWeaponChangeRequestTick = gametic;
+		}
+
+		// [BB] Clear the weapon on the server. It will be brought up when the client tells us.
+		PLAYER_ClearWeapon( &players[ulClient] );
+	}
+
+	// If we need to start this client's enter scripts, do that now.
+	if ( g_aClients[ulClient].bRunEnterScripts )
+	{
+		FBehavior::StaticStartTypedScripts( SCRIPT_Enter, players[ulClient].mo, true );
+		g_aClients[ulClient].bRunEnterScripts = false;
+	}
+
+	if ( ulFollowUps & FUF_ITEMOWNERS )
+	{
+		if ( GAMEMODE_GetCurrentFlags() & GMF_USETEAMITEM )
+		{
+			// In ST/CTF games, let the incoming player know who has flags/skulls.
+			for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+			{
+				if ( SERVER_IsValidClient( ulIdx ) == false )
+					continue;
+
+				// Player shouldn't have a flag/skull if he's not on a team...
+				if (( players[ulIdx].bOnTeam == false ) || ( players[ulIdx].mo == NULL ))
+					continue;
+
+				// See if this player is carrying the opponents flag/skull.
+				pInventory = TEAM_FindOpposingTeamsItemInPlayersInventory ( &players[ulIdx] );
+				if ( pInventory )
+					SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+
+				// See if the player is carrying the white flag in OFCTF.
+				pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "WhiteFlag" ), true );
+				if (( oneflagctf ) && ( pInventory ))
+					SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+			}
+
+			// Also let the client know if flags/skulls are on the ground.
+			for ( ulIdx = 0; ulIdx < teams.Size( ); ulIdx++ )
+				SERVERCOMMANDS_SetTeamReturnTicks( ulIdx, TEAM_GetReturnTicks( ulIdx ), ulClient, SVCF_ONLYTHISCLIENT );
+
+			SERVERCOMMANDS_SetTeamReturnTicks( teams.Size( ), TEAM_GetReturnTicks( teams.Size( ) ), ulClient, SVCF_ONLYTHISCLIENT );
+		}
+
+		// If we're playing terminator, potentially tell the client who's holding the terminator
+		// artifact.
+		if ( terminator )
+		{
+			for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+			{
+				if (( playeringame[ulIdx] == false ) || ( players[ulIdx].mo == NULL ))
+					continue;
+
+				pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "PowerTerminatorArtifact" ));
+				if ( pInventory )
+					SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+			}
+		}
+
+		// If we're playing possession/team possession, potentially tell the client who's holding
+		// the possession artifact.
+		if ( possession || teampossession )
+		{
+			for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+			{
+				if (( playeringame[ulIdx] == false ) || ( players[ulIdx].mo == NULL ))
+					continue;
+
+				pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "PowerPossessionArtifact" ));
+				if ( pInventory )
+					SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+			}
+		}
+	}
+
+	if ( ulFollowUps & FUF_SELECTWEAPON )
+	{
+		// [BL] To remove pistol fire-fights if the player is supposed to be unarmed clear his inventory
+		if ( players[ulClient].bUnarmed )
+			SERVERCOMMANDS_DestroyAllInventory( ulClient, ulClient, SVCF_ONLYTHISCLIENT );
+	}
+}
+
+//*****************************************************************************
+//
+// Actors the client predicts specials with and those that drive scripted
+// motion are sent first, no matter where they are on the map.
+//
+static bool server_IsCriticalForFullUpdate( AActor *pActor )
+{
+	return ( pActor->IsKindOf( PClass::FindClass( "SectorAction" ))
+		|| pActor->IsKindOf( RUNTIME_CLASS( APathFollower ))
+		|| pActor->IsKindOf( RUNTIME_CLASS( AInterpolationPoint )));
+}
+
+//*****************************************************************************
+//
+struct FULLUPDATEACTOR_s
+{
+	AActor	*pActor;
+	bool	bCritical;
+	double	dDistance;
+
+	bool operator< ( const FULLUPDATEACTOR_s &Other ) const
+	{
+		if ( bCritical != Other.bCritical )
+			return bCritical;
+
+		return ( dDistance < Other.dDistance );
+	}
+};
+
+//*****************************************************************************
+//
+// Collects the actors the client has to be told about. Whether an actor
+// is actually sent is decided once it's its turn, by then it may have changed.
+//
+static void server_StartFullUpdateStream( ULONG ulClient )
+{
+	static TArray<FULLUPDATEACTOR_s>	actors;
+	FULLUPDATESTREAM_s					&stream = g_aClients[ulClient].FullUpdate;
+	const AActor						*pOrigin = players[ulClient].camera ? players[ulClient].camera : players[ulClient].mo;
+	TThinkerIterator<AActor>			Iterator;
+	AActor								*pActor;
+
+	actors.Clear( );
+	while (( pActor = Iterator.Next( )))
+	{
+		if ( pActor->NetID == 0 )
+			continue;
+
+		FULLUPDATEACTOR_s actor;
+		actor.pActor = pActor;
+		actor.bCritical = server_IsCriticalForFullUpdate( pActor );
+		actor.dDistance = 0;
+
+		// Without a body to start from, the actors keep the thinker order.
+		if ( pOrigin != NULL )
+		{
+			const double dX = FIXED2DBL( pActor->x - pOrigin->x );
+			const double dY = FIXED2DBL( pActor->y - pOrigin->y );
+			const double dZ = FIXED2DBL( pActor->z - pOrigin->z );
+			actor.dDistance = dX * dX + dY * dY + dZ * dZ;
+		}
+
+		actors.Push( actor );
+	}
+
+	if ( actors.Size( ) > 0 )
+		std::stable_sort( &actors[0], &actors[0] + actors.Size( ));
+
+	stream.Actors.Resize( actors.Size( ));
+	stream.ActorNetIDs.Resize( actors.Size( ));
+	for ( unsigned int i = 0; i < actors.Size( ); ++i )
+	{
+		stream.Actors[i] = actors[i].pActor;
+		stream.ActorNetIDs[i] = actors[i].pActor->NetID;
+	}
+
+	stream.bActive = true;
+	stream.ulNextActor = 0;
+	stream.ulNumActors = actors.Size( );
+	stream.ulBytesSent = 0;
+	stream.lStartTic = gametic;
+	stream.lEndTic = gametic;
+}
+
+//*****************************************************************************
+//
+// Sends as many of the remaining actors as sv_fullupdatebytespertic permits.
+//
+static void server_StepFullUpdateStream( ULONG ulClient )
+{
+	CLIENT_s			*pClient = SERVER_GetClient( ulClient );
+	FULLUPDATESTREAM_s	&stream = pClient->FullUpdate;
+	const ULONG			ulStartBytes = pClient->ulReliableBytesWritten;
+
+	if ( stream.bActive == false )
+		return;
+
+	// Don't pile up more packets while the link still hasn't taken the previous ones.
+	if (( sv_fullupdatebytespertic > 0 ) && ( pClient->SavedPackets.GetNumUnsentPackets( ) > 0 ))
+		return;
+
+	while ( stream.ulNextActor < stream.ulNumActors )
+	{
+		if (( sv_fullupdatebytespertic > 0 ) && ( pClient->ulReliableBytesWritten - ulStartBytes >= static_cast<ULONG>( *sv_fullupdatebytespertic )))
+			break;
+
+		AActor *pActor = stream.Actors[stream.ulNextActor];
+		const unsigned short usNetID = stream.ActorNetIDs[stream.ulNextActor];
+		stream.ulNextActor++;
+
+		// If the actor was destroyed in the meantime, its ID doesn't lead to it anymore.
+		if ( g_ActorNetIDList.findPointerByID( usNetID ) != pActor )
+			continue;
+
+		if ( server_ShouldSendActorInFullUpdate( pActor ))
+			server_SendActorFullUpdate( pActor, ulClient );
+	}
+
+	if ( stream.ulNextActor >= stream.ulNumActors )
+	{
+		server_FinishFullUpdate( ulClient );
+
+		stream.bActive = false;
+		stream.lEndTic = gametic;
+		stream.Actors.Clear( );
+		stream.ActorNetIDs.Clear( );
+
+		server_FollowUpFullUpdate( ulClient );
+	}
+
+	stream.ulBytesSent += pClient->ulReliableBytesWritten - ulStartBytes;
+}
+
+//*****************************************************************************
+//
+void SERVER_SendFullUpdate( ULONG ulClient, ULONG ulFollowUps )
+{
+	ULONG						ulIdx;
+	player_t*					pPlayer;
+	AInventory					*pInventory;
+	CLIENT_s					*pClient = SERVER_GetClient( ulClient );
+	const ULONG					ulStartBytes = pClient->ulReliableBytesWritten;
+
+	// Should a previous full update still be running, it starts over. What it should
+	// have done afterwards is done after this one.
+	SERVER_CancelFullUpdate( ulClient );
+	pClient->FullUpdate.ulFollowUps |= ulFollowUps;
+
+	// [BB] The client will let us know that it received the update.
+	pClient->bFullUpdateIncomplete = true;
+
+	// The client starts from scratch, so it has none of the baselines for delta compressed movement.
+	SERVERCOMMANDS_ClearMovementHistory( ulClient );
+
+	// Send active players to the client.
+	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		if (( ulClient == ulIdx ) || ( playeringame[ulIdx] == false ))
+			continue;
+
+		pPlayer = &players[ulIdx];
+		if ( pPlayer->mo == NULL )
+			continue;
+
+		// [BB] To properly spawn the players the client already needs to know the userinfo, e.g. the handicap value.
+		SERVERCOMMANDS_SetAllPlayerUserInfo( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+		// [BB] Make sure that morphed players are spawned as morphed.
+		SERVERCOMMANDS_SpawnPlayer( ulIdx, PST_REBORNNOINVENTORY, ulClient, SVCF_ONLYTHISCLIENT, !!( pPlayer->morphTics ) );
+		// [BB] Since the player possibly lost something from his default inventory, destory everything
+		// he is spawned with on the client. Everything the client has to know about the inventory is
+		// handled below.
+		SERVERCOMMANDS_DestroyAllInventory( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// Also send this player's team.
+		if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS )
+			SERVERCOMMANDS_SetPlayerTeam( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// Check if we need to tell the incoming player about any powerups this player may have.
+		// [BB] Also tell about all the ammo, weapons, backpacks and keys this player has.
+		// [BB] Keys need to be handled carefully. In order to display them properly in ST's fullscrenn HUD
+		// in coop spy, they need to be given in reverse order.
+		TArray<AInventory *> keys;
+		for ( pInventory = pPlayer->mo->Inventory; pInventory != NULL; pInventory = pInventory->Inventory )
+		{
+			if ( pInventory->IsKindOf( RUNTIME_CLASS( APowerup )))
+			{
+				SERVERCOMMANDS_GivePowerup( ulIdx, static_cast<APowerup *>( pInventory ), ulClient, SVCF_ONLYTHISCLIENT );
+
+				// [BB] If it's a rune, we need to explicitly set its icon since it was set by the RuneGiver.
+				if ( pInventory == pInventory->Owner->Rune )
+				{
+					SERVERCOMMANDS_SetInventoryIcon( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+				}
+			}
+			// [WS] Inform clients of their PowerupGiver items.
+			else if ( pInventory->IsKindOf( RUNTIME_CLASS( AAmmo )) || pInventory->IsKindOf( RUNTIME_CLASS( AWeapon ))
+				|| pInventory->IsKindOf( RUNTIME_CLASS( ABackpackItem ))
+				|| pInventory->IsKindOf( RUNTIME_CLASS( APowerupGiver )) )
+			{
+				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+				// [BB] Ammo max amount needs to be handled explicitly.
+				if ( pInventory->IsKindOf( RUNTIME_CLASS( AAmmo ) ) )
+					SERVERCOMMANDS_SetPlayerAmmoCapacity( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+			}
+			else if ( pInventory->IsKindOf( RUNTIME_CLASS( AKey )) )
+				keys.Push ( pInventory );
+			else if ( pInventory->IsA( RUNTIME_CLASS( AWeaponHolder )) )
+			{
+				// [Dusk] Inform the client of weapon holders
+				SERVERCOMMANDS_GiveWeaponHolder( ulIdx, static_cast<AWeaponHolder *>( pInventory ), ulClient, SVCF_ONLYTHISCLIENT );
+			}
+		}
+		// [BB] Now give the keys we just collected from the inventory in reverse order.
+		while ( keys.Size() )
+		{
+			keys.Pop( pInventory );
+			SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+		}
+
+		// Also if this player is currently dead, let the incoming player know that.
+		if ( pPlayer->mo->health <= 0 )
+			SERVERCOMMANDS_ThingIsCorpse( pPlayer->mo, ulClient, SVCF_ONLYTHISCLIENT );
+		// [BB] SERVERCOMMANDS_SpawnPlayer instructs the client to spawn a player
+		// with default health. So we still need to send the correct current health value
+		// (if the player is not dead). Also set the armor and the corresponding max bonuses.
+		else
+		{
+			SERVERCOMMANDS_SetPlayerHealthAndMaxHealthBonus( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+			SERVERCOMMANDS_SetPlayerArmorAndMaxArmorBonus( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+			// [BB] Also send all non-default flag values.
+			SERVERCOMMANDS_UpdateThingFlagsNotAtDefaults( pPlayer->mo, ulClient, SVCF_ONLYTHISCLIENT );
+
+			// [BB] If the player is in its SeeState, let the client know.
+			if ( ( pPlayer->mo->SeeState != NULL ) && ( pPlayer->mo->InStateSequence(pPlayer->mo->state, pPlayer->mo->SeeState) ) )
+				SERVERCOMMANDS_SetPlayerState( ulIdx, STATE_PLAYER_SEE, ulClient, SVCF_ONLYTHISCLIENT);
+		}
+
+		// [BB] Clients need to know the active weapons of other players, so send it.
+		SERVERCOMMANDS_WeaponChange( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [geNia] Clients need to know player's current skin in ACS.
+		SERVERCOMMANDS_SetPlayerACSSkin( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [BB] It's possible that the MaxHealth property was changed dynamically with ACS, so send it.
+		SERVERCOMMANDS_SetPlayerMaxHealth( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [BB] Send the number of lives left.
+		SERVERCOMMANDS_SetPlayerLivesLeft( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [BB] Send this player's statuses to the new client.
+		SERVERCOMMANDS_SetPlayerStatus( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [BB] If this player has any cheats, also inform the new client.
+		if( players[ulIdx].cheats )
+			SERVERCOMMANDS_SetPlayerCheats(  ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [Dusk] Hexen armor values
+		SERVERCOMMANDS_SyncHexenArmorSlots( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [WS] Update the player's properties if they changed.
+		SERVER_UpdateActorProperties( players[ulIdx].mo, ulClient );
+
+		// [TP] Update the player's TID, if there is one.
+		if ( players[ulIdx].mo->tid )
+			SERVERCOMMANDS_SetThingTID( players[ulIdx].mo, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [AK] Update the player's country index if they're not a bot, they aren't hiding it, and it isn't "N/A".
+		if (( players[ulIdx].bIsBot == false ) && ( g_aClients[ulIdx].bWantHideCountry == false ) && ( players[ulIdx].ulCountryIndex > 0 ))
+			SERVERCOMMANDS_SetPlayerCountry( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [TP] Account name.
+		if ( g_aClients[ulIdx].WantHideAccount == false )
+			SERVERCOMMANDS_SetPlayerAccountName( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+	}
+
+	// Server may have already picked a team for the incoming player. If so, tell him!
+	if (( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS ) && players[ulClient].bOnTeam )
+		SERVERCOMMANDS_SetPlayerTeam( ulClient, ulClient, SVCF_ONLYTHISCLIENT );
+
+	// [AK] In case this player's already dead, let them know how much time they
+	// have left until they can respawn again.
+	if ( players[ulClient].playerstate == PST_DEAD )
+		SERVERCOMMANDS_SetLocalPlayerRespawnDelayTime( ulClient );
+
+	// [BB] This game mode uses teams, so inform the incoming player about the scores/wins/frags of the teams.
+	if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS )
+	{
+		for ( ulIdx = 0; ulIdx < teams.Size( ); ulIdx++ )
+		{
+			if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNWINS )
+				SERVERCOMMANDS_SetTeamScore( ulIdx, TEAMSCORE_WINS, false, ulClient, SVCF_ONLYTHISCLIENT );
+			else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNPOINTS )
+				SERVERCOMMANDS_SetTeamScore( ulIdx, TEAMSCORE_POINTS, false, ulClient, SVCF_ONLYTHISCLIENT );
+			else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNFRAGS )
+				SERVERCOMMANDS_SetTeamScore( ulIdx, TEAMSCORE_FRAGS, false, ulClient, SVCF_ONLYTHISCLIENT );
+		}
+	}
+
+	// [BB] Tell individual player scores/wins/frags/kills to the client.
+	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		if ( playeringame[ulIdx] == false )
+			continue;
+
+		// [BB] In all cooperative game modes players get kills, otherwise they get frags
+		// (even if the game mode is not won with frags).
+		if ( GAMEMODE_GetCurrentFlags() & GMF_COOPERATIVE )
+			SERVERCOMMANDS_SetPlayerKillCount( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+		else
+			SERVERCOMMANDS_SetPlayerFrags( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNWINS )
+			SERVERCOMMANDS_SetPlayerWins( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+		else if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSEARNPOINTS )
+			SERVERCOMMANDS_SetPlayerPoints( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// [AK] Tell the client how many times this player died.
+		SERVERCOMMANDS_SetPlayerDeaths( ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
+	}
+
+	// Send Domination State
+	if ( domination )
+	{
+		for ( unsigned int i = 0; i < level.info->SectorInfo.Points.Size(); i++ )
+		{
+			SERVERCOMMANDS_SetDominationPointOwner( i, level.info->SectorInfo.Points[i].owner, false, ulClient, SVCF_ONLYTHISCLIENT );
+			SERVERCOMMANDS_SetDominationPointState( i, level.info->SectorInfo.Points[i], ulClient, SVCF_ONLYTHISCLIENT );
+		}
+	}
+
+	// If we're in duel mode, tell the client how many duels have taken place.
+	if ( duel )
+		SERVERCOMMANDS_SetDuelNumDuels( ulClient, SVCF_ONLYTHISCLIENT );
+
+	// Send the level time.
+	if ( timelimit )
+		SERVERCOMMANDS_SetMapTime( ulClient, SVCF_ONLYTHISCLIENT );
+
+	// Everything above is needed right away, the actors on the map are
+	// sent over the next tics, the most important ones first.
+	server_StartFullUpdateStream( ulClient );
+	pClient->FullUpdate.ulBytesSent = pClient->ulReliableBytesWritten - ulStartBytes;
+	server_StepFullUpdateStream( ulClient );
+}
+
+//*****************************************************************************
+//
+void SERVER_TickFullUpdates( void )
+{
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		if (( g_aClients[ulIdx].State == CLS_FREE ) || ( g_aClients[ulIdx].FullUpdate.bActive == false ))
+			continue;
+
+		server_StepFullUpdateStream( ulIdx );
 	}
 }
 
+//*****************************************************************************
+//
+void SERVER_CancelFullUpdate( ULONG ulClient )
+{
+	FULLUPDATESTREAM_s &stream = g_aClients[ulClient].FullUpdate;
+
+	stream.bActive = false;
+	stream.Actors.Clear( );
+	stream.ActorNetIDs.Clear( );
+}
+
 //*****************************************************************************
 //
 void SERVER_WriteCommands( void )
@@ -3040,19 +3537,15 @@ void SERVER_WriteCommands( void )
 
 		// See if any players need to be updated to clients.
 		// [BB] Only necessary if we are in a level.
+		// The most relevant players come first, the least relevant ones are sent less often.
+		// The consoleplayer on a client has to be moved differently and isn't in the list.
 		if ( gamestate == GS_LEVEL )
 		{
-			for ( ULONG ulPlayer = 0; ulPlayer < MAXPLAYERS; ulPlayer++ )
-			{
-				if ( ( playeringame[ulPlayer] == false ) || players[ulPlayer].bSpectating )
-					continue;
-
-				// [BB] The consoleplayer on a client has to be moved differently.
-				if ( ulPlayer == ulIdx )
-					continue;
+			static TArray<ULONG> playersToUpdate;
+			SERVER_RELEVANCE_GetPlayerUpdateOrder( ulIdx, playersToUpdate );
 
-				SERVERCOMMANDS_MovePlayer( ulPlayer, ulIdx, SVCF_ONLYTHISCLIENT );
-			}
+			for ( unsigned int i = 0; i < playersToUpdate.Size( ); ++i )
+				SERVERCOMMANDS_MovePlayer( playersToUpdate[i], ulIdx, SVCF_ONLYTHISCLIENT );
 		}
 
 		// Spectators can move around freely, without us telling it what to do (lag-less).
@@ -3078,6 +3571,9 @@ void SERVER_WriteCommands( void )
 		SERVERCOMMANDS_MoveLocalPlayer( ulIdx );
 	}
 
+	// Send the actor positions that clients skipped because they weren't relevant.
+	SERVER_RELEVANCE_SendPendingUpdates( );
+
 	// Once every four seconds, update each player's ping.
 	if (( gametic % ( 4 * TICRATE )) == 0 )
 	{
@@ -3236,10 +3732,12 @@ void SERVER_DisconnectClient( ULONG ulClient, bool bBroadcast, bool bSaveInfo, L
 	// [BB] Clear any cheats the player had. Note: This may not be done before the player dropped the important items!
 	players[ulClient].cheats = players[ulClient].cheats2 = 0;
 
+	g_ClientAddressMap.Remove( g_aClients[ulClient].Address );
 	g_aClients[ulClient].Address.Clear( );
 	g_aClients[ulClient].State = CLS_FREE;
 	g_aClients[ulClient].ulLastGameTic = 0;
 	playeringame[ulClient] = false;
+	SERVER_MASTER_InvalidateLauncherCache( );
 
 	// Run the disconnect scripts now that the player is leaving.
 	// [AK] Only do this if the client is already spawned.
@@ -3260,7 +3758,10 @@ void SERVER_DisconnectClient( ULONG ulClient, bool bBroadcast, bool bSaveInfo, L
 	// Clear the client's buffers.
 	g_aClients[ulClient].PacketBuffer.Clear();
 	g_aClients[ulClient].UnreliablePacketBuffer.Clear();
+	g_BroadcastJournal.discard( ulClient, true );
+	g_BroadcastJournal.discard( ulClient, false );
 	g_aClients[ulClient].SavedPackets.Clear();
+	SERVER_CancelFullUpdate( ulClient );
 
 	// Tell the join queue module that a player has left the game.
 	JOINQUEUE_PlayerLeftGame( ulClient, true );
@@ -3787,6 +4288,9 @@ void SERVER_LoadNewLevel( const char *pszMapName )
 {
 	ULONG		ulIdx;
 
+	// Launcher responses built for the old map are no good anymore.
+	SERVER_MASTER_InvalidateLauncherCache( );
+
 	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
 	{
 		if ( SERVER_IsValidClient( ulIdx ) == false )
@@ -3812,6 +4316,9 @@ void SERVER_LoadNewLevel( const char *pszMapName )
 	// the map are not covered by the code above and need special treatment.
 	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
 	{
+		// The actors of the old map mustn't be sent anymore.
+		SERVER_CancelFullUpdate( ulIdx );
+
 		if ( SERVER_GetClient( ulIdx )->State == CLS_AUTHENTICATED )
 			SERVER_GetClient( ulIdx )->State = CLS_AUTHENTICATED_BUT_OUTDATED_MAP;
 	}
@@ -4821,6 +5328,57 @@ LONG SERVER_STATISTIC_GetCurrentInboundDataTransfer( void )
 	return ( g_lInboundDataTransferLastSecond );
 }
 
+//*****************************************************************************
+//
+ULONG SERVER_STATISTIC_GetAverageTicJitter( void )
+{
+	return ( g_ulAverageTicJitterLastSecond );
+}
+
+//*****************************************************************************
+//
+ULONG SERVER_STATISTIC_GetMaxTicJitter( void )
+{
+	return ( g_ulMaxTicJitterLastSecond );
+}
+
+//*****************************************************************************
+//
+ULONG SERVER_STATISTIC_GetCurrentTicOverruns( void )
+{
+	return ( g_ulTicOverrunsLastSecond );
+}
+
+//*****************************************************************************
+//
+QWORD SERVER_STATISTIC_GetTotalTicOverruns( void )
+{
+	return ( g_qwTotalTicOverruns );
+}
+
+//*****************************************************************************
+//
+void SERVER_STATISTIC_AddToLauncherResponses( bool bFromCache )
+{
+	g_qwTotalLauncherResponses++;
+	if ( bFromCache )
+		g_qwTotalCachedLauncherResponses++;
+}
+
+//*****************************************************************************
+//
+QWORD SERVER_STATISTIC_GetTotalLauncherResponses( void )
+{
+	return ( g_qwTotalLauncherResponses );
+}
+
+//*****************************************************************************
+//
+QWORD SERVER_STATISTIC_GetTotalCachedLauncherResponses( void )
+{
+	return ( g_qwTotalCachedLauncherResponses );
+}
+
 //*****************************************************************************
 //
 void SERVER_PrintCommand( LONG lCommand )
@@ -4834,7 +5392,7 @@ void SERVER_PrintCommand( LONG lCommand )
 		pszString = GetStringCLCC ( static_cast<CLCC> ( lCommand ) );
 	else
 	{
-		if (( sv_showcommands >= 2 ) && ( lCommand == CLC_CLIENTMOVE || lCommand == CLC_CLIENTMOVEBACKUP ))
+		if (( sv_showcommands >= 2 ) && ( lCommand == CLC_CLIENTMOVE || lCommand == CLC_CLIENTMOVEBACKUP || lCommand == CLC_PACKETACK || lCommand == CLC_PLAYERMOVEMENTACK ))
 			return;
 		if (( sv_showcommands >= 3 ) && ( lCommand == CLC_PONG ))
 			return;
@@ -4940,6 +5498,8 @@ bool SERVER_ProcessCommand( LONG lCommand, BYTESTREAM_s *pByteStream )
 	case CLC_QUIT:
 	case CLC_CLIENTMOVE:
 	case CLC_MISSINGPACKET:
+	case CLC_PACKETACK:
+	case CLC_PLAYERMOVEMENTACK:
 	case CLC_PONG:
 	case CLC_SPECTATE:
 	case CLC_SPECTATEINFO:
@@ -5021,6 +5581,14 @@ bool SERVER_ProcessCommand( LONG lCommand, BYTESTREAM_s *pByteStream )
 
 		// Client is missing a packet; it's our job to resend it!
 		return ( server_MissingPacket( pByteStream ));
+	case CLC_PACKETACK:
+
+		// Client tells us which packets it has received.
+		return ( server_PacketAck( pByteStream ));
+	case CLC_PLAYERMOVEMENTACK:
+
+		// Client tells us which updates of the players' movement it applied.
+		return ( server_PlayerMovementAck( pByteStream ));
 	case CLC_PONG:
 
 		// Ping response from client.
@@ -6123,12 +6691,46 @@ static bool server_MissingPacket( BYTESTREAM_s *pByteStream )
 	return ( false );
 }
 
+//*****************************************************************************
+//
+static bool server_PacketAck( BYTESTREAM_s *pByteStream )
+{
+	const LONG lLastParsedSequence = pByteStream->ReadLong();
+	const LONG lHighestReceivedSequence = pByteStream->ReadLong();
+	const ULONG ulReceivedBits = pByteStream->ReadLong();
+
+	// The packet archive checks whether this makes sense, a bogus acknowledgement
+	// can only make the client miss packets, which it then requests again.
+	g_aClients[g_lCurrentClient].SavedPackets.Acknowledge( lLastParsedSequence, lHighestReceivedSequence, ulReceivedBits );
+	return ( false );
+}
+
+//*****************************************************************************
+//
+static bool server_PlayerMovementAck( BYTESTREAM_s *pByteStream )
+{
+	const ULONG ulNumPlayers = pByteStream->ReadByte();
+
+	for ( ULONG ulIdx = 0; ulIdx < ulNumPlayers; ulIdx++ )
+	{
+		const ULONG ulPlayer = pByteStream->ReadByte();
+		const BYTE ucSequence = pByteStream->ReadByte();
+
+		// Acknowledgements of updates we don't know about are ignored there.
+		if ( ulPlayer < MAXPLAYERS )
+			SERVERCOMMANDS_AcknowledgePlayerMovement( g_lCurrentClient, ulPlayer, ucSequence );
+	}
+
+	return ( false );
+}
+
 //*****************************************************************************
 //
 static bool server_UpdateClientPing( BYTESTREAM_s *pByteStream )
 {
 	const unsigned int oldTime = pByteStream->ReadLong( );
-	const unsigned int nowTime = I_MSTime( );
+	// Use the time the packet arrived, not the time it is processed.
+	const unsigned int nowTime = NETWORK_GetPacketArrivalTime( );
 
 	// [BB] This ping information from the client doesn't make sense.
 	if ( oldTime > nowTime )
@@ -7072,42 +7674,8 @@ static bool server_AuthenticateLevel( BYTESTREAM_s *pByteStream )
 	// [AK] Update this player's own statuses.
 	SERVERCOMMANDS_SetPlayerStatus( g_lCurrentClient, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
 
-	// Send a snapshot of the level.
-	SERVER_SendFullUpdate( g_lCurrentClient );
-
-	// [BB] If the player doesn't have a ReadyWeapon for some reason, try to give him
-	// his starting weapon so that we can tell him to select it.
-	if ( ( players[g_lCurrentClient].ReadyWeapon == NULL ) && players[g_lCurrentClient].mo )
-	{
-		AInventory *pInventory = players[g_lCurrentClient].mo->FindInventory ( players[g_lCurrentClient].StartingWeaponName );
-		if ( pInventory && pInventory->IsKindOf( RUNTIME_CLASS( AWeapon ) ) )
-			players[g_lCurrentClient].ReadyWeapon =  static_cast<AWeapon *>( pInventory );
-	}
-	// [BB] To sync the weapon state clear the player's weapon on the server now. Before this
-	// tell the client which weapon he is using. This will also make him tell us that he is bringing
-	// up a wepaon.
-	SERVERCOMMANDS_WeaponChange( g_lCurrentClient, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-	// [BB] If the client has a weapon, we just requested him to bring it up.
-	if ( players[g_lCurrentClient].ReadyWeapon )
-	{
-			SERVER_GetClient ( g_lCurrentClient )->bWeaponChangeRequested = true;
-			SERVER_GetClient ( g_lCurrentClient )->bLastWeaponChangeRequestTick = gametic;
-	}
-
-	// [BB] Clear the weapon on the server. It will be brought up when the client tells us.
-	PLAYER_ClearWeapon( &players[g_lCurrentClient] );
-
-	// If we need to start this client's enter scripts, do that now.
-	if ( g_aClients[g_lCurrentClient].bRunEnterScripts )
-	{
-		FBehavior::StaticStartTypedScripts( SCRIPT_Enter, players[g_lCurrentClient].mo, true );
-		g_aClients[g_lCurrentClient].bRunEnterScripts = false;
-	}
-
-	// [BL] To remove pistol fire-fights if the player is supposed to be unarmed clear his inventory
-	if ( players[g_lCurrentClient].bUnarmed )
-		SERVERCOMMANDS_DestroyAllInventory( g_lCurrentClient, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
+	// Send a snapshot of the level. The weapon is selected once the actors are sent.
+	SERVER_SendFullUpdate( g_lCurrentClient, FUF_SELECTWEAPON );
 
 	// Finally, send out the packet.
 	SERVER_SendClientPacket( g_lCurrentClient, true );
@@ -7891,6 +8459,416 @@ CCMD( forcerename )
 	Printf( "Unknown player: %s\n", argv[1] );
 }
 
+//*****************************************************************************
+//
+CCMD( ticstats )
+{
+	// This function may not be used by ConsoleCommand.
+	if ( ACS_IsCalledFromConsoleCommand( ))
+		return;
+
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	Printf( "Tic jitter (last second): %lu ms average, %lu ms max\n", SERVER_STATISTIC_GetAverageTicJitter( ), SERVER_STATISTIC_GetMaxTicJitter( ));
+	Printf( "Tic overruns: %lu last second, %llu total\n", SERVER_STATISTIC_GetCurrentTicOverruns( ), static_cast<unsigned long long>( SERVER_STATISTIC_GetTotalTicOverruns( )));
+}
+
+//*****************************************************************************
+//
+// Shows how far the clients got with their last full update.
+CCMD( fullupdates )
+{
+	// This function may not be used by ConsoleCommand.
+	if ( ACS_IsCalledFromConsoleCommand( ))
+		return;
+
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		if (( SERVER_IsValidClient( ulIdx ) == false ) || players[ulIdx].bIsBot )
+			continue;
+
+		const FULLUPDATESTREAM_s &stream = g_aClients[ulIdx].FullUpdate;
+		if ( stream.ulNumActors == 0 && stream.ulBytesSent == 0 )
+			continue;
+
+		if ( stream.bActive )
+		{
+			// Assume the remaining actors are about as big as the ones sent so far.
+			const ULONG ulEstimate = ( stream.ulNextActor > 0 ) ? static_cast<ULONG>( static_cast<double>( stream.ulBytesSent ) * stream.ulNumActors / stream.ulNextActor ) : 0;
+			Printf( "%s: %lu of %lu actors, %lu of about %lu bytes, %ld tics\n", players[ulIdx].userinfo.GetName( ), stream.ulNextActor, stream.ulNumActors, stream.ulBytesSent, ulEstimate, gametic - stream.lStartTic );
+		}
+		else
+			Printf( "%s: complete, %lu actors, %lu bytes, %ld tics\n", players[ulIdx].userinfo.GetName( ), stream.ulNumActors, stream.ulBytesSent, stream.lEndTic - stream.lStartTic );
+	}
+}
+
+//*****************************************************************************
+//
+#if BUILD_ID != BUILD_RELEASE
+// Prepares the busiest tic recorded (or a made up one) for the benchmarks.
+static void server_PrepareBroadcastReplay( BroadcastJournal &replay, TArray<unsigned int> &numRecipients )
+{
+	replay.copyCommands( g_BusiestBroadcastTic );
+
+	if ( replay.getNumCommands( ) == 0 )
+	{
+		Printf( "No tic recorded yet, using 512 random commands.\n" );
+		BYTE abCommand[48];
+		for ( int i = 0; i < 512; ++i )
+		{
+			for ( unsigned int j = 0; j < sizeof( abCommand ); ++j )
+				abCommand[j] = M_Random( );
+			replay.addCommand( abCommand, 4 + M_Random( ) % 40 );
+		}
+	}
+
+	// Commands without recorded recipients go to everyone.
+	numRecipients.Clear( );
+	for ( unsigned int i = 0; i < replay.getNumCommands( ); ++i )
+	{
+		const unsigned int recipients = replay.getCommandNumRecipients( i );
+		numRecipients.Push(( recipients > 0 ) ? MIN<unsigned int>( recipients, MAXPLAYERS ) : MAXPLAYERS );
+	}
+}
+
+//*****************************************************************************
+//
+// Replays the busiest tic recorded in the broadcast journal (or a made up one) for
+// MAXPLAYERS fake clients, once copying every command into every client's buffer and once
+// through the journal, and compares bytes copied and time spent.
+BENCHMARK( broadcast )
+{
+	int numReplays = 100;
+	if ( argv.argc( ) > 1 )
+		numReplays = MAX( atoi( argv[1] ), 1 );
+
+	// Don't touch g_BroadcastJournal, it may hold references for the real clients.
+	static BroadcastJournal replay;
+	static BroadcastJournal journal;
+	TArray<unsigned int> numRecipients;
+	server_PrepareBroadcastReplay( replay, numRecipients );
+
+	const unsigned int maxPacketSize = SERVER_GetMaxPacketSize( ) ? SERVER_GetMaxPacketSize( ) : MAX_UDP_PACKET;
+	NETBUFFER_s buffers[MAXPLAYERS];
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		buffers[ulIdx].Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+
+	QWORD copiedDirect = 0;
+	QWORD copiedJournal = 0;
+	QWORD copyCallsDirect = 0;
+	QWORD copyCallsJournal = 0;
+	cycle_t directTime;
+	cycle_t journalTime;
+	directTime.Reset( );
+	journalTime.Reset( );
+
+	for ( int replayIdx = 0; replayIdx < numReplays; ++replayIdx )
+	{
+		directTime.Clock( );
+		for ( unsigned int i = 0; i < replay.getNumCommands( ); ++i )
+		{
+			const unsigned int size = replay.getCommandSize( i );
+			for ( ULONG ulIdx = 0; ulIdx < numRecipients[i]; ulIdx++ )
+			{
+				// Clearing the buffer stands in for sending the packet.
+				if ( buffers[ulIdx].CalcSize( ) + size + 5 >= maxPacketSize )
+					buffers[ulIdx].Clear( );
+
+				buffers[ulIdx].ByteStream.WriteBuffer( replay.getCommandData( i ), size );
+				copiedDirect += size;
+				copyCallsDirect++;
+			}
+		}
+		for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+			buffers[ulIdx].Clear( );
+		directTime.Unclock( );
+
+		journalTime.Clock( );
+		for ( unsigned int i = 0; i < replay.getNumCommands( ); ++i )
+		{
+			const unsigned int size = replay.getCommandSize( i );
+			const unsigned int command = journal.addCommand( replay.getCommandData( i ), size );
+			copiedJournal += size;
+			copyCallsJournal++;
+
+			for ( ULONG ulIdx = 0; ulIdx < numRecipients[i]; ulIdx++ )
+			{
+				if ( buffers[ulIdx].CalcSize( ) + journal.getPendingSize( ulIdx, true ) + size + 5 >= maxPacketSize )
+				{
+					copiedJournal += journal.flush( ulIdx, true, buffers[ulIdx].ByteStream );
+					copyCallsJournal++;
+					buffers[ulIdx].Clear( );
+				}
+				journal.addReference( ulIdx, true, command );
+			}
+		}
+		for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		{
+			if ( journal.getPendingSize( ulIdx, true ) > 0 )
+			{
+				copiedJournal += journal.flush( ulIdx, true, buffers[ulIdx].ByteStream );
+				copyCallsJournal++;
+			}
+			buffers[ulIdx].Clear( );
+		}
+		journal.clear( );
+		journalTime.Unclock( );
+	}
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		buffers[ulIdx].Free( );
+
+	Printf( "Replayed %u commands (%u bytes) %d times.\n", replay.getNumCommands( ), replay.getSize( ), numReplays );
+	Printf( "Direct:  %.3f ms, %llu bytes in %llu copies\n", directTime.TimeMS( ), static_cast<unsigned long long>( copiedDirect ), static_cast<unsigned long long>( copyCallsDirect ));
+	Printf( "Journal: %.3f ms, %llu bytes in %llu copies\n", journalTime.TimeMS( ), static_cast<unsigned long long>( copiedJournal ), static_cast<unsigned long long>( copyCallsJournal ));
+}
+
+//*****************************************************************************
+//
+// Puts a packet together like SERVER_SendClientPacket did before the packets were
+// assembled from segments, and returns how many bytes were copied on the way.
+static ULONG server_AssembleCopiedPacket( BroadcastJournal &journal, ULONG ulClient, bool bReliable, NETBUFFER_s &Buffer, NETBUFFER_s &Archive, NETBUFFER_s &TempBuffer, BYTE *pbOutput, int iOutputSize )
+{
+	NETPACKETSEGMENT_s	Segment;
+	ULONG				ulCopied = 0;
+
+	TempBuffer.Clear( );
+
+	if ( bReliable )
+	{
+		// The commands were flushed into the buffer, the buffer stored in the archive,
+		// and the stored packet copied behind its header to be sent.
+		ulCopied += journal.flush( ulClient, true, Buffer.ByteStream );
+		if ( Archive.CalcSize( ) + Buffer.CalcSize( ) >= static_cast<LONG>( Archive.ulMaxSize ))
+			Archive.Clear( );
+		const BYTE *pbStored = Archive.ByteStream.pbStream;
+		const LONG lSize = Buffer.WriteTo( Archive.ByteStream );
+		TempBuffer.ByteStream.WriteHeader( SVC_HEADER );
+		TempBuffer.ByteStream.WriteLong( 0 );
+		if ( lSize > 0 )
+			TempBuffer.ByteStream.WriteBuffer( pbStored, lSize );
+		ulCopied += lSize + TempBuffer.CalcSize( );
+	}
+	else
+	{
+		TempBuffer.ByteStream.WriteByte( SVC_UNRELIABLEPACKET );
+		ulCopied += Buffer.WriteTo( TempBuffer.ByteStream ) + 1;
+		ulCopied += journal.flush( ulClient, false, TempBuffer.ByteStream );
+	}
+
+	Segment.pbData = TempBuffer.pbData;
+	Segment.ulSize = TempBuffer.CalcSize( );
+	NETWORK_EncodePacket( &Segment, 1, pbOutput, iOutputSize );
+	Buffer.Clear( );
+	return ulCopied;
+}
+
+//*****************************************************************************
+//
+// Puts a packet together like SERVER_SendClientPacket does now, and returns how
+// many bytes were copied on the way.
+static ULONG server_AssembleGatheredPacket( BroadcastJournal &journal, ULONG ulClient, bool bReliable, NETBUFFER_s &Buffer, PacketArchive &Archive, BYTE *pbOutput, int iOutputSize )
+{
+	static TArray<NETPACKETSEGMENT_s>	Segments;
+	static const BYTE					abUnreliableHeader[1] = { SVC_UNRELIABLEPACKET };
+	NETPACKETSEGMENT_s					Segment;
+	ULONG								ulCopied = 0;
+
+	Segments.Clear( );
+	if ( bReliable == false )
+	{
+		Segment.pbData = abUnreliableHeader;
+		Segment.ulSize = sizeof( abUnreliableHeader );
+		Segments.Push( Segment );
+	}
+	Segment.pbData = Buffer.pbData;
+	Segment.ulSize = Buffer.CalcSize( );
+	Segments.Push( Segment );
+	journal.gather( ulClient, bReliable, MAX_UDP_PACKET - Segment.ulSize - 1, Segments );
+
+	// The reliable packet is stored once and sent from the archive.
+	if ( bReliable )
+	{
+		const BYTE *pbStored;
+		size_t size;
+		Archive.FindPacket( Archive.StorePacket( &Segments[0], Segments.Size( )), pbStored, size );
+		Segments.Clear( );
+		Segment.pbData = pbStored;
+		Segment.ulSize = size;
+		Segments.Push( Segment );
+		ulCopied += size;
+	}
+
+	NETWORK_EncodePacket( &Segments[0], Segments.Size( ), pbOutput, iOutputSize );
+	Buffer.Clear( );
+	return ulCopied;
+}
+
+//*****************************************************************************
+//
+// Replays the busiest tic recorded in the broadcast journal (or a made up one) for
+// MAXPLAYERS fake clients, once as reliable and once as unreliable commands, and assembles
+// and encodes the resulting packets (without sending them). This is done once copying the
+// packets together like before and once from segments, and compares the bytes copied.
+BENCHMARK( packetassembly )
+{
+	int numReplays = 20;
+	if ( argv.argc( ) > 1 )
+		numReplays = MAX( atoi( argv[1] ), 1 );
+
+	static BroadcastJournal replay;
+	static BroadcastJournal journal;
+	static BYTE abOutput[MAX_UDP_PACKET];
+	TArray<unsigned int> numRecipients;
+	server_PrepareBroadcastReplay( replay, numRecipients );
+
+	const unsigned int maxPacketSize = SERVER_GetMaxPacketSize( ) ? SERVER_GetMaxPacketSize( ) : MAX_UDP_PACKET;
+	NETBUFFER_s buffers[MAXPLAYERS];
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		buffers[ulIdx].Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+
+	NETBUFFER_s copiedArchive;
+	NETBUFFER_s tempBuffer;
+	PacketArchive archive;
+	copiedArchive.Init( maxPacketSize * PACKET_BUFFER_SIZE, BUFFERTYPE_WRITE );
+	tempBuffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+	archive.Initialize( maxPacketSize );
+
+	// Index 0 is the old way, index 1 the new one.
+	QWORD copied[2][2] = {{ 0, 0 }, { 0, 0 }};
+	QWORD numPackets[2] = { 0, 0 };
+	cycle_t times[2];
+
+	for ( int gathered = 0; gathered < 2; ++gathered )
+	{
+		times[gathered].Reset( );
+		for ( int replayIdx = 0; replayIdx < numReplays; ++replayIdx )
+		{
+			times[gathered].Clock( );
+			for ( int reliable = 0; reliable < 2; ++reliable )
+			{
+				for ( unsigned int i = 0; i < replay.getNumCommands( ) + 1; ++i )
+				{
+					const bool bLast = ( i == replay.getNumCommands( ));
+					const unsigned int size = bLast ? 0 : replay.getCommandSize( i );
+					const unsigned int command = bLast ? 0 : journal.addCommand( replay.getCommandData( i ), size );
+
+					for ( ULONG ulIdx = 0; ulIdx < ( bLast ? MAXPLAYERS : numRecipients[i] ); ulIdx++ )
+					{
+						// The packets are assembled when they're full, and at the end of the tic.
+						if ( bLast ? ( journal.getPendingSize( ulIdx, !!reliable ) > 0 ) : ( buffers[ulIdx].CalcSize( ) + journal.getPendingSize( ulIdx, !!reliable ) + size + 5 >= maxPacketSize ))
+						{
+							if ( gathered )
+								copied[gathered][reliable] += server_AssembleGatheredPacket( journal, ulIdx, !!reliable, buffers[ulIdx], archive, abOutput, sizeof( abOutput ));
+							else
+								copied[gathered][reliable] += server_AssembleCopiedPacket( journal, ulIdx, !!reliable, buffers[ulIdx], copiedArchive, tempBuffer, abOutput, sizeof( abOutput ));
+							numPackets[gathered]++;
+						}
+
+						if ( bLast == false )
+							journal.addReference( ulIdx, !!reliable, command );
+					}
+				}
+				journal.clear( );
+			}
+			times[gathered].Unclock( );
+		}
+	}
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		buffers[ulIdx].Free( );
+	copiedArchive.Free( );
+	tempBuffer.Free( );
+	archive.Free( );
+
+	Printf( "Replayed %u commands (%u bytes) %d times, %llu packets per replay.\n", replay.getNumCommands( ), replay.getSize( ), numReplays, static_cast<unsigned long long>( numPackets[1] / numReplays ));
+	for ( int gathered = 0; gathered < 2; ++gathered )
+	{
+		Printf( "%s %.3f ms per tic, %llu bytes copied per tic (%llu reliable, %llu unreliable)\n", gathered ? "Segments:" : "Copied:  ",
+			times[gathered].TimeMS( ) / numReplays,
+			static_cast<unsigned long long>(( copied[gathered][0] + copied[gathered][1] ) / numReplays ),
+			static_cast<unsigned long long>( copied[gathered][1] / numReplays ),
+			static_cast<unsigned long long>( copied[gathered][0] / numReplays ));
+	}
+}
+#endif
+
+//*****************************************************************************
+//
+#if BUILD_ID != BUILD_RELEASE
+// Compares the cost of finding the client an incoming packet belongs to with the
+// address map against the old scan over all client slots. Uses MAXPLAYERS fake clients
+// and a flood of packets from unknown addresses (e.g. launcher queries).
+BENCHMARK( clientlookup )
+{
+	int numPackets = 1000000;
+	if ( argv.argc( ) > 1 )
+		numPackets = MAX( atoi( argv[1] ), 1 );
+
+	NETADDRESS_s clientAddresses[MAXPLAYERS];
+	ClientAddressMap addressMap;
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		for ( int i = 0; i < 4; ++i )
+			clientAddresses[ulIdx].abIP[i] = M_Random( );
+		clientAddresses[ulIdx].usPort = htons( DEFAULT_CLIENT_PORT + ulIdx );
+		addressMap[clientAddresses[ulIdx]] = ulIdx;
+	}
+
+	// One in sixteen packets comes from a client, the rest is flood.
+	TArray<NETADDRESS_s> packetAddresses;
+	for ( int i = 0; i < 4096; ++i )
+	{
+		NETADDRESS_s address;
+		if (( i % 16 ) == 0 )
+			address = clientAddresses[M_Random( ) % MAXPLAYERS];
+		else
+		{
+			for ( int j = 0; j < 4; ++j )
+				address.abIP[j] = M_Random( );
+			address.usPort = htons( M_Random( ) << 8 | M_Random( ));
+		}
+		packetAddresses.Push( address );
+	}
+
+	cycle_t scanTime, mapTime;
+	LONG lScanMatches = 0, lMapMatches = 0;
+	scanTime.Reset( );
+	mapTime.Reset( );
+
+	scanTime.Clock( );
+	for ( int i = 0; i < numPackets; ++i )
+	{
+		const NETADDRESS_s &address = packetAddresses[i % packetAddresses.Size( )];
+		for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		{
+			if ( clientAddresses[ulIdx].Compare( address ))
+			{
+				lScanMatches++;
+				break;
+			}
+		}
+	}
+	scanTime.Unclock( );
+
+	mapTime.Clock( );
+	for ( int i = 0; i < numPackets; ++i )
+	{
+		if ( addressMap.CheckKey( packetAddresses[i % packetAddresses.Size( )] ) != NULL )
+			lMapMatches++;
+	}
+	mapTime.Unclock( );
+
+	Printf( "%d packets, %d clients: scan %.3f ms (%ld matches), map %.3f ms (%ld matches)\n",
+		numPackets, MAXPLAYERS, scanTime.TimeMS( ), lScanMatches, mapTime.TimeMS( ), lMapMatches );
+}
+#endif
+
 //*****************************************************************************
 #ifdef	_DEBUG
 CCMD( testchecksum )
@@ -62,6 +62,8 @@
 #include <queue>
 #include <memory>
 
+class BroadcastJournal;
+
 //*****************************************************************************
 //	DEFINES
 
@@ -99,6 +101,10 @@
 #define	UDF_PING					0x00000004
 #define	UDF_TIME					0x00000008
 
+// What SERVER_SendFullUpdate does once all actors of the full update are sent.
+#define	FUF_ITEMOWNERS				0x00000001	// Tell the client who holds team items and artifacts.
+#define	FUF_SELECTWEAPON			0x00000002	// Tell the client which weapon to bring up.
+
 #define	MAX_OVERMOVEMENT_LEVEL		( 2 * TICRATE )
 
 #define	KILOBYTE					1024
@@ -339,6 +345,33 @@ public:
 	}
 };
 
+//*****************************************************************************
+// The actors of a full update, sent over several tics.
+struct FULLUPDATESTREAM_s
+{
+	// Is the client still waiting for the rest of its full update?
+	bool					bActive;
+
+	// The actors still to be sent, ordered by their priority. The network IDs
+	// tell us whether an actor was destroyed since the update started.
+	TArray<AActor *>		Actors;
+	TArray<unsigned short>	ActorNetIDs;
+
+	// Index of the next actor to send, and how many actors there are in total.
+	ULONG					ulNextActor;
+	ULONG					ulNumActors;
+
+	// How many bytes the full update has taken so far.
+	ULONG					ulBytesSent;
+
+	// The gametics the full update started and was completed.
+	LONG					lStartTic;
+	LONG					lEndTic;
+
+	// What to do once all actors are sent, a combination of FUF_* flags.
+	ULONG					ulFollowUps;
+};
+
 //*****************************************************************************
 struct CLIENT_s
 {
@@ -389,6 +422,13 @@ struct CLIENT_s
 	// [BB] Did the client not yet acknowledge receiving the last full update?
 	bool			bFullUpdateIncomplete;
 
+	// The part of the full update that still has to be sent.
+	FULLUPDATESTREAM_s	FullUpdate;
+
+	// How many bytes of reliable commands were written to this client, including the
+	// ones referenced in the broadcast journal.
+	ULONG			ulReliableBytesWritten;
+
 	// [BB] A record of the gametics the client called protected commands, e.g. send_password.
 	RingBuffer<LONG, 8> commandInstances;
 
@@ -544,6 +584,7 @@ void		SERVER_Tick( void );
 void		SERVER_SendOutPackets( void );
 void		SERVER_SendClientPacket( ULONG ulClient, bool bReliable );
 void		SERVER_CheckClientBuffer( ULONG ulClient, ULONG ulSize, bool bReliable );
+BroadcastJournal	&SERVER_GetBroadcastJournal( void );
 LONG		SERVER_FindFreeClientSlot( void );
 LONG		SERVER_FindClientByAddress( NETADDRESS_s Address );
 CLIENT_s	*SERVER_GetClient( ULONG ulIdx );
@@ -562,7 +603,9 @@ void		SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream );
 bool		SERVER_GetUserInfo( BYTESTREAM_s *pByteStream, bool bAllowKick, bool bEnforceRequired = false );
 void		SERVER_ConnectionError( NETADDRESS_s Address, const char *pszMessage, ULONG ulErrorCode );
 void		SERVER_ClientError( ULONG ulClient, ULONG ulErrorCode );
-void		SERVER_SendFullUpdate( ULONG ulClient );
+void		SERVER_SendFullUpdate( ULONG ulClient, ULONG ulFollowUps = 0 );
+void		SERVER_TickFullUpdates( void );
+void		SERVER_CancelFullUpdate( ULONG ulClient );
 void		SERVER_WriteCommands( void );
 bool		SERVER_IsValidClient( ULONG ulClient );
 void		SERVER_AdjustPlayersReactiontime( const ULONG ulPlayer );
@@ -635,6 +678,7 @@ void		SERVER_MASTER_Destruct( void );
 void		SERVER_MASTER_Tick( void );
 void		SERVER_MASTER_Broadcast( void );
 void		SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ulTime, ULONG ulFlags2, bool bBroadcasting, bool bSegmentedResponse );
+void		SERVER_MASTER_InvalidateLauncherCache( void );
 const char	*SERVER_MASTER_GetGameName( void );
 NETADDRESS_s SERVER_MASTER_GetMasterAddress( void );
 void		SERVER_MASTER_HandleVerificationRequest( BYTESTREAM_s *pByteStream );
@@ -654,6 +698,13 @@ QWORD		SERVER_STATISTIC_GetTotalInboundDataTransferred( void );
 LONG		SERVER_STATISTIC_GetPeakInboundDataTransfer( void );
 void		SERVER_STATISTIC_AddToInboundDataTransfer( ULONG ulNumBytes );
 LONG		SERVER_STATISTIC_GetCurrentInboundDataTransfer( void );
+ULONG		SERVER_STATISTIC_GetAverageTicJitter( void );
+ULONG		SERVER_STATISTIC_GetMaxTicJitter( void );
+ULONG		SERVER_STATISTIC_GetCurrentTicOverruns( void );
+QWORD		SERVER_STATISTIC_GetTotalTicOverruns( void );
+void		SERVER_STATISTIC_AddToLauncherResponses( bool bFromCache );
+QWORD		SERVER_STATISTIC_GetTotalLauncherResponses( void );
+QWORD		SERVER_STATISTIC_GetTotalCachedLauncherResponses( void );
 
 //*****************************************************************************
 //	EXTERNAL CONSOLE VARIABLES
@@ -85,6 +85,20 @@ struct LauncherResponseContext
 
 using LauncherFieldFunction = void(*)(const LauncherResponseContext &);
 
+// A serialized launcher response body (everything after the time the launcher sent us),
+// cached per corrected flag set.
+struct LauncherResponseCacheEntry
+{
+	TArray<BYTE> Body;
+	int BuiltTic;
+	ULONG Generation;
+	QWORD LastUsed;
+};
+
+// The flags come from the launchers, so only this many flag sets are cached. The one
+// that wasn't used for the longest time makes room for a new one.
+#define	MAX_CACHED_LAUNCHER_RESPONSES	16
+
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 //-- VARIABLES -------------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -106,6 +120,11 @@ static	LONG				g_lStoredQueryIPHead;
 static	LONG				g_lStoredQueryIPTail;
 static	TArray<int>			g_OptionalWadIndices;
 
+// Cached launcher responses, keyed by ( ulBits2 << 32 ) | ulBits.
+static	std::map<QWORD, LauncherResponseCacheEntry>	g_LauncherResponseCache;
+static	ULONG				g_ulLauncherCacheGeneration = 0;
+static	QWORD				g_qwLauncherCacheClock = 0;
+
 extern	NETADDRESS_s		g_LocalAddress;
 
 FString g_VersionWithOS;
@@ -113,6 +132,14 @@ FString g_VersionWithOS;
 //*****************************************************************************
 //	CONSOLE VARIABLES
 
+// How many tics a cached launcher response may be reused for (0 disables the cache). Player
+// scores, pings and times don't invalidate the cache, so anything above 1 lets those lag behind.
+CUSTOM_CVAR( Int, sv_launchercachetics, 1, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( self < 0 )
+		self = 0;
+}
+
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 //-- FUNCTIONS -------------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -695,6 +722,92 @@ void SERVER_MASTER_Broadcast( void )
 //	NETWORK_LaunchPacket( g_MasterServerBuffer, AddressBroadcast, true );
 }
 
+//*****************************************************************************
+//
+// Stores a launcher response body in the cache, making room for it if necessary.
+static void server_master_CacheLauncherResponse( QWORD qwKey, const BYTE *pbBody, unsigned int bodySize )
+{
+	if ( g_LauncherResponseCache.find( qwKey ) == g_LauncherResponseCache.end( ))
+	{
+		// Responses that are out of date are of no use anymore.
+		for ( auto it = g_LauncherResponseCache.begin( ); it != g_LauncherResponseCache.end( ); )
+		{
+			if ( it->second.Generation != g_ulLauncherCacheGeneration )
+				it = g_LauncherResponseCache.erase( it );
+			else
+				++it;
+		}
+
+		if ( g_LauncherResponseCache.size( ) >= MAX_CACHED_LAUNCHER_RESPONSES )
+		{
+			auto leastRecentlyUsed = g_LauncherResponseCache.begin( );
+			for ( auto it = g_LauncherResponseCache.begin( ); it != g_LauncherResponseCache.end( ); ++it )
+			{
+				if ( it->second.LastUsed < leastRecentlyUsed->second.LastUsed )
+					leastRecentlyUsed = it;
+			}
+			g_LauncherResponseCache.erase( leastRecentlyUsed );
+		}
+	}
+
+	LauncherResponseCacheEntry &cacheEntry = g_LauncherResponseCache[qwKey];
+	cacheEntry.Body.Resize( bodySize );
+	if ( bodySize > 0 )
+		memcpy( &cacheEntry.Body[0], pbBody, bodySize );
+	cacheEntry.BuiltTic = gametic;
+	cacheEntry.Generation = g_ulLauncherCacheGeneration;
+	cacheEntry.LastUsed = ++g_qwLauncherCacheClock;
+}
+
+//*****************************************************************************
+//
+// Sends the launcher response assembled in g_MasterServerBuffer, in segments if requested.
+static void server_master_LaunchResponse( const NETADDRESS_s &Address, bool bSegmentedResponse )
+{
+	// [SB] Handle a segmented response.
+	if ( bSegmentedResponse )
+	{
+		// [SB] Size of the segment header, as written in the loop below.
+		constexpr LONG segmentHeaderSize = 12;
+
+		const LONG sourceBufferSize = g_MasterServerBuffer.CalcSize();
+		const LONG segmentMaxSize = static_cast<LONG>( sv_maxpacketsize ) - segmentHeaderSize;
+		const LONG numSegments = static_cast<LONG>( std::ceil( static_cast<double>( sourceBufferSize ) / static_cast<double>( segmentMaxSize ) ) );
+
+		LONG segmentNumber = 0;
+		LONG offset = 0;
+
+		// [SB] Now assemble segments until we've exhausted the buffer.
+		while ( offset < sourceBufferSize )
+		{
+			// [SB] (std::min) prevents macro expansion of min.
+			const LONG readSize = (std::min)( segmentMaxSize, sourceBufferSize - offset );
+
+			g_SegmentBuffer.Clear();
+
+			// [SB] segmentHeaderSize must be equal to the byte size of this header, including the challenge.
+			g_SegmentBuffer.ByteStream.WriteLong( SERVER_LAUNCHER_CHALLENGE_SEGMENTED );
+			g_SegmentBuffer.ByteStream.WriteByte( segmentNumber );
+			g_SegmentBuffer.ByteStream.WriteByte( numSegments );
+			g_SegmentBuffer.ByteStream.WriteShort( offset );
+			g_SegmentBuffer.ByteStream.WriteShort( readSize );
+			g_SegmentBuffer.ByteStream.WriteShort( sourceBufferSize );
+
+			// [SB] Read from the master buffer directly into the segment buffer.
+			memcpy( g_SegmentBuffer.ByteStream.pbStream, g_MasterServerBuffer.pbData + offset, readSize );
+			offset += readSize;
+			g_SegmentBuffer.ByteStream.pbStream += readSize;
+
+			NETWORK_LaunchPacket( &g_SegmentBuffer, Address );
+			segmentNumber++;
+		}
+	}
+	else
+	{
+		NETWORK_LaunchPacket( &g_MasterServerBuffer, Address );
+	}
+}
+
 //*****************************************************************************
 //
 void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ulTime, ULONG ulFlags2, bool bBroadcasting, bool bSegmentedResponse )
@@ -782,9 +895,6 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 	// Send the time the launcher sent to us.
 	g_MasterServerBuffer.ByteStream.WriteLong( ulTime );
 
-	// Send our version. [K6] ...with OS
-	g_MasterServerBuffer.ByteStream.WriteString( g_VersionWithOS.GetChars() );
-
 	// Send the information about the data that will be sent.
 	ulBits = ulFlags;
 
@@ -828,6 +938,30 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 			ulBits &= ~SQF_EXTENDED_INFO;
 	}
 
+	// If we already built a response for these flags recently, just copy it.
+	const QWORD qwCacheKey = ( static_cast<QWORD>( ulBits2 ) << 32 ) | ulBits;
+	const auto cached = g_LauncherResponseCache.find( qwCacheKey );
+
+	if (( sv_launchercachetics > 0 )
+		&& ( cached != g_LauncherResponseCache.end( ))
+		&& ( cached->second.Body.Size( ) > 0 )
+		&& ( cached->second.Generation == g_ulLauncherCacheGeneration )
+		&& ( gametic - cached->second.BuiltTic < sv_launchercachetics ))
+	{
+		LauncherResponseCacheEntry &cacheEntry = cached->second;
+		cacheEntry.LastUsed = ++g_qwLauncherCacheClock;
+		SERVER_STATISTIC_AddToLauncherResponses( true );
+		g_MasterServerBuffer.ByteStream.WriteBuffer( &cacheEntry.Body[0], cacheEntry.Body.Size( ));
+		server_master_LaunchResponse( Address, bSegmentedResponse );
+		return;
+	}
+
+	SERVER_STATISTIC_AddToLauncherResponses( false );
+	BYTE *const pbBodyStart = g_MasterServerBuffer.ByteStream.pbStream;
+
+	// Send our version. [K6] ...with OS
+	g_MasterServerBuffer.ByteStream.WriteString( g_VersionWithOS.GetChars() );
+
 	const ULONG flags[] = { ulBits, ulBits2 }; // [SB] The bits for each field set we'll be sending.
 	ULONG ulCurrentSetNum = 0; // [SB] Current field set. 0 -> SQF_, 1 -> SQF2_
 	const LauncherResponseContext ctx{ &g_MasterServerBuffer.ByteStream, ulBits, ulBits2 };
@@ -873,48 +1007,18 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 		}
 	}
 
-	// [SB] Handle a segmented response.
-	if ( bSegmentedResponse )
-	{
-		// [SB] Size of the segment header, as written in the loop below.
-		constexpr LONG segmentHeaderSize = 12;
-
-		const LONG sourceBufferSize = g_MasterServerBuffer.CalcSize();
-		const LONG segmentMaxSize = static_cast<LONG>( sv_maxpacketsize ) - segmentHeaderSize;
-		const LONG numSegments = static_cast<LONG>( std::ceil( static_cast<double>( sourceBufferSize ) / static_cast<double>( segmentMaxSize ) ) );
-
-		LONG segmentNumber = 0;
-		LONG offset = 0;
+	// Remember the body for the next launcher asking for the same flags.
+	if ( sv_launchercachetics > 0 )
+		server_master_CacheLauncherResponse( qwCacheKey, pbBodyStart, static_cast<unsigned int>( g_MasterServerBuffer.ByteStream.pbStream - pbBodyStart ));
 
-		// [SB] Now assemble segments until we've exhausted the buffer.
-		while ( offset < sourceBufferSize )
-		{
-			// [SB] (std::min) prevents macro expansion of min.
-			const LONG readSize = (std::min)( segmentMaxSize, sourceBufferSize - offset );
-
-			g_SegmentBuffer.Clear();
-
-			// [SB] segmentHeaderSize must be equal to the byte size of this header, including the challenge.
-			g_SegmentBuffer.ByteStream.WriteLong( SERVER_LAUNCHER_CHALLENGE_SEGMENTED );
-			g_SegmentBuffer.ByteStream.WriteByte( segmentNumber );
-			g_SegmentBuffer.ByteStream.WriteByte( numSegments );
-			g_SegmentBuffer.ByteStream.WriteShort( offset );
-			g_SegmentBuffer.ByteStream.WriteShort( readSize );
-			g_SegmentBuffer.ByteStream.WriteShort( sourceBufferSize );
-
-			// [SB] Read from the master buffer directly into the segment buffer.
-			memcpy( g_SegmentBuffer.ByteStream.pbStream, g_MasterServerBuffer.pbData + offset, readSize );
-			offset += readSize;
-			g_SegmentBuffer.ByteStream.pbStream += readSize;
+	server_master_LaunchResponse( Address, bSegmentedResponse );
+}
 
-			NETWORK_LaunchPacket( &g_SegmentBuffer, Address );
-			segmentNumber++;
-		}
-	}
-	else
-	{
-		NETWORK_LaunchPacket( &g_MasterServerBuffer, Address );
-	}
+//*****************************************************************************
+//
+void SERVER_MASTER_InvalidateLauncherCache( void )
+{
+	g_ulLauncherCacheGeneration++;
 }
 
 //*****************************************************************************
@@ -0,0 +1,448 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_profile.cpp
+//
+// Description: Measures how long the stages of each server tic take.
+//
+// SERVER_Tick brackets every tic with SERVER_PROFILE_BeginTic and SERVER_PROFILE_EndTic,
+// and the stages in between are timed with FServerProfileScope. At the end of each tic,
+// the times go into a histogram per stage. Tics that take longer than sv_slowticthreshold
+// are kept, together with the stages that cost the most time.
+//
+// The statistics can be printed with dumpserverprofile (also through RCON), and can be
+// written periodically to sv_profileexportfile in the Prometheus text format.
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <stdio.h>
+#include "sv_profile.h"
+#include "sv_main.h"
+#include "network.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "doomstat.h"
+
+//*****************************************************************************
+//	DEFINES
+
+// The upper limits (in ms) of the histogram buckets. The last bucket has no limit.
+static	const double	g_adBucketLimits[] = { 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 20, MS_PER_TIC, 50, 100 };
+
+enum
+{
+	NUM_PROFILEBUCKETS = countof( g_adBucketLimits ) + 1,
+
+	// How many slow tics are kept.
+	NUM_SLOWTICS = 16,
+};
+
+//*****************************************************************************
+struct PROFILESTATS_s
+{
+	// The total time of all tics in ms.
+	double		dSum;
+
+	// The longest time of a single tic in ms.
+	double		dMax;
+
+	// How many tics fell into each bucket.
+	ULONG		aulBuckets[NUM_PROFILEBUCKETS];
+};
+
+//*****************************************************************************
+struct SLOWTIC_s
+{
+	int			lGametic;
+	double		dTotal;
+
+	// The time spent in each stage, without the time spent in its nested stages.
+	double		adExclusive[NUM_SERVERPROFILESTAGES];
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+cycle_t		g_ServerProfileCycles[NUM_SERVERPROFILESTAGES];
+
+static	const struct
+{
+	const char				*pszName;
+
+	// The stage this stage is nested in, NUM_SERVERPROFILESTAGES if it isn't nested.
+	SERVERPROFILESTAGE_e	Parent;
+} g_StageInfo[NUM_SERVERPROFILESTAGES] =
+{
+	{ "getpackets",		NUM_SERVERPROFILESTAGES },
+	{ "unlagged",		NUM_SERVERPROFILESTAGES },
+	{ "ticker",			NUM_SERVERPROFILESTAGES },
+	{ "bots",			SPS_TICKER },
+	{ "thinkers",		SPS_TICKER },
+	{ "acs",			SPS_THINKERS },
+	{ "writecommands",	NUM_SERVERPROFILESTAGES },
+	{ "fullupdates",	NUM_SERVERPROFILESTAGES },
+	{ "sendpackets",	NUM_SERVERPROFILESTAGES },
+	{ "master",			NUM_SERVERPROFILESTAGES },
+	{ "other",			NUM_SERVERPROFILESTAGES },
+};
+
+static	cycle_t			g_TicCycles;
+static	int				g_lTicGametic;
+static	ULONG			g_ulNumProfiledTics = 0;
+static	PROFILESTATS_s	g_TicStats;
+static	PROFILESTATS_s	g_StageStats[NUM_SERVERPROFILESTAGES];
+
+static	SLOWTIC_s		g_SlowTics[NUM_SLOWTICS];
+static	ULONG			g_ulNumSlowTics = 0;
+
+//*****************************************************************************
+//	CONSOLE VARIABLES
+
+// Tics that take longer than this (in ms) are kept by the profiler. 0 disables this.
+CVAR( Float, sv_slowticthreshold, MS_PER_TIC, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// Print the most expensive stages of every slow tic.
+CVAR( Bool, sv_printslowtics, false, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// How many of the most expensive stages of a slow tic are printed.
+CVAR( Int, sv_slowticstages, 3, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// If set, the profile is written to this file every sv_profileexportinterval seconds.
+CVAR( String, sv_profileexportfile, "", CVAR_ARCHIVE|CVAR_NOSETBYACS|CVAR_SENSITIVESERVERSETTING )
+CVAR( Int, sv_profileexportinterval, 10, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	void	server_profile_AddToStats( PROFILESTATS_s &Stats, double dTime );
+static	double	server_profile_GetPercentile( const PROFILESTATS_s &Stats, double dPercentile );
+static	FString	server_profile_DescribeSlowTic( const SLOWTIC_s &SlowTic, int lNumStages );
+static	void	server_profile_WriteExport( FString &Output );
+static	void	server_profile_ExportToFile( const char *pszFileName );
+
+//*****************************************************************************
+//	FUNCTIONS
+
+void SERVER_PROFILE_BeginTic( void )
+{
+	for ( unsigned int i = 0; i < NUM_SERVERPROFILESTAGES; i++ )
+		g_ServerProfileCycles[i].Reset( );
+
+	g_lTicGametic = gametic;
+	g_TicCycles.Reset( );
+	g_TicCycles.Clock( );
+}
+
+//*****************************************************************************
+//
+void SERVER_PROFILE_EndTic( void )
+{
+	g_TicCycles.Unclock( );
+
+	const double dTotal = g_TicCycles.TimeMS( );
+	double adInclusive[NUM_SERVERPROFILESTAGES];
+	double adExclusive[NUM_SERVERPROFILESTAGES];
+	double dTimedStages = 0;
+
+	for ( unsigned int i = 0; i < NUM_SERVERPROFILESTAGES; i++ )
+		adInclusive[i] = adExclusive[i] = ( i == SPS_OTHER ) ? 0 : g_ServerProfileCycles[i].TimeMS( );
+
+	// Remove the time of the nested stages from their parents.
+	for ( unsigned int i = 0; i < NUM_SERVERPROFILESTAGES; i++ )
+	{
+		if ( g_StageInfo[i].Parent != NUM_SERVERPROFILESTAGES )
+			adExclusive[g_StageInfo[i].Parent] -= adInclusive[i];
+		else
+			dTimedStages += adInclusive[i];
+	}
+
+	adInclusive[SPS_OTHER] = adExclusive[SPS_OTHER] = MAX( 0.0, dTotal - dTimedStages );
+
+	g_ulNumProfiledTics++;
+	server_profile_AddToStats( g_TicStats, dTotal );
+
+	for ( unsigned int i = 0; i < NUM_SERVERPROFILESTAGES; i++ )
+		server_profile_AddToStats( g_StageStats[i], adInclusive[i] );
+
+	// Keep the tic if it took too long.
+	if (( sv_slowticthreshold > 0 ) && ( dTotal > sv_slowticthreshold ))
+	{
+		SLOWTIC_s &SlowTic = g_SlowTics[g_ulNumSlowTics % NUM_SLOWTICS];
+
+		SlowTic.lGametic = g_lTicGametic;
+		SlowTic.dTotal = dTotal;
+		for ( unsigned int i = 0; i < NUM_SERVERPROFILESTAGES; i++ )
+			SlowTic.adExclusive[i] = MAX( 0.0, adExclusive[i] );
+
+		g_ulNumSlowTics++;
+
+		if ( sv_printslowtics )
+			Printf( "Slow tic %d: %s\n", SlowTic.lGametic, server_profile_DescribeSlowTic( SlowTic, sv_slowticstages ).GetChars( ));
+	}
+
+	// Export the profile for monitoring every now and then.
+	if (( strlen( sv_profileexportfile ) > 0 )
+		&& ( sv_profileexportinterval > 0 )
+		&& (( g_ulNumProfiledTics % ( sv_profileexportinterval * TICRATE )) == 0 ))
+	{
+		server_profile_ExportToFile( sv_profileexportfile );
+	}
+}
+
+//*****************************************************************************
+//
+void SERVER_PROFILE_Clear( void )
+{
+	g_ulNumProfiledTics = 0;
+	g_ulNumSlowTics = 0;
+	memset( &g_TicStats, 0, sizeof( g_TicStats ));
+	memset( g_StageStats, 0, sizeof( g_StageStats ));
+}
+
+//*****************************************************************************
+//
+static void server_profile_AddToStats( PROFILESTATS_s &Stats, double dTime )
+{
+	unsigned int ulBucket = 0;
+
+	while (( ulBucket < countof( g_adBucketLimits )) && ( dTime > g_adBucketLimits[ulBucket] ))
+		ulBucket++;
+
+	Stats.aulBuckets[ulBucket]++;
+	Stats.dSum += dTime;
+	Stats.dMax = MAX( Stats.dMax, dTime );
+}
+
+//*****************************************************************************
+//
+// The histogram only tells in which bucket the percentile is, so this returns
+// the upper limit of that bucket (or the longest time for the last bucket).
+static double server_profile_GetPercentile( const PROFILESTATS_s &Stats, double dPercentile )
+{
+	const double dRank = g_ulNumProfiledTics * dPercentile;
+	ULONG ulCount = 0;
+
+	for ( unsigned int i = 0; i < countof( g_adBucketLimits ); i++ )
+	{
+		ulCount += Stats.aulBuckets[i];
+
+		if (( ulCount > 0 ) && ( ulCount >= dRank ))
+			return MIN( g_adBucketLimits[i], Stats.dMax );
+	}
+
+	return Stats.dMax;
+}
+
+//*****************************************************************************
+//
+static FString server_profile_DescribeSlowTic( const SLOWTIC_s &SlowTic, int lNumStages )
+{
+	unsigned int auStages[NUM_SERVERPROFILESTAGES];
+	FString Description;
+
+	for ( unsigned int i = 0; i < NUM_SERVERPROFILESTAGES; i++ )
+		auStages[i] = i;
+
+	std::sort( auStages, auStages + NUM_SERVERPROFILESTAGES, [&]( unsigned int a, unsigned int b )
+	{
+		return SlowTic.adExclusive[a] > SlowTic.adExclusive[b];
+	});
+
+	Description.Format( "%.2f ms", SlowTic.dTotal );
+
+	for ( int i = 0; i < clamp<int>( lNumStages, 0, NUM_SERVERPROFILESTAGES ); i++ )
+		Description.AppendFormat( "%s %s %.2f ms", ( i == 0 ) ? " -" : ",", g_StageInfo[auStages[i]].pszName, SlowTic.adExclusive[auStages[i]] );
+
+	return Description;
+}
+
+//*****************************************************************************
+//
+// Writes the profile in the Prometheus text format, so that it can be picked up
+// by node_exporter's textfile collector or scraped from the RCON output.
+static void server_profile_WriteExport( FString &Output )
+{
+	Output = "# TYPE zandronum_tic_ms histogram\n";
+
+	for ( unsigned int i = 0; i <= NUM_SERVERPROFILESTAGES; i++ )
+	{
+		const PROFILESTATS_s &Stats = ( i < NUM_SERVERPROFILESTAGES ) ? g_StageStats[i] : g_TicStats;
+		const char *pszStage = ( i < NUM_SERVERPROFILESTAGES ) ? g_StageInfo[i].pszName : "total";
+		ULONG ulCount = 0;
+
+		for ( unsigned int j = 0; j < countof( g_adBucketLimits ); j++ )
+		{
+			ulCount += Stats.aulBuckets[j];
+			Output.AppendFormat( "zandronum_tic_ms_bucket{stage=\"%s\",le=\"%g\"} %lu\n", pszStage, g_adBucketLimits[j], ulCount );
+		}
+
+		Output.AppendFormat( "zandronum_tic_ms_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n", pszStage, g_ulNumProfiledTics );
+		Output.AppendFormat( "zandronum_tic_ms_sum{stage=\"%s\"} %f\n", pszStage, Stats.dSum );
+		Output.AppendFormat( "zandronum_tic_ms_count{stage=\"%s\"} %lu\n", pszStage, g_ulNumProfiledTics );
+	}
+
+	Output += "# TYPE zandronum_tic_max_ms gauge\n";
+	for ( unsigned int i = 0; i < NUM_SERVERPROFILESTAGES; i++ )
+		Output.AppendFormat( "zandronum_tic_max_ms{stage=\"%s\"} %f\n", g_StageInfo[i].pszName, g_StageStats[i].dMax );
+	Output.AppendFormat( "zandronum_tic_max_ms{stage=\"total\"} %f\n", g_TicStats.dMax );
+
+	Output += "# TYPE zandronum_slow_tics_total counter\n";
+	Output.AppendFormat( "zandronum_slow_tics_total %lu\n", g_ulNumSlowTics );
+}
+
+//*****************************************************************************
+//
+static void server_profile_ExportToFile( const char *pszFileName )
+{
+	FString Output;
+	FString TempFileName;
+	FILE *pFile;
+
+	server_profile_WriteExport( Output );
+
+	// Write to a temporary file first, so that nobody reads a half written file.
+	TempFileName.Format( "%s.tmp", pszFileName );
+
+	if (( pFile = fopen( TempFileName, "w" )) == NULL )
+	{
+		Printf( "server_profile_ExportToFile: Couldn't open %s!\n", TempFileName.GetChars( ));
+		return;
+	}
+
+	fputs( Output, pFile );
+	fclose( pFile );
+
+	// rename only replaces an existing file atomically on POSIX, on Windows it fails instead.
+#ifdef _WIN32
+	remove( pszFileName );
+#endif
+	if ( rename( TempFileName, pszFileName ) != 0 )
+		Printf( "server_profile_ExportToFile: Couldn't rename %s to %s!\n", TempFileName.GetChars( ), pszFileName );
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+CCMD( dumpserverprofile )
+{
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	if ( g_ulNumProfiledTics == 0 )
+	{
+		Printf( "No tics were profiled yet.\n" );
+		return;
+	}
+
+	// "dumpserverprofile export" prints the same output as the export file, for
+	// monitoring that reads it through RCON.
+	if (( argv.argc( ) > 1 ) && ( stricmp( argv[1], "export" ) == 0 ))
+	{
+		FString Output;
+		server_profile_WriteExport( Output );
+
+		// Print line by line, so that RCON doesn't have to deal with a huge message.
+		for ( const char *pszLine = Output.GetChars( ); *pszLine != '\0'; )
+		{
+			const char *pszEnd = strchr( pszLine, '\n' );
+			Printf( "%.*s\n", static_cast<int>( pszEnd - pszLine ), pszLine );
+			pszLine = pszEnd + 1;
+		}
+
+		return;
+	}
+
+	Printf( "Server tic profile over %lu tics (times in ms, percentiles are histogram bucket limits):\n", g_ulNumProfiledTics );
+	Printf( "%-16s %8s %8s %8s %8s %8s\n", "stage", "avg", "p50", "p95", "p99", "max" );
+
+	for ( unsigned int i = 0; i <= NUM_SERVERPROFILESTAGES; i++ )
+	{
+		const PROFILESTATS_s &Stats = ( i < NUM_SERVERPROFILESTAGES ) ? g_StageStats[i] : g_TicStats;
+		FString Name = ( i < NUM_SERVERPROFILESTAGES ) ? g_StageInfo[i].pszName : "total";
+
+		// Indent the nested stages.
+		if ( i < NUM_SERVERPROFILESTAGES )
+		{
+			for ( unsigned int ulParent = g_StageInfo[i].Parent; ulParent != NUM_SERVERPROFILESTAGES; ulParent = g_StageInfo[ulParent].Parent )
+				Name.Insert( 0, "  " );
+		}
+
+		Printf( "%-16s %8.3f %8.3f %8.3f %8.3f %8.3f\n", Name.GetChars( ), Stats.dSum / g_ulNumProfiledTics,
+			server_profile_GetPercentile( Stats, 0.5 ), server_profile_GetPercentile( Stats, 0.95 ),
+			server_profile_GetPercentile( Stats, 0.99 ), Stats.dMax );
+	}
+
+	Printf( "%lu tics took longer than %.2f ms.\n", g_ulNumSlowTics, static_cast<float>( sv_slowticthreshold ));
+}
+
+//*****************************************************************************
+//
+CCMD( dumpslowtics )
+{
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	if ( g_ulNumSlowTics == 0 )
+	{
+		Printf( "No slow tics were recorded.\n" );
+		return;
+	}
+
+	const ULONG ulNumKept = MIN<ULONG>( g_ulNumSlowTics, NUM_SLOWTICS );
+	const int lNumStages = ( argv.argc( ) > 1 ) ? atoi( argv[1] ) : 5;
+
+	Printf( "The last %lu of %lu slow tics:\n", ulNumKept, g_ulNumSlowTics );
+
+	for ( ULONG ulIdx = g_ulNumSlowTics - ulNumKept; ulIdx < g_ulNumSlowTics; ulIdx++ )
+	{
+		const SLOWTIC_s &SlowTic = g_SlowTics[ulIdx % NUM_SLOWTICS];
+		Printf( "Tic %d: %s\n", SlowTic.lGametic, server_profile_DescribeSlowTic( SlowTic, lNumStages ).GetChars( ));
+	}
+}
+
+//*****************************************************************************
+//
+CCMD( clearserverprofile )
+{
+	SERVER_PROFILE_Clear( );
+}
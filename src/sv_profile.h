@@ -0,0 +1,128 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_profile.h
+//
+// Description: Measures how long the stages of each server tic take.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __SV_PROFILE_H__
+#define __SV_PROFILE_H__
+
+#include "stats.h"
+
+//*****************************************************************************
+//	DEFINES
+
+enum SERVERPROFILESTAGE_e
+{
+	// Receiving and parsing the packets of the clients.
+	SPS_GETPACKETS,
+
+	// Recording the positions of the players and sectors for unlagged.
+	SPS_UNLAGGED,
+
+	// G_Ticker, including the stages below.
+	SPS_TICKER,
+
+	// BOTS_Tick.
+	SPS_BOTS,
+
+	// DThinker::RunThinkers.
+	SPS_THINKERS,
+
+	// The ACS scripts, which run as part of the thinkers.
+	SPS_ACS,
+
+	// SERVER_WriteCommands.
+	SPS_WRITECOMMANDS,
+
+	// Streaming the full updates to joining clients.
+	SPS_FULLUPDATES,
+
+	// SERVER_SendOutPackets and the packets scheduled by the packet archives.
+	SPS_SENDPACKETS,
+
+	// Updating the master server.
+	SPS_MASTER,
+
+	// Everything else the tic spent time on. This isn't timed by itself.
+	SPS_OTHER,
+
+	NUM_SERVERPROFILESTAGES
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+extern	cycle_t		g_ServerProfileCycles[NUM_SERVERPROFILESTAGES];
+
+//*****************************************************************************
+//	PROTOTYPES
+
+void	SERVER_PROFILE_BeginTic( void );
+void	SERVER_PROFILE_EndTic( void );
+void	SERVER_PROFILE_Clear( void );
+
+//*****************************************************************************
+//
+// Adds the time spent in its scope to a stage of the current tic. Nested
+// stages are also counted in their parent stage.
+class FServerProfileScope
+{
+public:
+	FServerProfileScope( SERVERPROFILESTAGE_e Stage ) : m_Stage( Stage )
+	{
+		g_ServerProfileCycles[m_Stage].Clock( );
+	}
+
+	~FServerProfileScope( )
+	{
+		g_ServerProfileCycles[m_Stage].Unclock( );
+	}
+
+private:
+	const SERVERPROFILESTAGE_e	m_Stage;
+};
+
+#endif	// __SV_PROFILE_H__
@@ -0,0 +1,416 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_relevance.cpp
+//
+// Description: Decides how relevant actors are to each client (interest management).
+//
+// Position updates of actors that are of low relevance to a client (it can't see them
+// according to the REJECT table, or they're far away) aren't sent to that client right
+// away. Instead, the client is marked in the actor's netStaleClients and the actor is put
+// on the client's list of stale actors. The complete position is sent later by
+// SERVER_RELEVANCE_SendPendingUpdates, most relevant actors first.
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include "sv_relevance.h"
+#include "sv_main.h"
+#include "sv_commands.h"
+#include "network/netcommand.h"
+#include "actor.h"
+#include "d_player.h"
+#include "c_cvars.h"
+#include "p_local.h"
+#include "r_defs.h"
+#include "r_state.h"
+#include "doomstat.h"
+
+//*****************************************************************************
+//	DEFINES
+
+// Roughly how many bytes SERVERCOMMANDS_ResyncThingPosition writes.
+#define	RESYNC_COMMAND_SIZE			48
+
+// Catch-up updates each client gets per tic even if its current packet is full.
+#define	MIN_RESYNCS_PER_TIC			4
+
+//*****************************************************************************
+//	VARIABLES
+
+// Network IDs of the actors whose position is outdated on each client. An actor is on a
+// client's list whenever it has the client's bit set in netStaleClients. Entries whose
+// actor is gone (or whose ID was given to an actor without the bit) are dropped when
+// they come up.
+static	TArray<USHORT>	g_StaleActors[MAXPLAYERS];
+
+// Last tic a client was sent a low relevance player's position.
+static	int			g_LastLowRelevancePlayerUpdate[MAXPLAYERS][MAXPLAYERS];
+
+struct PENDINGUPDATE_s
+{
+	AActor		*pActor;
+	LONG		lScore;
+
+	bool operator< ( const PENDINGUPDATE_s &other ) const
+	{
+		return ( lScore > other.lScore );
+	}
+};
+
+struct PLAYERUPDATE_s
+{
+	ULONG		ulPlayer;
+	LONG		lScore;
+
+	bool operator< ( const PLAYERUPDATE_s &other ) const
+	{
+		return ( lScore > other.lScore );
+	}
+};
+
+CVAR( Bool, sv_relevance, true, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// Actors closer than this (in map units) are always of high relevance.
+CVAR( Int, sv_relevancenear, 1024, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// Actors farther away than this are of low relevance, even if they may be visible.
+CVAR( Int, sv_relevancefar, 4096, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+// How often (in tics) clients get the positions of actors of low relevance.
+CVAR( Int, sv_relevanceinterval, 10, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	AActor		*relevance_GetViewer( ULONG ulClient );
+static	bool		relevance_IsInterested( ULONG ulClient );
+static	void		relevance_ClearStaleActors( ULONG ulClient );
+
+//*****************************************************************************
+//	FUNCTIONS
+
+RELEVANCE_e SERVER_RELEVANCE_GetRelevance( ULONG ulClient, AActor *pActor )
+{
+	if ( sv_relevance == false )
+		return ( RELEVANCE_HIGH );
+
+	const AActor *pViewer = relevance_GetViewer( ulClient );
+	if (( pViewer == NULL ) || ( pActor == pViewer ))
+		return ( RELEVANCE_HIGH );
+
+	// Anything that's after the viewer matters, no matter where it is.
+	if (( pActor->target == pViewer ) || ( pActor->tracer == pViewer ))
+		return ( RELEVANCE_HIGH );
+
+	const LONG lDistance = P_AproxDistance( pActor->x - pViewer->x, pActor->y - pViewer->y ) >> FRACBITS;
+	if ( lDistance <= sv_relevancenear )
+		return ( RELEVANCE_HIGH );
+
+	// Use the REJECT table to find out if the viewer can't possibly see the actor.
+	if (( rejectmatrix != NULL ) && ( pViewer->Sector != NULL ) && ( pActor->Sector != NULL ))
+	{
+		const int pnum = int( pViewer->Sector - sectors ) * numsectors + int( pActor->Sector - sectors );
+		if ( rejectmatrix[pnum >> 3] & ( 1 << ( pnum & 7 )))
+			return ( RELEVANCE_LOW );
+	}
+
+	if ( lDistance > sv_relevancefar )
+		return ( RELEVANCE_LOW );
+
+	return ( RELEVANCE_MEDIUM );
+}
+
+//*****************************************************************************
+//
+// Higher scores mean more relevant. Within the same relevance, closer actors come first.
+//
+LONG SERVER_RELEVANCE_GetScore( ULONG ulClient, AActor *pActor )
+{
+	const AActor *pViewer = relevance_GetViewer( ulClient );
+	LONG lDistance = 0;
+
+	if ( pViewer != NULL )
+		lDistance = MIN<LONG>( P_AproxDistance( pActor->x - pViewer->x, pActor->y - pViewer->y ) >> FRACBITS, 65535 );
+
+	return ( SERVER_RELEVANCE_GetRelevance( ulClient, pActor ) * 65536 + 65535 - lDistance );
+}
+
+//*****************************************************************************
+//
+// Returns the clients that shouldn't get a position update about the actor now. These
+// are the clients that already missed an update (they need the complete position anyway)
+// and, if bMarkIrrelevant is true, the clients the actor isn't relevant to. The latter are
+// marked as missing the update.
+//
+QWORD SERVER_RELEVANCE_GetSkippedClients( AActor *pActor, bool bMarkIrrelevant )
+{
+	if ( sv_relevance == false )
+		return ( pActor->netStaleClients );
+
+	if ( bMarkIrrelevant )
+	{
+		for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		{
+			if ( relevance_IsInterested( ulIdx ) == false )
+				continue;
+
+			const QWORD clientBit = static_cast<QWORD>( 1 ) << ulIdx;
+			if ((( pActor->netStaleClients & clientBit ) == 0 ) && ( SERVER_RELEVANCE_GetRelevance( ulIdx, pActor ) == RELEVANCE_LOW ))
+			{
+				pActor->netStaleClients |= clientBit;
+				g_StaleActors[ulIdx].Push( pActor->NetID );
+			}
+		}
+	}
+
+	return ( pActor->netStaleClients );
+}
+
+//*****************************************************************************
+//
+// Sends the clients the positions they missed. Actors that became relevant are updated
+// right away, the others only every sv_relevanceinterval tics. The most relevant updates are
+// sent first and only as many as fit into the client's current packet.
+//
+void SERVER_RELEVANCE_SendPendingUpdates( void )
+{
+	static TArray<PENDINGUPDATE_s> updates;
+
+	if ( gamestate != GS_LEVEL )
+		return;
+
+	const int interval = MAX<int>( sv_relevanceinterval, 1 );
+
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		TArray<USHORT> &staleActors = g_StaleActors[ulIdx];
+		if ( staleActors.Size( ) == 0 )
+			continue;
+
+		// Clients that left or are still getting the full update don't need this.
+		if ( relevance_IsInterested( ulIdx ) == false )
+		{
+			relevance_ClearStaleActors( ulIdx );
+			continue;
+		}
+
+		const QWORD clientBit = static_cast<QWORD>( 1 ) << ulIdx;
+		const bool bLowRelevanceTic = ((( gametic + ulIdx ) % interval ) == 0 );
+		unsigned int numLeft = 0;
+
+		// Collect the updates that are due, the others stay on the list.
+		updates.Clear( );
+		for ( unsigned int i = 0; i < staleActors.Size( ); ++i )
+		{
+			AActor *pActor = g_ActorNetIDList.findPointerByID( staleActors[i] );
+			if (( pActor == NULL ) || (( pActor->netStaleClients & clientBit ) == 0 ))
+				continue;
+
+			PENDINGUPDATE_s update;
+			update.pActor = pActor;
+			update.lScore = SERVER_RELEVANCE_GetScore( ulIdx, pActor );
+
+			if (( update.lScore < RELEVANCE_MEDIUM * 65536 ) && ( bLowRelevanceTic == false ))
+				staleActors[numLeft++] = staleActors[i];
+			else
+				updates.Push( update );
+		}
+		staleActors.Resize( numLeft );
+
+		if ( updates.Size( ) == 0 )
+			continue;
+
+		std::sort( &updates[0], &updates[0] + updates.Size( ));
+
+		const LONG lBufferSize = SERVER_GetClient( ulIdx )->PacketBuffer.CalcSize( ) + SERVER_GetBroadcastJournal( ).getPendingSize( ulIdx, true );
+		LONG lRoom = static_cast<LONG>( SERVER_GetMaxPacketSize( )) - 5 - lBufferSize;
+		unsigned int numSent = 0;
+
+		for ( unsigned int i = 0; i < updates.Size( ); ++i )
+		{
+			AActor *pActor = updates[i].pActor;
+
+			// A reused network ID can put the same actor on the list twice.
+			if (( pActor->netStaleClients & clientBit ) == 0 )
+				continue;
+
+			if (( lRoom < RESYNC_COMMAND_SIZE ) && ( numSent >= MIN_RESYNCS_PER_TIC ))
+			{
+				staleActors.Push( pActor->NetID );
+				continue;
+			}
+
+			SERVERCOMMANDS_ResyncThingPosition( pActor, ulIdx );
+			pActor->netStaleClients &= ~clientBit;
+			lRoom -= RESYNC_COMMAND_SIZE;
+			numSent++;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+// Forgets what a client missed, when a new client takes the slot.
+//
+void SERVER_RELEVANCE_ResetClient( ULONG ulClient )
+{
+	if ( ulClient >= MAXPLAYERS )
+		return;
+
+	relevance_ClearStaleActors( ulClient );
+
+	// The player in this slot is a new one for the other clients as well.
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+	{
+		g_LastLowRelevancePlayerUpdate[ulClient][ulIdx] = 0;
+		g_LastLowRelevancePlayerUpdate[ulIdx][ulClient] = 0;
+	}
+}
+
+//*****************************************************************************
+//
+// Forgets what the clients missed, when a new level starts. The actors that stay (e.g. the
+// players' bodies) can have new network IDs then, so their marks are cleared directly.
+//
+void SERVER_RELEVANCE_Reset( void )
+{
+	for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		g_StaleActors[ulIdx].Clear( );
+
+	TThinkerIterator<AActor> iterator;
+	AActor *pActor;
+	while (( pActor = iterator.Next( )) != NULL )
+		pActor->netStaleClients = 0;
+
+	memset( g_LastLowRelevancePlayerUpdate, 0, sizeof( g_LastLowRelevancePlayerUpdate ));
+}
+
+//*****************************************************************************
+//
+// Fills Players with the players whose position should be sent to the client this tic,
+// most relevant first. Players of low relevance are only sent every sv_relevanceinterval tics.
+//
+void SERVER_RELEVANCE_GetPlayerUpdateOrder( ULONG ulClient, TArray<ULONG> &Players )
+{
+	static TArray<PLAYERUPDATE_s> updates;
+
+	updates.Clear( );
+	Players.Clear( );
+
+	for ( ULONG ulPlayer = 0; ulPlayer < MAXPLAYERS; ulPlayer++ )
+	{
+		if (( playeringame[ulPlayer] == false ) || players[ulPlayer].bSpectating || ( ulPlayer == ulClient ))
+			continue;
+
+		if ( sv_relevance == false )
+		{
+			Players.Push( ulPlayer );
+			continue;
+		}
+
+		PLAYERUPDATE_s update;
+		update.ulPlayer = ulPlayer;
+		update.lScore = ( players[ulPlayer].mo != NULL ) ? SERVER_RELEVANCE_GetScore( ulClient, players[ulPlayer].mo ) : RELEVANCE_HIGH * 65536;
+
+		if ( update.lScore < RELEVANCE_MEDIUM * 65536 )
+		{
+			int &lastUpdate = g_LastLowRelevancePlayerUpdate[ulClient][ulPlayer];
+			if (( gametic >= lastUpdate ) && ( gametic - lastUpdate < sv_relevanceinterval ))
+				continue;
+
+			lastUpdate = gametic;
+		}
+
+		updates.Push( update );
+	}
+
+	if ( updates.Size( ) == 0 )
+		return;
+
+	std::stable_sort( &updates[0], &updates[0] + updates.Size( ));
+
+	for ( unsigned int i = 0; i < updates.Size( ); ++i )
+		Players.Push( updates[i].ulPlayer );
+}
+
+//*****************************************************************************
+//
+static AActor *relevance_GetViewer( ULONG ulClient )
+{
+	player_t *pPlayer = &players[ulClient];
+
+	// Cameras that aren't players (e.g. from ChangeCamera) are what the client sees.
+	if (( pPlayer->camera != NULL ) && ( pPlayer->camera->player == NULL ))
+		return ( pPlayer->camera );
+
+	const ULONG ulDisplayPlayer = SERVER_GetClient( ulClient )->ulDisplayPlayer;
+	if (( ulDisplayPlayer < MAXPLAYERS ) && playeringame[ulDisplayPlayer] && ( players[ulDisplayPlayer].mo != NULL ))
+		return ( players[ulDisplayPlayer].mo );
+
+	return ( pPlayer->mo );
+}
+
+//*****************************************************************************
+//
+// Only clients that are completely in the game get position updates.
+//
+static bool relevance_IsInterested( ULONG ulClient )
+{
+	return ( SERVER_IsValidClient( ulClient ) && ( SERVER_GetClient( ulClient )->State == CLS_SPAWNED ));
+}
+
+//*****************************************************************************
+//
+static void relevance_ClearStaleActors( ULONG ulClient )
+{
+	const QWORD clientBit = static_cast<QWORD>( 1 ) << ulClient;
+
+	for ( unsigned int i = 0; i < g_StaleActors[ulClient].Size( ); ++i )
+	{
+		AActor *pActor = g_ActorNetIDList.findPointerByID( g_StaleActors[ulClient][i] );
+		if ( pActor != NULL )
+			pActor->netStaleClients &= ~clientBit;
+	}
+
+	g_StaleActors[ulClient].Clear( );
+}
@@ -0,0 +1,83 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_relevance.h
+//
+// Description: Decides how relevant actors are to each client (interest management).
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __SV_RELEVANCE_H__
+#define __SV_RELEVANCE_H__
+
+#include "doomtype.h"
+#include "tarray.h"
+
+class AActor;
+
+//*****************************************************************************
+//	DEFINES
+
+enum RELEVANCE_e
+{
+	// The client can't see the actor or it's far away. Its position updates are throttled.
+	RELEVANCE_LOW,
+
+	// The client might see the actor.
+	RELEVANCE_MEDIUM,
+
+	// The actor is close to the client, is the client's display player or is after it.
+	RELEVANCE_HIGH,
+};
+
+//*****************************************************************************
+//	PROTOTYPES
+
+RELEVANCE_e		SERVER_RELEVANCE_GetRelevance( ULONG ulClient, AActor *pActor );
+LONG			SERVER_RELEVANCE_GetScore( ULONG ulClient, AActor *pActor );
+QWORD			SERVER_RELEVANCE_GetSkippedClients( AActor *pActor, bool bMarkIrrelevant );
+void			SERVER_RELEVANCE_SendPendingUpdates( void );
+void			SERVER_RELEVANCE_GetPlayerUpdateOrder( ULONG ulClient, TArray<ULONG> &Players );
+void			SERVER_RELEVANCE_ResetClient( ULONG ulClient );
+void			SERVER_RELEVANCE_Reset( void );
+
+#endif	// __SV_RELEVANCE_H__
@@ -117,6 +117,9 @@
 #define IDC_PEAKOUTBOUNDDATATRANSFER            1214
 #define IDC_CURRENTINBOUNDDATATRANSFER          1215
 #define IDC_CURRENTOUTBOUNDDATATRANSFER         1216
+#define IDC_TICJITTER                           1217
+#define IDC_TICOVERRUNS                         1218
+#define IDC_LAUNCHERCACHE                       1219
 #define IDC_PWADS                               1222
 #define IDC_BARRELS_RESPAWN                     2027
 #define IDC_COMPATF_BOOMSCROLL                  2036
@@ -2060,6 +2060,21 @@ void SERVERCONSOLE_UpdateStatistics( void )
 		sprintf( szString, "Uptime: %lds", lData );
 
 	SetDlgItemText( g_hStatisticDlg, IDC_TOTALUPTIME, szString );
+
+	// Update how punctual the tics were during the last second.
+	sprintf( szString, "Tic jitter: %lu ms avg, %lu ms max", SERVER_STATISTIC_GetAverageTicJitter( ), SERVER_STATISTIC_GetMaxTicJitter( ));
+	SetDlgItemText( g_hStatisticDlg, IDC_TICJITTER, szString );
+
+	sprintf( szString, "Tic overruns: %lu (%llu total)", SERVER_STATISTIC_GetCurrentTicOverruns( ), static_cast<unsigned long long>( SERVER_STATISTIC_GetTotalTicOverruns( )));
+	SetDlgItemText( g_hStatisticDlg, IDC_TICOVERRUNS, szString );
+
+	// Update how many launcher queries were answered from the response cache.
+	const QWORD qwLauncherResponses = SERVER_STATISTIC_GetTotalLauncherResponses( );
+	if ( qwLauncherResponses == 0 )
+		sprintf( szString, "Cached replies: N/A" );
+	else
+		sprintf( szString, "Cached replies: %0.1f%% of %llu", 100.0 * SERVER_STATISTIC_GetTotalCachedLauncherResponses( ) / qwLauncherResponses, static_cast<unsigned long long>( qwLauncherResponses ));
+	SetDlgItemText( g_hStatisticDlg, IDC_LAUNCHERCACHE, szString );
 }
 
 //*****************************************************************************